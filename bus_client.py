@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+"""
+Bus Daemon Client
+Shares one servo bus between processes through BusDaemon
+(external/SCServo_Linux_220329/SCServo_Linux/examples/ST3215_Control/BusDaemon)
+
+Joint state is read from the daemon's shared memory (no serial round trip),
+commands go over its Unix socket. BusRobotController is a drop-in
+RobotController, so the ROS state publisher, teaching tools and
+leader-follower can run at the same time.
+"""
+
+import mmap
+import os
+import socket
+import struct
+import time
+from robot_controller import RobotController, INST_PING, INST_WRITE
+
+BUS_SHM_PATH = '/dev/shm/scservo_bus'
+BUS_SOCKET_PATH = '/tmp/scservo_bus.sock'
+
+# Must match BusShm.h
+BUS_SHM_MAGIC = 0x53554253
+BUS_SHM_VERSION = 1
+BUS_SHM_SIZE = 456
+BUS_SHM_JOINTS = 32
+_HEADER = struct.Struct('=IHHIIIIQq32s')   # Magic .. ID[32], 72 bytes
+_JOINT = struct.Struct('=hhhhBBBB')          # BusJointState, 12 bytes
+_SEQ = struct.Struct('=I')
+_SEQ_OFFSET = 16
+
+
+def daemon_running(socket_path=BUS_SOCKET_PATH, shm_path=BUS_SHM_PATH):
+    """True if a BusDaemon is publishing"""
+    return os.path.exists(socket_path) and os.path.exists(shm_path)
+
+
+class BusClient:
+    """Low-level BusDaemon connection: shared-memory state + socket commands"""
+
+    def __init__(self, socket_path=BUS_SOCKET_PATH, shm_path=BUS_SHM_PATH):
+        self.socket_path = socket_path
+        self.shm_path = shm_path
+        self.sock = None
+        self.shm = None
+        self.rx = b''
+
+    def connect(self):
+        """Map the state region and connect the command socket"""
+        with open(self.shm_path, 'rb') as f:
+            self.shm = mmap.mmap(f.fileno(), BUS_SHM_SIZE, prot=mmap.PROT_READ)
+        magic, version = struct.unpack_from('=IH', self.shm, 0)
+        if magic != BUS_SHM_MAGIC or version != BUS_SHM_VERSION:
+            self.close()
+            raise RuntimeError(f"{self.shm_path} is not a BusDaemon v{BUS_SHM_VERSION} region")
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.settimeout(1.0)
+        self.sock.connect(self.socket_path)
+
+    def close(self):
+        if self.sock:
+            self.sock.close()
+            self.sock = None
+        if self.shm:
+            self.shm.close()
+            self.shm = None
+        self.rx = b''
+
+    def read_state(self):
+        """
+        Consistent snapshot of the published joint state (seqlock read)
+
+        Returns:
+            dict with 'tick', 'time_us', 'answered', 'rate_hz' and 'joints',
+            a dict of servo ID -> {'pos', 'speed', 'load', 'current',
+            'voltage', 'temper', 'move', 'err'}
+        """
+        while True:
+            seq0 = _SEQ.unpack_from(self.shm, _SEQ_OFFSET)[0]
+            if seq0 & 1:
+                continue
+            raw = self.shm[:BUS_SHM_SIZE]
+            if _SEQ.unpack_from(self.shm, _SEQ_OFFSET)[0] == seq0:
+                break
+        (_, _, joints, rate_hz, _, _, answered, tick, time_us, ids) = _HEADER.unpack_from(raw, 0)
+        state = {}
+        for i in range(joints):
+            pos, speed, load, current, voltage, temper, move, err = \
+                _JOINT.unpack_from(raw, _HEADER.size + i * _JOINT.size)
+            state[ids[i]] = {'pos': pos, 'speed': speed, 'load': load, 'current': current,
+                             'voltage': voltage, 'temper': temper, 'move': move, 'err': err}
+        return {'tick': tick, 'time_us': time_us, 'answered': answered,
+                'rate_hz': rate_hz, 'joints': state}
+
+    def command(self, line):
+        """Send one command line, return (ok, reply)"""
+        self.sock.sendall(line.encode() + b'\n')
+        while b'\n' not in self.rx:
+            chunk = self.sock.recv(256)
+            if not chunk:
+                raise ConnectionError("BusDaemon closed the connection")
+            self.rx += chunk
+        reply, self.rx = self.rx.split(b'\n', 1)
+        reply = reply.decode()
+        return reply.startswith('ok'), reply
+
+    def ping(self, servo_id):
+        return self.command(f"ping {servo_id}")[0]
+
+    def read(self, servo_id, addr, length):
+        ok, reply = self.command(f"read {servo_id} {addr} {length}")
+        if not ok:
+            return None
+        return [int(b) for b in reply.split()[1:]]
+
+    def write(self, servo_id, addr, data):
+        return self.command(f"write {servo_id} {addr} " + " ".join(str(int(b)) for b in data))[0]
+
+    def write_pos(self, servo_id, position, speed, acc):
+        return self.command(f"pos {servo_id} {position} {speed} {acc}")[0]
+
+    def sync_write_pos(self, positions, speed, acc):
+        """One position per published joint, in published order"""
+        return self.command(f"sync {speed} {acc} " + " ".join(str(int(p)) for p in positions))[0]
+
+    def enable_torque(self, servo_id, enable):
+        return self.command(f"torque {servo_id} {1 if enable else 0}")[0]
+
+
+class BusRobotController(RobotController):
+    """
+    RobotController that goes through BusDaemon instead of the serial port
+    Positions of published servos come from shared memory; everything else
+    is forwarded to the daemon
+    """
+
+    def __init__(self, socket_path=BUS_SOCKET_PATH, shm_path=BUS_SHM_PATH):
+        super().__init__(port=socket_path)
+        self.bus = BusClient(socket_path, shm_path)
+
+    def connect(self):
+        """Connect to BusDaemon"""
+        try:
+            self.bus.connect()
+            self.connected = True
+            state = self.bus.read_state()
+            print(f"✓ Connected to BusDaemon ({state['rate_hz']} Hz)")
+
+            online = [sid for sid, _, _, _, _ in self.servo_config if self.ping(sid)]
+            print(f"✓ Found {len(online)}/{self.num_servos} servos online: {online}")
+            return True
+
+        except Exception as e:
+            print(f"✗ BusDaemon connection error: {e}")
+            self.bus.close()
+            self.connected = False
+            return False
+
+    def disconnect(self):
+        self.bus.close()
+        self.connected = False
+
+    def write_packet(self, servo_id, instruction, params):
+        """Forward raw packets the daemon understands (WRITE, PING)"""
+        if not self.connected:
+            return False
+        if instruction == INST_WRITE and params:
+            return self.bus.write(servo_id, params[0], params[1:])
+        if instruction == INST_PING:
+            return self.bus.ping(servo_id)
+        print(f"✗ Instruction {instruction} not supported through BusDaemon")
+        return False
+
+    def ping(self, servo_id):
+        joint = self.bus.read_state()['joints'].get(servo_id)
+        if joint is not None and not joint['err']:
+            return True
+        return self.bus.ping(servo_id)
+
+    def write_position(self, servo_id, position, speed=None, acc=None):
+        if speed is None:
+            speed = self.default_speed
+        if acc is None:
+            acc = self.default_acc
+        position = int(max(0, min(4095, position)))
+        speed = int(max(0, min(2400, speed)))
+        acc = int(max(0, min(254, acc)))
+        return self.bus.write_pos(servo_id, position, speed, acc)
+
+    def read_position(self, servo_id):
+        joint = self.bus.read_state()['joints'].get(servo_id)
+        if joint is not None:
+            return None if joint['err'] else joint['pos']
+        data = self.bus.read(servo_id, 56, 2)   # SMS_STS_PRESENT_POSITION_L
+        return None if data is None else data[0] | (data[1] << 8)
+
+
+def make_robot_controller(port='/dev/ttyACM0', baudrate=1000000, native=None):
+    """
+    BusRobotController if a BusDaemon is running, else a direct controller:
+    NativeRobotController when the scservo module is built and NumPy is
+    installed, RobotController (pyserial) otherwise. native=False (or
+    SCSERVO_NATIVE=0) forces pyserial, native=True warns when falling back
+    """
+    if daemon_running():
+        return BusRobotController()
+    if native is None:
+        native = None if os.environ.get('SCSERVO_NATIVE') != '0' else False
+    if native is not False:
+        try:
+            from native_controller import NativeRobotController, native_available
+        except ImportError:
+            native_available = lambda: False
+        if native_available():
+            return NativeRobotController(port, baudrate)
+        if native:
+            print("⚠ scservo module not built (or NumPy missing), using RobotController")
+    return RobotController(port, baudrate)
+
+
+if __name__ == '__main__':
+    client = BusClient()
+    client.connect()
+    print("Reading published state (Ctrl+C to stop)...")
+    try:
+        while True:
+            t0 = time.perf_counter()
+            state = client.read_state()
+            dt_us = (time.perf_counter() - t0) * 1e6
+            joints = " ".join(f"{sid}:{j['pos'] if not j['err'] else '--'}"
+                              for sid, j in state['joints'].items())
+            print(f"\rtick {state['tick']} [{dt_us:.0f}us] {joints}    ", end='', flush=True)
+            time.sleep(0.1)
+    except KeyboardInterrupt:
+        print()
+    client.close()
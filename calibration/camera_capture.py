@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""
+Camera Capture Client for CalibrateCamera
+==========================================
+
+Grabs one camera frame per calibration pose, driven by the events that
+CalibrateCamera publishes on its Unix socket
+(external/SCServo_Linux_220329/SCServo_Linux/examples/ST3215_Control/CalibrateCamera)
+
+Protocol, one text line each:
+    robot -> client:  start <points>
+                      pose <i> <t_us> <J1> .. <J6> <gripper> <frame_file>
+                      end
+    client -> robot:  captured <i> <frame_t_us>
+
+Angles are the joint positions read back at settle time (degrees), times are
+CLOCK_MONOTONIC microseconds - the same clock as time.monotonic() here, so
+pose and frame times can be compared directly.
+
+The arm holds still only until "captured" is sent. Decoding and saving the
+frame happen while it moves on to the next pose (writer thread), so the run
+takes roughly the sum of the moves.
+
+Usage:
+    python3 camera_capture.py [--camera 0] [--out-dir calibration_frames]
+                              [--json calibration_capture.json] [--no-camera]
+"""
+
+import argparse
+import json
+import os
+import queue
+import socket
+import threading
+import time
+
+CALIB_SOCKET_PATH = '/tmp/scservo_calib.sock'   # Must match CalibrateCamera.cpp
+
+
+def monotonic_us():
+    return int(time.monotonic() * 1e6)
+
+
+def connect(path, timeout_s=60.0):
+    """Connect to CalibrateCamera, waiting for it to open the socket"""
+    deadline = time.monotonic() + timeout_s
+    while True:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            sock.connect(path)
+            return sock
+        except (FileNotFoundError, ConnectionRefusedError):
+            sock.close()
+            if time.monotonic() > deadline:
+                raise
+            time.sleep(0.2)
+
+
+def lines(sock):
+    """Yield text lines from the socket until it closes"""
+    rx = b''
+    while True:
+        while b'\n' in rx:
+            line, rx = rx.split(b'\n', 1)
+            yield line.decode()
+        chunk = sock.recv(4096)
+        if not chunk:
+            return
+        rx += chunk
+
+
+class Camera:
+    """Fresh frames on request; buffered frames from during the move are skipped"""
+
+    def __init__(self, index):
+        import cv2
+        self.cv2 = cv2
+        self.cap = cv2.VideoCapture(index)
+        if not self.cap.isOpened():
+            raise RuntimeError(f"Cannot open camera {index}")
+        self.cap.set(cv2.CAP_PROP_BUFFERSIZE, 1)
+
+    def grab(self, after_us):
+        """Grab the first frame exposed after after_us, return its time"""
+        # The driver may hold one frame taken while the arm was still moving
+        self.cap.grab()
+        while True:
+            start = monotonic_us()
+            if not self.cap.grab():
+                raise RuntimeError("Camera grab failed")
+            if start >= after_us:
+                return monotonic_us()
+
+    def retrieve(self):
+        ok, frame = self.cap.retrieve()
+        return frame if ok else None
+
+    def save(self, path, frame):
+        self.cv2.imwrite(path, frame)
+
+    def close(self):
+        self.cap.release()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Capture client for CalibrateCamera')
+    parser.add_argument('--socket', default=CALIB_SOCKET_PATH)
+    parser.add_argument('--camera', type=int, default=0)
+    parser.add_argument('--out-dir', default='calibration_frames')
+    parser.add_argument('--json', default='calibration_capture.json')
+    parser.add_argument('--no-camera', action='store_true', help='acknowledge poses without a camera (dry run)')
+    args = parser.parse_args()
+
+    camera = None if args.no_camera else Camera(args.camera)
+    os.makedirs(args.out_dir, exist_ok=True)
+
+    # Frames are written by a separate thread while the arm moves on
+    pending = queue.Queue()
+
+    def writer():
+        while True:
+            item = pending.get()
+            if item is None:
+                return
+            path, frame = item
+            camera.save(path, frame)
+
+    writer_thread = threading.Thread(target=writer, daemon=True)
+    writer_thread.start()
+
+    print(f"Waiting for CalibrateCamera on {args.socket}...")
+    sock = connect(args.socket)
+    print("✓ Connected")
+
+    points = []
+    t_start = None
+    for line in lines(sock):
+        fields = line.split()
+        if not fields:
+            continue
+        if fields[0] == 'start':
+            print(f"Calibration run with {fields[1]} points")
+            t_start = time.monotonic()
+        elif fields[0] == 'pose' and len(fields) >= 11:
+            index = int(fields[1])
+            pose_us = int(fields[2])
+            joints = [float(v) for v in fields[3:10]]
+            frame_file = os.path.join(args.out_dir, fields[10])
+
+            frame_us = camera.grab(pose_us) if camera else monotonic_us()
+            sock.sendall(f"captured {index} {frame_us}\n".encode())
+
+            # The arm is moving again from here on
+            if camera:
+                frame = camera.retrieve()
+                if frame is not None:
+                    pending.put((frame_file, frame))
+            points.append({'index': index, 'pose_time_us': pose_us, 'frame_time_us': frame_us,
+                           'joint_angles_deg': joints, 'frame_file': frame_file if camera else None})
+            print(f"  [{index}] captured {(frame_us - pose_us) / 1000.0:.1f} ms after the reading")
+        elif fields[0] == 'end':
+            break
+
+    pending.put(None)
+    writer_thread.join()
+    sock.close()
+    if camera:
+        camera.close()
+
+    with open(args.json, 'w') as f:
+        json.dump({'clock': 'CLOCK_MONOTONIC', 'points': points}, f, indent=2)
+    elapsed = time.monotonic() - t_start if t_start else 0
+    print(f"✓ {len(points)} frames in {elapsed:.1f} s, saved to {args.json}")
+
+
+if __name__ == '__main__':
+    main()
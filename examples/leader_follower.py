@@ -9,7 +9,7 @@ Two robots on same bus:
 
 import time
 import json
-from robot_controller import RobotController
+from bus_client import make_robot_controller
 from servo_limits_config import degrees_to_steps, steps_to_degrees
 
 # Servo IDs for each robot
@@ -17,16 +17,20 @@ from servo_limits_config import degrees_to_steps, steps_to_degrees
 LEADER_SERVO_IDS = [1, 2, 3, 4, 5, 6]       # Leader robot servo IDs (6 joints, no gripper)
 FOLLOWER_SERVO_IDS = [8, 9, 10, 11, 12, 13, 14]  # Follower robot servo IDs (7 joints with gripper)
 
+# Follower - leader offsets in degrees, shared with the native LeaderFollower example
+OFFSETS_FILE = 'leader_follower_offsets.json'
+
 class LeaderFollowerController:
     def __init__(self):
-        self.robot = RobotController()
+        self.robot = make_robot_controller()  # shares BusDaemon if running
         self.leader_positions = [0] * 6  # Leader has 6 joints (no gripper)
         self.follower_positions = [0] * 7  # Follower has 7 joints (with gripper)
         self.running = False
         self.gripper_position = 0.0  # Fixed gripper position for follower
         
-        # Load home positions
+        # Load home positions and calibrated offsets
         self.load_home_positions()
+        self.offsets = self.load_offsets()
     
     def load_home_positions(self):
         """Load saved home positions for both robots"""
@@ -59,6 +63,21 @@ class LeaderFollowerController:
             self.leader_home = [0] * 6
             self.follower_home = [0] * 7
     
+    def load_offsets(self):
+        """Load follower - leader offsets (degrees, 6 joints), zeros if not calibrated"""
+        try:
+            with open(OFFSETS_FILE, 'r') as f:
+                offsets = json.load(f)['offsets_deg']
+            if len(offsets) != len(LEADER_SERVO_IDS):
+                raise ValueError(f"expected {len(LEADER_SERVO_IDS)} offsets, got {len(offsets)}")
+            print(f"✓ Loaded offsets: {[f'{o:.1f}°' for o in offsets]}")
+            return [float(o) for o in offsets]
+        except FileNotFoundError:
+            return [0.0] * len(LEADER_SERVO_IDS)
+        except Exception as e:
+            print(f"⚠ Warning: Could not load offsets: {e}")
+            return [0.0] * len(LEADER_SERVO_IDS)
+    
     def connect(self):
         """Connect to serial bus"""
         if not self.robot.connect():
@@ -139,10 +158,10 @@ class LeaderFollowerController:
         return positions
     
     def write_follower_positions(self, positions, speed=1500):
-        """Write positions to follower robot"""
+        """Write leader positions (degrees) to follower robot, offsets applied"""
         for i, servo_id in enumerate(FOLLOWER_SERVO_IDS):
             if i < len(positions):
-                steps = degrees_to_steps(positions[i])
+                steps = degrees_to_steps(positions[i] + self.offsets[i])
                 self.robot.write_position(servo_id, steps, speed=speed, acc=50)
     
     def move_to_home(self):
@@ -259,18 +278,21 @@ class LeaderFollowerController:
             if pos_steps is not None:
                 follower_pos.append(steps_to_degrees(pos_steps))
         
-        if leader_pos and len(follower_pos) == 7:
+        # Leader has no gripper: offsets cover the 6 arm joints
+        if leader_pos and len(follower_pos) >= len(leader_pos):
             print("\nMeasured positions:")
             print(f"{'Joint':<10} {'Leader':<12} {'Follower':<12} {'Offset':<12}")
             print("-" * 50)
             offsets = []
-            for i in range(7):
-                offset = follower_pos[i] - leader_pos[i]
+            for i in range(len(leader_pos)):
+                offset = (follower_pos[i] - leader_pos[i] + 180.0) % 360.0 - 180.0
                 offsets.append(offset)
                 print(f"Joint {i+1:<3} {leader_pos[i]:>10.1f}° {follower_pos[i]:>10.1f}° {offset:>10.1f}°")
             
-            print(f"\nOffset array: {offsets}")
-            print("\nYou can apply this offset in the code if needed.")
+            self.offsets = offsets
+            with open(OFFSETS_FILE, 'w') as f:
+                json.dump({'offsets_deg': offsets}, f, indent=2)
+            print(f"\n✓ Offsets saved to {OFFSETS_FILE} (also used by the native LeaderFollower)")
         else:
             print("❌ Failed to read positions")
     
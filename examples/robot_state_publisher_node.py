@@ -9,7 +9,7 @@ from rclpy.node import Node
 from sensor_msgs.msg import JointState
 from std_msgs.msg import Header
 import time
-from robot_controller import RobotController
+from bus_client import make_robot_controller
 
 class RobotStatePublisher(Node):
     def __init__(self):
@@ -20,7 +20,7 @@ class RobotStatePublisher(Node):
         
         # Connect to robot
         self.get_logger().info("Connecting to robot...")
-        self.robot = RobotController()
+        self.robot = make_robot_controller()  # shares BusDaemon if running
         if not self.robot.connect():
             self.get_logger().error("Failed to connect to robot!")
             return
@@ -0,0 +1,226 @@
+/*
+ * ArmBus.cpp
+ * One arm split across several serial buses, driven in parallel
+ * Date: 2026.10.14
+ */
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ArmBus.h"
+
+static long long armBusUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
+
+ArmBus::ArmBus()
+{
+	Priority = 0;
+	LowLatency = false;
+	busN = 0;
+	jointN = 0;
+	cmdPos = NULL;
+	cmdSpeed = NULL;
+	cmdAcc = NULL;
+	outState = NULL;
+	torque = 0;
+	op = OpSnapshot;
+	gen = 0;
+	pending = 0;
+	running = false;
+	quit = false;
+}
+
+ArmBus::~ArmBus()
+{
+	End();
+}
+
+int ArmBus::AddBus(const char *Port, int Baud, const u8 ID[], u8 IDN)
+{
+	if(running || busN>=ARM_BUS_MAX || IDN==0 || IDN>SMS_STS_SYNC_MAX || jointN+IDN>ARM_BUS_JOINTS_MAX){
+		return -1;
+	}
+	Lane *L = new Lane;
+	L->Bus.LowLatency = LowLatency;
+	if(!L->Bus.begin(Baud, Port)){
+		delete L;
+		return -1;
+	}
+	memcpy(L->ID, ID, IDN);
+	L->IDN = IDN;
+	L->Answered = 0;
+	L->WorkUs = 0;
+	for(u8 i=0; i<IDN; i++){
+		L->Joint[i] = jointN;
+		jointID[jointN] = ID[i];
+		jointBus[jointN] = busN;
+		jointN++;
+	}
+	lane[busN] = L;
+	return busN++;
+}
+
+bool ArmBus::Start()
+{
+	if(running){
+		return false;
+	}
+	quit = false;
+	running = true;
+	for(int i=1; i<busN; i++){
+		lane[i]->Worker = std::thread(&ArmBus::Work, this, i, gen);
+	}
+	return true;
+}
+
+void ArmBus::Stop()
+{
+	if(!running){
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l(lock);
+		quit = true;
+	}
+	kick.notify_all();
+	for(int i=1; i<busN; i++){
+		lane[i]->Worker.join();
+	}
+	running = false;
+}
+
+void ArmBus::End()
+{
+	Stop();
+	for(int i=0; i<busN; i++){
+		lane[i]->Bus.end();
+		delete lane[i];
+	}
+	busN = 0;
+	jointN = 0;
+}
+
+void ArmBus::Work(int Index, unsigned long Seen)
+{
+	if(Priority>0){
+		struct sched_param sp;
+		memset(&sp, 0, sizeof(sp));
+		sp.sched_priority = Priority;
+		int e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+		if(e){
+			fprintf(stderr, "ArmBus: SCHED_FIFO %d: %s\n", Priority, strerror(e));
+		}
+	}
+	Lane &L = *lane[Index];
+	unsigned long seen = Seen;
+	std::unique_lock<std::mutex> l(lock);
+	while(1){
+		kick.wait(l, [&]{ return quit || gen!=seen; });
+		if(quit){
+			return;
+		}
+		seen = gen;
+		Op o = op;
+		l.unlock();
+		Execute(L, o);
+		l.lock();
+		if(--pending==0){
+			done.notify_one();
+		}
+	}
+}
+
+//bus 0 runs on the calling thread while the workers run the others
+int ArmBus::Dispatch(Op o)
+{
+	if(!busN){
+		return 0;
+	}
+	if(!running || busN==1){
+		for(int i=0; i<busN; i++){
+			Execute(*lane[i], o);
+		}
+	}else{
+		{
+			std::lock_guard<std::mutex> l(lock);
+			op = o;
+			pending = busN-1;
+			gen++;
+		}
+		kick.notify_all();
+		Execute(*lane[0], o);
+		std::unique_lock<std::mutex> l(lock);
+		done.wait(l, [&]{ return pending==0; });
+	}
+	int n = 0;
+	for(int i=0; i<busN; i++){
+		n += lane[i]->Answered;
+	}
+	return n;
+}
+
+void ArmBus::Execute(Lane &L, Op o)
+{
+	long long t0 = armBusUs();
+	L.Answered = 0;
+	if(o==OpWrite || o==OpExchange){
+		s16 P[SMS_STS_SYNC_MAX];
+		u16 V[SMS_STS_SYNC_MAX];
+		u8 A[SMS_STS_SYNC_MAX];
+		for(u8 i=0; i<L.IDN; i++){
+			P[i] = cmdPos[L.Joint[i]];
+			V[i] = cmdSpeed ? cmdSpeed[L.Joint[i]] : 0;
+			A[i] = cmdAcc ? cmdAcc[L.Joint[i]] : 0;
+		}
+		L.Bus.SyncWritePosEx(L.ID, L.IDN, P, V, A);
+	}
+	if(o==OpSnapshot || o==OpExchange){
+		ServoState S[SMS_STS_SYNC_MAX];
+		int n = L.Bus.SyncFeedBack(L.ID, L.IDN, S);
+		for(u8 i=0; i<L.IDN; i++){
+			outState[L.Joint[i]] = S[i];
+		}
+		L.Answered = n>0 ? n : 0;
+	}
+	if(o==OpTorque){
+		for(u8 i=0; i<L.IDN; i++){
+			L.Bus.queueWrite(L.ID[i], SMS_STS_TORQUE_ENABLE, &torque, 1);
+		}
+		L.Answered = L.Bus.runQueue();
+	}
+	L.WorkUs = (long)(armBusUs()-t0);
+}
+
+int ArmBus::Snapshot(ServoState State[])
+{
+	outState = State;
+	return Dispatch(OpSnapshot);
+}
+
+void ArmBus::Write(const s16 Position[], const u16 Speed[], const u8 ACC[])
+{
+	cmdPos = Position;
+	cmdSpeed = Speed;
+	cmdAcc = ACC;
+	Dispatch(OpWrite);
+}
+
+int ArmBus::Exchange(const s16 Position[], const u16 Speed[], const u8 ACC[], ServoState State[])
+{
+	cmdPos = Position;
+	cmdSpeed = Speed;
+	cmdAcc = ACC;
+	outState = State;
+	return Dispatch(OpExchange);
+}
+
+int ArmBus::EnableTorque(u8 Enable)
+{
+	torque = Enable;
+	return Dispatch(OpTorque);
+}
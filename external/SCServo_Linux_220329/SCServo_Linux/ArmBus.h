@@ -0,0 +1,91 @@
+/*
+ * ArmBus.h
+ * One arm split across several serial buses, driven in parallel
+ *
+ * Each bus (its own SMS_STS on its own port) carries a slice of the arm's
+ * joints. Joints are numbered in the order they were added, across buses,
+ * and every call takes arrays in that order. Snapshot(), Write(),
+ * Exchange() and EnableTorque() run on all buses at once, one worker thread
+ * per extra bus (the calling thread drives bus 0), and return when every
+ * bus has finished: a per-tick barrier. The time per call is that of the
+ * slowest bus instead of the sum.
+ *
+ * Without Start() the same calls drive the buses one after another on the
+ * calling thread. Call from one thread, e.g. a ControlLoop task.
+ * Date: 2026.10.14
+ */
+
+#ifndef _ARMBUS_H
+#define _ARMBUS_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "SMS_STS.h"
+
+#define ARM_BUS_MAX 4//serial buses
+#define ARM_BUS_JOINTS_MAX 32//joints across all buses
+
+class ArmBus
+{
+public:
+	ArmBus();
+	~ArmBus();
+	int AddBus(const char *Port, int Baud, const u8 ID[], u8 IDN);//open a bus for these joints, returns bus index or -1
+	bool Start();//spawn the worker threads, false if already running
+	void Stop();//join the workers; the buses stay open
+	void End();//Stop() and close every bus
+	int Snapshot(ServoState State[]);//sync read feedback of every joint, returns joints answered
+	void Write(const s16 Position[], const u16 Speed[], const u8 ACC[]);//sync write every joint
+	int Exchange(const s16 Position[], const u16 Speed[], const u8 ACC[], ServoState State[]);//Write() then Snapshot() in one pass per bus
+	int EnableTorque(u8 Enable);//returns joints acknowledged
+	u8 Joints() const { return jointN; }
+	const u8 *IDs() const { return jointID; }//servo ID per joint (the same ID may appear on two buses)
+	int BusOf(u8 Joint) const { return jointBus[Joint]; }
+	int Buses() const { return busN; }
+	SMS_STS &Bus(int Index) { return lane[Index]->Bus; }
+	long LastUs(int Index) const { return lane[Index]->WorkUs; }//duration of the last call on this bus
+public:
+	int Priority;//SCHED_FIFO priority (1-99) for the worker threads, 0 keeps the default scheduler
+	bool LowLatency;//set SMS_STS::LowLatency on buses added after this
+private:
+	enum Op{
+		OpSnapshot,
+		OpWrite,
+		OpExchange,
+		OpTorque
+	};
+	struct Lane{
+		SMS_STS Bus;
+		u8 ID[SMS_STS_SYNC_MAX];
+		u8 Joint[SMS_STS_SYNC_MAX];//joint index per servo on this bus
+		u8 IDN;
+		int Answered;
+		long WorkUs;
+		std::thread Worker;
+	};
+	int Dispatch(Op op);//run op on every bus, wait for all, returns joints answered
+	void Execute(Lane &L, Op op);
+	void Work(int Index, unsigned long Seen);//worker for bus Index, Seen = call counter at Start()
+	Lane *lane[ARM_BUS_MAX];
+	int busN;
+	u8 jointN;
+	u8 jointID[ARM_BUS_JOINTS_MAX];
+	u8 jointBus[ARM_BUS_JOINTS_MAX];
+	//current call, shared with the workers
+	const s16 *cmdPos;
+	const u16 *cmdSpeed;
+	const u8 *cmdAcc;
+	ServoState *outState;
+	u8 torque;
+	Op op;
+	std::mutex lock;
+	std::condition_variable kick;//new call for the workers
+	std::condition_variable done;//last worker finished
+	unsigned long gen;//call counter
+	int pending;//workers still busy with the current call
+	bool running;
+	bool quit;
+};
+
+#endif
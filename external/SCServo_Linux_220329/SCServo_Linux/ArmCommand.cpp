@@ -0,0 +1,196 @@
+/*
+ * ArmCommand.cpp
+ * Coordinated multi-joint motion for ST3215 arms
+ * Date: 2026.10.14
+ */
+
+#include <math.h>
+#include <string.h>
+#include "ArmCommand.h"
+#include "SafetyModel.h"
+
+ArmCommand::ArmCommand(SMS_STS &Bus, const u8 ID[], u8 IDN):Bus(Bus)
+{
+	if(IDN>SMS_STS_SYNC_MAX){
+		IDN = SMS_STS_SYNC_MAX;
+	}
+	this->IDN = IDN;
+	memcpy(this->ID, ID, IDN);
+	memset(goalPos, 0, sizeof(goalPos));
+	GoalValid = false;
+	SpeedLimit = 2400;
+	Deadband = 0;
+	Sent = 0;
+	Skipped = 0;
+	Safety = NULL;
+	Resync();
+}
+
+void ArmCommand::Resync()
+{
+	memset(sentValid, 0, sizeof(sentValid));
+	memset(torque, ARM_TORQUE_UNKNOWN, sizeof(torque));
+}
+
+int ArmCommand::ReadPositions()
+{
+	ServoState State[SMS_STS_SYNC_MAX];
+	int n = Bus.SyncFeedBack(ID, IDN, State);
+	if(n!=IDN){
+		return n;
+	}
+	for(u8 i=0; i<IDN; i++){
+		goalPos[i] = State[i].Pos;
+	}
+	GoalValid = true;
+	memset(sentValid, 0, sizeof(sentValid));//someone may have moved the joints: re-send everything
+	if(Safety){
+		Safety->Reset(ID, IDN, goalPos);
+	}
+	return n;
+}
+
+void ArmCommand::SetPositions(const s16 Position[])
+{
+	memcpy(goalPos, Position, IDN*sizeof(s16));
+	GoalValid = true;
+	if(Safety){
+		Safety->Reset(ID, IDN, goalPos);
+	}
+}
+
+int ArmCommand::WaitMotionComplete(u16 Tolerance, u32 TimeOut)
+{
+	return Bus.WaitMotionComplete(ID, IDN, GoalValid ? goalPos : NULL, Tolerance, TimeOut);
+}
+
+//a torque change lets the servo drift or re-latch its goal: the joint is
+//re-sent on the next write
+int ArmCommand::EnableTorque(u8 Enable)
+{
+	int n = 0;
+	for(u8 i=0; i<IDN; i++){
+		if(torque[i]==Enable){
+			n++;
+			continue;
+		}
+		sentValid[i] = false;
+		Bus.queueWrite(ID[i], SMS_STS_TORQUE_ENABLE, &Enable, 1, [this, i, Enable](const SCSReply &Reply){
+			torque[i] = Reply.Status ? Enable : ARM_TORQUE_UNKNOWN;
+		});
+	}
+	if(Bus.queueSize()){
+		n += Bus.runQueue();
+	}
+	return n;
+}
+
+int ArmCommand::Travel(u8 i, const s16 Position[])
+{
+	int d = Position[i]-goalPos[i];
+	return d<0 ? -d : d;
+}
+
+//speed and acceleration are both scaled by travel/maxTravel: a trapezoid
+//of length k*D at k*V, k*A takes exactly as long as D at V, A
+void ArmCommand::MoveTo(const s16 Position[], u16 Speed, u8 ACC)
+{
+	if(!GoalValid){
+		ReadPositions();
+	}
+	if(Speed>SpeedLimit){
+		Speed = SpeedLimit;
+	}
+	int maxTravel = 0;
+	if(GoalValid){
+		for(u8 i=0; i<IDN; i++){
+			int d = Travel(i, Position);
+			if(d>maxTravel){
+				maxTravel = d;
+			}
+		}
+	}
+	for(u8 i=0; i<IDN; i++){
+		if(maxTravel==0){
+			goalSpeed[i] = Speed;
+			goalAcc[i] = ACC;
+			continue;
+		}
+		int d = Travel(i, Position);
+		int V = (Speed*d+maxTravel-1)/maxTravel;
+		int A = (ACC*d+maxTravel-1)/maxTravel;
+		//0 means "maximum" to the servo, never let scaling round down to it
+		goalSpeed[i] = V ? V : 1;
+		goalAcc[i] = (ACC && !A) ? 1 : A;
+	}
+	send(Position, goalSpeed, goalAcc, false);
+}
+
+//per joint: trapezoid T = d/v + v/a solved for v, or plain d/T without ramp
+void ArmCommand::MoveTimed(const s16 Position[], u32 TimeMs, u8 ACC)
+{
+	if(!GoalValid){
+		ReadPositions();
+	}
+	if(TimeMs==0){
+		TimeMs = 1;
+	}
+	double T = TimeMs/1000.0;
+	for(u8 i=0; i<IDN; i++){
+		double d = GoalValid ? Travel(i, Position) : 0;
+		double V;
+		if(ACC){
+			double a = ACC*100.0;
+			double disc = a*a*T*T-4.0*a*d;
+			V = disc<0 ? a*T/2.0 : (a*T-sqrt(disc))/2.0;
+		}else{
+			V = d/T;
+		}
+		if(V>SpeedLimit){
+			V = SpeedLimit;
+		}
+		goalSpeed[i] = V<1.0 ? 1 : (u16)(V+0.5);
+		goalAcc[i] = ACC;
+	}
+	send(Position, goalSpeed, goalAcc, false);
+}
+
+int ArmCommand::Write(const s16 Position[], const u16 Speed[], const u8 ACC[])
+{
+	return send(Position, Speed, ACC, true);
+}
+
+int ArmCommand::send(const s16 Position[], const u16 Speed[], const u8 ACC[], bool Stream)
+{
+	if(Safety && Safety->Check(ID, IDN, Position, Speed, Stream)!=SAFETY_OK){
+		return -1;
+	}
+	u8 cID[SMS_STS_SYNC_MAX];
+	s16 cPos[SMS_STS_SYNC_MAX];
+	u16 cSpeed[SMS_STS_SYNC_MAX];
+	u8 cAcc[SMS_STS_SYNC_MAX];
+	u8 N = 0;
+	for(u8 i=0; i<IDN; i++){
+		u16 V = Speed ? Speed[i] : 0;
+		u8 A = ACC ? ACC[i] : 0;
+		if(sentValid[i] && V==sentSpeed[i] && A==sentAcc[i]){
+			int d = Position[i]-sentPos[i];
+			if((d<0 ? -d : d)<=Deadband){
+				continue;
+			}
+		}
+		sentValid[i] = true;
+		sentPos[i] = cPos[N] = Position[i];
+		sentSpeed[i] = cSpeed[N] = V;
+		sentAcc[i] = cAcc[N] = A;
+		cID[N++] = ID[i];
+	}
+	if(N){
+		Bus.SyncWritePosEx(cID, N, cPos, cSpeed, cAcc);
+	}
+	Sent += N;
+	Skipped += IDN-N;
+	memcpy(goalPos, Position, IDN*sizeof(s16));
+	GoalValid = true;
+	return N;
+}
@@ -0,0 +1,68 @@
+/*
+ * ArmCommand.h
+ * Coordinated multi-joint motion for ST3215 arms
+ * All joints are packed into one SyncWritePosEx broadcast per update
+ *
+ * The last position/speed/acc sent to each joint and its torque state are
+ * mirrored: a joint whose position moved by no more than Deadband steps
+ * and whose speed and acc are unchanged is left out of the sync write, a
+ * write with no changed joint is not sent at all, and EnableTorque() only
+ * addresses joints not already in that state. ReadPositions() drops the
+ * position mirror; anything else that talks to the servos behind the
+ * mirror's back must call Resync().
+ *
+ * With a SafetyModel attached every setpoint is checked before anything
+ * is sent: Write() calls are a stream (one per control period), MoveTo()
+ * and MoveTimed() are goals. A refused setpoint is not sent, the goal is
+ * left where it was and Write() returns -1 (Safety->Fault says why).
+ * Date: 2026.10.14
+ */
+
+#ifndef _ARMCOMMAND_H
+#define _ARMCOMMAND_H
+
+#include "SMS_STS.h"
+
+class SafetyModel;
+
+#define ARM_TORQUE_UNKNOWN 0xff
+
+class ArmCommand
+{
+public:
+	ArmCommand(SMS_STS &Bus, const u8 ID[], u8 IDN);
+	int ReadPositions();//sync read present positions as motion start point, returns joints answered
+	void SetPositions(const s16 Position[]);//set motion start point without touching the bus
+	void MoveTo(const s16 Position[], u16 Speed, u8 ACC = 0);//joint with longest travel runs at Speed/ACC, others scaled to arrive together
+	void MoveTimed(const s16 Position[], u32 TimeMs, u8 ACC = 0);//every joint arrives after TimeMs
+	int Write(const s16 Position[], const u16 Speed[], const u8 ACC[]);//raw per-joint sync write of the changed joints, returns joints sent, -1 if refused by Safety; Speed/ACC may be NULL (0)
+	void Resync();//forget the mirror: the next write and EnableTorque() address every joint
+	int WaitMotionComplete(u16 Tolerance, u32 TimeOut);//until every joint stopped within Tolerance steps of its goal, returns ms waited, -1 on timeout or at once while a joint is tripped by the circuit breaker
+	int EnableTorque(u8 Enable);//torque on/off for every joint not already so in one queued bus pass, returns joints in that state
+	u8 Joints() const { return IDN; }
+	const u8 *IDs() const { return ID; }
+	const s16 *Goal() const { return goalPos; }
+public:
+	u16 SpeedLimit;//upper bound for computed speeds (steps/s)
+	u16 Deadband;//steps a goal may move without being re-sent (0: only exact repeats are skipped); the servo may stop this far short
+	u32 Sent;//joint entries written since construction
+	u32 Skipped;//joint entries left out by the mirror
+	SafetyModel *Safety;//setpoint validation, NULL (default) = unchecked
+private:
+	int Travel(u8 i, const s16 Position[]);
+	int send(const s16 Position[], const u16 Speed[], const u8 ACC[], bool Stream);
+	SMS_STS &Bus;
+	u8 ID[SMS_STS_SYNC_MAX];
+	u8 IDN;
+	s16 goalPos[SMS_STS_SYNC_MAX];//last commanded (or read) position per joint
+	bool GoalValid;
+	u16 goalSpeed[SMS_STS_SYNC_MAX];
+	u8 goalAcc[SMS_STS_SYNC_MAX];
+	bool sentValid[SMS_STS_SYNC_MAX];//mirror of what the servo was last told
+	s16 sentPos[SMS_STS_SYNC_MAX];
+	u16 sentSpeed[SMS_STS_SYNC_MAX];
+	u8 sentAcc[SMS_STS_SYNC_MAX];
+	u8 torque[SMS_STS_SYNC_MAX];//0, 1 or ARM_TORQUE_UNKNOWN
+};
+
+#endif
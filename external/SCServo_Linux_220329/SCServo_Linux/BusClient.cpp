@@ -0,0 +1,211 @@
+/*
+ * BusClient.cpp
+ * Client side of BusDaemon
+ * Date: 2026.10.14
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "BusClient.h"
+
+BusClient::BusClient()
+{
+	fd = -1;
+	rxLen = 0;
+}
+
+BusClient::~BusClient()
+{
+	Close();
+}
+
+bool BusClient::Connect(const char *SocketPath, const char *ShmName)
+{
+	Close();
+	if(!State.Open(ShmName)){
+		return false;
+	}
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, SocketPath, sizeof(addr.sun_path)-1);
+	fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+	if(fd==-1){
+		perror("socket:");
+		State.Close();
+		return false;
+	}
+	if(connect(fd, (sockaddr*)&addr, sizeof(addr))==-1){
+		close(fd);
+		fd = -1;
+		State.Close();
+		return false;
+	}
+	return true;
+}
+
+void BusClient::Close()
+{
+	if(fd!=-1){
+		close(fd);
+		fd = -1;
+	}
+	rxLen = 0;
+	State.Close();
+}
+
+bool BusClient::Command(const char *Line, char *Reply, int Len)
+{
+	if(fd==-1){
+		return false;
+	}
+	char txBuf[BUS_LINE_MAX];
+	int n = snprintf(txBuf, sizeof(txBuf), "%s\n", Line);
+	if(n<=0 || n>=(int)sizeof(txBuf)){
+		return false;
+	}
+	for(int sent=0; sent<n; ){
+		int w = send(fd, txBuf+sent, n-sent, MSG_NOSIGNAL);
+		if(w<0 && errno==EINTR){
+			continue;
+		}
+		if(w<=0){
+			Close();
+			return false;
+		}
+		sent += w;
+	}
+	//replies come back in order, one line each
+	for(;;){
+		char *eol = (char*)memchr(rxBuf, '\n', rxLen);
+		if(eol){
+			*eol = 0;
+			bool ok = strncmp(rxBuf, "ok", 2)==0;
+			if(Reply && Len>0){
+				strncpy(Reply, rxBuf, Len-1);
+				Reply[Len-1] = 0;
+			}
+			rxLen -= eol+1-rxBuf;
+			memmove(rxBuf, eol+1, rxLen);
+			return ok;
+		}
+		if(rxLen==sizeof(rxBuf)){
+			Close();//no newline within a full line: not a BusDaemon
+			return false;
+		}
+		pollfd pfd = {fd, POLLIN, 0};
+		int r = poll(&pfd, 1, BUS_REPLY_TIMEOUT_MS);
+		if(r<0 && errno==EINTR){
+			continue;
+		}
+		if(r<=0){
+			Close();//lost sync with the reply stream
+			return false;
+		}
+		int got = recv(fd, rxBuf+rxLen, sizeof(rxBuf)-rxLen, 0);
+		if(got<0 && errno==EINTR){
+			continue;
+		}
+		if(got<=0){
+			Close();
+			return false;
+		}
+		rxLen += got;
+	}
+}
+
+bool BusClient::Ping(u8 ID)
+{
+	char line[32];
+	snprintf(line, sizeof(line), "ping %d", ID);
+	return Command(line);
+}
+
+int BusClient::Read(u8 ID, u8 MemAddr, u8 *nData, u8 nLen)
+{
+	if(nLen>BUS_READ_MAX){
+		return -1;
+	}
+	char line[32];
+	char reply[BUS_LINE_MAX];
+	snprintf(line, sizeof(line), "read %d %d %d", ID, MemAddr, nLen);
+	if(!Command(line, reply, sizeof(reply))){
+		return -1;
+	}
+	int n = 0;
+	char *p = reply+2;
+	while(n<nLen){
+		char *end;
+		long b = strtol(p, &end, 10);
+		if(end==p){
+			break;
+		}
+		nData[n++] = (u8)b;
+		p = end;
+	}
+	return n;
+}
+
+bool BusClient::Write(u8 ID, u8 MemAddr, const u8 *nDat, u8 nLen)
+{
+	char line[BUS_LINE_MAX];
+	int n = snprintf(line, sizeof(line), "write %d %d", ID, MemAddr);
+	for(u8 i=0; i<nLen; i++){
+		if(n+5>=(int)sizeof(line)){
+			return false;
+		}
+		n += snprintf(line+n, sizeof(line)-n, " %d", nDat[i]);
+	}
+	return Command(line);
+}
+
+bool BusClient::WritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC)
+{
+	char line[64];
+	snprintf(line, sizeof(line), "pos %d %d %d %d", ID, Position, Speed, ACC);
+	return Command(line);
+}
+
+bool BusClient::SyncWritePosEx(const s16 Position[], u16 Speed, u8 ACC)
+{
+	const BusShmRegion *R = State.Region();
+	if(!R){
+		return false;
+	}
+	char line[BUS_LINE_MAX];
+	int n = snprintf(line, sizeof(line), "sync %d %d", Speed, ACC);
+	for(u16 i=0; i<R->Joints; i++){
+		if(n+8>=(int)sizeof(line)){
+			return false;
+		}
+		n += snprintf(line+n, sizeof(line)-n, " %d", Position[i]);
+	}
+	return Command(line);
+}
+
+bool BusClient::EnableTorque(u8 ID, u8 Enable)
+{
+	char line[32];
+	snprintf(line, sizeof(line), "torque %d %d", ID, Enable ? 1 : 0);
+	return Command(line);
+}
+
+int BusClient::ReadPos(u8 ID) const
+{
+	BusShmRegion S;
+	if(!State.Read(S)){
+		return -1;
+	}
+	for(u16 i=0; i<S.Joints; i++){
+		if(S.ID[i]==ID){
+			return S.State[i].Err ? -1 : S.State[i].Pos;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,57 @@
+/*
+ * BusClient.h
+ * Client side of BusDaemon: joint state from shared memory, commands over
+ * a Unix stream socket
+ *
+ * Commands are single text lines, each answered by one line starting with
+ * "ok" or "err". They run on the daemon's loop thread between two sync reads:
+ *   ping <id>
+ *   read <id> <addr> <len>               reply "ok <byte> ..."
+ *   write <id> <addr> <byte> [byte ...]
+ *   pos <id> <position> <speed> <acc>
+ *   sync <speed> <acc> <p1> .. <pN>      one position per published joint
+ *   torque <id> <0|1>
+ * pos and sync positions of IDs 1-14 are clamped to the joint limits
+ * (JointModel.h). For these IDs write refuses the ID, angle limit, offset,
+ * mode and goal position registers ("err protected register"). A line
+ * with too many arguments is refused as a whole, never cut short, and so
+ * is an ID outside 0-253 ("err bad id"). A line longer than BUS_LINE_MAX
+ * gets "err line too long" in its place in the reply order.
+ * Date: 2026.10.14
+ */
+
+#ifndef _BUSCLIENT_H
+#define _BUSCLIENT_H
+
+#include "BusShm.h"
+
+#define BUS_SOCKET_PATH "/tmp/scservo_bus.sock"
+#define BUS_LINE_MAX 256//longest command or reply line, newline included
+#define BUS_REPLY_TIMEOUT_MS 1000
+#define BUS_READ_MAX 32//longest "read" reply, in bytes
+
+class BusClient
+{
+public:
+	BusClient();
+	~BusClient();
+	bool Connect(const char *SocketPath = BUS_SOCKET_PATH, const char *ShmName = BUS_SHM_NAME);
+	void Close();
+	bool Connected() const { return fd!=-1; }
+	bool Command(const char *Line, char *Reply = NULL, int Len = 0);//one round trip, true on "ok"
+	bool Ping(u8 ID);
+	int Read(u8 ID, u8 MemAddr, u8 *nData, u8 nLen);//bytes read, -1 on error; nLen up to BUS_READ_MAX
+	bool Write(u8 ID, u8 MemAddr, const u8 *nDat, u8 nLen);
+	bool WritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC);
+	bool SyncWritePosEx(const s16 Position[], u16 Speed, u8 ACC);//Position[] in published joint order
+	bool EnableTorque(u8 ID, u8 Enable);
+	int ReadPos(u8 ID) const;//-1 if ID is not published or did not answer the last sync read
+public:
+	BusShm State;//State.Read() for a consistent snapshot of every joint
+private:
+	int fd;
+	char rxBuf[BUS_LINE_MAX];
+	int rxLen;
+};
+
+#endif
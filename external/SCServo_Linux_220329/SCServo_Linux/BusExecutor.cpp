@@ -0,0 +1,188 @@
+/*
+ * BusExecutor.cpp
+ * Non-blocking servo bus calls on an I/O thread
+ * Date: 2026.10.14
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "BusExecutor.h"
+
+BusExecutor::BusExecutor(SMS_STS &Bus):Bus(Bus)
+{
+	Priority = 0;
+	busy = 0;
+	running = false;
+	quit = false;
+}
+
+BusExecutor::~BusExecutor()
+{
+	Stop();
+}
+
+bool BusExecutor::Start()
+{
+	if(running){
+		return false;
+	}
+	quit = false;
+	running = true;
+	worker = std::thread(&BusExecutor::Work, this);
+	return true;
+}
+
+void BusExecutor::Stop()
+{
+	if(!running){
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l(lock);
+		quit = true;
+	}
+	kick.notify_one();
+	worker.join();
+	running = false;
+}
+
+void BusExecutor::Drain()
+{
+	std::unique_lock<std::mutex> l(lock);
+	idle.wait(l, [&]{ return queue.empty() && busy==0; });
+}
+
+int BusExecutor::Pending() const
+{
+	std::lock_guard<std::mutex> l(lock);
+	return (int)queue.size()+busy;
+}
+
+void BusExecutor::Enqueue(Job J)
+{
+	if(!running){
+		J(Bus);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l(lock);
+		queue.push_back(J);
+	}
+	kick.notify_one();
+}
+
+//quit only ends the thread once the queue is empty, so no future is left unset
+void BusExecutor::Work()
+{
+	if(Priority>0){
+		struct sched_param sp;
+		memset(&sp, 0, sizeof(sp));
+		sp.sched_priority = Priority;
+		int e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+		if(e){
+			fprintf(stderr, "BusExecutor: SCHED_FIFO %d: %s\n", Priority, strerror(e));
+		}
+	}
+	std::unique_lock<std::mutex> l(lock);
+	while(1){
+		kick.wait(l, [&]{ return quit || !queue.empty(); });
+		if(queue.empty()){
+			return;
+		}
+		Job J = queue.front();
+		queue.pop_front();
+		busy++;
+		l.unlock();
+		J(Bus);
+		l.lock();
+		busy--;
+		if(queue.empty()){
+			idle.notify_all();
+		}
+	}
+}
+
+std::future<int> BusExecutor::Ping(u8 ID)
+{
+	return Post([ID](SMS_STS &B){ return B.Ping(ID); });
+}
+
+std::future<int> BusExecutor::WritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC)
+{
+	return Post([=](SMS_STS &B){ return B.WritePosEx(ID, Position, Speed, ACC); });
+}
+
+std::future<ServoState> BusExecutor::FeedBack(u8 ID)
+{
+	return Post([ID](SMS_STS &B) -> ServoState {
+		ServoState S;
+		memset(&S, 0, sizeof(S));
+		if(B.FeedBack(ID)==-1){
+			S.Err = 1;
+			return S;
+		}
+		S.Pos = B.ReadPos(-1);
+		S.Speed = B.ReadSpeed(-1);
+		S.Load = B.ReadLoad(-1);
+		S.Voltage = B.ReadVoltage(-1);
+		S.Temper = B.ReadTemper(-1);
+		S.Move = B.ReadMove(-1);
+		S.Current = B.ReadCurrent(-1);
+		return S;
+	});
+}
+
+std::future<BusSnapshot> BusExecutor::SyncFeedBack(const u8 ID[], u8 IDN)
+{
+	struct Args{
+		u8 ID[SMS_STS_SYNC_MAX];
+		u8 IDN;
+	};
+	std::shared_ptr<Args> A(new Args);
+	//too many IDs still reach SMS_STS::SyncFeedBack(), which refuses them (N=-1)
+	A->IDN = IDN;
+	if(IDN<=SMS_STS_SYNC_MAX){
+		memcpy(A->ID, ID, IDN);
+	}
+	return Post([A](SMS_STS &B) -> BusSnapshot {
+		BusSnapshot S;
+		S.N = B.SyncFeedBack(A->ID, A->IDN, S.State);
+		return S;
+	});
+}
+
+std::future<int> BusExecutor::SyncWritePosEx(const u8 ID[], u8 IDN, const s16 Position[], const u16 Speed[], const u8 ACC[])
+{
+	struct Args{
+		u8 ID[SMS_STS_SYNC_MAX];
+		s16 Position[SMS_STS_SYNC_MAX];
+		u16 Speed[SMS_STS_SYNC_MAX];
+		u8 ACC[SMS_STS_SYNC_MAX];
+		u8 IDN;
+	};
+	if(IDN>SMS_STS_SYNC_MAX){
+		std::promise<int> Refused;
+		Refused.set_value(-1);
+		return Refused.get_future();
+	}
+	std::shared_ptr<Args> A(new Args);
+	A->IDN = IDN;
+	memcpy(A->ID, ID, A->IDN);
+	memcpy(A->Position, Position, A->IDN*sizeof(s16));
+	//NULL Speed/ACC mean 0 for every servo, as in SMS_STS::SyncWritePosEx()
+	if(Speed){
+		memcpy(A->Speed, Speed, A->IDN*sizeof(u16));
+	}else{
+		memset(A->Speed, 0, sizeof(A->Speed));
+	}
+	if(ACC){
+		memcpy(A->ACC, ACC, A->IDN);
+	}else{
+		memset(A->ACC, 0, sizeof(A->ACC));
+	}
+	return Post([A](SMS_STS &B){
+		B.SyncWritePosEx(A->ID, A->IDN, A->Position, A->Speed, A->ACC);
+		return (int)A->IDN;
+	});
+}
@@ -0,0 +1,82 @@
+/*
+ * BusExecutor.h
+ * Non-blocking servo bus calls: one I/O thread owns the bus, callers get
+ * a std::future per operation
+ *
+ * Jobs run one at a time in the order they were posted, from any number
+ * of threads. Post() takes any callable on the SMS_STS and returns a
+ * future of its result; the common operations have wrappers that copy
+ * their arguments, so nothing has to outlive the call. The caller can plan
+ * the next move, redraw a screen or post more work while the bus is busy,
+ * and only waits where it needs a result.
+ *
+ * While started the I/O thread owns the bus: other code may only touch it
+ * directly after Drain() and before the next Post(). Without Start() every
+ * call runs on the calling thread and returns a ready future.
+ * Date: 2026.10.14
+ */
+
+#ifndef _BUSEXECUTOR_H
+#define _BUSEXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "SMS_STS.h"
+
+//SyncFeedBack() result
+struct BusSnapshot{
+	int N;//servos answered, -1 for more than SMS_STS_SYNC_MAX IDs (as SMS_STS::SyncFeedBack())
+	ServoState State[SMS_STS_SYNC_MAX];//in ID[] order, Err=1 for no reply, 2 skipped by the breaker
+};
+
+class BusExecutor
+{
+public:
+	BusExecutor(SMS_STS &Bus);
+	~BusExecutor();//Stop()
+	bool Start();//spawn the I/O thread, false if already running
+	void Stop();//run what is queued, then join; the bus stays open
+	void Drain();//until every posted job has finished
+	int Pending() const;//jobs queued or running
+	template<class F>
+	std::future<typename std::result_of<F(SMS_STS&)>::type> Post(F Job);//Job(Bus) on the I/O thread
+	std::future<int> Ping(u8 ID);
+	std::future<int> WritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC = 0);
+	std::future<ServoState> FeedBack(u8 ID);//Err=1 for no reply
+	std::future<BusSnapshot> SyncFeedBack(const u8 ID[], u8 IDN);
+	std::future<int> SyncWritePosEx(const u8 ID[], u8 IDN, const s16 Position[], const u16 Speed[], const u8 ACC[]);//Speed/ACC may be NULL (0); servos written, -1 (nothing sent) for more than SMS_STS_SYNC_MAX
+public:
+	SMS_STS &Bus;
+	int Priority;//SCHED_FIFO priority (1-99) for the I/O thread, 0 keeps the default scheduler
+private:
+	typedef std::function<void(SMS_STS&)> Job;
+	void Enqueue(Job J);
+	void Work();
+	std::deque<Job> queue;
+	mutable std::mutex lock;
+	std::condition_variable kick;//job queued or quit
+	std::condition_variable idle;//queue empty and nothing running
+	int busy;//jobs taken off the queue and not finished
+	bool running;
+	bool quit;
+	std::thread worker;
+};
+
+template<class F>
+std::future<typename std::result_of<F(SMS_STS&)>::type> BusExecutor::Post(F J)
+{
+	typedef typename std::result_of<F(SMS_STS&)>::type R;
+	//packaged_task is move-only, std::function needs a copyable target
+	std::shared_ptr<std::packaged_task<R(SMS_STS&)> > Task(new std::packaged_task<R(SMS_STS&)>(J));
+	std::future<R> Result = Task->get_future();
+	Enqueue([Task](SMS_STS &B){ (*Task)(B); });
+	return Result;
+}
+
+#endif
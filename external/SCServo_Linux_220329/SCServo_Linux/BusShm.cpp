@@ -0,0 +1,201 @@
+/*
+ * BusShm.cpp
+ * Joint state published by BusDaemon in POSIX shared memory
+ * Date: 2026.10.14
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "BusShm.h"
+
+//bus_client.py hard-codes these offsets
+static_assert(offsetof(BusShmRegion, Seq)==16, "BusShmRegion layout");
+static_assert(offsetof(BusShmRegion, State)==72, "BusShmRegion layout");
+static_assert(sizeof(BusJointState)==12, "BusJointState layout");
+static_assert(sizeof(BusShmRegion)==456, "BusShmRegion layout");
+
+//Pid of an existing region if that process is still alive, else 0
+static pid_t livePid(const char *Name)
+{
+	int fd = shm_open(Name, O_RDONLY, 0);
+	if(fd==-1){
+		return 0;
+	}
+	struct stat st;
+	void *p = MAP_FAILED;
+	if(fstat(fd, &st)==0 && st.st_size>=(off_t)sizeof(BusShmRegion)){
+		p = mmap(NULL, sizeof(BusShmRegion), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if(p==MAP_FAILED){
+		return 0;
+	}
+	pid_t pid = (pid_t)((BusShmRegion*)p)->Pid;
+	munmap(p, sizeof(BusShmRegion));
+	if(pid<=0 || pid==getpid()){
+		return 0;
+	}
+	return (kill(pid, 0)==0 || errno==EPERM) ? pid : 0;
+}
+
+BusShm::BusShm()
+{
+	region = NULL;
+	owner = false;
+	name[0] = 0;
+}
+
+BusShm::~BusShm()
+{
+	Close();
+}
+
+bool BusShm::Create(const char *Name, const u8 ID[], u8 IDN, uint32_t RateHz)
+{
+	Close();
+	if(IDN>BUS_SHM_JOINTS){
+		return false;
+	}
+	int fd = shm_open(Name, O_RDWR|O_CREAT|O_EXCL, 0644);
+	if(fd==-1 && errno==EEXIST){
+		//left behind by a daemon that died, unless its process is still there
+		pid_t pid = livePid(Name);
+		if(pid){
+			fprintf(stderr, "BusShm: %s is owned by running process %d\n", Name, (int)pid);
+			return false;
+		}
+		shm_unlink(Name);
+		fd = shm_open(Name, O_RDWR|O_CREAT|O_EXCL, 0644);
+	}
+	if(fd==-1){
+		perror("shm_open:");
+		return false;
+	}
+	if(ftruncate(fd, sizeof(BusShmRegion))==-1){
+		perror("ftruncate:");
+		close(fd);
+		shm_unlink(Name);
+		return false;
+	}
+	void *p = mmap(NULL, sizeof(BusShmRegion), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p==MAP_FAILED){
+		perror("mmap:");
+		shm_unlink(Name);
+		return false;
+	}
+	region = (BusShmRegion*)p;
+	owner = true;
+	strncpy(name, Name, sizeof(name)-1);
+	name[sizeof(name)-1] = 0;
+
+	//Magic goes last so a client never sees a half-initialised header
+	region->Magic = 0;
+	region->Seq.store(0, std::memory_order_relaxed);
+	region->Version = BUS_SHM_VERSION;
+	region->Joints = IDN;
+	region->RateHz = RateHz;
+	region->Pid = getpid();
+	region->Answered = 0;
+	region->Tick = 0;
+	region->TimeUs = 0;
+	memset(region->ID, 0, sizeof(region->ID));
+	memcpy(region->ID, ID, IDN);
+	memset(region->State, 0, sizeof(region->State));
+	for(u8 i=0; i<IDN; i++){
+		region->State[i].Err = 1;
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+	region->Magic = BUS_SHM_MAGIC;
+	return true;
+}
+
+bool BusShm::Open(const char *Name)
+{
+	Close();
+	int fd = shm_open(Name, O_RDONLY, 0);
+	if(fd==-1){
+		return false;
+	}
+	//a truncated or stale object would SIGBUS on first access instead
+	struct stat st;
+	void *p = MAP_FAILED;
+	if(fstat(fd, &st)==0 && st.st_size>=(off_t)sizeof(BusShmRegion)){
+		p = mmap(NULL, sizeof(BusShmRegion), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if(p==MAP_FAILED){
+		return false;
+	}
+	region = (BusShmRegion*)p;
+	if(region->Magic!=BUS_SHM_MAGIC || region->Version!=BUS_SHM_VERSION){
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void BusShm::Close()
+{
+	if(region){
+		munmap(region, sizeof(BusShmRegion));
+		region = NULL;
+	}
+	if(owner){
+		shm_unlink(name);
+		owner = false;
+	}
+}
+
+void BusShm::Publish(const ServoState State[], uint32_t Answered, uint64_t Tick, int64_t TimeUs)
+{
+	if(!region || !owner){
+		return;
+	}
+	uint32_t seq = region->Seq.load(std::memory_order_relaxed);
+	region->Seq.store(seq+1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for(u16 i=0; i<region->Joints; i++){
+		BusJointState &S = region->State[i];
+		S.Err = State[i].Err ? 1 : 0;
+		if(S.Err){
+			continue;//keep the last good reading, Err tells readers it is stale
+		}
+		S.Pos = State[i].Pos;
+		S.Speed = State[i].Speed;
+		S.Load = State[i].Load;
+		S.Current = State[i].Current;
+		S.Voltage = State[i].Voltage;
+		S.Temper = State[i].Temper;
+		S.Move = State[i].Move;
+	}
+	region->Answered = Answered;
+	region->Tick = Tick;
+	region->TimeUs = TimeUs;
+	region->Seq.store(seq+2, std::memory_order_release);
+}
+
+bool BusShm::Read(BusShmRegion &Snapshot) const
+{
+	if(!region){
+		return false;
+	}
+	uint32_t s0, s1 = 0;
+	do{
+		s0 = region->Seq.load(std::memory_order_acquire);
+		if(s0&1){
+			continue;
+		}
+		memcpy((void*)&Snapshot, (const void*)region, sizeof(BusShmRegion));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		s1 = region->Seq.load(std::memory_order_relaxed);
+	}while((s0&1) || s0!=s1);
+	return true;
+}
@@ -0,0 +1,69 @@
+/*
+ * BusShm.h
+ * Joint state published by BusDaemon in POSIX shared memory
+ * One writer (the daemon's control loop), any number of readers, guarded by
+ * a seqlock: Seq is odd while an update is in progress, readers copy and
+ * retry until they see the same even Seq before and after
+ *
+ * Layout (native endian, fixed-width fields, 456 bytes, see bus_client.py):
+ *   0  Magic  4 Version  6 Joints  8 RateHz  12 Pid  16 Seq  20 Answered
+ *   24 Tick  32 TimeUs  40 ID[32]  72 State[32] (12 bytes each)
+ * Date: 2026.10.14
+ */
+
+#ifndef _BUSSHM_H
+#define _BUSSHM_H
+
+#include <stdint.h>
+#include <atomic>
+#include "SMS_STS.h"
+
+#define BUS_SHM_NAME "/scservo_bus"//shm_open() name, appears as /dev/shm/scservo_bus
+#define BUS_SHM_MAGIC 0x53554253//"SBUS"
+#define BUS_SHM_VERSION 1
+#define BUS_SHM_JOINTS SMS_STS_SYNC_MAX
+
+struct BusJointState{
+	int16_t Pos;
+	int16_t Speed;
+	int16_t Load;
+	int16_t Current;
+	uint8_t Voltage;
+	uint8_t Temper;
+	uint8_t Move;
+	uint8_t Err;//1 if the servo did not answer the last sync read
+};
+
+struct BusShmRegion{
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t Joints;
+	uint32_t RateHz;
+	uint32_t Pid;//daemon process
+	std::atomic<uint32_t> Seq;
+	uint32_t Answered;//servos that answered the last sync read
+	uint64_t Tick;//loop tick of the last update
+	int64_t TimeUs;//CLOCK_MONOTONIC time of the last update
+	uint8_t ID[BUS_SHM_JOINTS];
+	BusJointState State[BUS_SHM_JOINTS];
+};
+
+class BusShm
+{
+public:
+	BusShm();
+	~BusShm();
+	bool Create(const char *Name, const u8 ID[], u8 IDN, uint32_t RateHz);//daemon: create and own the region, false while the Pid of an existing one is alive
+	bool Open(const char *Name = BUS_SHM_NAME);//client: map read-only, false if no daemon published it
+	void Close();//unmaps, the owner also unlinks
+	bool IsOpen() const { return region!=NULL; }
+	void Publish(const ServoState State[], uint32_t Answered, uint64_t Tick, int64_t TimeUs);//owner only
+	bool Read(BusShmRegion &Snapshot) const;//consistent copy, false if not open
+	const BusShmRegion *Region() const { return region; }
+private:
+	BusShmRegion *region;
+	bool owner;
+	char name[64];
+};
+
+#endif
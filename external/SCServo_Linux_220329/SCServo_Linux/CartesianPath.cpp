@@ -0,0 +1,283 @@
+/*
+ * CartesianPath.cpp
+ * Straight lines, arcs and circles of the tool point turned into joint setpoints
+ * Date: 2026.10.14
+ */
+
+#include <math.h>
+#include <string.h>
+#include "CartesianPath.h"
+
+CartesianPath::CartesianPath(const Kinematics &Kin) : kin(Kin)
+{
+	StepMm = CART_PATH_STEP_MM;
+	AccMmS2 = CART_PATH_ACC;
+	MaxJointStep = CART_PATH_JOINT_STEP;
+	MinManipulability = CART_PATH_MIN_MANIP;
+	Bad = -1;
+	WorstJointStep = 0;
+	WorstManipulability = 0;
+	double P[4] = {0, 0, 0, 0};
+	Start(P);
+}
+
+void CartesianPath::Start(const double P[4])
+{
+	memcpy(start, P, sizeof(start));
+	seg.clear();
+}
+
+void CartesianPath::End(double P[4]) const
+{
+	if(seg.empty()){
+		memcpy(P, start, sizeof(start));
+	}else{
+		Eval(seg.back(), 1, P);
+	}
+}
+
+bool CartesianPath::Line(const double P[4], double Speed)
+{
+	Segment S;
+	memset(&S, 0, sizeof(S));
+	End(S.From);
+	memcpy(S.To, P, sizeof(S.To));
+	double dx = P[0]-S.From[0], dy = P[1]-S.From[1], dz = P[2]-S.From[2];
+	S.Length = sqrt(dx*dx+dy*dy+dz*dz);
+	S.Speed = Speed;
+	if(S.Length<1e-6 || Speed<=0){
+		return false;
+	}
+	seg.push_back(S);
+	return true;
+}
+
+bool CartesianPath::Arc(const double Center[3], const double Normal[3], double Angle, double Speed)
+{
+	Segment S;
+	memset(&S, 0, sizeof(S));
+	S.Arc = true;
+	End(S.From);
+	double n = sqrt(Normal[0]*Normal[0]+Normal[1]*Normal[1]+Normal[2]*Normal[2]);
+	if(n<1e-9 || Speed<=0){
+		return false;
+	}
+	double v[3], vn = 0;
+	for(int k=0; k<3; k++){
+		S.Center[k] = Center[k];
+		S.Normal[k] = Normal[k]/n;
+		v[k] = S.From[k]-Center[k];
+		vn += v[k]*S.Normal[k];
+	}
+	double r2 = 0;
+	for(int k=0; k<3; k++){
+		double d = v[k]-vn*S.Normal[k];
+		r2 += d*d;
+	}
+	S.Angle = Angle;
+	S.Length = fabs(Angle)*sqrt(r2);
+	S.Speed = Speed;
+	if(S.Length<1e-6){
+		return false;
+	}
+	seg.push_back(S);
+	return true;
+}
+
+bool CartesianPath::Circle(const double Center[3], const double Normal[3], double Radius, double Speed, double Turns)
+{
+	double n[3];
+	double nl = sqrt(Normal[0]*Normal[0]+Normal[1]*Normal[1]+Normal[2]*Normal[2]);
+	if(nl<1e-9 || Radius<=0){
+		return false;
+	}
+	for(int k=0; k<3; k++){
+		n[k] = Normal[k]/nl;
+	}
+	//enter the circle at the point nearest the present one
+	double P[4], v[3], vn = 0;
+	End(P);
+	for(int k=0; k<3; k++){
+		v[k] = P[k]-Center[k];
+		vn += v[k]*n[k];
+	}
+	double vl = 0;
+	for(int k=0; k<3; k++){
+		v[k] -= vn*n[k];
+		vl += v[k]*v[k];
+	}
+	vl = sqrt(vl);
+	if(vl<1e-6){
+		//on the axis: any direction in the plane
+		double e[3] = {fabs(n[0])<0.9 ? 1.0 : 0.0, fabs(n[0])<0.9 ? 0.0 : 1.0, 0};
+		v[0] = n[1]*e[2]-n[2]*e[1];
+		v[1] = n[2]*e[0]-n[0]*e[2];
+		v[2] = n[0]*e[1]-n[1]*e[0];
+		vl = sqrt(v[0]*v[0]+v[1]*v[1]+v[2]*v[2]);
+	}
+	double Entry[4] = {Center[0]+Radius*v[0]/vl, Center[1]+Radius*v[1]/vl, Center[2]+Radius*v[2]/vl, P[3]};
+	Line(Entry, Speed);//no segment if already there
+	return Arc(Center, n, 2*M_PI*Turns, Speed);
+}
+
+void CartesianPath::Eval(const Segment &S, double u, double P[4]) const
+{
+	if(!S.Arc){
+		for(int k=0; k<4; k++){
+			P[k] = S.From[k]+(S.To[k]-S.From[k])*u;
+		}
+		return;
+	}
+	//Rodrigues: v cos + (n x v) sin + n (n.v)(1 - cos)
+	double a = S.Angle*u, c = cos(a), s = sin(a);
+	const double *n = S.Normal;
+	double v[3] = {S.From[0]-S.Center[0], S.From[1]-S.Center[1], S.From[2]-S.Center[2]};
+	double nv = n[0]*v[0]+n[1]*v[1]+n[2]*v[2];
+	double x[3] = {n[1]*v[2]-n[2]*v[1], n[2]*v[0]-n[0]*v[2], n[0]*v[1]-n[1]*v[0]};
+	for(int k=0; k<3; k++){
+		P[k] = S.Center[k]+v[k]*c+x[k]*s+n[k]*nv*(1-c);
+	}
+	P[3] = S.From[3];
+}
+
+double CartesianPath::Time(const Segment &S, double s) const
+{
+	double L = S.Length, v = S.Speed, a = AccMmS2;
+	if(a<=0){
+		return s/v;
+	}
+	double sa = v*v/(2*a);
+	if(2*sa>L){
+		//triangular: never reaches Speed
+		sa = L/2;
+		v = sqrt(a*L);
+	}
+	double ta = v/a;
+	double T = 2*ta+(L-2*sa)/v;
+	if(s<sa){
+		return sqrt(2*s/a);
+	}
+	if(s>L-sa){
+		return T-sqrt(2*(L-s)/a);
+	}
+	return ta+(s-sa)/v;
+}
+
+double CartesianPath::Length() const
+{
+	double L = 0;
+	for(size_t i=0; i<seg.size(); i++){
+		L += seg[i].Length;
+	}
+	return L;
+}
+
+double CartesianPath::DurationUs() const
+{
+	double T = 0;
+	for(size_t i=0; i<seg.size(); i++){
+		T += Time(seg[i], seg[i].Length);
+	}
+	return T*1e6;
+}
+
+void CartesianPath::Joint(int i, double q[4]) const
+{
+	for(int j=0; j<4; j++){
+		q[j] = Q[j][i];
+	}
+}
+
+int CartesianPath::Plan(TrajectoryEngine &Engine, const s16 Pose[], u8 Joints)
+{
+	Bad = -1;
+	WorstJointStep = 0;
+	WorstManipulability = 0;
+	for(int j=0; j<4; j++){
+		Q[j].clear();
+	}
+	if(Joints<4 || Joints>SMS_STS_SYNC_MAX){
+		return CART_PATH_JOINTS;
+	}
+	if(seg.empty()){
+		return CART_PATH_EMPTY;
+	}
+	//sample the path: start pose, then every StepMm of each segment
+	std::vector<double> buf[4];
+	std::vector<double> T;
+	for(int k=0; k<4; k++){
+		buf[k].push_back(start[k]);
+	}
+	T.push_back(0);
+	double t0 = 0;
+	for(size_t i=0; i<seg.size(); i++){
+		const Segment &S = seg[i];
+		int n = (int)ceil(S.Length/StepMm);
+		for(int p=1; p<=n; p++){
+			double P[4];
+			Eval(S, (double)p/n, P);
+			for(int k=0; k<4; k++){
+				buf[k].push_back(P[k]);
+			}
+			T.push_back(t0+Time(S, S.Length*p/n));
+		}
+		t0 += Time(S, S.Length);
+	}
+	int N = (int)T.size();
+	for(int j=0; j<4; j++){
+		Q[j].resize(N);
+	}
+	std::vector<u8> ok(N);
+	const double *P[4] = {&buf[0][0], &buf[1][0], &buf[2][0], &buf[3][0]};
+	double *q[4] = {&Q[0][0], &Q[1][0], &Q[2][0], &Q[3][0]};
+	double seed[4];
+	for(int j=0; j<4; j++){
+		seed[j] = Angle(j, Pose[j]);
+	}
+	if(kin.InverseBatch(N, P, q, &ok[0], seed)!=N){
+		for(Bad=0; ok[Bad]; Bad++);
+		return CART_PATH_UNREACHABLE;
+	}
+	for(int i=0; i<N; i++){
+		double qi[4] = {q[0][i], q[1][i], q[2][i], q[3][i]};
+		double m = kin.Manipulability(qi);
+		if(i==0 || m<WorstManipulability){
+			WorstManipulability = m;
+		}
+		if(m<MinManipulability){
+			Bad = i;
+			return CART_PATH_SINGULAR;
+		}
+		if(i){
+			for(int j=0; j<4; j++){
+				double d = fabs(q[j][i]-q[j][i-1]);
+				if(d>WorstJointStep){
+					WorstJointStep = d;
+				}
+			}
+			if(WorstJointStep>MaxJointStep){
+				Bad = i;
+				return CART_PATH_FLIP;
+			}
+		}
+	}
+	//every point is a knot: the path is already as dense as it should be played
+	if(Engine.Joints()!=Joints){
+		Engine.SetJoints(Joints);
+	}else{
+		Engine.Clear();
+	}
+	Engine.KnotUs = 0;
+	s16 goal[SMS_STS_SYNC_MAX];
+	memcpy(goal, Pose, Joints*sizeof(s16));
+	for(int i=0; i<N; i++){
+		for(int j=0; j<4; j++){
+			goal[j] = Steps(j, q[j][i]);
+		}
+		Engine.Add((uint32_t)(T[i]*1e6+0.5), goal);
+	}
+	if(!Engine.Plan(Pose)){
+		return CART_PATH_EMPTY;
+	}
+	return N;
+}
@@ -0,0 +1,81 @@
+/*
+ * CartesianPath.h
+ * Straight lines, arcs and circles of the tool point turned into joint setpoints
+ *
+ * Segments are sampled every StepMm along the path with a trapezoidal speed
+ * profile (AccMmS2 up to the segment speed and back to rest), solved by
+ * Kinematics::InverseBatch seeded from the arm's pose, and loaded into a
+ * TrajectoryEngine as timed knots, one per point. Streaming Step() at the
+ * control rate then sends one sync write per tick. The engine only slows
+ * segments down where a joint would exceed its limits, the shape is kept.
+ * The whole path is checked before anything moves: every point must be
+ * reachable within the joint limits, no joint may jump by more than
+ * MaxJointStep between two points (elbow flip) and the manipulability must
+ * stay above MinManipulability (singularities).
+ * Date: 2026.10.14
+ */
+
+#ifndef _CARTESIANPATH_H
+#define _CARTESIANPATH_H
+
+#include <vector>
+#include "Kinematics.h"
+#include "TrajectoryEngine.h"
+#include "JointModel.h"
+
+#define CART_PATH_STEP_MM 2.0//default point spacing along the path
+#define CART_PATH_ACC 500.0//default path acceleration (mm/s^2)
+#define CART_PATH_JOINT_STEP 0.17//default largest joint change between two points (rad, ~10 deg)
+#define CART_PATH_MIN_MANIP 1e5//default lowest |det J| accepted
+
+//Plan() results below 1
+#define CART_PATH_EMPTY 0//no segments
+#define CART_PATH_UNREACHABLE -1//point Bad is out of reach or outside the joint limits
+#define CART_PATH_FLIP -2//a joint jumps by more than MaxJointStep before point Bad
+#define CART_PATH_SINGULAR -3//point Bad is too close to a singularity
+#define CART_PATH_JOINTS -4//Joints is below 4 or above SMS_STS_SYNC_MAX
+
+class CartesianPath
+{
+public:
+	CartesianPath(const Kinematics &Kin);
+	void Start(const double P[4]);//x, y, z, pitch the path begins at, drops all segments
+	bool Line(const double P[4], double Speed);//straight to P, pitch interpolated, Speed in mm/s
+	bool Arc(const double Center[3], const double Normal[3], double Angle, double Speed);//turn Angle (rad, right-handed) about the axis through Center along Normal
+	bool Circle(const double Center[3], const double Normal[3], double Radius, double Speed, double Turns = 1);//line onto the circle in the plane through Center, then Turns full turns
+	int Plan(TrajectoryEngine &Engine, const s16 Pose[], u8 Joints);//Pose: present servo positions; J1-J4 follow the path, the others hold; returns points or CART_PATH_*; limits already set on an Engine with Joints joints are kept
+	void End(double P[4]) const;//pose at the end of the path
+	double Length() const;//mm
+	double DurationUs() const;//at the programmed speeds, before the engine's joint limits
+	int Points() const { return (int)Q[0].size(); }
+	void Joint(int i, double q[4]) const;//J1-J4 of point i from the last Plan()
+	s16 Steps(int j, double q) const { return (s16)JointStepsRad(j, q); }//joint angle -> servo position, clamped to the limits
+	double Angle(int j, s16 Steps) const { return JointRad(j, Steps); }//servo position -> joint angle
+public:
+	double StepMm;
+	double AccMmS2;//0 = start and stop at full speed
+	double MaxJointStep;//rad
+	double MinManipulability;
+	int Bad;//point the last Plan() failed on
+	double WorstJointStep;//largest joint change between two points in the last Plan() (rad)
+	double WorstManipulability;//lowest |det J| in the last Plan()
+private:
+	struct Segment{
+		bool Arc;
+		double From[4];
+		double To[4];//line end
+		double Center[3];//arc axis point
+		double Normal[3];//arc axis unit vector
+		double Angle;
+		double Length;//mm
+		double Speed;//mm/s
+	};
+	void Eval(const Segment &S, double u, double P[4]) const;//pose at fraction u of the segment
+	double Time(const Segment &S, double s) const;//seconds to travel s mm into the segment
+	const Kinematics &kin;
+	double start[4];
+	std::vector<Segment> seg;
+	std::vector<double> Q[4];//joint solutions of the last Plan(), SoA
+};
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * ControlLoop.cpp
+ * Fixed-period real-time control loop owning one SMS_STS bus
+ * Date: 2026.10.14
+ */
+
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "ControlLoop.h"
+
+ControlLoop::ControlLoop()
+{
+	Priority = 0;
+	CPU = -1;
+	LockMemory = false;
+	periodUs = 0;
+	running = false;
+	stopReq = false;
+	ResetStats();
+}
+
+ControlLoop::~ControlLoop()
+{
+	Stop();
+}
+
+long long ControlLoop::NowUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
+
+bool ControlLoop::Start(unsigned long PeriodUs, Task task)
+{
+	if(running || !PeriodUs){
+		return false;
+	}
+	if(worker.joinable()){
+		worker.join();
+	}
+	this->task = task;
+	periodUs = PeriodUs;
+	stopReq = false;
+	running = true;
+	ResetStats();
+	worker = std::thread(&ControlLoop::Run, this);
+	return true;
+}
+
+void ControlLoop::Stop()
+{
+	stopReq = true;
+	if(worker.joinable()){
+		worker.join();
+	}
+}
+
+void ControlLoop::Wait()
+{
+	if(worker.joinable()){
+		worker.join();
+	}
+}
+
+void ControlLoop::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(statsLock);
+	memset(&stats, 0, sizeof(stats));
+	stats.MinPeriodUs = -1;
+	lastWake = 0;
+	periodSum = 0;
+}
+
+ControlLoopStats ControlLoop::GetStats()
+{
+	std::lock_guard<std::mutex> lock(statsLock);
+	return stats;
+}
+
+static void addUs(struct timespec *ts, long long us)
+{
+	long long ns = ts->tv_nsec + (us%1000000)*1000;
+	ts->tv_sec += us/1000000 + ns/1000000000;
+	ts->tv_nsec = ns%1000000000;
+}
+
+static long long toUs(const struct timespec *ts)
+{
+	return (long long)ts->tv_sec*1000000LL + ts->tv_nsec/1000;
+}
+
+void ControlLoop::Run()
+{
+	if(CPU>=0){
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(CPU, &set);
+		int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if(e){
+			fprintf(stderr, "ControlLoop: pin to CPU %d: %s\n", CPU, strerror(e));
+		}
+	}
+	if(Priority>0){
+		struct sched_param sp;
+		memset(&sp, 0, sizeof(sp));
+		sp.sched_priority = Priority;
+		int e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+		if(e){
+			fprintf(stderr, "ControlLoop: SCHED_FIFO %d: %s\n", Priority, strerror(e));
+		}
+	}
+	if(LockMemory){
+		if(mlockall(MCL_CURRENT|MCL_FUTURE)){
+			perror("ControlLoop: mlockall");
+		}
+		//touch the stack now so the first ticks don't page-fault
+		volatile unsigned char prefault[64*1024];
+		memset((void*)prefault, 0, sizeof(prefault));
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	unsigned long tick = 0;
+	while(!stopReq){
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)==EINTR);
+		long long wake = NowUs();
+		bool more = task(Bus, tick++);
+		long long done = NowUs();
+		Account(wake, toUs(&deadline), done);
+		if(!more){
+			break;
+		}
+		addUs(&deadline, periodUs);
+		//overrun: skip the periods we already missed instead of bursting to catch up
+		long long next = toUs(&deadline);
+		if(done>next){
+			unsigned long missed = (done-next)/periodUs+1;
+			addUs(&deadline, (long long)missed*periodUs);
+			std::lock_guard<std::mutex> lock(statsLock);
+			stats.Overruns++;
+			stats.Missed += missed;
+		}
+	}
+	running = false;
+}
+
+void ControlLoop::Account(long long wake, long long deadline, long long done)
+{
+	long latency = wake>deadline ? (long)(wake-deadline) : 0;
+	long work = (long)(done-wake);
+	int bin = 0;
+	while(bin<CONTROL_LOOP_HIST_BINS-1 && latency>=(1L<<bin)){
+		bin++;
+	}
+	std::lock_guard<std::mutex> lock(statsLock);
+	stats.Ticks++;
+	stats.LatencyHist[bin]++;
+	if(latency>stats.MaxLatencyUs){
+		stats.MaxLatencyUs = latency;
+	}
+	if(work>stats.MaxWorkUs){
+		stats.MaxWorkUs = work;
+	}
+	if(lastWake){
+		long period = (long)(wake-lastWake);
+		if(stats.MinPeriodUs<0 || period<stats.MinPeriodUs){
+			stats.MinPeriodUs = period;
+		}
+		if(period>stats.MaxPeriodUs){
+			stats.MaxPeriodUs = period;
+		}
+		periodSum += period;
+		stats.MeanPeriodUs = periodSum/(stats.Ticks-1);
+	}
+	lastWake = wake;
+}
+
+void ControlLoop::PrintStats(FILE *out)
+{
+	ControlLoopStats s = GetStats();
+	fprintf(out, "control loop: period %luus (%.1f Hz), %lu ticks, %lu overruns, %lu missed periods\n",
+		periodUs, periodUs ? 1e6/periodUs : 0.0, s.Ticks, s.Overruns, s.Missed);
+	if(s.Ticks>1){
+		fprintf(out, "  period min/mean/max: %ld / %.1f / %ld us\n", s.MinPeriodUs, s.MeanPeriodUs, s.MaxPeriodUs);
+	}
+	fprintf(out, "  worst wake latency: %ld us, worst task time: %ld us\n", s.MaxLatencyUs, s.MaxWorkUs);
+	fprintf(out, "  wake latency histogram:\n");
+	for(int i=0; i<CONTROL_LOOP_HIST_BINS; i++){
+		if(!s.LatencyHist[i]){
+			continue;
+		}
+		char label[24];
+		if(i==CONTROL_LOOP_HIST_BINS-1){
+			snprintf(label, sizeof(label), ">=%ldus", 1L<<(i-1));
+		}else{
+			snprintf(label, sizeof(label), "<%ldus", 1L<<i);
+		}
+		fprintf(out, "    %-10s %lu\n", label, s.LatencyHist[i]);
+	}
+}
@@ -0,0 +1,68 @@
+/*
+ * ControlLoop.h
+ * Fixed-period real-time control loop owning one SMS_STS bus
+ * Each period runs a read->compute->write task on a dedicated thread,
+ * woken by clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME)
+ * Date: 2026.10.14
+ */
+
+#ifndef _CONTROLLOOP_H
+#define _CONTROLLOOP_H
+
+#include <stdio.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "SMS_STS.h"
+
+//wake latency histogram: bin 0 = <1us, bin i = [2^(i-1), 2^i) us, last bin = everything above
+#define CONTROL_LOOP_HIST_BINS 18
+
+struct ControlLoopStats{
+	unsigned long Ticks;//task invocations
+	unsigned long Overruns;//ticks whose work ran past the next deadline
+	unsigned long Missed;//periods skipped because of overruns
+	long MinPeriodUs;//measured wake-to-wake period
+	long MaxPeriodUs;
+	double MeanPeriodUs;
+	long MaxLatencyUs;//worst wake-up delay after deadline
+	long MaxWorkUs;//worst task execution time
+	unsigned long LatencyHist[CONTROL_LOOP_HIST_BINS];
+};
+
+class ControlLoop
+{
+public:
+	typedef std::function<bool(SMS_STS &Bus, unsigned long Tick)> Task;//return false to stop the loop
+	ControlLoop();
+	~ControlLoop();
+	bool Start(unsigned long PeriodUs, Task task);//spawn loop thread, false if already running
+	void Stop();//request stop and join
+	void Wait();//join once the task has returned false
+	bool Running() const { return running; }
+	unsigned long PeriodUs() const { return periodUs; }
+	ControlLoopStats GetStats();
+	void ResetStats();
+	void PrintStats(FILE *out = stdout);
+	static long long NowUs();//CLOCK_MONOTONIC in microseconds
+public:
+	SMS_STS Bus;//the servo bus this loop owns
+	int Priority;//SCHED_FIFO priority (1-99), 0 keeps the default scheduler
+	int CPU;//pin loop thread to this CPU, -1 for no pinning
+	bool LockMemory;//mlockall() and prefault stack before the first tick
+private:
+	void Run();
+	void Account(long long wake, long long deadline, long long done);
+	Task task;
+	unsigned long periodUs;
+	std::thread worker;
+	std::atomic<bool> running;
+	std::atomic<bool> stopReq;
+	std::mutex statsLock;
+	ControlLoopStats stats;
+	long long lastWake;
+	double periodSum;
+};
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Gripper.cpp
+ * Closed-loop grasping on current/load feedback
+ * Date: 2026.10.14
+ */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Gripper.h"
+
+static long long gripperUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
+
+static int gripperAbs(int V)
+{
+	return V<0 ? -V : V;
+}
+
+Gripper::Gripper(SMS_STS &Bus, u8 ID):Bus(Bus)
+{
+	PeriodUs = GRIPPER_PERIOD_US;
+	CurrentLimit = GRIPPER_CURRENT;
+	LoadLimit = GRIPPER_LOAD;
+	Confirm = GRIPPER_CONFIRM;
+	HoldSteps = GRIPPER_HOLD_STEPS;
+	GoalSteps = GRIPPER_GOAL_STEPS;
+	id = ID;
+	goal = 0;
+	holdPos = 0;
+	side = 1;
+	holding = false;
+}
+
+int Gripper::Close(s16 Goal, u16 Speed, u8 ACC, u32 TimeOut, GripReport *Report)
+{
+	GripReport R;
+	memset(&R, 0, sizeof(R));
+	R.Result = GRIP_TIMEOUT;
+	goal = Goal;
+	holdPos = Goal;
+	holding = false;
+	u8 need = Confirm ? Confirm : 1;
+	int over = 0, still = 0, miss = 0;
+	bool started = false, known = false;
+	long long t0 = gripperUs();
+	long long next = t0;
+	if(Bus.WritePosEx(id, Goal, Speed, ACC)==-1){
+		R.Result = GRIP_NO_REPLY;
+		miss = need;
+	}
+	while(miss<need){
+		ServoState S;
+		Bus.SyncFeedBack(&id, 1, &S);
+		R.Samples++;
+		if(S.Err){
+			R.Misses++;
+			if(++miss>=need){
+				R.Result = GRIP_NO_REPLY;
+				break;
+			}
+		}else{
+			miss = 0;
+			int c = gripperAbs(S.Current), l = gripperAbs(S.Load);
+			R.Pos = S.Pos;
+			R.Current = S.Current;
+			R.Load = S.Load;
+			if(c>R.PeakCurrent){
+				R.PeakCurrent = c;
+			}
+			if(l>R.PeakLoad){
+				R.PeakLoad = l;
+			}
+			int d = Goal-S.Pos;
+			if(!known){
+				side = d<0 ? -1 : 1;
+				known = true;
+			}
+			if(gripperAbs(d)<=GoalSteps){
+				R.Result = GRIP_EMPTY;
+				break;
+			}
+			over = (c>=CurrentLimit || l>=LoadLimit) ? over+1 : 0;
+			if(over==1){
+				R.ContactUs = gripperUs()-t0;
+			}
+			if(S.Move){
+				started = true;
+				still = 0;
+			}else if(started){
+				still++;
+			}
+			if(over>=need || still>=need){
+				//squeeze HoldSteps past the contact point, never past Goal
+				int h = S.Pos+side*HoldSteps;
+				holdPos = (Goal-h)*side<0 ? Goal : h;
+				Bus.WritePosEx(id, holdPos, Speed, ACC);
+				holding = true;
+				R.Result = GRIP_HOLDING;
+				break;
+			}
+		}
+		if(gripperUs()-t0>=(long long)TimeOut*1000){
+			break;
+		}
+		next += PeriodUs;
+		long long w = next-gripperUs();
+		if(w>0){
+			usleep(w);
+		}else{
+			next = gripperUs();
+		}
+	}
+	R.TimeUs = gripperUs()-t0;
+	if(Report){
+		*Report = R;
+	}
+	return R.Result;
+}
+
+int Gripper::Open(s16 Goal, u16 Speed, u8 ACC)
+{
+	holding = false;
+	goal = Goal;
+	holdPos = Goal;
+	return Bus.WritePosEx(id, Goal, Speed, ACC);
+}
+
+int Gripper::Holding()
+{
+	ServoState S;
+	if(Bus.SyncFeedBack(&id, 1, &S)!=1){
+		return -1;
+	}
+	if(!holding){
+		return 0;
+	}
+	//an object keeps the jaws near the contact point; without it they run on to holdPos
+	return (holdPos-S.Pos)*side>HoldSteps/2 ? 1 : 0;
+}
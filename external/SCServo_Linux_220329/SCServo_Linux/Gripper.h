@@ -0,0 +1,73 @@
+/*
+ * Gripper.h
+ * Closed-loop grasping: close until the jaws meet the object, then hold
+ *
+ * Close() sends the closed position and then streams the gripper's
+ * feedback block (SyncFeedBack: position, load, current, MOVING) every
+ * PeriodUs. Current or load above the contact threshold for Confirm
+ * samples in a row means the jaws are on the object: the goal is pulled
+ * back to HoldSteps past the contact point, so the servo squeezes with a
+ * bounded force instead of stalling at full torque, and Close() returns
+ * GRIP_HOLDING. Arriving within GoalSteps of the closed position means
+ * nothing was in between (GRIP_EMPTY). Stopping short without a current
+ * spike (a soft object) also counts as holding. The decision comes
+ * Confirm*PeriodUs after contact, not after a fixed wait.
+ * Date: 2026.10.14
+ */
+
+#ifndef _GRIPPER_H
+#define _GRIPPER_H
+
+#include "SMS_STS.h"
+
+#define GRIPPER_PERIOD_US 5000//feedback poll while closing
+#define GRIPPER_CURRENT 150//contact current (6.5 mA units, ~1 A)
+#define GRIPPER_LOAD 500//contact load (0.1 % of full PWM)
+#define GRIPPER_CONFIRM 3//samples in a row above a threshold
+#define GRIPPER_HOLD_STEPS 20//squeeze past the contact point
+#define GRIPPER_GOAL_STEPS 10//"closed" within this many steps of the goal
+
+#define GRIP_HOLDING 1
+#define GRIP_EMPTY 0
+#define GRIP_TIMEOUT -1//still moving at TimeOut
+#define GRIP_NO_REPLY -2//no feedback for Confirm polls in a row
+
+struct GripReport{
+	int Result;//GRIP_*
+	int Pos;//where the jaws stopped
+	int Current;//at the decision
+	int Load;
+	int PeakCurrent;//largest |current| seen while closing
+	int PeakLoad;
+	unsigned long TimeUs;//from the goal write to the decision
+	unsigned long ContactUs;//from the goal write to the first sample above a threshold, 0 if none
+	int Samples;//feedback polls
+	int Misses;//polls without a reply
+};
+
+class Gripper
+{
+public:
+	Gripper(SMS_STS &Bus, u8 ID);
+	int Close(s16 Goal, u16 Speed, u8 ACC, u32 TimeOut, GripReport *Report = NULL);//GRIP_*, TimeOut in ms
+	int Open(s16 Goal, u16 Speed, u8 ACC);//WritePosEx, -1 on no reply
+	int Holding();//after GRIP_HOLDING: 1 while the jaws still push on the object, 0 once they closed through (slipped), -1 on no reply
+	u8 ID() const { return id; }
+	s16 HoldPos() const { return holdPos; }
+public:
+	unsigned long PeriodUs;
+	int CurrentLimit;
+	int LoadLimit;
+	u8 Confirm;
+	u16 HoldSteps;
+	u16 GoalSteps;
+private:
+	SMS_STS &Bus;
+	u8 id;
+	s16 goal;
+	s16 holdPos;//goal while holding
+	int side;//closing direction, +1 or -1
+	bool holding;
+};
+
+#endif
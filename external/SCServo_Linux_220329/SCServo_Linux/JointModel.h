@@ -0,0 +1,87 @@
+/*
+ * JointModel.h
+ * KikoBot C1 joint model shared by the examples: servo step <-> angle
+ * conversion, calibration offsets and joint limits
+ *
+ * Angles come in two frames:
+ *   servo angle - what the servo sees, 0 deg = position 2048, one turn = 4096 steps
+ *   joint angle - arm coordinates (camera scripts, Kinematics), servo angle
+ *                 minus the calibration offset (J1 is mounted 90 deg round)
+ * Limits are servo angles, the tested HomeAll ranges that
+ * servo_limits_config.py is based on. Every per-joint step value is a
+ * constexpr table, so a conversion at run time is one multiply, one add and
+ * a min/max clamp in integer steps.
+ * Date: 2026.10.14
+ */
+
+#ifndef _JOINTMODEL_H
+#define _JOINTMODEL_H
+
+#include "INST.h"
+
+#define JOINT_N 7//J1-J6 and the gripper, servo IDs 1-7
+#define JOINT_CENTER 2048//servo position at servo angle 0
+#define JOINT_STEPS 4096//servo positions per turn
+
+constexpr double JOINT_STEPS_PER_DEG = JOINT_STEPS/360.0;
+constexpr double JOINT_STEPS_PER_RAD = JOINT_STEPS/(2*3.14159265358979323846);
+
+//servo angle limits (deg)
+constexpr int JOINT_MIN_DEG[JOINT_N] = {-165, -125, -140, -140, -140, -175, -180};
+constexpr int JOINT_MAX_DEG[JOINT_N] = { 165,  125,  140,  140,  140,  175,  180};
+
+//calibration: servo angle = joint angle + offset (deg)
+constexpr double JOINT_OFFSET_DEG[JOINT_N] = {90, 0, 0, 0, 0, 0, 0};
+
+//rounded to the nearest step, halves away from zero
+constexpr int JointRound(double Steps) { return (int)(Steps<0 ? Steps-0.5 : Steps+0.5); }
+
+//servo angle -> position, wrapped into 0-4095
+constexpr int ServoSteps(double Deg) { return (JOINT_CENTER+JointRound(Deg*JOINT_STEPS_PER_DEG))&(JOINT_STEPS-1); }
+//position -> servo angle in [-180, 180)
+constexpr double ServoDeg(int Steps) { return ((Steps&(JOINT_STEPS-1))-JOINT_CENTER)/JOINT_STEPS_PER_DEG; }
+
+//servo angle -> position, not wrapped: -180 is 0 and +180 is 4095
+constexpr int ServoBound(int Steps) { return Steps<0 ? 0 : (Steps>JOINT_STEPS-1 ? JOINT_STEPS-1 : Steps); }
+constexpr int ServoLimit(double Deg) { return ServoBound(JOINT_CENTER+JointRound(Deg*JOINT_STEPS_PER_DEG)); }
+
+//position of joint angle 0
+constexpr s16 JOINT_ZERO_STEPS[JOINT_N] = {
+	(s16)ServoSteps(JOINT_OFFSET_DEG[0]), (s16)ServoSteps(JOINT_OFFSET_DEG[1]), (s16)ServoSteps(JOINT_OFFSET_DEG[2]),
+	(s16)ServoSteps(JOINT_OFFSET_DEG[3]), (s16)ServoSteps(JOINT_OFFSET_DEG[4]), (s16)ServoSteps(JOINT_OFFSET_DEG[5]),
+	(s16)ServoSteps(JOINT_OFFSET_DEG[6])
+};
+//limits as positions
+constexpr s16 JOINT_MIN_STEPS[JOINT_N] = {
+	(s16)ServoLimit(JOINT_MIN_DEG[0]), (s16)ServoLimit(JOINT_MIN_DEG[1]), (s16)ServoLimit(JOINT_MIN_DEG[2]),
+	(s16)ServoLimit(JOINT_MIN_DEG[3]), (s16)ServoLimit(JOINT_MIN_DEG[4]), (s16)ServoLimit(JOINT_MIN_DEG[5]),
+	(s16)ServoLimit(JOINT_MIN_DEG[6])
+};
+constexpr s16 JOINT_MAX_STEPS[JOINT_N] = {
+	(s16)ServoLimit(JOINT_MAX_DEG[0]), (s16)ServoLimit(JOINT_MAX_DEG[1]), (s16)ServoLimit(JOINT_MAX_DEG[2]),
+	(s16)ServoLimit(JOINT_MAX_DEG[3]), (s16)ServoLimit(JOINT_MAX_DEG[4]), (s16)ServoLimit(JOINT_MAX_DEG[5]),
+	(s16)ServoLimit(JOINT_MAX_DEG[6])
+};
+
+//position clamped to the limits of joint J (0-based)
+constexpr int JointClamp(int J, int Steps)
+{
+	return Steps<JOINT_MIN_STEPS[J] ? JOINT_MIN_STEPS[J] : (Steps>JOINT_MAX_STEPS[J] ? JOINT_MAX_STEPS[J] : Steps);
+}
+//joint angle (deg) -> clamped position
+constexpr int JointSteps(int J, double Deg) { return JointClamp(J, JOINT_ZERO_STEPS[J]+JointRound(Deg*JOINT_STEPS_PER_DEG)); }
+constexpr int JointStepsRad(int J, double Rad) { return JointClamp(J, JOINT_ZERO_STEPS[J]+JointRound(Rad*JOINT_STEPS_PER_RAD)); }
+//position -> joint angle
+constexpr double JointDeg(int J, int Steps) { return (Steps-JOINT_ZERO_STEPS[J])/JOINT_STEPS_PER_DEG; }
+constexpr double JointRad(int J, int Steps) { return (Steps-JOINT_ZERO_STEPS[J])/JOINT_STEPS_PER_RAD; }
+//one joint limit as a joint angle (rad), for Kinematics
+constexpr double JointMinRad(int J) { return JointRad(J, JOINT_MIN_STEPS[J]); }
+constexpr double JointMaxRad(int J) { return JointRad(J, JOINT_MAX_STEPS[J]); }
+//position moved by Offset steps, wrapped into 0-4095 (leader -> follower)
+constexpr int JointShift(int Steps, int Offset) { return (Steps+Offset)&(JOINT_STEPS-1); }
+//shortest signed move From -> To across the 0/4095 wrap, -2048..2047
+constexpr int JointDelta(int To, int From) { return ((To-From+JOINT_STEPS/2)&(JOINT_STEPS-1))-JOINT_STEPS/2; }
+//joint of a servo ID: 1-7 is the arm, 8-14 a second arm on the same bus; -1 otherwise
+constexpr int JointOfID(int ID) { return ID>=1 && ID<=2*JOINT_N ? (ID-1)%JOINT_N : -1; }
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * Kinematics.cpp
+ * Closed-form forward/inverse kinematics for the KikoBot C1 arm
+ * Date: 2026.10.14
+ */
+
+#include <math.h>
+#include <string.h>
+#include "Kinematics.h"
+#include "JointModel.h"
+
+Kinematics::Kinematics()
+{
+	//a, alpha, d, offset
+	static const KinDH C1[KIN_JOINTS] = {
+		{0.0, -M_PI/2, 137.8, 0.0},//J1 base
+		{147.0, 0.0, 0.0, 0.0},//J2 shoulder
+		{147.0, 0.0, 0.0, 0.0},//J3 elbow
+		{81.0, 0.0, 0.0, 0.0},//J4 wrist pitch
+		{0.0, M_PI/2, 0.0, 0.0},//J5 wrist roll
+		{0.0, 0.0, 0.0, 0.0}//J6 flange
+	};
+	memcpy(DH, C1, sizeof(DH));
+	for(int j=0; j<KIN_JOINTS; j++){
+		Sign[j] = 1.0;
+		Min[j] = JointMinRad(j);
+		Max[j] = JointMaxRad(j);
+	}
+}
+
+double Kinematics::Joint(int j, double Theta) const
+{
+	double q = Sign[j]*(Theta-DH[j].offset);
+	q = fmod(q, 2*M_PI);
+	if(q>M_PI){
+		q -= 2*M_PI;
+	}else if(q<=-M_PI){
+		q += 2*M_PI;
+	}
+	return q;
+}
+
+//limits wider than one turn (J1 runs -255..75 deg in arm coordinates)
+//need the other representation of the same angle
+bool Kinematics::InLimits(int j, double &q) const
+{
+	for(int k=0; k<3; k++){
+		double t = q+(k==1 ? -2*M_PI : (k==2 ? 2*M_PI : 0));
+		if(t>=Min[j] && t<=Max[j]){
+			q = t;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Kinematics::Forward(const double Q[KIN_JOINTS], double T[4][4]) const
+{
+	double M[4][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}};
+	for(int j=0; j<KIN_JOINTS; j++){
+		double t = Sign[j]*Q[j]+DH[j].offset;
+		double ct = cos(t), st = sin(t);
+		double ca = cos(DH[j].alpha), sa = sin(DH[j].alpha);
+		double A[4][4] = {
+			{ct, -st*ca, st*sa, DH[j].a*ct},
+			{st, ct*ca, -ct*sa, DH[j].a*st},
+			{0, sa, ca, DH[j].d},
+			{0, 0, 0, 1}
+		};
+		double R[4][4];
+		for(int r=0; r<4; r++){
+			for(int c=0; c<4; c++){
+				R[r][c] = M[r][0]*A[0][c]+M[r][1]*A[1][c]+M[r][2]*A[2][c]+M[r][3]*A[3][c];
+			}
+		}
+		memcpy(M, R, sizeof(M));
+	}
+	memcpy(T, M, sizeof(M));
+}
+
+//J1 turns the arm plane, J2-J4 are a planar 3R chain in it:
+//r = a1 + a2 c2 + a3 c23 + a4 c234 out from the base axis, h = a2 s2 + a3 s23 + a4 s234 along y1
+void Kinematics::Position(const double Q[], double P[4]) const
+{
+	double t1 = Sign[0]*Q[0]+DH[0].offset;
+	double t2 = Sign[1]*Q[1]+DH[1].offset;
+	double t23 = t2+Sign[2]*Q[2]+DH[2].offset;
+	double t234 = t23+Sign[3]*Q[3]+DH[3].offset;
+	double r = DH[0].a+DH[1].a*cos(t2)+DH[2].a*cos(t23)+DH[3].a*cos(t234);
+	double h = DH[1].a*sin(t2)+DH[2].a*sin(t23)+DH[3].a*sin(t234);
+	P[0] = cos(t1)*r;
+	P[1] = sin(t1)*r;
+	P[2] = DH[0].d+sin(DH[0].alpha)*h;
+	P[3] = t234;
+}
+
+void Kinematics::Jacobian(const double Q[], double J[4][4]) const
+{
+	double t1 = Sign[0]*Q[0]+DH[0].offset;
+	double t2 = Sign[1]*Q[1]+DH[1].offset;
+	double t23 = t2+Sign[2]*Q[2]+DH[2].offset;
+	double t234 = t23+Sign[3]*Q[3]+DH[3].offset;
+	double c1 = cos(t1), s1 = sin(t1), sa = sin(DH[0].alpha);
+	double r4 = DH[3].a*cos(t234), h4 = DH[3].a*sin(t234);
+	double r3 = DH[2].a*cos(t23)+r4, h3 = DH[2].a*sin(t23)+h4;
+	double r2 = DH[1].a*cos(t2)+r3, h2 = DH[1].a*sin(t2)+h3;
+	double r = DH[0].a+r2;
+	//d r/d theta_k = -h_k, d h/d theta_k = r_k
+	double dr[4] = {0, -h2, -h3, -h4};
+	double dh[4] = {0, r2, r3, r4};
+	J[0][0] = -s1*r*Sign[0];
+	J[1][0] = c1*r*Sign[0];
+	J[2][0] = 0;
+	J[3][0] = 0;
+	for(int k=1; k<4; k++){
+		J[0][k] = c1*dr[k]*Sign[k];
+		J[1][k] = s1*dr[k]*Sign[k];
+		J[2][k] = sa*dh[k]*Sign[k];
+		J[3][k] = Sign[k];
+	}
+}
+
+double Kinematics::Manipulability(const double Q[]) const
+{
+	double J[4][4];
+	Jacobian(Q, J);
+	//Gaussian elimination with partial pivoting
+	double det = 1;
+	for(int c=0; c<4; c++){
+		int p = c;
+		for(int r=c+1; r<4; r++){
+			if(fabs(J[r][c])>fabs(J[p][c])){
+				p = r;
+			}
+		}
+		if(J[p][c]==0){
+			return 0;
+		}
+		if(p!=c){
+			for(int k=0; k<4; k++){
+				double t = J[c][k];
+				J[c][k] = J[p][k];
+				J[p][k] = t;
+			}
+			det = -det;
+		}
+		det *= J[c][c];
+		for(int r=c+1; r<4; r++){
+			double f = J[r][c]/J[c][c];
+			for(int k=c; k<4; k++){
+				J[r][k] -= f*J[c][k];
+			}
+		}
+	}
+	return fabs(det);
+}
+
+//up to four solutions: elbow up/down, reaching forward or back over the base axis;
+//the one nearest Seed (forward, elbow up without a seed) that is within the limits
+int Kinematics::Solve(double x, double y, double z, double Pitch, double Q[4], const double Seed[]) const
+{
+	double a2 = DH[1].a, a3 = DH[2].a, a4 = DH[3].a;
+	double sa = sin(DH[0].alpha);
+	double r = sqrt(x*x+y*y);
+	double t1;
+	if(r>1e-9){
+		t1 = atan2(y, x);
+	}else{
+		t1 = Seed ? Sign[0]*Seed[0]+DH[0].offset : DH[0].offset;//on the base axis J1 is free
+	}
+	double h = (z-DH[0].d)/sa;
+	double wh = h-a4*sin(Pitch);
+	double best[4];
+	double bestCost = -1;
+	bool reach = false;
+	for(int side=0; side<2; side++){
+		double wr = (side==0 ? r : -r)-DH[0].a-a4*cos(Pitch);
+		double c3 = (wr*wr+wh*wh-a2*a2-a3*a3)/(2*a2*a3);
+		if(c3>1+1e-9 || c3<-1-1e-9){
+			continue;
+		}
+		reach = true;
+		if(c3>1){
+			c3 = 1;
+		}else if(c3<-1){
+			c3 = -1;
+		}
+		double q1 = Joint(0, side==0 ? t1 : t1+M_PI);
+		for(int e=0; e<2; e++){
+			//elbow up first: theta3 bends toward -y1, i.e. sign -sa
+			double t3 = (e==0 ? -1 : 1)*(sa<0 ? -1 : 1)*acos(c3);
+			double t2 = atan2(wh, wr)-atan2(a3*sin(t3), a2+a3*cos(t3));
+			double t4 = Pitch-t2-t3;
+			double q[4] = {q1, Joint(1, t2), Joint(2, t3), Joint(3, t4)};
+			if(!InLimits(0, q[0]) || !InLimits(1, q[1]) || !InLimits(2, q[2]) || !InLimits(3, q[3])){
+				continue;
+			}
+			double cost = 2*side+e;
+			if(Seed){
+				cost = 0;
+				for(int j=0; j<4; j++){
+					double d = fabs(q[j]-Seed[j]);
+					cost += d>M_PI ? 2*M_PI-d : d;
+				}
+			}
+			if(bestCost<0 || cost<bestCost){
+				bestCost = cost;
+				memcpy(best, q, sizeof(best));
+			}
+		}
+	}
+	if(!reach){
+		return 0;
+	}
+	if(bestCost<0){
+		return -1;
+	}
+	memcpy(Q, best, sizeof(best));
+	return 1;
+}
+
+int Kinematics::Inverse(const double P[4], double Q[], const double Seed[]) const
+{
+	double q[4];
+	int ok = Solve(P[0], P[1], P[2], P[3], q, Seed);
+	if(ok==1){
+		memcpy(Q, q, sizeof(q));
+	}
+	return ok;
+}
+
+void Kinematics::ForwardBatch(int N, const double *const Q[4], double *const P[4]) const
+{
+	double a1 = DH[0].a, a2 = DH[1].a, a3 = DH[2].a, a4 = DH[3].a;
+	double d1 = DH[0].d, sa = sin(DH[0].alpha);
+	double c1[KIN_BATCH_BLOCK], s1[KIN_BATCH_BLOCK], c2[KIN_BATCH_BLOCK], s2[KIN_BATCH_BLOCK];
+	double c3[KIN_BATCH_BLOCK], s3[KIN_BATCH_BLOCK], c4[KIN_BATCH_BLOCK], s4[KIN_BATCH_BLOCK];
+	double t[4][KIN_BATCH_BLOCK];
+	for(int b=0; b<N; b+=KIN_BATCH_BLOCK){
+		int n = N-b<KIN_BATCH_BLOCK ? N-b : KIN_BATCH_BLOCK;
+		//joint angles -> DH theta, then the trigonometry
+		for(int j=0; j<4; j++){
+			const double *q = Q[j]+b;
+			double S = Sign[j], O = DH[j].offset;
+			for(int i=0; i<n; i++){
+				t[j][i] = S*q[i]+O;
+			}
+		}
+		for(int i=0; i<n; i++){
+			c1[i] = cos(t[0][i]);
+			s1[i] = sin(t[0][i]);
+			c2[i] = cos(t[1][i]);
+			s2[i] = sin(t[1][i]);
+			c3[i] = cos(t[2][i]);
+			s3[i] = sin(t[2][i]);
+			c4[i] = cos(t[3][i]);
+			s4[i] = sin(t[3][i]);
+		}
+		//chain arithmetic: angle sums by the addition formulas, no calls
+		double *X = P[0]+b, *Y = P[1]+b, *Z = P[2]+b, *Pitch = P[3]+b;
+		for(int i=0; i<n; i++){
+			double c23 = c2[i]*c3[i]-s2[i]*s3[i];
+			double s23 = s2[i]*c3[i]+c2[i]*s3[i];
+			double c234 = c23*c4[i]-s23*s4[i];
+			double s234 = s23*c4[i]+c23*s4[i];
+			double r = a1+a2*c2[i]+a3*c23+a4*c234;
+			double h = a2*s2[i]+a3*s23+a4*s234;
+			X[i] = c1[i]*r;
+			Y[i] = s1[i]*r;
+			Z[i] = d1+sa*h;
+			Pitch[i] = t[1][i]+t[2][i]+t[3][i];
+		}
+	}
+}
+
+int Kinematics::InverseBatch(int N, const double *const P[4], double *const Q[4], u8 Ok[], const double Seed[]) const
+{
+	double seed[4];
+	bool seeded = Seed!=NULL;
+	if(seeded){
+		memcpy(seed, Seed, sizeof(seed));
+	}
+	int n = 0;
+	for(int i=0; i<N; i++){
+		double q[4];
+		int r = Solve(P[0][i], P[1][i], P[2][i], P[3][i], q, seeded ? seed : NULL);
+		Ok[i] = (r==1);
+		for(int j=0; j<4; j++){
+			Q[j][i] = r==1 ? q[j] : 0;
+		}
+		if(r==1){
+			memcpy(seed, q, sizeof(seed));
+			seeded = true;
+			n++;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,60 @@
+/*
+ * Kinematics.h
+ * Closed-form forward/inverse kinematics for the KikoBot C1 arm
+ *
+ * Standard DH chain (T = Rz(theta) Tz(d) Tx(a) Rx(alpha)) with the nominal
+ * parameters of calibration/robot_calibration.py: a base joint, three
+ * parallel pitch joints (shoulder, elbow, wrist) and a wrist roll/yaw pair
+ * that only turns the flange. Units are mm and radians. Joint angles are in
+ * arm coordinates (servo angle minus JOINT_OFFSET_DEG, see JointModel.h),
+ * theta = Sign*q + offset.
+ *
+ * The position of the flange depends on J1-J4 only, so Position()/Inverse()
+ * work on the 4-vector (x, y, z, pitch), pitch being the angle of the tool
+ * axis below horizontal (theta2+theta3+theta4). J5/J6 are left to the caller.
+ *
+ * The batch calls take structure-of-arrays buffers: trigonometry for a
+ * block of poses is done first, then the chain arithmetic runs as plain
+ * loops over contiguous arrays that the compiler vectorizes at -O3.
+ * Date: 2026.10.14
+ */
+
+#ifndef _KINEMATICS_H
+#define _KINEMATICS_H
+
+#include "INST.h"
+
+#define KIN_JOINTS 6
+#define KIN_BATCH_BLOCK 64//poses per trigonometry pass in the batch calls
+
+struct KinDH{
+	double a;//link length (mm)
+	double alpha;//link twist (rad)
+	double d;//link offset (mm)
+	double offset;//theta at q = 0 (rad)
+};
+
+class Kinematics
+{
+public:
+	Kinematics();//KikoBot C1 nominal model, limits from JointModel.h
+	void Forward(const double Q[KIN_JOINTS], double T[4][4]) const;//flange frame in the base frame, all joints
+	void Position(const double Q[], double P[4]) const;//x, y, z, pitch from J1-J4
+	int Inverse(const double P[4], double Q[], const double Seed[] = NULL) const;//J1-J4 into Q[0..3], the solution nearest Seed: 1 solved, 0 out of reach, -1 only outside the joint limits
+	void Jacobian(const double Q[], double J[4][4]) const;//d(x, y, z, pitch)/d(q1..q4)
+	double Manipulability(const double Q[]) const;//|det J|, 0 at singularities (arm stretched or folded, wrist on the base axis)
+	double Reach() const { return DH[1].a+DH[2].a; }//shoulder-to-wrist reach (mm)
+	void ForwardBatch(int N, const double *const Q[4], double *const P[4]) const;//Q[j][i] -> P[k][i]
+	int InverseBatch(int N, const double *const P[4], double *const Q[4], u8 Ok[], const double Seed[] = NULL) const;//each pose seeded by the previous one, returns poses solved
+public:
+	KinDH DH[KIN_JOINTS];
+	double Sign[KIN_JOINTS];//+1/-1: joint angle direction relative to DH theta
+	double Min[KIN_JOINTS];//joint limits (rad, arm coordinates)
+	double Max[KIN_JOINTS];
+private:
+	int Solve(double x, double y, double z, double Pitch, double Q[4], const double Seed[]) const;
+	double Joint(int j, double Theta) const;//DH theta -> joint angle in (-pi, pi]
+	bool InLimits(int j, double &q) const;//q or q -+ 2pi within the limits, q is moved there
+};
+
+#endif
@@ -13,6 +13,13 @@ SCS::SCS()
 {
 	Level = 1;//除广播指令所有指令返回应答
 	Error = 0;
+	syncReadRxBuff = NULL;
+	syncReadRxBuffLen = 0;
+	syncReadRxBuffMax = 0;
+	Trace = NULL;
+	Retries = 0;
+	syncReadHeap = false;
+	memset(syncReadRxIndex, 0, sizeof(syncReadRxIndex));
 }
 
 SCS::SCS(u8 End)
@@ -20,6 +27,13 @@ SCS::SCS(u8 End)
 	Level = 1;
 	this->End = End;
 	Error = 0;
+	syncReadRxBuff = NULL;
+	syncReadRxBuffLen = 0;
+	syncReadRxBuffMax = 0;
+	Trace = NULL;
+	Retries = 0;
+	syncReadHeap = false;
+	memset(syncReadRxIndex, 0, sizeof(syncReadRxIndex));
 }
 
 SCS::SCS(u8 End, u8 Level)
@@ -27,6 +41,13 @@ SCS::SCS(u8 End, u8 Level)
 	this->Level = Level;
 	this->End = End;
 	Error = 0;
+	syncReadRxBuff = NULL;
+	syncReadRxBuffLen = 0;
+	syncReadRxBuffMax = 0;
+	Trace = NULL;
+	Retries = 0;
+	syncReadHeap = false;
+	memset(syncReadRxIndex, 0, sizeof(syncReadRxIndex));
 }
 
 //1个16位数拆分为2个8位数
@@ -93,6 +114,7 @@ void SCS::writeBuf(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen, u8 Fun)
 //舵机ID，MemAddr内存表地址，写入数据，写入长度
 int SCS::genWrite(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen)
 {
+	SCS_TRACE_BEGIN(Trace, INST_WRITE, ID, rxParser);
 	rFlushSCS();
 	writeBuf(ID, MemAddr, nDat, nLen, INST_WRITE);
 	wFlushSCS();
@@ -103,6 +125,7 @@ int SCS::genWrite(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen)
 //舵机ID，MemAddr内存表地址，写入数据，写入长度
 int SCS::regWrite(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen)
 {
+	SCS_TRACE_BEGIN(Trace, INST_REG_WRITE, ID, rxParser);
 	rFlushSCS();
 	writeBuf(ID, MemAddr, nDat, nLen, INST_REG_WRITE);
 	wFlushSCS();
@@ -113,6 +136,7 @@ int SCS::regWrite(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen)
 //舵机ID
 int SCS::RegWriteAction(u8 ID)
 {
+	SCS_TRACE_BEGIN(Trace, INST_REG_ACTION, ID, rxParser);
 	rFlushSCS();
 	writeBuf(ID, 0, NULL, 0, INST_REG_ACTION);
 	wFlushSCS();
@@ -121,37 +145,48 @@ int SCS::RegWriteAction(u8 ID)
 
 //同步写指令
 //舵机ID[]数组，IDN数组长度，MemAddr内存表地址，写入数据，写入长度
+//帧长度字节为u8, 舵机数超过SCS_SYNC_WRITE_IDN(nLen)时分成多个帧, 一次写出
 void SCS::snycWrite(u8 ID[], u8 IDN, u8 MemAddr, u8 *nDat, u8 nLen)
 {
+	SCS_TRACE_BEGIN(Trace, INST_SYNC_WRITE, 0xfe, rxParser);
 	rFlushSCS();
-	u8 mesLen = ((nLen+1)*IDN+4);
-	u8 Sum = 0;
-	u8 bBuf[7];
-	bBuf[0] = 0xff;
-	bBuf[1] = 0xff;
-	bBuf[2] = 0xfe;
-	bBuf[3] = mesLen;
-	bBuf[4] = INST_SYNC_WRITE;
-	bBuf[5] = MemAddr;
-	bBuf[6] = nLen;
-	writeSCS(bBuf, 7);
+	int Per = SCS_SYNC_WRITE_IDN(nLen);
+	if(!Per){
+		SCS_TRACE_END(Trace, rxParser);
+		return;
+	}
+	for(int k=0; k<IDN; k+=Per){
+		int n = IDN-k<Per ? IDN-k : Per;
+		u8 mesLen = (nLen+1)*n+4;
+		u8 Sum = 0;
+		u8 bBuf[7];
+		bBuf[0] = 0xff;
+		bBuf[1] = 0xff;
+		bBuf[2] = 0xfe;
+		bBuf[3] = mesLen;
+		bBuf[4] = INST_SYNC_WRITE;
+		bBuf[5] = MemAddr;
+		bBuf[6] = nLen;
+		writeSCS(bBuf, 7);
 
-	Sum = 0xfe + mesLen + INST_SYNC_WRITE + MemAddr + nLen;
-	u8 i, j;
-	for(i=0; i<IDN; i++){
-		writeSCS(ID[i]);
-		writeSCS(nDat+i*nLen, nLen);
-		Sum += ID[i];
-		for(j=0; j<nLen; j++){
-			Sum += nDat[i*nLen+j];
+		Sum = 0xfe + mesLen + INST_SYNC_WRITE + MemAddr + nLen;
+		for(int i=k; i<k+n; i++){
+			writeSCS(ID[i]);
+			writeSCS(nDat+i*nLen, nLen);
+			Sum += ID[i];
+			for(int j=0; j<nLen; j++){
+				Sum += nDat[i*nLen+j];
+			}
 		}
+		writeSCS(~Sum);
 	}
-	writeSCS(~Sum);
 	wFlushSCS();
+	SCS_TRACE_END(Trace, rxParser);
 }
 
 int SCS::writeByte(u8 ID, u8 MemAddr, u8 bDat)
 {
+	SCS_TRACE_BEGIN(Trace, INST_WRITE, ID, rxParser);
 	rFlushSCS();
 	writeBuf(ID, MemAddr, &bDat, 1, INST_WRITE);
 	wFlushSCS();
@@ -162,6 +197,7 @@ int SCS::writeWord(u8 ID, u8 MemAddr, u16 wDat)
 {
 	u8 bBuf[2];
 	Host2SCS(bBuf+0, bBuf+1, wDat);
+	SCS_TRACE_BEGIN(Trace, INST_WRITE, ID, rxParser);
 	rFlushSCS();
 	writeBuf(ID, MemAddr, bBuf, 2, INST_WRITE);
 	wFlushSCS();
@@ -170,36 +206,31 @@ int SCS::writeWord(u8 ID, u8 MemAddr, u16 wDat)
 
 //读指令
 //舵机ID，MemAddr内存表地址，返回数据nData，数据长度nLen
+//无应答或长度不符时重发, 最多Retries次
 int SCS::Read(u8 ID, u8 MemAddr, u8 *nData, u8 nLen)
 {
-	rFlushSCS();
-	writeBuf(ID, MemAddr, &nLen, 1, INST_READ);
-	wFlushSCS();
+	for(u8 Try=0; ; Try++){
+		if(Try){
+			SCS_TRACE_RETRY(Trace, INST_READ, ID);
+		}
+		SCS_TRACE_BEGIN(Trace, INST_READ, ID, rxParser);
+		rFlushSCS();
+		writeBuf(ID, MemAddr, &nLen, 1, INST_READ);
+		wFlushSCS();
 
-	u8 bBuf[255];
-	u8 i;
-	u8 calSum = 0;
-	int Size = readSCS(bBuf, nLen+6);
-	//printf("nLen+6 = %d, Size = %d\n", nLen+6, Size);
-	if(Size!=(nLen+6)){
-		return 0;
-	}
-	//for(i=0; i<Size; i++){
-		//printf("%x\n", bBuf[i]);
-	//}
-	if(bBuf[0]!=0xff || bBuf[1]!=0xff){
-		return 0;
-	}
-	for(i=2; i<(Size-1); i++){
-		calSum += bBuf[i];
-	}
-	calSum = ~calSum;
-	if(calSum!=bBuf[Size-1]){
-		return 0;
+		SCSFrame Frame;
+		int Ok = readFrame(ID, &Frame, nLen+6);
+		SCS_TRACE_REPLY(Trace, ID, Ok && Frame.nLen==nLen, Ok ? Frame.Size : 0);
+		SCS_TRACE_END(Trace, rxParser);
+		if(Ok && Frame.nLen==nLen){
+			memcpy(nData, Frame.nDat, nLen);
+			Error = Frame.Error;
+			return nLen;
+		}
+		if(Try>=Retries){
+			return 0;
+		}
 	}
-	memcpy(nData, bBuf+5, nLen);
-	Error = bBuf[4];
-	return nLen;
 }
 
 //读1字节，超时返回-1
@@ -228,146 +259,232 @@ int SCS::readWord(u8 ID, u8 MemAddr)
 }
 
 //Ping指令，返回舵机ID，超时返回-1
+//无应答时重发, 最多Retries次
 int	SCS::Ping(u8 ID)
 {
-	rFlushSCS();
-	writeBuf(ID, 0, NULL, 0, INST_PING);
-	wFlushSCS();
-	Error = 0;
+	for(u8 Try=0; ; Try++){
+		if(Try){
+			SCS_TRACE_RETRY(Trace, INST_PING, ID);
+		}
+		SCS_TRACE_BEGIN(Trace, INST_PING, ID, rxParser);
+		rFlushSCS();
+		writeBuf(ID, 0, NULL, 0, INST_PING);
+		wFlushSCS();
+		Error = 0;
 
-	u8 bBuf[6];
-	u8 i;
-	u8 calSum = 0;
-	int Size = readSCS(bBuf, 6);
-	if(Size!=6){
-		return -1;
-	}
-	if(bBuf[0]!=0xff || bBuf[1]!=0xff){
-		return -1;
-	}
-	if(bBuf[2]!=ID && ID!=0xfe){
-		return -1;
-	}
-	if(bBuf[3]!=2){
-		return -1;
+		SCSFrame Frame;
+		int Ok = readFrame(ID, &Frame, 6);
+		SCS_TRACE_REPLY(Trace, ID, Ok && Frame.nLen==0, Ok ? Frame.Size : 0);
+		SCS_TRACE_END(Trace, rxParser);
+		if(Ok && Frame.nLen==0){
+			Error = Frame.ID;
+			return Error;
+		}
+		if(Try>=Retries){
+			return -1;
+		}
 	}
-	for(i=2; i<(Size-1); i++){
-		calSum += bBuf[i];
+}
+
+//广播Ping, 所有舵机同时应答, 多个应答在总线上可能互相冲突
+//逐帧接收直到超时, 跳过噪声和校验错误的帧, ID[]按到达顺序且不重复
+//Noise>0说明有应答损坏, 舵机数可能不全, 需逐个Ping确认
+int SCS::PingBroadcast(u8 ID[], int Max, int *Noise)
+{
+	SCS_TRACE_BEGIN(Trace, INST_PING, 0xfe, rxParser);
+	rFlushSCS();
+	writeBuf(0xfe, 0, NULL, 0, INST_PING);
+	wFlushSCS();
+	unsigned long Dropped = rxParser.Dropped;
+	unsigned long BadSum = rxParser.BadSum;
+	int n = 0;
+	SCSFrame Frame;
+	while(n<Max && readFrame(0xfe, &Frame, 6)){
+		if(Frame.nLen!=0){
+			continue;
+		}
+		int i = 0;
+		while(i<n && ID[i]!=Frame.ID){
+			i++;
+		}
+		if(i==n){
+			ID[n++] = Frame.ID;
+			SCS_TRACE_REPLY(Trace, Frame.ID, 1, Frame.Size);
+		}
 	}
-	calSum = ~calSum;
-	if(calSum!=bBuf[Size-1]){
-		return -1;
+	if(Noise){
+		*Noise = (int)(rxParser.Dropped-Dropped+rxParser.BadSum-BadSum);
 	}
-	Error = bBuf[2];
-	return Error;
+	SCS_TRACE_END(Trace, rxParser);
+	return n;
 }
 
 int	SCS::Ack(u8 ID)
 {
 	Error = 0;
 	if(ID!=0xfe && Level){
-		u8 bBuf[6];
-		u8 i;
-		u8 calSum = 0;
-		int Size = readSCS(bBuf, 6);
-		if(Size!=6){
+		SCSFrame Frame;
+		if(!readFrame(ID, &Frame, 6)){
+			SCS_TRACE_REPLY(Trace, ID, 0, 0);
+			SCS_TRACE_END(Trace, rxParser);
 			return 0;
 		}
-		if(bBuf[0]!=0xff || bBuf[1]!=0xff){
+		SCS_TRACE_REPLY(Trace, ID, Frame.nLen==0, Frame.Size);
+		SCS_TRACE_END(Trace, rxParser);
+		if(Frame.nLen!=0){
 			return 0;
 		}
-		if(bBuf[2]!=ID){
-			return 0;
+		Error = Frame.Error;
+		return 1;
+	}
+	SCS_TRACE_END(Trace, rxParser);
+	return 1;
+}
+
+//接收ID的应答帧, 跳过噪声、校验错误帧和其他ID的帧
+//frameLen为预期帧长, 用于决定每次readSCS的字节数
+int SCS::readFrame(u8 ID, SCSFrame *Frame, int frameLen)
+{
+	int Len = 0;
+	rxParser.Reset();
+	while(1){
+		int Used;
+		int got = rxParser.Parse(rxFrameBuf, Len, Frame, &Used);
+		if(got && (Frame->ID==ID || ID==0xfe)){
+			return 1;
 		}
-		if(bBuf[3]!=2){
-			return 0;
+		Len -= Used;
+		memmove(rxFrameBuf, rxFrameBuf+Used, Len);
+		if(got){
+			continue;
+		}
+		int want = Len ? rxParser.Need : frameLen;
+		if(want<1){
+			want = 1;
 		}
-		for(i=2; i<(Size-1); i++){
-			calSum += bBuf[i];
+		if(want>(int)sizeof(rxFrameBuf)-Len){
+			want = sizeof(rxFrameBuf)-Len;
 		}
-		calSum = ~calSum;
-		if(calSum!=bBuf[Size-1]){
+		int n = readSCS(rxFrameBuf+Len, want);
+		if(n<=0){
 			return 0;
 		}
-		Error = bBuf[4];
+		Len += n;
 	}
-	return 1;
 }
 
+//熔断中的舵机不写入指令包, 只等待其余舵机的应答
 int	SCS::syncReadPacketTx(u8 ID[], u8 IDN, u8 MemAddr, u8 nLen)
 {
+	SCSParser Parser;
+	SCS_TRACE_BEGIN(Trace, INST_SYNC_READ, 0xfe, Parser);
 	rFlushSCS();
 	syncReadRxPacketLen = nLen;
-	u8 checkSum = (4+0xfe)+IDN+MemAddr+nLen+INST_SYNC_READ;
 	u8 i;
+	u8 n = 0;
+	//清除上次的索引: 本次未请求的ID查询失败, 不返回旧数据
+	memset(syncReadRxIndex, 0, sizeof(syncReadRxIndex));
+	for(i=0; i<IDN; i++){
+		if(syncReadSkip(ID[i])){
+			syncReadRxIndex[ID[i]] = SCS_SYNC_DROPPED;
+		}else{
+			n++;
+		}
+	}
+	if(!n || n>SCS_SYNC_READ_IDN){
+		syncReadRxBuffLen = 0;
+		SCS_TRACE_END(Trace, Parser);
+		return 0;
+	}
+	u8 checkSum = (4+0xfe)+n+MemAddr+nLen+INST_SYNC_READ;
 	writeSCS(0xff);
 	writeSCS(0xff);
 	writeSCS(0xfe);
-	writeSCS(IDN+4);
+	writeSCS(n+4);
 	writeSCS(INST_SYNC_READ);
 	writeSCS(MemAddr);
 	writeSCS(nLen);
 	for(i=0; i<IDN; i++){
-		writeSCS(ID[i]);
-		checkSum += ID[i];
+		if(syncReadRxIndex[ID[i]]!=SCS_SYNC_DROPPED){
+			writeSCS(ID[i]);
+			checkSum += ID[i];
+		}
 	}
 	checkSum = ~checkSum;
 	writeSCS(checkSum);
 	wFlushSCS();
 	
-	syncReadRxBuffLen = readSCS(syncReadRxBuff, syncReadRxBuffMax);
+	int rxLen = n*(nLen+6);
+	if(rxLen>syncReadRxBuffMax){
+		rxLen = syncReadRxBuffMax;
+	}
+	syncReadWait(rxLen);
+	syncReadRxBuffLen = readSCS(syncReadRxBuff, rxLen);
+
+	//一次线性解析所有应答帧, 建立ID到帧偏移的索引
+	SCSFrame Frame;
+	int Pos = 0;
+	while(Pos<syncReadRxBuffLen){
+		int Used;
+		int got = Parser.Parse(syncReadRxBuff+Pos, syncReadRxBuffLen-Pos, &Frame, &Used);
+		if(!got){
+			break;
+		}
+		if(Frame.nLen==nLen && syncReadRxIndex[Frame.ID]!=SCS_SYNC_DROPPED){
+			syncReadRxIndex[Frame.ID] = (Frame.Raw-syncReadRxBuff)+1;
+		}
+		Pos += Used;
+	}
+	syncReadResult(ID, IDN);
+#ifdef SCS_TRACE
+	if(Trace){
+		for(i=0; i<IDN; i++){
+			u16 Index = syncReadRxIndex[ID[i]];
+			if(Index!=SCS_SYNC_DROPPED){
+				Trace->Reply(ID[i], Index!=0, Index ? nLen+6 : 0);
+			}
+		}
+		Trace->End(Parser);
+	}
+#endif
 	return syncReadRxBuffLen;
 }
 
 void SCS::syncReadBegin(u8 IDN, u8 rxLen)
 {
+	syncReadEnd();
 	syncReadRxBuffMax = IDN*(rxLen+6);
-	syncReadRxBuff = new u8[syncReadRxBuffMax];
+	if(syncReadRxBuffMax<=SCS_SYNC_RX_ARENA){
+		syncReadRxBuff = syncReadArena;
+	}else{
+		syncReadRxBuff = new u8[syncReadRxBuffMax];
+		syncReadHeap = true;
+	}
 }
 
 void SCS::syncReadEnd()
 {
-	if(syncReadRxBuff){
-		delete syncReadRxBuff;
-		syncReadRxBuff = NULL;
+	if(syncReadHeap){
+		delete[] syncReadRxBuff;
+		syncReadHeap = false;
 	}
+	syncReadRxBuff = NULL;
+	syncReadRxBuffMax = 0;
 }
 
+//按syncReadPacketTx建立的索引直接取帧, 帧已在解析时校验
 int SCS::syncReadPacketRx(u8 ID, u8 *nDat)
 {
-	u16 syncReadRxBuffIndex = 0;
 	syncReadRxPacket = nDat;
 	syncReadRxPacketIndex = 0;
-	while((syncReadRxBuffIndex+6+syncReadRxPacketLen)<=syncReadRxBuffLen){
-		u8 bBuf[] = {0, 0, 0};
-		u8 calSum = 0;
-		while(syncReadRxBuffIndex<syncReadRxBuffLen){
-			bBuf[0] = bBuf[1];
-			bBuf[1] = bBuf[2];
-			bBuf[2] = syncReadRxBuff[syncReadRxBuffIndex++];
-			if(bBuf[0]==0xff && bBuf[1]==0xff && bBuf[2]!=0xff){
-				break;
-			}
-		}
-		if(bBuf[2]!=ID){
-			continue;
-		}
-		if(syncReadRxBuff[syncReadRxBuffIndex++]!=(syncReadRxPacketLen+2)){
-			continue;
-		}
-		Error = syncReadRxBuff[syncReadRxBuffIndex++];
-		calSum = ID+(syncReadRxPacketLen+2)+Error;
-		for(u8 i=0; i<syncReadRxPacketLen; i++){
-			syncReadRxPacket[i] = syncReadRxBuff[syncReadRxBuffIndex++];
-			calSum += syncReadRxPacket[i];
-		}
-		calSum = ~calSum;
-		if(calSum!=syncReadRxBuff[syncReadRxBuffIndex++]){
-			return 0;
-		}
-		return syncReadRxPacketLen;
+	u16 Index = syncReadRxIndex[ID];
+	if(!Index || Index-1+syncReadRxPacketLen+6>syncReadRxBuffLen){
+		return 0;
 	}
-	return 0;
+	const u8 *bBuf = syncReadRxBuff+Index-1;
+	Error = bBuf[4];
+	memcpy(syncReadRxPacket, bBuf+5, syncReadRxPacketLen);
+	return syncReadRxPacketLen;
 }
 
 int SCS::syncReadRxPacketToByte()
@@ -9,6 +9,13 @@
 #define _SCS_H
 
 #include "INST.h"
+#include "SCSParser.h"
+#include "SCSTrace.h"
+
+#define SCS_SYNC_DROPPED 0xffff//syncReadRxIndex: 熔断中, 未包含在同步读指令包内
+#define SCS_SYNC_WRITE_IDN(nLen) ((255-4)/((nLen)+1))//单个SYNC_WRITE帧最多舵机数(帧长度字节为u8), 超出时snycWrite分帧
+#define SCS_SYNC_READ_IDN 251//单个SYNC_READ帧最多舵机数
+#define SCS_SYNC_RX_ARENA 1024//syncReadBegin()常驻接收缓冲, 更大时才在堆上分配
 
 class SCS{
 public:
@@ -25,12 +32,14 @@ public:
 	int readByte(u8 ID, u8 MemAddr);//读1个字节
 	int readWord(u8 ID, u8 MemAddr);//读2个字节
 	int Ping(u8 ID);//Ping指令
+	int PingBroadcast(u8 ID[], int Max, int *Noise = NULL);//广播Ping, 收集可解析的应答(冲突损坏的跳过), 返回舵机数, Noise为噪声字节数+校验错误帧数
 	int syncReadPacketTx(u8 ID[], u8 IDN, u8 MemAddr, u8 nLen);//同步读指令包发送
 	int syncReadPacketRx(u8 ID, u8 *nDat);//同步读返回包解码，成功返回内存字节数，失败返回0
 	int syncReadRxPacketToByte();//解码一个字节
 	int syncReadRxPacketToWrod(u8 negBit=0);//解码两个字节，negBit为方向为，negBit=0表示无方向
-	void syncReadBegin(u8 IDN, u8 rxLen);//同步读开始
+	void syncReadBegin(u8 IDN, u8 rxLen);//同步读开始, IDN*(rxLen+6)不超过SCS_SYNC_RX_ARENA时不分配内存
 	void syncReadEnd();//同步读结束
+	bool syncReadDropped(u8 ID){  return syncReadRxIndex[ID]==SCS_SYNC_DROPPED;  }//上次同步读因熔断跳过ID
 public:
 	u8	Level;//舵机返回等级
 	u8	End;//处理器大小端结构
@@ -41,16 +50,27 @@ public:
 	u8 *syncReadRxBuff;
 	u16 syncReadRxBuffLen;
 	u16 syncReadRxBuffMax;
+	SCSTrace *Trace;//收发统计/跟踪, NULL为关闭(需-DSCS_TRACE编译)
+	u8 Retries;//Read/Ping无应答时重发次数(幂等指令), 默认0
 protected:
 	virtual int writeSCS(unsigned char *nDat, int nLen) = 0;
 	virtual int readSCS(unsigned char *nDat, int nLen) = 0;
 	virtual int writeSCS(unsigned char bDat) = 0;
 	virtual void rFlushSCS() = 0;
 	virtual void wFlushSCS() = 0;
+	virtual int readFrame(u8 ID, SCSFrame *Frame, int frameLen);//接收ID的应答帧(ID=0xfe为任意ID), 帧视图在下次接收前有效
+	virtual bool syncReadSkip(u8 /*ID*/){  return false;  }//同步读指令包是否略去ID(熔断)
+	virtual void syncReadWait(int /*rxLen*/){}//同步读接收rxLen字节之前, 设定超时
+	virtual void syncReadResult(u8 /*ID*/[], u8 /*IDN*/){}//同步读解析之后, 按syncReadRxIndex统计应答
 protected:
 	void writeBuf(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen, u8 Fun);
 	void Host2SCS(u8 *DataL, u8* DataH, u16 Data);//1个16位数拆分为2个8位数
 	u16	SCS2Host(u8 DataL, u8 DataH);//2个8位数组合为1个16位数
 	int	Ack(u8 ID);//返回应答
+	SCSParser rxParser;//应答帧解析器
+	u8 rxFrameBuf[SCS_FRAME_MAX];//readFrame()接收缓冲
+	u16 syncReadRxIndex[256];//同步读应答帧在syncReadRxBuff中的偏移+1, 0为无应答
+	u8 syncReadArena[SCS_SYNC_RX_ARENA];
+	bool syncReadHeap;//syncReadRxBuff由syncReadBegin()在堆上分配
 };
 #endif
\ No newline at end of file
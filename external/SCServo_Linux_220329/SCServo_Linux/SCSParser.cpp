@@ -0,0 +1,112 @@
+/*
+ * SCSParser.cpp
+ * Incremental SCS reply frame parser
+ * Date: 2026.10.14
+ */
+
+#include "SCSParser.h"
+
+SCSParser::SCSParser()
+{
+	Frames = 0;
+	Dropped = 0;
+	BadSum = 0;
+	Reset();
+}
+
+void SCSParser::Reset()
+{
+	have = 0;
+	Need = 4;
+}
+
+int SCSParser::Parse(const u8 *Buf, int Len, SCSFrame *Frame, int *Used)
+{
+	int drop = 0;
+	while(1){
+		const u8 *p = Buf+drop;
+		int n = Len-drop;
+		if(have==0){
+			while(n>0 && *p!=0xff){
+				p++;
+				n--;
+				drop++;
+				Dropped++;
+			}
+			if(n<=0){
+				Need = 4;
+				break;
+			}
+			have = 1;
+		}
+		if(have==1){
+			if(n<2){
+				Need = 4-n;
+				break;
+			}
+			if(p[1]!=0xff){
+				drop++;
+				Dropped++;
+				have = 0;
+				continue;
+			}
+			have = 2;
+		}
+		if(have==2){
+			if(n<3){
+				Need = 4-n;
+				break;
+			}
+			if(p[2]==0xff){
+				//0xFF 0xFF 0xFF: header may start one byte later
+				drop++;
+				Dropped++;
+				continue;
+			}
+			have = 3;
+		}
+		if(have==3){
+			if(n<4){
+				Need = 1;
+				break;
+			}
+			if(p[3]<2){
+				drop++;
+				Dropped++;
+				have = 0;
+				continue;
+			}
+			have = 4;
+		}
+		int Size = p[3]+4;
+		if(n<Size){
+			Need = Size-n;
+			break;
+		}
+		u8 calSum = 0;
+		for(int i=2; i<Size-1; i++){
+			calSum += p[i];
+		}
+		if((u8)~calSum!=p[Size-1]){
+			//resync from the byte after this header
+			BadSum++;
+			drop++;
+			Dropped++;
+			have = 0;
+			continue;
+		}
+		Frame->Raw = p;
+		Frame->ID = p[2];
+		Frame->Error = p[4];
+		Frame->nDat = p+5;
+		Frame->nLen = p[3]-2;
+		Frame->Size = Size;
+		*Used = drop+Size;
+		have = 0;
+		Need = 4;
+		Frames++;
+		return 1;
+	}
+	*Used = drop;
+	return 0;
+}
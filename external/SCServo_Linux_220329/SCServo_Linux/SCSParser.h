@@ -0,0 +1,44 @@
+/*
+ * SCSParser.h
+ * Incremental SCS reply frame parser
+ * Hunts 0xFF 0xFF headers, validates length and checksum and returns
+ * frame views into the caller's buffer without copying
+ * Date: 2026.10.14
+ */
+
+#ifndef _SCSPARSER_H
+#define _SCSPARSER_H
+
+#include "INST.h"
+
+#define SCS_FRAME_MAX 260//0xFF 0xFF ID LEN + up to 255 LEN bytes
+
+//view of one reply frame, points into the parsed buffer
+struct SCSFrame{
+	const u8 *Raw;//frame start (0xFF 0xFF)
+	u8 ID;
+	u8 Error;//servo status byte
+	const u8 *nDat;//parameter bytes
+	u8 nLen;
+	u16 Size;//total frame bytes, checksum included
+};
+
+class SCSParser
+{
+public:
+	SCSParser();
+	void Reset();//forget any partial frame
+	//Buf[0..Len) are the bytes not yet consumed; the caller appends to Buf between calls
+	//and drops *Used bytes (noise + the returned frame) from the front after each call
+	//returns 1 with Frame filled when a frame completes, 0 when more bytes are needed
+	int Parse(const u8 *Buf, int Len, SCSFrame *Frame, int *Used);
+public:
+	int Need;//after Parse()==0: bytes still missing for the current candidate frame
+	unsigned long Frames;//frames returned
+	unsigned long Dropped;//noise bytes skipped while resynchronizing
+	unsigned long BadSum;//candidates rejected by checksum
+private:
+	int have;//header bytes of the candidate at Buf[0] already validated (0-4)
+};
+
+#endif
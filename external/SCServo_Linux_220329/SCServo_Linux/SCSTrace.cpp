@@ -0,0 +1,250 @@
+/*
+ * SCSTrace.cpp
+ * Bus transaction counters and Chrome trace output for SCS/SCSerial
+ * Date: 2026.10.14
+ */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "SCSTrace.h"
+
+static long long traceUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
+
+SCSTrace::SCSTrace()
+{
+	chrome = NULL;
+	Reset();
+}
+
+SCSTrace::~SCSTrace()
+{
+	CloseChrome();
+}
+
+void SCSTrace::Reset()
+{
+	memset(servo, 0, sizeof(servo));
+	memset(inst, 0, sizeof(inst));
+	total = 0;
+	active = false;
+}
+
+int SCSTrace::InstIndex(u8 Inst)
+{
+	switch(Inst){
+	case INST_PING:
+		return 0;
+	case INST_READ:
+		return 1;
+	case INST_WRITE:
+		return 2;
+	case INST_REG_WRITE:
+		return 3;
+	case INST_REG_ACTION:
+		return 4;
+	case INST_SYNC_READ:
+		return 5;
+	case INST_SYNC_WRITE:
+		return 6;
+	default:
+		return 7;
+	}
+}
+
+const char *SCSTrace::InstName(u8 Inst)
+{
+	static const char *Names[SCS_TRACE_INSTS] = {"PING", "READ", "WRITE", "REG_WRITE", "ACTION", "SYNC_READ", "SYNC_WRITE", "OTHER"};
+	return Names[InstIndex(Inst)];
+}
+
+void SCSTrace::Begin(u8 Inst, u8 ID, const SCSParser &Parser)
+{
+	active = true;
+	curInst = Inst;
+	curID = ID;
+	t0 = traceUs();
+	dropped0 = Parser.Dropped;
+	badSum0 = Parser.BadSum;
+	tx = 0;
+	rx = 0;
+	replies = 0;
+	failed = 0;
+}
+
+void SCSTrace::Tx(int nLen)
+{
+	if(active && nLen>0){
+		tx += nLen;
+	}
+}
+
+void SCSTrace::Reply(u8 ID, int Ok, int RxBytes)
+{
+	if(!active){
+		return;
+	}
+	SCSTraceStats &S = servo[ID];
+	S.Txn++;
+	replies++;
+	if(RxBytes>0){
+		rx += RxBytes;
+		S.RxBytes += RxBytes;
+	}
+	if(Ok){
+		S.Ok++;
+		Account(S, (long)(traceUs()-t0));
+	}else if(failed<(int)sizeof(failedID)){
+		failedID[failed++] = ID;
+	}
+}
+
+void SCSTrace::Account(SCSTraceStats &S, long LatencyUs)
+{
+	int bin = 0;
+	while(bin<SCS_TRACE_HIST_BINS-1 && LatencyUs>=(1L<<bin)){
+		bin++;
+	}
+	S.LatencyHist[bin]++;
+	if(LatencyUs>S.MaxLatencyUs){
+		S.MaxLatencyUs = LatencyUs;
+	}
+}
+
+void SCSTrace::End(const SCSParser &Parser)
+{
+	if(!active){
+		return;
+	}
+	active = false;
+	long long t1 = traceUs();
+	long latency = (long)(t1-t0);
+	unsigned long noise = Parser.Dropped-dropped0;
+	unsigned long badSum = Parser.BadSum-badSum0;
+	//a failed reply is put down to a bad checksum while there are rejected frames left, else to a timeout
+	int bad = (unsigned long)failed<badSum ? failed : (int)badSum;
+
+	SCSTraceStats &I = inst[InstIndex(curInst)];
+	I.Txn++;
+	I.Ok += (failed==0);
+	I.Timeouts += failed-bad;
+	I.BadHeader += noise;
+	I.BadSum += badSum;
+	I.TxBytes += tx;
+	I.RxBytes += rx;
+	Account(I, latency);
+
+	//per servo: requests and noise go to the addressed servo (0xfe = broadcast row)
+	SCSTraceStats &S = servo[curID];
+	if(replies==0){
+		S.Txn++;
+		S.Ok++;
+		Account(S, latency);
+	}
+	S.TxBytes += tx;
+	S.BadHeader += noise;
+	for(int i=0; i<failed; i++){
+		if(i<bad){
+			servo[failedID[i]].BadSum++;
+		}else{
+			servo[failedID[i]].Timeouts++;
+		}
+	}
+	total++;
+
+	if(chrome){
+		fprintf(chrome, "%s\n{\"name\":\"%s\",\"cat\":\"scs\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%ld,\"pid\":%d,\"tid\":%d,"
+			"\"args\":{\"id\":%d,\"replies\":%d,\"failed\":%d,\"tx\":%lu,\"rx\":%lu,\"bad_sum\":%lu,\"noise\":%lu}}",
+			firstEvent ? "" : ",", InstName(curInst), t0, latency, pid, tid,
+			curID, replies, failed, tx, rx, badSum, noise);
+		firstEvent = false;
+	}
+}
+
+void SCSTrace::Retry(u8 Inst, u8 ID)
+{
+	inst[InstIndex(Inst)].Retries++;
+	servo[ID].Retries++;
+}
+
+bool SCSTrace::OpenChrome(const char *Path)
+{
+	CloseChrome();
+	chrome = fopen(Path, "w");
+	if(!chrome){
+		perror("fopen:");
+		return false;
+	}
+	fprintf(chrome, "[");
+	firstEvent = true;
+	pid = getpid();
+	tid = (int)syscall(SYS_gettid);
+	return true;
+}
+
+void SCSTrace::CloseChrome()
+{
+	if(chrome){
+		fprintf(chrome, "\n]\n");
+		fclose(chrome);
+		chrome = NULL;
+	}
+}
+
+static long histPercentile(const SCSTraceStats &S, double P)
+{
+	unsigned long n = 0;
+	for(int i=0; i<SCS_TRACE_HIST_BINS; i++){
+		n += S.LatencyHist[i];
+	}
+	if(!n){
+		return 0;
+	}
+	unsigned long want = (unsigned long)(n*P+0.999999), seen = 0;
+	for(int i=0; i<SCS_TRACE_HIST_BINS-1; i++){
+		seen += S.LatencyHist[i];
+		if(seen>=want){
+			return (1L<<i)<S.MaxLatencyUs ? (1L<<i) : S.MaxLatencyUs;
+		}
+	}
+	return S.MaxLatencyUs;
+}
+
+static void printRow(FILE *out, const char *Name, const SCSTraceStats &S)
+{
+	fprintf(out, "  %-10s %8lu %8lu %6lu %6lu %6lu %6lu %9lu %9lu %7ld %7ld %8ld\n",
+		Name, S.Txn, S.Ok, S.Timeouts, S.BadHeader, S.BadSum, S.Retries, S.TxBytes, S.RxBytes,
+		histPercentile(S, 0.5), histPercentile(S, 0.99), S.MaxLatencyUs);
+}
+
+void SCSTrace::Print(FILE *out)
+{
+	fprintf(out, "bus trace: %lu transactions\n", total);
+	const char *Head = "  %-10s %8s %8s %6s %6s %6s %6s %9s %9s %7s %7s %8s\n";
+	fprintf(out, Head, "inst", "txn", "ok", "t/o", "noise", "badsum", "retry", "tx B", "rx B", "p50<us", "p99<us", "max us");
+	static const u8 Insts[SCS_TRACE_INSTS] = {INST_PING, INST_READ, INST_WRITE, INST_REG_WRITE, INST_REG_ACTION, INST_SYNC_READ, INST_SYNC_WRITE, 0};
+	for(int i=0; i<SCS_TRACE_INSTS; i++){
+		if(inst[i].Txn){
+			printRow(out, InstName(Insts[i]), inst[i]);
+		}
+	}
+	fprintf(out, Head, "servo", "txn", "ok", "t/o", "noise", "badsum", "retry", "tx B", "rx B", "p50<us", "p99<us", "max us");
+	for(int ID=0; ID<256; ID++){
+		if(!servo[ID].Txn && !servo[ID].Retries){
+			continue;
+		}
+		char Name[16];
+		if(ID==0xfe){
+			snprintf(Name, sizeof(Name), "broadcast");
+		}else{
+			snprintf(Name, sizeof(Name), "%d", ID);
+		}
+		printRow(out, Name, servo[ID]);
+	}
+}
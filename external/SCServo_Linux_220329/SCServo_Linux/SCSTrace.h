@@ -0,0 +1,104 @@
+/*
+ * SCSTrace.h
+ * Bus transaction counters and Chrome trace output for SCS/SCSerial
+ *
+ * Built with -DSCS_TRACE (cmake -DSCSERVO_TRACE=ON), every transaction in
+ * Read, Ping, Ack (genWrite/regWrite/RegWriteAction/writeByte/writeWord),
+ * snycWrite, syncReadPacketTx and runQueue is counted per servo and per
+ * instruction in the SCSTrace pointed to by SCS::Trace:
+ *   transactions, answered replies, timeouts, noise bytes before a header
+ *   (BadHeader), checksum failures, retries, TX/RX bytes and a latency
+ *   histogram from the first byte written to the last byte parsed.
+ * With OpenChrome() each transaction is also written as a Chrome trace
+ * "complete" event (chrome://tracing, ui.perfetto.dev).
+ *
+ * Without SCS_TRACE the hooks compile to nothing; with it, a NULL Trace
+ * costs one pointer test per transaction. The SCS layout is the same either
+ * way. Counters belong to the thread driving the bus: read them from that
+ * thread or once it has stopped.
+ * Date: 2026.10.14
+ */
+
+#ifndef _SCSTRACE_H
+#define _SCSTRACE_H
+
+#include <stdio.h>
+#include "SCSParser.h"
+
+//latency histogram: bin 0 = <1us, bin i = [2^(i-1), 2^i) us, last bin = everything above
+#define SCS_TRACE_HIST_BINS 18
+#define SCS_TRACE_INSTS 8//PING READ WRITE REG_WRITE ACTION SYNC_READ SYNC_WRITE, other
+
+struct SCSTraceStats{
+	unsigned long Txn;//transactions (per servo: replies expected from it)
+	unsigned long Ok;//answered
+	unsigned long Timeouts;//no reply before the timeout (IOTimeOut, or the adaptive one)
+	unsigned long BadHeader;//noise bytes skipped while looking for 0xFF 0xFF
+	unsigned long BadSum;//replies rejected by checksum
+	unsigned long Retries;
+	unsigned long TxBytes;
+	unsigned long RxBytes;
+	long MaxLatencyUs;
+	unsigned long LatencyHist[SCS_TRACE_HIST_BINS];
+};
+
+class SCSTrace
+{
+public:
+	SCSTrace();
+	~SCSTrace();
+	//hooks, called through the SCS_TRACE_* macros
+	void Begin(u8 Inst, u8 ID, const SCSParser &Parser);//before the request is flushed
+	void Tx(int nLen);//bytes flushed
+	void Reply(u8 ID, int Ok, int RxBytes);//one expected reply, received or not
+	void End(const SCSParser &Parser);//after the last reply; Parser is the one given to Begin
+	void Retry(u8 Inst, u8 ID);
+	//results
+	const SCSTraceStats &Servo(u8 ID) const { return servo[ID]; }
+	const SCSTraceStats &Inst(u8 Inst) const { return inst[InstIndex(Inst)]; }
+	unsigned long Transactions() const { return total; }
+	void Reset();
+	void Print(FILE *out = stdout);
+	static int InstIndex(u8 Inst);
+	static const char *InstName(u8 Inst);
+	//Chrome trace event file
+	bool OpenChrome(const char *Path);
+	void CloseChrome();
+private:
+	void Account(SCSTraceStats &S, long LatencyUs);
+	SCSTraceStats servo[256];
+	SCSTraceStats inst[SCS_TRACE_INSTS];
+	unsigned long total;
+	//current transaction
+	bool active;
+	u8 curInst;
+	u8 curID;
+	long long t0;
+	unsigned long dropped0;
+	unsigned long badSum0;
+	unsigned long tx;
+	unsigned long rx;
+	int replies;
+	int failed;
+	u8 failedID[32];//servos without a reply, in order
+	FILE *chrome;
+	bool firstEvent;
+	int pid;
+	int tid;
+};
+
+#ifdef SCS_TRACE
+#define SCS_TRACE_BEGIN(T, Inst, ID, Parser) do{ if(T) (T)->Begin(Inst, ID, Parser); }while(0)
+#define SCS_TRACE_TX(T, nLen) do{ if(T) (T)->Tx(nLen); }while(0)
+#define SCS_TRACE_REPLY(T, ID, Ok, RxBytes) do{ if(T) (T)->Reply(ID, Ok, RxBytes); }while(0)
+#define SCS_TRACE_END(T, Parser) do{ if(T) (T)->End(Parser); }while(0)
+#define SCS_TRACE_RETRY(T, Inst, ID) do{ if(T) (T)->Retry(Inst, ID); }while(0)
+#else
+#define SCS_TRACE_BEGIN(T, Inst, ID, Parser) do{}while(0)
+#define SCS_TRACE_TX(T, nLen) do{}while(0)
+#define SCS_TRACE_REPLY(T, ID, Ok, RxBytes) do{}while(0)
+#define SCS_TRACE_END(T, Parser) do{}while(0)
+#define SCS_TRACE_RETRY(T, Inst, ID) do{}while(0)
+#endif
+
+#endif
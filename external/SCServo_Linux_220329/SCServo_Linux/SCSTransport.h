@@ -0,0 +1,25 @@
+/*
+ * SCSTransport.h
+ * Byte transport under SCSerial
+ * SCSerial talks to a termios serial port by default; with a transport set
+ * (begin(baudRate, Transport) or begin(baudRate, "sim...")) every packet
+ * goes through this interface instead
+ * Date: 2026.10.14
+ */
+
+#ifndef _SCSTRANSPORT_H
+#define _SCSTRANSPORT_H
+
+#include "INST.h"
+
+class SCSTransport
+{
+public:
+	virtual ~SCSTransport(){}
+	virtual int Write(const u8 *nDat, int nLen) = 0;//send one burst of host packets, returns bytes accepted
+	virtual int Read(u8 *nDat, int nLen, long TimeOutUs) = 0;//up to nLen bytes, waiting at most TimeOutUs for them
+	virtual void FlushRx() = 0;//drop received bytes not yet read
+	virtual int SetBaudRate(int Baud) = 0;//-1 if not supported
+};
+
+#endif
@@ -1,4 +1,4 @@
-/*
+﻿/*
  * SCSerial.h
  * 串行舵机硬件接口层程序
  * 日期: 2022.3.29
@@ -6,12 +6,44 @@
  */
 
 #include "SCSerial.h"
+#include "SimulatedBus.h"
+#include "SerialBaud.h"
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+static long long monoUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
 
 SCSerial::SCSerial()
 {
 	IOTimeOut = 100;
 	fd = -1;
 	txBufLen = 0;
+	txOverflow = false;
+	TxOverflows = 0;
+	Err = 0;
+	LowLatency = false;
+	epfd = -1;
+	serialFlags = -1;
+	rxHead = rxTail = 0;
+	txnN = 0;
+	transport = NULL;
+	ownTransport = false;
+	baud = 0;
+	AdaptiveTimeOut = false;
+	BreakerMisses = 0;
+	BreakerMs = SCSERIAL_BREAKER_MS;
+	rxBudgetUs = 0;
+	txDoneUs = 0;
+	txLen = 0;
+	resetLinks();
 }
 
 SCSerial::SCSerial(u8 End):SCS(End)
@@ -19,6 +51,24 @@ SCSerial::SCSerial(u8 End):SCS(End)
 	IOTimeOut = 100;
 	fd = -1;
 	txBufLen = 0;
+	txOverflow = false;
+	TxOverflows = 0;
+	Err = 0;
+	LowLatency = false;
+	epfd = -1;
+	serialFlags = -1;
+	rxHead = rxTail = 0;
+	txnN = 0;
+	transport = NULL;
+	ownTransport = false;
+	baud = 0;
+	AdaptiveTimeOut = false;
+	BreakerMisses = 0;
+	BreakerMs = SCSERIAL_BREAKER_MS;
+	rxBudgetUs = 0;
+	txDoneUs = 0;
+	txLen = 0;
+	resetLinks();
 }
 
 SCSerial::SCSerial(u8 End, u8 Level):SCS(End, Level)
@@ -26,17 +76,47 @@ SCSerial::SCSerial(u8 End, u8 Level):SCS(End, Level)
 	IOTimeOut = 100;
 	fd = -1;
 	txBufLen = 0;
+	txOverflow = false;
+	TxOverflows = 0;
+	Err = 0;
+	LowLatency = false;
+	epfd = -1;
+	serialFlags = -1;
+	rxHead = rxTail = 0;
+	txnN = 0;
+	transport = NULL;
+	ownTransport = false;
+	baud = 0;
+	AdaptiveTimeOut = false;
+	BreakerMisses = 0;
+	BreakerMs = SCSERIAL_BREAKER_MS;
+	rxBudgetUs = 0;
+	txDoneUs = 0;
+	txLen = 0;
+	resetLinks();
+}
+
+SCSerial::~SCSerial()
+{
+	end();
+	syncReadEnd();
 }
 
 bool SCSerial::begin(int baudRate, const char* serialPort)
 {
-	if(fd != -1){
-		close(fd);
-		fd = -1;
+	if(fd != -1 || transport){
+		end();
 	}
 	//printf("servo port:%s\n", serialPort);
     if(serialPort == NULL)
 		return false;
+	SimulatedBus *Sim = SimulatedBus::Create(serialPort);
+	if(Sim){
+		printf("simulated bus %s, %d servos\n", serialPort, Sim->Servos());
+		begin(baudRate, Sim);
+		ownTransport = true;
+		return true;
+	}
     fd = open(serialPort, O_RDWR | O_NOCTTY | O_NONBLOCK);
     if(fd == -1){
 		perror("open:");
@@ -45,36 +125,6 @@ bool SCSerial::begin(int baudRate, const char* serialPort)
     fcntl(fd, F_SETFL, FNDELAY);
     tcgetattr(fd, &orgopt);
     tcgetattr(fd, &curopt);
-    speed_t CR_BAUDRATE;
-    switch(baudRate){
-    case 9600:
-        CR_BAUDRATE = B9600;
-        break;
-    case 19200:
-        CR_BAUDRATE = B19200;
-        break;
-    case 38400:
-        CR_BAUDRATE = B38400;
-        break;
-    case 57600:
-        CR_BAUDRATE = B57600;
-        break;
-    case 115200:
-        CR_BAUDRATE = B115200;
-        break;
-    case 500000:
-        CR_BAUDRATE = B500000;
-        break;
-    case 1000000:
-        CR_BAUDRATE = B1000000;
-        break;
-    default:
-		CR_BAUDRATE = B115200;
-        break;
-    }
-    cfsetispeed(&curopt, CR_BAUDRATE);
-    cfsetospeed(&curopt, CR_BAUDRATE);
-
 	printf("serial speed %d\n", baudRate);
     //Mostly 8N1
     curopt.c_cflag &= ~PARENB;
@@ -85,113 +135,718 @@ bool SCSerial::begin(int baudRate, const char* serialPort)
     curopt.c_cflag |= CLOCAL;//disable modem statuc check
     cfmakeraw(&curopt);//make raw mode
     curopt.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
-    if(tcsetattr(fd, TCSANOW, &curopt) == 0){
-        return true;
-    }else{
+    if(tcsetattr(fd, TCSANOW, &curopt) != 0){
 		perror("tcsetattr:");
+		close(fd);
+		fd = -1;
+		return false;
+	}
+	if(setBaudRate(baudRate)<0){
+		end();
+		return false;
+	}
+	rxHead = rxTail = 0;
+	if(LowLatency){
+		openLowLatency();
+	}
+	return true;
+}
+
+bool SCSerial::begin(int baudRate, SCSTransport *Transport)
+{
+	if(fd != -1 || transport){
+		end();
+	}
+	if(Transport == NULL){
 		return false;
 	}
+	transport = Transport;
+	ownTransport = false;
+	transport->SetBaudRate(baudRate);
+	baud = baudRate;
+	txBufLen = 0;
+	return true;
 }
 
+//标准波特率用termios, 其他(如250000, 128000, 76800)用termios2/BOTHER
+//待发数据发完后切换, 并丢弃切换前收到的数据
 int SCSerial::setBaudRate(int baudRate)
-{ 
-    if(fd==-1){
+{
+	wFlushSCS();
+	if(transport){
+		if(transport->SetBaudRate(baudRate)<0){
+			return -1;
+		}
+		transport->FlushRx();
+		baud = baudRate;
+		return 1;
+	}
+	if(fd==-1){
 		return -1;
 	}
-    tcgetattr(fd, &orgopt);
-    tcgetattr(fd, &curopt);
-    speed_t CR_BAUDRATE;
-    switch(baudRate){
-    case 9600:
-        CR_BAUDRATE = B9600;
-        break;
-    case 19200:
-        CR_BAUDRATE = B19200;
-        break;
-    case 38400:
-        CR_BAUDRATE = B38400;
-        break;
-    case 57600:
-        CR_BAUDRATE = B57600;
-        break;
-    case 115200:
-        CR_BAUDRATE = B115200;
-        break;
-    case 230400:
-        CR_BAUDRATE = B230400;
-	break;
-    case 500000:
-        CR_BAUDRATE = B500000;
-        break;
-    default:
-        break;
-    }
-    cfsetispeed(&curopt, CR_BAUDRATE);
-    cfsetospeed(&curopt, CR_BAUDRATE);
-    return 1;
+	speed_t CR_BAUDRATE = B0;
+	switch(baudRate){
+	case 9600:
+		CR_BAUDRATE = B9600;
+		break;
+	case 19200:
+		CR_BAUDRATE = B19200;
+		break;
+	case 38400:
+		CR_BAUDRATE = B38400;
+		break;
+	case 57600:
+		CR_BAUDRATE = B57600;
+		break;
+	case 115200:
+		CR_BAUDRATE = B115200;
+		break;
+	case 230400:
+		CR_BAUDRATE = B230400;
+		break;
+	case 500000:
+		CR_BAUDRATE = B500000;
+		break;
+	case 1000000:
+		CR_BAUDRATE = B1000000;
+		break;
+	}
+	int Actual = baudRate;
+	if(CR_BAUDRATE!=B0){
+		tcgetattr(fd, &curopt);
+		cfsetispeed(&curopt, CR_BAUDRATE);
+		cfsetospeed(&curopt, CR_BAUDRATE);
+		if(tcsetattr(fd, TCSADRAIN, &curopt)!=0){
+			perror("tcsetattr:");
+			return -1;
+		}
+	}else{
+		Actual = SerialSetBaud(fd, baudRate);
+		if(Actual<0){
+			printf("baud rate %d not supported by the serial port\n", baudRate);
+			return -1;
+		}
+		tcgetattr(fd, &curopt);
+	}
+	//误差超过3%时8N1帧会出错
+	if(Actual*100LL<baudRate*97LL || Actual*100LL>baudRate*103LL){
+		printf("baud rate %d set as %d\n", baudRate, Actual);
+	}
+	tcflush(fd, TCIFLUSH);
+	rxHead = rxTail = 0;
+	baud = baudRate;
+	return 1;
 }
 
 int SCSerial::readSCS(unsigned char *nDat, int nLen)
-{	
-    int fs_sel;
-    fd_set fs_read;
+{
+	if(transport){
+		return transport->Read(nDat, nLen, rxTimeOutUs());
+	}
+	if(epfd!=-1){
+		return readRing(nDat, nLen);
+	}
+	return readSelect(nDat, nLen);
+}
+
+//select接收, 每次等待前重置fd_set和剩余超时
+int SCSerial::readSelect(unsigned char *nDat, int nLen)
+{
 	int rvLen = 0;
+	long long deadline = monoUs() + rxTimeOutUs();
+	while(rvLen<nLen){
+		long long remain = deadline - monoUs();
+		if(remain<=0){
+			break;
+		}
+		fd_set fs_read;
+		FD_ZERO(&fs_read);
+		FD_SET(fd, &fs_read);
+		struct timeval time;
+		time.tv_sec = remain/1000000;
+		time.tv_usec = remain%1000000;
+		int fs_sel = select(fd+1, &fs_read, NULL, NULL, &time);
+		if(fs_sel<0){
+			if(errno==EINTR){
+				continue;
+			}
+			break;
+		}
+		if(fs_sel==0){
+			break;
+		}
+		int n = read(fd, nDat+rvLen, nLen-rvLen);
+		if(n>0){
+			rvLen += n;
+		}else if(n==0 || (errno!=EAGAIN && errno!=EINTR)){
+			//可读但返回0为设备断开
+			break;
+		}
+	}
+	return rvLen;
+}
 
-    struct timeval time;
+//epoll+环形缓冲接收, 每次唤醒读空驱动缓冲区, 多余字节留给下次读取
+int SCSerial::readRing(unsigned char *nDat, int nLen)
+{
+	int rvLen = 0;
+	long long deadline = monoUs() + rxTimeOutUs();
+	while(1){
+		while(rvLen<nLen && rxTail!=rxHead){
+			nDat[rvLen++] = rxRing[rxTail++&(SCSERIAL_RX_RING-1)];
+		}
+		if(rvLen==nLen){
+			break;
+		}
+		if(waitRing(deadline)<=0){
+			break;
+		}
+	}
+	return rvLen;
+}
 
-    FD_ZERO(&fs_read);
-    FD_SET(fd,&fs_read);
+int SCSerial::waitRing(long long deadline)
+{
+	while(1){
+		long long remain = deadline - monoUs();
+		if(remain<=0){
+			return 0;
+		}
+		struct epoll_event ev;
+		int n = epoll_wait(epfd, &ev, 1, (int)((remain+999)/1000));
+		if(n<0){
+			if(errno==EINTR){
+				continue;
+			}
+			return -1;
+		}
+		if(n==0){
+			return 0;
+		}
+		n = fillRing();
+		if(n>0){
+			return n;
+		}
+		if(ev.events&(EPOLLERR|EPOLLHUP)){
+			return -1;
+		}
+	}
+}
 
-    time.tv_sec = 0;
-    time.tv_usec = IOTimeOut*1000;
+//在环形缓冲上原地解析, Frame指向环内数据, 下次接收前有效
+//AdaptiveTimeOut时按ID的链路统计设定超时, 并以结果更新统计
+int SCSerial::readFrame(u8 ID, SCSFrame *Frame, int frameLen)
+{
+	if(!AdaptiveTimeOut){
+		return readFrameRx(ID, Frame, frameLen);
+	}
+	if(ID==0xfe){
+		//任意ID的应答无法归属舵机, 只用总线估计, 不更新统计
+		rxBudgetUs = linkBudgetUs(busLink, frameLen);
+		int Ok = readFrameRx(ID, Frame, frameLen);
+		rxBudgetUs = 0;
+		return Ok;
+	}
+	SCSLink &Link = link[ID];
+	rxBudgetUs = linkBudgetUs(Link.SrttUs<0 ? busLink : Link, frameLen);
+	int Ok = readFrameRx(ID, Frame, frameLen);
+	rxBudgetUs = 0;
+	if(Ok){
+		linkSample(Link, frameLen);
+		linkSample(busLink, frameLen);
+		Link.Misses = 0;
+	}else{
+		linkMiss(Link);
+		Link.Timeouts++;
+		if(Link.Misses<255){
+			Link.Misses++;
+		}
+	}
+	return Ok;
+}
+
+int SCSerial::readFrameRx(u8 ID, SCSFrame *Frame, int frameLen)
+{
+	if(epfd==-1){
+		return SCS::readFrame(ID, Frame, frameLen);
+	}
+	long long deadline = monoUs() + rxTimeOutUs();
+	rxParser.Reset();
+	while(1){
+		unsigned int idx = rxTail&(SCSERIAL_RX_RING-1);
+		unsigned int Len = rxHead-rxTail;
+		if(Len>SCSERIAL_RX_RING+SCS_FRAME_MAX-idx){
+			Len = SCSERIAL_RX_RING+SCS_FRAME_MAX-idx;
+		}
+		int Used;
+		int got = rxParser.Parse(rxRing+idx, Len, Frame, &Used);
+		rxTail += Used;
+		if(got && (Frame->ID==ID || ID==0xfe)){
+			return 1;
+		}
+		if(got){
+			continue;
+		}
+		if(waitRing(deadline)<=0){
+			return 0;
+		}
+	}
+}
 
-    //使用select实现串口的多路通信
+int SCSerial::fillRing()
+{
+	int total = 0;
 	while(1){
-		fs_sel = select(fd+1, &fs_read, NULL, NULL, &time);
-		if(fs_sel){
-			rvLen += read(fd, nDat+rvLen, nLen-rvLen);
-			//printf("nLen = %d rvLen = %d\n", nLen, rvLen);
-			if(rvLen<nLen){
+		unsigned int used = rxHead-rxTail;
+		if(used>=SCSERIAL_RX_RING){
+			return total;
+		}
+		unsigned int idx = rxHead&(SCSERIAL_RX_RING-1);
+		unsigned int len = SCSERIAL_RX_RING-used;
+		if(len>SCSERIAL_RX_RING-idx){
+			len = SCSERIAL_RX_RING-idx;
+		}
+		int n = read(fd, rxRing+idx, len);
+		if(n<=0){
+			if(n<0 && errno==EINTR){
 				continue;
-			}else{
-				return rvLen;
 			}
+			return total;
+		}
+		if(idx<SCS_FRAME_MAX){
+			unsigned int m = SCS_FRAME_MAX-idx;
+			memcpy(rxRing+SCSERIAL_RX_RING+idx, rxRing+idx, (unsigned int)n<m ? n : m);
+		}
+		rxHead += n;
+		total += n;
+		if((unsigned int)n<len){
+			return total;
+		}
+	}
+}
+
+//USB串口(FTDI等)关闭延迟定时器, 并建立epoll接收
+void SCSerial::openLowLatency()
+{
+	struct serial_struct ss;
+	if(ioctl(fd, TIOCGSERIAL, &ss)==0){
+		int flags = ss.flags;
+		ss.flags |= ASYNC_LOW_LATENCY;
+		if(ioctl(fd, TIOCSSERIAL, &ss)==0){
+			serialFlags = flags;
 		}else{
-			//printf("serial read fd read return 0\n");
-			return rvLen;
+			perror("TIOCSSERIAL:");
 		}
 	}
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if(epfd==-1){
+		perror("epoll_create1:");
+		return;
+	}
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev)==-1){
+		perror("epoll_ctl:");
+		close(epfd);
+		epfd = -1;
+	}
+}
+
+void SCSerial::closeLowLatency()
+{
+	if(serialFlags!=-1){
+		struct serial_struct ss;
+		if(ioctl(fd, TIOCGSERIAL, &ss)==0){
+			ss.flags = serialFlags;
+			ioctl(fd, TIOCSSERIAL, &ss);
+		}
+		serialFlags = -1;
+	}
+	if(epfd!=-1){
+		close(epfd);
+		epfd = -1;
+	}
 }
 
+//写入发送缓冲, 超出时置txOverflow, 不截断写出
 int SCSerial::writeSCS(unsigned char *nDat, int nLen)
 {
-	while(nLen--){
-		txBuf[txBufLen++] = *nDat++;
+	if(nLen>SCSERIAL_TX_MAX-txBufLen){
+		txOverflow = true;
+		return txBufLen;
 	}
+	memcpy(txBuf+txBufLen, nDat, nLen);
+	txBufLen += nLen;
 	return txBufLen;
 }
 
 int SCSerial::writeSCS(unsigned char bDat)
 {
+	if(txBufLen>=SCSERIAL_TX_MAX){
+		txOverflow = true;
+		return txBufLen;
+	}
 	txBuf[txBufLen++] = bDat;
 	return txBufLen;
 }
 
 void SCSerial::rFlushSCS()
 {
+	if(transport){
+		transport->FlushRx();
+		return;
+	}
 	tcflush(fd, TCIFLUSH);
+	rxHead = rxTail = 0;
+}
+
+//非阻塞fd: 写满整个缓冲, EINTR重试, EAGAIN时等待POLLOUT(最多IOTimeOut)
+//返回写出字节数, 出错或超时时小于nLen
+int SCSerial::writeAll(const u8 *nDat, int nLen)
+{
+	int done = 0;
+	while(done<nLen){
+		ssize_t n = write(fd, nDat+done, nLen-done);
+		if(n>0){
+			done += (int)n;
+			continue;
+		}
+		if(n<0 && errno==EINTR){
+			continue;
+		}
+		if(n<0 && errno!=EAGAIN && errno!=EWOULDBLOCK){
+			break;
+		}
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		int r = poll(&pfd, 1, (int)IOTimeOut);
+		if(r<0 && errno==EINTR){
+			continue;
+		}
+		if(r<=0 || (pfd.revents&(POLLERR|POLLHUP|POLLNVAL))){
+			break;
+		}
+	}
+	return done;
 }
 
 void SCSerial::wFlushSCS()
 {
+	if(txOverflow){
+		//部分帧会被舵机当作噪声或错误指令, 整包丢弃
+		txOverflow = false;
+		txBufLen = 0;
+		TxOverflows++;
+		Err = 1;
+		return;
+	}
 	if(txBufLen){
-		txBufLen = write(fd, txBuf, txBufLen);
+		SCS_TRACE_TX(Trace, txBufLen);
+		int n;
+		if(transport){
+			n = transport->Write(txBuf, txBufLen);
+		}else{
+			n = writeAll(txBuf, txBufLen);
+		}
+		if(n<txBufLen){
+			//写出失败或超时: 记为错误, 线上时间按实际写出字节计
+			TxOverflows++;
+			Err = 1;
+			n = n<0 ? 0 : n;
+		}
+		txLen = n;
+		txDoneUs = monoUs();
 		txBufLen = 0;
 	}
 }
 
+long SCSerial::rxTimeOutUs()
+{
+	return rxBudgetUs>0 ? rxBudgetUs : (long)IOTimeOut*1000;
+}
+
+long SCSerial::wireUs(int nByte)
+{
+	if(baud<=0){
+		return 0;
+	}
+	return (long)(nByte*10*1000000LL/baud);
+}
+
+//同TCP重传超时: 平滑延时+4倍偏差, 加上本次收发的线上时间
+long SCSerial::linkBudgetUs(const SCSLink &Link, int rxLen)
+{
+	long Limit = (long)IOTimeOut*1000;
+	if(Link.SrttUs<0){
+		return Limit;
+	}
+	long long us = wireUs(txLen+rxLen)+Link.SrttUs+4LL*Link.RttVarUs+SCSERIAL_RTT_MARGIN_US;
+	return us<Limit ? (long)us : Limit;
+}
+
+void SCSerial::linkSample(SCSLink &Link, int rxLen)
+{
+	long long x = monoUs()-txDoneUs-wireUs(txLen+rxLen);
+	if(x<0){
+		x = 0;
+	}
+	if(Link.SrttUs<0){
+		Link.SrttUs = (long)x;
+		Link.RttVarUs = (long)(x/2);
+		return;
+	}
+	long long d = x-Link.SrttUs;
+	Link.RttVarUs += (long)(((d<0 ? -d : d)-Link.RttVarUs)/4);
+	Link.SrttUs += (long)(d/8);
+}
+
+void SCSerial::linkMiss(SCSLink &Link)
+{
+	if(Link.SrttUs<0){
+		return;
+	}
+	long Limit = (long)IOTimeOut*1000;
+	Link.RttVarUs = Link.RttVarUs*2+SCSERIAL_RTT_MARGIN_US;
+	if(Link.RttVarUs>Limit){
+		Link.RttVarUs = Limit;
+	}
+}
+
+bool SCSerial::linkDropped(u8 ID)
+{
+	return link[ID].OpenUntilUs && monoUs()<link[ID].OpenUntilUs;
+}
+
+void SCSerial::resetLinks()
+{
+	SCSLink L;
+	memset(&L, 0, sizeof(L));
+	L.SrttUs = -1;
+	for(int i=0; i<256; i++){
+		link[i] = L;
+	}
+	syncLink = L;
+	busLink = L;
+}
+
+//熔断期间略去; 到期后半开: 再试一次, 仍无应答则立即重新熔断
+bool SCSerial::syncReadSkip(u8 ID)
+{
+	SCSLink &Link = link[ID];
+	if(!BreakerMisses || !Link.OpenUntilUs){
+		return false;
+	}
+	if(monoUs()<Link.OpenUntilUs){
+		Link.Dropped++;
+		return true;
+	}
+	Link.OpenUntilUs = 0;
+	Link.Misses = BreakerMisses-1;
+	return false;
+}
+
+void SCSerial::syncReadWait(int rxLen)
+{
+	if(AdaptiveTimeOut){
+		rxBudgetUs = linkBudgetUs(syncLink.SrttUs<0 ? busLink : syncLink, rxLen);
+	}
+}
+
+//全部应答: 更新同步读延时; 全部无应答: 视为总线延时变化, 退避而不计舵机无应答;
+//部分应答: 无应答的舵机计一次, 连续BreakerMisses次熔断
+void SCSerial::syncReadResult(u8 ID[], u8 IDN)
+{
+	rxBudgetUs = 0;
+	int n = 0;
+	int nOk = 0;
+	for(u8 i=0; i<IDN; i++){
+		u16 Index = syncReadRxIndex[ID[i]];
+		if(Index!=SCS_SYNC_DROPPED){
+			n++;
+			nOk += (Index!=0);
+		}
+	}
+	if(!n){
+		return;
+	}
+	if(nOk==n){
+		linkSample(syncLink, syncReadRxBuffLen);
+		linkSample(busLink, syncReadRxBuffLen);
+	}else if(!nOk){
+		linkMiss(syncLink);
+		syncLink.Timeouts++;
+	}
+	for(u8 i=0; i<IDN; i++){
+		u16 Index = syncReadRxIndex[ID[i]];
+		SCSLink &Link = link[ID[i]];
+		if(Index==SCS_SYNC_DROPPED){
+			continue;
+		}
+		if(Index){
+			Link.Misses = 0;
+			continue;
+		}
+		Link.Timeouts++;
+		if(!nOk){
+			continue;
+		}
+		if(Link.Misses<255){
+			Link.Misses++;
+		}
+		if(BreakerMisses && Link.Misses>=BreakerMisses){
+			Link.OpenUntilUs = monoUs()+BreakerMs*1000LL;
+			Link.Trips++;
+		}
+	}
+}
+
+int SCSerial::queueTxn(u8 ID, u8 Inst, u8 MemAddr, const u8 *nDat, u8 nLen, SCSCallback &Done)
+{
+	if(txnN>=SCSERIAL_TXN_MAX || nLen>SCSERIAL_TXN_DATA){
+		return -1;
+	}
+	SCSTxn &Txn = txnQueue[txnN];
+	Txn.ID = ID;
+	Txn.Inst = Inst;
+	Txn.MemAddr = MemAddr;
+	Txn.nLen = nLen;
+	if(nDat){
+		memcpy(Txn.nDat, nDat, nLen);
+	}
+	Txn.Done.swap(Done);
+	return txnN++;
+}
+
+int SCSerial::queueWrite(u8 ID, u8 MemAddr, const u8 *nDat, u8 nLen, SCSCallback Done)
+{
+	return queueTxn(ID, INST_WRITE, MemAddr, nDat, nLen, Done);
+}
+
+int SCSerial::queueRegWrite(u8 ID, u8 MemAddr, const u8 *nDat, u8 nLen, SCSCallback Done)
+{
+	return queueTxn(ID, INST_REG_WRITE, MemAddr, nDat, nLen, Done);
+}
+
+int SCSerial::queueAction(u8 ID, SCSCallback Done)
+{
+	return queueTxn(ID, INST_REG_ACTION, 0, NULL, 0, Done);
+}
+
+int SCSerial::queueRead(u8 ID, u8 MemAddr, u8 nLen, SCSCallback Done)
+{
+	return queueTxn(ID, INST_READ, MemAddr, NULL, nLen, Done);
+}
+
+int SCSerial::queuePing(u8 ID, SCSCallback Done)
+{
+	return queueTxn(ID, INST_PING, 0, NULL, 0, Done);
+}
+
+int SCSerial::txnReplyLen(const SCSTxn &Txn)
+{
+	if(Txn.Inst==INST_PING){
+		return 6;
+	}
+	if(Txn.Inst==INST_READ){
+		return Txn.nLen+6;
+	}
+	if(Txn.ID==0xfe || !Level){
+		return 0;
+	}
+	return 6;
+}
+
+int SCSerial::runQueue()
+{
+	int nOk = 0;
+	int i = 0;
+	rFlushSCS();
+	while(i<txnN){
+		//无应答包与下一个需应答包合并写出, 半双工总线上同时只允许一个待应答包
+		int j = i;
+		int replyLen = 0;
+		while(j<txnN){
+			SCSTxn &Txn = txnQueue[j];
+			int pktLen = 6;
+			if(Txn.Inst==INST_READ){
+				pktLen = 8;
+			}else if(Txn.nLen){
+				pktLen = Txn.nLen+7;
+			}
+			if(j>i && txBufLen+pktLen>(int)sizeof(txBuf)){
+				break;
+			}
+			if(Txn.Inst==INST_READ){
+				writeBuf(Txn.ID, Txn.MemAddr, &Txn.nLen, 1, INST_READ);
+			}else{
+				writeBuf(Txn.ID, Txn.MemAddr, Txn.nLen ? Txn.nDat : NULL, Txn.nLen, Txn.Inst);
+			}
+			replyLen = txnReplyLen(Txn);
+			j++;
+			if(replyLen){
+				break;
+			}
+		}
+		SCS_TRACE_BEGIN(Trace, txnQueue[j-1].Inst, txnQueue[j-1].ID, rxParser);
+		wFlushSCS();
+		if(!replyLen){
+			SCS_TRACE_END(Trace, rxParser);
+		}
+
+		for(; i<j; i++){
+			SCSTxn &Txn = txnQueue[i];
+			SCSReply Reply;
+			Reply.ID = Txn.ID;
+			Reply.Inst = Txn.Inst;
+			Reply.Status = 1;
+			Reply.Error = 0;
+			Reply.nDat = NULL;
+			Reply.nLen = 0;
+			if(i==j-1 && replyLen){
+				SCSFrame Frame;
+				Reply.Status = readFrame(Txn.ID, &Frame, replyLen);
+				if(Reply.Status && Frame.nLen!=replyLen-6){
+					Reply.Status = 0;
+				}
+				SCS_TRACE_REPLY(Trace, Txn.ID, Reply.Status, Reply.Status ? Frame.Size : 0);
+				SCS_TRACE_END(Trace, rxParser);
+				if(Reply.Status){
+					Reply.ID = Frame.ID;
+					Reply.Error = Error = Frame.Error;
+					if(Txn.Inst==INST_READ){
+						Reply.nDat = Frame.nDat;
+						Reply.nLen = Frame.nLen;
+					}
+				}
+			}
+			nOk += Reply.Status;
+			if(Txn.Done){
+				Txn.Done(Reply);
+				Txn.Done = SCSCallback();
+			}
+		}
+	}
+	txnN = 0;
+	return nOk;
+}
+
 void SCSerial::end()
 {
-	fd = -1;
+	if(transport){
+		if(ownTransport){
+			delete transport;
+		}
+		transport = NULL;
+		ownTransport = false;
+	}
+	if(fd==-1){
+		return;
+	}
+	closeLowLatency();
 	close(fd);
+	fd = -1;
 }
\ No newline at end of file
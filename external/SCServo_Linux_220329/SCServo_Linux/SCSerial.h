@@ -9,12 +9,56 @@
 #define _SCSERIAL_H
 
 #include "SCS.h"
+#include "SCSTransport.h"
 #include <stdio.h>
 #include <termios.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <functional>
+
+#define SCSERIAL_RX_RING 1024//接收环形缓冲区大小(必须为2的幂)
+#define SCSERIAL_TXN_MAX 64//事务队列长度
+#define SCSERIAL_TXN_DATA 32//单个事务最大写入/读取字节数
+#define SCSERIAL_TX_MAX 4096//发送缓冲: 255个舵机的SyncWritePosEx分帧后可一次写出
+#define SCSERIAL_RTT_MARGIN_US 500//自适应超时在线上时间和实测延时之外的余量(us)
+#define SCSERIAL_BREAKER_MISSES 3//建议熔断阈值: 同步读连续无应答次数
+#define SCSERIAL_BREAKER_MS 1000//默认熔断时长(ms)
+
+//链路统计(自适应超时与熔断), 每个舵机一份
+//延时为应答完成时间减去收发字节的线上时间, 即USB/驱动延迟与舵机应答延时之和
+struct SCSLink{
+	long SrttUs;//延时平滑值(1/8), -1为未测
+	long RttVarUs;//延时偏差平滑值(1/4)
+	u8 Misses;//连续无应答次数
+	long long OpenUntilUs;//熔断截止时间(CLOCK_MONOTONIC), 0为未熔断
+	unsigned long Timeouts;//无应答次数
+	unsigned long Dropped;//熔断期间跳过的同步读次数
+	unsigned long Trips;//熔断次数
+};
+
+//事务应答
+struct SCSReply{
+	u8 ID;
+	u8 Inst;
+	int Status;//1成功, 0无应答或校验错误
+	u8 Error;//舵机状态
+	const u8 *nDat;//读指令返回数据(仅回调内有效)
+	u8 nLen;
+};
+typedef std::function<void(const SCSReply &Reply)> SCSCallback;
+
+//事务
+struct SCSTxn{
+	u8 ID;
+	u8 Inst;
+	u8 MemAddr;
+	u8 nLen;
+	u8 nDat[SCSERIAL_TXN_DATA];
+	SCSCallback Done;
+};
 
 class SCSerial : public SCS
 {
@@ -22,6 +66,7 @@ public:
 	SCSerial();
 	SCSerial(u8 End);
 	SCSerial(u8 End, u8 Level);
+	virtual ~SCSerial();
 
 protected:
 	int writeSCS(unsigned char *nDat, int nLen);//输出nLen字节
@@ -29,20 +74,80 @@ protected:
 	int writeSCS(unsigned char bDat);//输出1字节
 	void rFlushSCS();//
 	void wFlushSCS();//
+	int readFrame(u8 ID, SCSFrame *Frame, int frameLen);//epoll接收时直接在环形缓冲上解析
+	int readFrameRx(u8 ID, SCSFrame *Frame, int frameLen);
 public:
 	unsigned long int IOTimeOut;//输入输出超时
 	int Err;
+	unsigned long TxOverflows;//因超出发送缓冲而丢弃, 或写出失败/超时的次数
+	bool LowLatency;//begin()前置true: ASYNC_LOW_LATENCY+epoll+环形缓冲接收
+	bool AdaptiveTimeOut;//true: 每次接收的超时=线上时间+实测延时+4倍偏差+余量, IOTimeOut为上限; 未测时用IOTimeOut
+	u8 BreakerMisses;//同步读中某舵机连续无应答(其他舵机有应答)达到次数后熔断, 0为关闭
+	unsigned long BreakerMs;//熔断时长, 期间同步读略去该舵机, 到期后重试一次
 public:
 	virtual int getErr(){  return Err;  }
-	virtual int setBaudRate(int baudRate);
-	virtual bool begin(int baudRate, const char* serialPort);
+	virtual int setBaudRate(int baudRate);//运行中切换主机波特率, 任意值(termios2), 失败返回-1
+	int getBaudRate(){  return baud;  }
+	virtual bool begin(int baudRate, const char* serialPort);//serialPort "sim"/"simfast[:ids]"为SimulatedBus模拟总线
+	virtual bool begin(int baudRate, SCSTransport *Transport);//经Transport收发, 不接管其生命周期
 	virtual void end();
+	SCSTransport *getTransport(){  return transport;  }
+	const SCSLink &getLink(u8 ID){  return link[ID];  }//单个舵机链路统计
+	const SCSLink &getSyncLink(){  return syncLink;  }//同步读整体延时
+	bool linkDropped(u8 ID);//ID正在熔断
+	void resetLinks();//清除全部链路统计与熔断
+public:
+	//事务队列: 先入队, runQueue()一次执行
+	//无应答包(广播/Level=0写)与下一个需应答包合并为一次写出, 按ID匹配应答
+	int queueWrite(u8 ID, u8 MemAddr, const u8 *nDat, u8 nLen, SCSCallback Done = SCSCallback());
+	int queueRegWrite(u8 ID, u8 MemAddr, const u8 *nDat, u8 nLen, SCSCallback Done = SCSCallback());
+	int queueAction(u8 ID = 0xfe, SCSCallback Done = SCSCallback());
+	int queueRead(u8 ID, u8 MemAddr, u8 nLen, SCSCallback Done = SCSCallback());
+	int queuePing(u8 ID, SCSCallback Done = SCSCallback());
+	int runQueue();//执行队列, 返回成功事务数
+	int queueSize() const { return txnN; }
 protected:
     int fd;//serial port handle
     struct termios orgopt;//fd ort opt
 	struct termios curopt;//fd cur opt
-	unsigned char txBuf[255];
+	unsigned char txBuf[SCSERIAL_TX_MAX];
 	int txBufLen;
+	bool txOverflow;//本次写出的数据超出txBuf, wFlushSCS()整包丢弃
+protected:
+	int readSelect(unsigned char *nDat, int nLen);//select接收
+	int readRing(unsigned char *nDat, int nLen);//epoll+环形缓冲接收
+	int fillRing();//一次读空驱动缓冲区到环形缓冲
+	int waitRing(long long deadline);//等待并接收新数据, 超时返回0
+	void openLowLatency();
+	void closeLowLatency();
+	long rxTimeOutUs();//本次接收超时
+	int writeAll(const u8 *nDat, int nLen);//非阻塞fd上写完整个缓冲
+	long wireUs(int nByte);//nByte字节8N1线上时间
+	long linkBudgetUs(const SCSLink &Link, int rxLen);
+	void linkSample(SCSLink &Link, int rxLen);//应答完成, 更新延时
+	void linkMiss(SCSLink &Link);//无应答, 超时加倍退避
+	virtual bool syncReadSkip(u8 ID);
+	virtual void syncReadWait(int rxLen);
+	virtual void syncReadResult(u8 ID[], u8 IDN);
+	SCSTransport *transport;//非NULL时替代串口fd
+	bool ownTransport;//begin("sim...")创建, end()时释放
+	int baud;//当前主机波特率
+	int epfd;//epoll句柄, -1为select接收
+	int serialFlags;//原ASYNC标志, -1为未修改
+	unsigned char rxRing[SCSERIAL_RX_RING+SCS_FRAME_MAX];//尾部镜像环首SCS_FRAME_MAX字节, 使任意位置起的帧连续
+	unsigned int rxHead;
+	unsigned int rxTail;
+	SCSLink link[256];
+	SCSLink syncLink;
+	SCSLink busLink;//全部应答, 舵机未测时使用
+	long rxBudgetUs;//当前接收超时, 0为IOTimeOut
+	long long txDoneUs;//上次wFlushSCS()写出时间
+	int txLen;//上次wFlushSCS()写出字节数
+protected:
+	int queueTxn(u8 ID, u8 Inst, u8 MemAddr, const u8 *nDat, u8 nLen, SCSCallback &Done);
+	int txnReplyLen(const SCSTxn &Txn);//应答帧长度, 0为无应答
+	SCSTxn txnQueue[SCSERIAL_TXN_MAX];
+	int txnN;
 };
 
 #endif
\ No newline at end of file
@@ -11,4 +11,46 @@
 // ST3215 uses SMS_STS protocol only
 #include "SMS_STS.h"
 
+// Arm-level helpers built on SMS_STS
+#include "ArmCommand.h"
+#include "ArmBus.h"
+#include "Gripper.h"
+
+// Non-blocking bus calls on an I/O thread (std::future)
+#include "BusExecutor.h"
+
+// Fixed-period real-time control loop
+#include "ControlLoop.h"
+#include "SPSCRing.h"
+
+// Binary trajectory files
+#include "TrajectoryFile.h"
+
+// Spline playback within joint speed/acceleration limits
+#include "TrajectoryEngine.h"
+
+// Keyframe reduction of recorded samples
+#include "TrajectorySimplify.h"
+
+// Joint limits, offsets and step/angle conversion
+#include "JointModel.h"
+
+// Closed-form arm kinematics, Cartesian lines/arcs/circles
+#include "Kinematics.h"
+#include "CartesianPath.h"
+
+// Joint/speed/acceleration limits and self-collision grid, checked per setpoint
+#include "SafetyModel.h"
+
+// Simulated ST3215 bus (begin(baud, "sim"))
+#include "SCSTransport.h"
+#include "SimulatedBus.h"
+
+// Shared bus daemon: state in shared memory, commands over a Unix socket
+#include "BusShm.h"
+#include "BusClient.h"
+
+// Compressed load/current/voltage/temperature logs with rolling statistics
+#include "TelemetryLog.h"
+
 #endif
\ No newline at end of file
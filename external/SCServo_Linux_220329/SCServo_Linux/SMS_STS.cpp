@@ -5,19 +5,86 @@
  * 作者: 
  */
 
+#include <time.h>
+#include <string.h>
 #include "SMS_STS.h"
 
+static long long monoMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000LL + ts.tv_nsec/1000000;
+}
+
+static long long monoUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
+
 SMS_STS::SMS_STS()
 {
 	End = 0;
+	CacheUs = 0;
+	ClearCache();
 }
 
 SMS_STS::SMS_STS(u8 End):SCSerial(End)
 {
+	CacheUs = 0;
+	ClearCache();
 }
 
 SMS_STS::SMS_STS(u8 End, u8 Level):SCSerial(End, Level)
 {
+	CacheUs = 0;
+	ClearCache();
+}
+
+void SMS_STS::ClearCache()
+{
+	memset(cacheTime, 0, sizeof(cacheTime));
+	CacheHits = 0;
+	CacheMisses = 0;
+}
+
+//写入后舵机状态会变化(MOVING等), 丢弃其缓存; 广播ID丢弃全部
+void SMS_STS::cacheDrop(u8 ID)
+{
+	if(ID==0xfe){
+		memset(cacheTime, 0, sizeof(cacheTime));
+	}else{
+		cacheTime[ID] = 0;
+	}
+}
+
+void SMS_STS::cacheStore(u8 ID, const u8 *nMem, long long Us)
+{
+	memcpy(cacheMem[ID], nMem, sizeof(Mem));
+	cacheTime[ID] = Us;
+}
+
+//缓存未过期直接返回; 否则一次读取整个反馈内存块, 随后其余几项的ReadX(ID)都由缓存返回
+const u8 *SMS_STS::feedBackMem(int ID)
+{
+	if(ID==-1){
+		return Mem;
+	}
+	if(cacheTime[ID] && monoUs()-cacheTime[ID]<=(long long)CacheUs){
+		CacheHits++;
+		Err = 0;
+		return cacheMem[ID];
+	}
+	CacheMisses++;
+	if(Read(ID, SMS_STS_PRESENT_POSITION_L, cacheMem[ID], sizeof(Mem))!=sizeof(Mem)){
+		cacheTime[ID] = 0;
+		Err = 1;
+		return NULL;
+	}
+	cacheTime[ID] = monoUs();
+	Err = 0;
+	return cacheMem[ID];
 }
 
 int SMS_STS::WritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC)
@@ -31,6 +98,7 @@ int SMS_STS::WritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC)
 	Host2SCS(bBuf+1, bBuf+2, Position);
 	Host2SCS(bBuf+3, bBuf+4, 0);
 	Host2SCS(bBuf+5, bBuf+6, Speed);
+	cacheDrop(ID);
 	
 	return genWrite(ID, SMS_STS_ACC, bBuf, 7);
 }
@@ -46,20 +114,22 @@ int SMS_STS::RegWritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC)
 	Host2SCS(bBuf+1, bBuf+2, Position);
 	Host2SCS(bBuf+3, bBuf+4, 0);
 	Host2SCS(bBuf+5, bBuf+6, Speed);
+	cacheDrop(ID);
 	
 	return regWrite(ID, SMS_STS_ACC, bBuf, 7);
 }
 
-void SMS_STS::SyncWritePosEx(u8 ID[], u8 IDN, s16 Position[], u16 Speed[], u8 ACC[])
+//参数在栈上的定长缓冲中组装(IDN最大255)
+void SMS_STS::SyncWritePosEx(u8 ID[], u8 IDN, const s16 Position[], const u16 Speed[], const u8 ACC[])
 {
-
-    u8 offbuf[IDN][7];
-    for(u8 i = 0; i<IDN; i++){
-		if(Position[i]<0){
-			Position[i] = -Position[i];
-			Position[i] |= (1<<15);
+	u8 offbuf[255*7];
+	for(u8 i = 0; i<IDN; i++){
+		s16 Pos = Position[i];
+		if(Pos<0){
+			Pos = -Pos;
+			Pos |= (1<<15);
 		}
-        u8 bBuf[7];
+		u8 *bBuf = offbuf+i*7;
 		u16 V;
 		if(Speed){
 			V = Speed[i];
@@ -71,16 +141,17 @@ void SMS_STS::SyncWritePosEx(u8 ID[], u8 IDN, s16 Position[], u16 Speed[], u8 AC
 		}else{
 			bBuf[0] = 0;
 		}
-        Host2SCS(bBuf+1, bBuf+2, Position[i]);
-        Host2SCS(bBuf+3, bBuf+4, 0);
-        Host2SCS(bBuf+5, bBuf+6, V);
-        memcpy(offbuf[i], bBuf, 7);
-    }
-    snycWrite(ID, IDN, SMS_STS_ACC, (u8*)offbuf, 7);
+		Host2SCS(bBuf+1, bBuf+2, Pos);
+		Host2SCS(bBuf+3, bBuf+4, 0);
+		Host2SCS(bBuf+5, bBuf+6, V);
+		cacheDrop(ID[i]);
+	}
+	snycWrite(ID, IDN, SMS_STS_ACC, offbuf, 7);
 }
 
 int SMS_STS::WheelMode(u8 ID)
 {
+	cacheDrop(ID);
 	return writeByte(ID, SMS_STS_MODE, 1);		
 }
 
@@ -92,6 +163,7 @@ int SMS_STS::WriteSpe(u8 ID, s16 Speed, u8 ACC)
 	}
 	u8 bBuf[2];
 	bBuf[0] = ACC;
+	cacheDrop(ID);
 	genWrite(ID, SMS_STS_ACC, bBuf, 1);
 	Host2SCS(bBuf+0, bBuf+1, Speed);
 	
@@ -100,6 +172,7 @@ int SMS_STS::WriteSpe(u8 ID, s16 Speed, u8 ACC)
 
 int SMS_STS::EnableTorque(u8 ID, u8 Enable)
 {
+	cacheDrop(ID);
 	return writeByte(ID, SMS_STS_TORQUE_ENABLE, Enable);
 }
 
@@ -115,9 +188,73 @@ int SMS_STS::LockEprom(u8 ID)
 
 int SMS_STS::CalibrationOfs(u8 ID)
 {
+	cacheDrop(ID);
 	return writeByte(ID, SMS_STS_TORQUE_ENABLE, 128);
 }
 
+int SMS_STS::BaudRateCode(int baudRate)
+{
+	static const int Baud[8] = {1000000, 500000, 250000, 128000, 115200, 76800, 57600, 38400};//SMS_STS_1M..SMS_STS_38400
+	for(int i=0; i<8; i++){
+		if(Baud[i]==baudRate){
+			return i;
+		}
+	}
+	return -1;
+}
+
+//先试主机能否切换到新波特率(如适配器拒绝BOTHER)并切回, 失败则不改动舵机
+//当前波特率下逐个解锁eprom写入波特率, 主机切换后逐个Ping确认并加锁eprom
+//当前波特率下无应答的舵机不修改; 返回后主机保持新波特率
+int SMS_STS::ChangeBaudRate(u8 ID[], u8 IDN, int baudRate)
+{
+	int Code = BaudRateCode(baudRate);
+	if(Code<0){
+		return -1;
+	}
+	int Old = baud;
+	if(setBaudRate(baudRate)<0){
+		setBaudRate(Old);
+		return -1;
+	}
+	if(setBaudRate(Old)<0){
+		return -1;
+	}
+	u8 Switched[256];
+	int N = 0;
+	for(int i=0; i<IDN; i++){
+		if(!unLockEprom(ID[i])){
+			LockEprom(ID[i]);//解锁应答可能丢失, 加锁不留解锁状态
+			continue;
+		}
+		writeByte(ID[i], SMS_STS_BAUD_RATE, Code);//舵机可能以新波特率应答, 不检查
+		Switched[N++] = ID[i];
+	}
+	if(setBaudRate(baudRate)<0){
+		//预检后仍失败: 回到原波特率, 尚未切换的舵机加锁
+		setBaudRate(Old);
+		for(int i=0; i<N; i++){
+			LockEprom(Switched[i]);
+		}
+		return 0;
+	}
+	usleep(10000);//等待舵机切换
+	int Ok = 0;
+	for(int i=0; i<N; i++){
+		int Try;
+		for(Try=0; Try<3; Try++){
+			if(Ping(Switched[i])==Switched[i]){
+				break;
+			}
+		}
+		LockEprom(Switched[i]);//无应答也发, 不留解锁状态
+		if(Try<3){
+			Ok++;
+		}
+	}
+	return Ok;
+}
+
 int SMS_STS::FeedBack(int ID)
 {
 	int nLen = Read(ID, SMS_STS_PRESENT_POSITION_L, Mem, sizeof(Mem));
@@ -126,16 +263,124 @@ int SMS_STS::FeedBack(int ID)
 		return -1;
 	}
 	Err = 0;
+	if(ID>=0 && ID<0xfe){
+		cacheStore(ID, Mem, monoUs());
+	}
 	return nLen;
 }
 
+//同步读多个舵机反馈信息
+//一次INST_SYNC_READ读取IDN个舵机的FeedBack内存块，结果按ID[]顺序写入State[]
+//返回成功应答的舵机数，无应答舵机State[i].Err=1
+int SMS_STS::SyncFeedBack(u8 ID[], u8 IDN, ServoState State[])
+{
+	if(IDN>SMS_STS_SYNC_MAX){
+		Err = 1;
+		return -1;
+	}
+	u8 *rxBuff = syncReadRxBuff;
+	u16 rxBuffMax = syncReadRxBuffMax;
+	syncReadRxBuff = syncFeedBackBuff;
+	syncReadRxBuffMax = IDN*(sizeof(Mem)+6);
+
+	syncReadPacketTx(ID, IDN, SMS_STS_PRESENT_POSITION_L, sizeof(Mem));
+	long long Us = monoUs();
+	int n = 0;
+	for(u8 i=0; i<IDN; i++){
+		if(syncReadPacketRx(ID[i], Mem)==sizeof(Mem)){
+			Mem2State(Mem, &State[i]);
+			cacheStore(ID[i], Mem, Us);
+			n++;
+		}else{
+			State[i].Err = syncReadDropped(ID[i]) ? 2 : 1;
+		}
+	}
+
+	syncReadRxBuff = rxBuff;
+	syncReadRxBuffMax = rxBuffMax;
+	Err = (n!=IDN);
+	return n;
+}
+
+//每SMS_STS_WAIT_POLL_US同步读一次FeedBack内存块, 全部舵机应答、MOVING=0且到位才返回
+//Goal为NULL时只看MOVING, 须在舵机开始运动后调用
+int SMS_STS::WaitMotionComplete(u8 ID[], u8 IDN, const s16 Goal[], u16 Tolerance, u32 TimeOut)
+{
+	if(IDN>SMS_STS_SYNC_MAX){
+		Err = 1;
+		return -1;
+	}
+	ServoState State[SMS_STS_SYNC_MAX];
+	long long Start = monoMs();
+	for(;;){
+		bool Done = SyncFeedBack(ID, IDN, State)==IDN;
+		for(u8 i=0; i<IDN; i++){
+			//熔断中的舵机不会应答, 等待只会超时
+			if(State[i].Err==2){
+				Err = 2;
+				return -1;
+			}
+		}
+		for(u8 i=0; Done && i<IDN; i++){
+			if(State[i].Move){
+				Done = false;
+			}else if(Goal){
+				int d = State[i].Pos-Goal[i];
+				Done = (d<0 ? -d : d)<=Tolerance;
+			}
+		}
+		long long t = monoMs()-Start;
+		if(Done){
+			Err = 0;
+			return (int)t;
+		}
+		if(t>=(long long)TimeOut){
+			Err = 1;
+			return -1;
+		}
+		usleep(SMS_STS_WAIT_POLL_US);
+	}
+}
+
+void SMS_STS::Mem2State(const u8 *nMem, ServoState *State)
+{
+	int Pos = SCS2Host(nMem[SMS_STS_PRESENT_POSITION_L-SMS_STS_PRESENT_POSITION_L], nMem[SMS_STS_PRESENT_POSITION_H-SMS_STS_PRESENT_POSITION_L]);
+	if(Pos&(1<<15)){
+		Pos = -(Pos&~(1<<15));
+	}
+	int Speed = SCS2Host(nMem[SMS_STS_PRESENT_SPEED_L-SMS_STS_PRESENT_POSITION_L], nMem[SMS_STS_PRESENT_SPEED_H-SMS_STS_PRESENT_POSITION_L]);
+	if(Speed&(1<<15)){
+		Speed = -(Speed&~(1<<15));
+	}
+	int Load = SCS2Host(nMem[SMS_STS_PRESENT_LOAD_L-SMS_STS_PRESENT_POSITION_L], nMem[SMS_STS_PRESENT_LOAD_H-SMS_STS_PRESENT_POSITION_L]);
+	if(Load&(1<<10)){
+		Load = -(Load&~(1<<10));
+	}
+	int Current = SCS2Host(nMem[SMS_STS_PRESENT_CURRENT_L-SMS_STS_PRESENT_POSITION_L], nMem[SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L]);
+	if(Current&(1<<15)){
+		Current = -(Current&~(1<<15));
+	}
+	State->Pos = Pos;
+	State->Speed = Speed;
+	State->Load = Load;
+	State->Voltage = nMem[SMS_STS_PRESENT_VOLTAGE-SMS_STS_PRESENT_POSITION_L];
+	State->Temper = nMem[SMS_STS_PRESENT_TEMPERATURE-SMS_STS_PRESENT_POSITION_L];
+	State->Move = nMem[SMS_STS_MOVING-SMS_STS_PRESENT_POSITION_L];
+	State->Current = Current;
+	State->Err = 0;
+}
+
 int SMS_STS::ReadPos(int ID)
 {
 	int Pos = -1;
-	if(ID==-1){
-		Pos = Mem[SMS_STS_PRESENT_POSITION_H-SMS_STS_PRESENT_POSITION_L];
+	if(ID==-1 || (CacheUs && ID>=0 && ID<0xfe)){
+		const u8 *m = feedBackMem(ID);
+		if(!m){
+			return -1;
+		}
+		Pos = m[SMS_STS_PRESENT_POSITION_H-SMS_STS_PRESENT_POSITION_L];
 		Pos <<= 8;
-		Pos |= Mem[SMS_STS_PRESENT_POSITION_L-SMS_STS_PRESENT_POSITION_L];
+		Pos |= m[SMS_STS_PRESENT_POSITION_L-SMS_STS_PRESENT_POSITION_L];
 	}else{
 		Err = 0;
 		Pos = readWord(ID, SMS_STS_PRESENT_POSITION_L);
@@ -153,10 +398,14 @@ int SMS_STS::ReadPos(int ID)
 int SMS_STS::ReadSpeed(int ID)
 {
 	int Speed = -1;
-	if(ID==-1){
-		Speed = Mem[SMS_STS_PRESENT_SPEED_H-SMS_STS_PRESENT_POSITION_L];
+	if(ID==-1 || (CacheUs && ID>=0 && ID<0xfe)){
+		const u8 *m = feedBackMem(ID);
+		if(!m){
+			return -1;
+		}
+		Speed = m[SMS_STS_PRESENT_SPEED_H-SMS_STS_PRESENT_POSITION_L];
 		Speed <<= 8;
-		Speed |= Mem[SMS_STS_PRESENT_SPEED_L-SMS_STS_PRESENT_POSITION_L];
+		Speed |= m[SMS_STS_PRESENT_SPEED_L-SMS_STS_PRESENT_POSITION_L];
 	}else{
 		Err = 0;
 		Speed = readWord(ID, SMS_STS_PRESENT_SPEED_L);
@@ -174,10 +423,14 @@ int SMS_STS::ReadSpeed(int ID)
 int SMS_STS::ReadLoad(int ID)
 {
 	int Load = -1;
-	if(ID==-1){
-		Load = Mem[SMS_STS_PRESENT_LOAD_H-SMS_STS_PRESENT_POSITION_L];
+	if(ID==-1 || (CacheUs && ID>=0 && ID<0xfe)){
+		const u8 *m = feedBackMem(ID);
+		if(!m){
+			return -1;
+		}
+		Load = m[SMS_STS_PRESENT_LOAD_H-SMS_STS_PRESENT_POSITION_L];
 		Load <<= 8;
-		Load |= Mem[SMS_STS_PRESENT_LOAD_L-SMS_STS_PRESENT_POSITION_L];
+		Load |= m[SMS_STS_PRESENT_LOAD_L-SMS_STS_PRESENT_POSITION_L];
 	}else{
 		Err = 0;
 		Load = readWord(ID, SMS_STS_PRESENT_LOAD_L);
@@ -194,8 +447,12 @@ int SMS_STS::ReadLoad(int ID)
 int SMS_STS::ReadVoltage(int ID)
 {	
 	int Voltage = -1;
-	if(ID==-1){
-		Voltage = Mem[SMS_STS_PRESENT_VOLTAGE-SMS_STS_PRESENT_POSITION_L];	
+	if(ID==-1 || (CacheUs && ID>=0 && ID<0xfe)){
+		const u8 *m = feedBackMem(ID);
+		if(!m){
+			return -1;
+		}
+		Voltage = m[SMS_STS_PRESENT_VOLTAGE-SMS_STS_PRESENT_POSITION_L];	
 	}else{
 		Err = 0;
 		Voltage = readByte(ID, SMS_STS_PRESENT_VOLTAGE);
@@ -209,8 +466,12 @@ int SMS_STS::ReadVoltage(int ID)
 int SMS_STS::ReadTemper(int ID)
 {	
 	int Temper = -1;
-	if(ID==-1){
-		Temper = Mem[SMS_STS_PRESENT_TEMPERATURE-SMS_STS_PRESENT_POSITION_L];	
+	if(ID==-1 || (CacheUs && ID>=0 && ID<0xfe)){
+		const u8 *m = feedBackMem(ID);
+		if(!m){
+			return -1;
+		}
+		Temper = m[SMS_STS_PRESENT_TEMPERATURE-SMS_STS_PRESENT_POSITION_L];	
 	}else{
 		Err = 0;
 		Temper = readByte(ID, SMS_STS_PRESENT_TEMPERATURE);
@@ -224,8 +485,12 @@ int SMS_STS::ReadTemper(int ID)
 int SMS_STS::ReadMove(int ID)
 {
 	int Move = -1;
-	if(ID==-1){
-		Move = Mem[SMS_STS_MOVING-SMS_STS_PRESENT_POSITION_L];	
+	if(ID==-1 || (CacheUs && ID>=0 && ID<0xfe)){
+		const u8 *m = feedBackMem(ID);
+		if(!m){
+			return -1;
+		}
+		Move = m[SMS_STS_MOVING-SMS_STS_PRESENT_POSITION_L];	
 	}else{
 		Err = 0;
 		Move = readByte(ID, SMS_STS_MOVING);
@@ -239,10 +504,14 @@ int SMS_STS::ReadMove(int ID)
 int SMS_STS::ReadCurrent(int ID)
 {
 	int Current = -1;
-	if(ID==-1){
-		Current = Mem[SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L];
+	if(ID==-1 || (CacheUs && ID>=0 && ID<0xfe)){
+		const u8 *m = feedBackMem(ID);
+		if(!m){
+			return -1;
+		}
+		Current = m[SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L];
 		Current <<= 8;
-		Current |= Mem[SMS_STS_PRESENT_CURRENT_L-SMS_STS_PRESENT_POSITION_L];
+		Current |= m[SMS_STS_PRESENT_CURRENT_L-SMS_STS_PRESENT_POSITION_L];
 	}else{
 		Err = 0;
 		Current = readWord(ID, SMS_STS_PRESENT_CURRENT_L);
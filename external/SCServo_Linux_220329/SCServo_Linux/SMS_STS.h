@@ -60,8 +60,26 @@
 #define SMS_STS_PRESENT_CURRENT_L 69
 #define SMS_STS_PRESENT_CURRENT_H 70
 
+//同步读最大舵机数量
+#define SMS_STS_SYNC_MAX 32
+
+//WaitMotionComplete()同步读间隔(us)
+#define SMS_STS_WAIT_POLL_US 2000
+
 #include "SCSerial.h"
 
+//舵机反馈信息(FeedBack内存块解码结果)
+struct ServoState{
+	int Pos;//位置
+	int Speed;//速度
+	int Load;//输出至电机的电压百分比(0~1000)
+	int Voltage;//电压
+	int Temper;//温度
+	int Move;//移动状态
+	int Current;//电流
+	int Err;//0=有效, 1=无应答或校验错误, 2=熔断中未读取(SCSerial::BreakerMisses)
+};
+
 class SMS_STS : public SCSerial
 {
 public:
@@ -70,14 +88,18 @@ public:
 	SMS_STS(u8 End, u8 Level);
 	virtual int WritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC = 0);//普通写单个舵机位置指令
 	virtual int RegWritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC = 0);//异步写单个舵机位置指令(RegWriteAction生效)
-	virtual void SyncWritePosEx(u8 ID[], u8 IDN, s16 Position[], u16 Speed[], u8 ACC[]);//同步写多个舵机位置指令
+	virtual void SyncWritePosEx(u8 ID[], u8 IDN, const s16 Position[], const u16 Speed[], const u8 ACC[]);//同步写多个舵机位置指令(不修改Position[])
 	virtual int WheelMode(u8 ID);//恒速模式
 	virtual int WriteSpe(u8 ID, s16 Speed, u8 ACC = 0);//恒速模式控制指令
 	virtual int EnableTorque(u8 ID, u8 Enable);//扭力控制指令
 	virtual int unLockEprom(u8 ID);//eprom解锁
 	virtual int LockEprom(u8 ID);//eprom加锁
 	virtual int CalibrationOfs(u8 ID);//中位校准
+	virtual int ChangeBaudRate(u8 ID[], u8 IDN, int baudRate);//舵机与主机一起切换波特率并Ping确认, 返回新波特率下应答的舵机数, 舵机或主机不支持该波特率返回-1(未改动舵机)
+	static int BaudRateCode(int baudRate);//波特率->SMS_STS_BAUD_RATE寄存器值, 不支持返回-1
 	virtual int FeedBack(int ID);//反馈舵机信息
+	virtual int SyncFeedBack(u8 ID[], u8 IDN, ServoState State[]);//同步读多个舵机反馈信息，返回应答舵机数(略去熔断中的舵机)
+	virtual int WaitMotionComplete(u8 ID[], u8 IDN, const s16 Goal[], u16 Tolerance, u32 TimeOut);//等待全部舵机停止(MOVING=0)且距Goal[]不超过Tolerance步, 返回等待ms, 超时返回-1; 有舵机熔断中(BreakerMisses)立即返回-1, Err=2
 	virtual int ReadPos(int ID);//读位置
 	virtual int ReadSpeed(int ID);//读速度
 	virtual int ReadLoad(int ID);//读输出至电机的电压百分比(0~1000)
@@ -85,8 +107,20 @@ public:
 	virtual int ReadTemper(int ID);//读温度
 	virtual int ReadMove(int ID);//读移动状态
 	virtual int ReadCurrent(int ID);//读电流
+	void ClearCache();//清除全部反馈缓存
+public:
+	unsigned long CacheUs;//反馈缓存有效期(us), 0为关闭(默认, ReadX(ID)每次读单个寄存器); >0时FeedBack()/SyncFeedBack()的应答按ID缓存, 有效期内ReadX(ID)直接返回, 过期则一次读整个反馈内存块; 本类的写指令丢弃该舵机的缓存
+	unsigned long CacheHits;//ReadX(ID)由缓存返回的次数
+	unsigned long CacheMisses;//ReadX(ID)因缓存过期或缺失读取反馈内存块的次数
 private:
+	void Mem2State(const u8 *nMem, ServoState *State);//反馈内存块解码
+	const u8 *feedBackMem(int ID);//ReadX()的反馈内存块: ID=-1为Mem, 否则为ID的缓存(过期时先读取), 无应答返回NULL
+	void cacheStore(u8 ID, const u8 *nMem, long long Us);
+	void cacheDrop(u8 ID);
 	u8 Mem[SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L+1];
+	u8 cacheMem[256][SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L+1];//按ID缓存的反馈内存块
+	long long cacheTime[256];//缓存时间(us, CLOCK_MONOTONIC), 0为无缓存
+	u8 syncFeedBackBuff[SMS_STS_SYNC_MAX*(SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L+1+6)];//同步读常驻接收缓冲
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+/*
+ * SPSCRing.h
+ * Lock-free single-producer/single-consumer ring of preallocated slots
+ * One thread calls Push(), one other thread calls Pop(); neither blocks
+ * Date: 2026.10.14
+ */
+
+#ifndef _SPSCRING_H
+#define _SPSCRING_H
+
+#include <atomic>
+
+template<typename T, unsigned N>
+class SPSCRing
+{
+	static_assert(N>=2 && (N&(N-1))==0, "SPSCRing capacity must be a power of two");
+public:
+	SPSCRing():head(0), tail(0), dropped(0){}
+
+	//producer: copy v into the ring, false (and counted as dropped) when full
+	bool Push(const T &v)
+	{
+		unsigned h = head.load(std::memory_order_relaxed);
+		if(h-tail.load(std::memory_order_acquire)==N){
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		slot[h&(N-1)] = v;
+		head.store(h+1, std::memory_order_release);
+		return true;
+	}
+
+	//consumer: take the oldest element, false when empty
+	bool Pop(T &v)
+	{
+		unsigned t = tail.load(std::memory_order_relaxed);
+		if(t==head.load(std::memory_order_acquire)){
+			return false;
+		}
+		v = slot[t&(N-1)];
+		tail.store(t+1, std::memory_order_release);
+		return true;
+	}
+
+	unsigned Size() const { return head.load(std::memory_order_acquire)-tail.load(std::memory_order_acquire); }
+	bool Empty() const { return Size()==0; }
+	static unsigned Capacity() { return N; }
+	unsigned long Dropped() const { return dropped.load(std::memory_order_relaxed); }
+	void ResetDropped() { dropped.store(0, std::memory_order_relaxed); }
+private:
+	//producer and consumer indices on separate cache lines
+	alignas(64) std::atomic<unsigned> head;
+	alignas(64) std::atomic<unsigned> tail;
+	alignas(64) std::atomic<unsigned long> dropped;
+	T slot[N];
+};
+
+#endif
@@ -0,0 +1,354 @@
+/*
+ * SafetyModel.cpp
+ * Table-driven setpoint validation for the KikoBot C1 arm
+ * Date: 2026.10.14
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include "SafetyModel.h"
+
+#define SAFETY_ROUND 1.0//steps: setpoints are whole steps, each difference may be one off
+
+static long long monoUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
+
+//grid joints: J2, J3, J4
+static const int GJ[3] = {1, 2, 3};
+
+SafetyModel::SafetyModel()
+{
+	for(int j=0; j<JOINT_N; j++){
+		Min[j] = JOINT_MIN_STEPS[j];
+		Max[j] = JOINT_MAX_STEPS[j];
+		MaxSpeed[j] = SAFETY_SPEED_MAX;
+		MaxAcc[j] = SAFETY_ACC_MAX;
+		stepTick[j] = 0;
+	}
+	FloorMm = 0;
+	BaseRadiusMm = 45;
+	LinkRadiusMm = 20;
+	ToolMm = 0;
+	Checked = 0;
+	Refused = 0;
+	Fault = SAFETY_OK;
+	FaultJoint = -1;
+	memset(n, 0, sizeof(n));
+	memset(gridMin, 0, sizeof(gridMin));
+	window = 1;
+	memset(ref, 0, sizeof(ref));
+	Reset();
+}
+
+void SafetyModel::Reset()
+{
+	memset(refValid, 0, sizeof(refValid));
+	head = 0;
+	streamN = 0;
+}
+
+void SafetyModel::Reset(const u8 ID[], u8 IDN, const s16 Position[])
+{
+	Reset();
+	for(u8 i=0; i<IDN; i++){
+		int j = JointOfID(ID[i]);
+		if(j>=0){
+			ref[j] = Position[i];
+			refValid[j] = true;
+		}
+	}
+}
+
+//closest distance of segments ab and cd in the arm plane
+static double segDist(const double a[2], const double b[2], const double c[2], const double d[2])
+{
+	double r[2] = {b[0]-a[0], b[1]-a[1]};
+	double s[2] = {d[0]-c[0], d[1]-c[1]};
+	double den = r[0]*s[1]-r[1]*s[0];
+	if(den!=0){
+		double t = ((c[0]-a[0])*s[1]-(c[1]-a[1])*s[0])/den;
+		double u = ((c[0]-a[0])*r[1]-(c[1]-a[1])*r[0])/den;
+		if(t>=0 && t<=1 && u>=0 && u<=1){
+			return 0;
+		}
+	}
+	//otherwise one of the four endpoints is closest
+	const double *p[4] = {a, b, c, d};
+	const double *s0[4] = {c, c, a, a};
+	const double *s1[4] = {d, d, b, b};
+	double best = 1e30;
+	for(int k=0; k<4; k++){
+		double vx = s1[k][0]-s0[k][0], vy = s1[k][1]-s0[k][1];
+		double l2 = vx*vx+vy*vy;
+		double t = l2>0 ? ((p[k][0]-s0[k][0])*vx+(p[k][1]-s0[k][1])*vy)/l2 : 0;
+		t = t<0 ? 0 : (t>1 ? 1 : t);
+		double dx = p[k][0]-s0[k][0]-t*vx, dy = p[k][1]-s0[k][1]-t*vy;
+		best = std::min(best, sqrt(dx*dx+dy*dy));
+	}
+	return best;
+}
+
+//does segment ab cross the box r in [-R, R], z below Top (Liang-Barsky clip)?
+static bool segColumn(const double a[2], const double b[2], double R, double Top)
+{
+	double t0 = 0, t1 = 1;
+	double d[2] = {b[0]-a[0], b[1]-a[1]};
+	double p[3] = {-d[0], d[0], d[1]};
+	double q[3] = {a[0]+R, R-a[0], Top-a[1]};
+	for(int k=0; k<3; k++){
+		if(p[k]==0){
+			if(q[k]<0){
+				return false;
+			}
+			continue;
+		}
+		double t = q[k]/p[k];
+		if(p[k]<0){
+			t0 = std::max(t0, t);
+		}else{
+			t1 = std::min(t1, t);
+		}
+		if(t0>t1){
+			return false;
+		}
+	}
+	return true;
+}
+
+//the planar chain of Kinematics::Position(): r out from the base axis, z up;
+//joint angles in arm coordinates
+bool SafetyModel::collides(const Kinematics &Kin, double Q2, double Q3, double Q4, double Margin) const
+{
+	const KinDH *D = Kin.DH;
+	double sa = sin(D[0].alpha);
+	double t2 = Kin.Sign[1]*Q2+D[1].offset;
+	double t23 = t2+Kin.Sign[2]*Q3+D[2].offset;
+	double t234 = t23+Kin.Sign[3]*Q4+D[3].offset;
+	double L = D[3].a+ToolMm;
+	double S[2] = {D[0].a, D[0].d};
+	double E[2] = {S[0]+D[1].a*cos(t2), S[1]+sa*D[1].a*sin(t2)};
+	double W[2] = {E[0]+D[2].a*cos(t23), E[1]+sa*D[2].a*sin(t23)};
+	double F[2] = {W[0]+L*cos(t234), W[1]+sa*L*sin(t234)};
+	double R = LinkRadiusMm+Margin;
+	//links are straight, their lowest points are joints
+	if(E[1]<FloorMm+R || W[1]<FloorMm+R || F[1]<FloorMm+Margin){
+		return true;
+	}
+	//forearm and tool link into the base column (the upper arm is hinged on it)
+	if(segColumn(E, W, BaseRadiusMm+R, S[1]+R) || segColumn(W, F, BaseRadiusMm+R, S[1]+R)){
+		return true;
+	}
+	//tool link back onto the upper arm; neighbouring links are kept apart by the joint limits
+	return segDist(S, E, W, F)<2*LinkRadiusMm+Margin;
+}
+
+void SafetyModel::Build(const Kinematics &Kin, unsigned long PeriodUs)
+{
+	if(PeriodUs==0){
+		PeriodUs = 1;
+	}
+	for(int j=0; j<JOINT_N; j++){
+		stepTick[j] = MaxSpeed[j]*(PeriodUs/1e6)+SAFETY_ROUND;
+	}
+	window = (int)((SAFETY_ACC_WINDOW_US+PeriodUs-1)/PeriodUs);
+	window = std::max(1, std::min(window, (SAFETY_HISTORY-1)/2));
+
+	//how far a link point can move between a cell's nearest corner and any
+	//point inside: half a cell on each grid joint times its lever arm
+	const KinDH *D = Kin.DH;
+	double L = D[3].a+ToolMm;
+	double h = (SAFETY_GRID_STEPS/2)/JOINT_STEPS_PER_RAD;
+	double margin = h*((D[1].a+D[2].a+L)+(D[2].a+L)+L);
+
+	int c[3];
+	for(int g=0; g<3; g++){
+		gridMin[g] = Min[GJ[g]];
+		n[g] = ((Max[GJ[g]]-Min[GJ[g]])>>SAFETY_GRID_SHIFT)+1;
+		c[g] = n[g]+1;
+	}
+	//collision at every cell corner, then a cell is blocked if any corner is
+	std::vector<char> corner((size_t)c[0]*c[1]*c[2]);
+	std::vector<double> a4(c[2]);
+	for(int k=0; k<c[2]; k++){
+		a4[k] = JointRad(GJ[2], gridMin[2]+k*SAFETY_GRID_STEPS);
+	}
+	for(int i=0; i<c[0]; i++){
+		double a2 = JointRad(GJ[0], gridMin[0]+i*SAFETY_GRID_STEPS);
+		for(int j=0; j<c[1]; j++){
+			double a3 = JointRad(GJ[1], gridMin[1]+j*SAFETY_GRID_STEPS);
+			char *row = &corner[((size_t)i*c[1]+j)*c[2]];
+			for(int k=0; k<c[2]; k++){
+				row[k] = collides(Kin, a2, a3, a4[k], margin);
+			}
+		}
+	}
+	size_t cells = (size_t)n[0]*n[1]*n[2];
+	grid.assign((cells+31)/32, 0);
+	for(int i=0; i<n[0]; i++){
+		for(int j=0; j<n[1]; j++){
+			for(int k=0; k<n[2]; k++){
+				bool b = false;
+				for(int d=0; d<8 && !b; d++){
+					b = corner[((size_t)(i+(d&1))*c[1]+j+((d>>1)&1))*c[2]+k+(d>>2)];
+				}
+				if(b){
+					size_t x = ((size_t)i*n[1]+j)*n[2]+k;
+					grid[x>>5] |= 1u<<(x&31);
+				}
+			}
+		}
+	}
+	Reset();
+}
+
+bool SafetyModel::Collides(const s16 Position[JOINT_N]) const
+{
+	if(grid.empty()){
+		return false;
+	}
+	int c[3];
+	for(int g=0; g<3; g++){
+		c[g] = (Position[GJ[g]]-gridMin[g])>>SAFETY_GRID_SHIFT;
+		if(Position[GJ[g]]<gridMin[g] || c[g]>=n[g]){
+			return true;
+		}
+	}
+	size_t x = ((size_t)c[0]*n[1]+c[1])*n[2]+c[2];
+	return (grid[x>>5]>>(x&31))&1;
+}
+
+//joint-space line at half-cell spacing, at most 2*4096/SAFETY_GRID_STEPS lookups
+bool SafetyModel::pathBlocked(const s16 From[], const s16 To[]) const
+{
+	int travel = 0;
+	for(int g=0; g<3; g++){
+		travel = std::max(travel, abs(To[GJ[g]]-From[GJ[g]]));
+	}
+	int steps = travel/(SAFETY_GRID_STEPS/2)+1;
+	s16 P[JOINT_N];
+	memcpy(P, To, sizeof(P));
+	for(int k=1; k<steps; k++){
+		for(int g=0; g<3; g++){
+			int j = GJ[g];
+			P[j] = (s16)(From[j]+(To[j]-From[j])*k/steps);
+		}
+		if(Collides(P)){
+			return true;
+		}
+	}
+	return Collides(To);
+}
+
+int SafetyModel::Check(const u8 ID[], u8 IDN, const s16 Position[], const u16 Speed[], bool Stream)
+{
+	Checked++;
+	s16 next[JOINT_N];
+	bool set[JOINT_N] = {false};
+	memcpy(next, ref, sizeof(next));
+	int fault = SAFETY_OK;
+	int joint = -1;
+	//the first setpoint of a stream has no speed history: checked as a goal
+	bool goal = !Stream || streamN==0;
+	for(u8 i=0; i<IDN; i++){
+		int j = JointOfID(ID[i]);
+		if(j<0){
+			continue;
+		}
+		s16 p = Position[i];
+		next[j] = p;
+		set[j] = true;
+		int f = SAFETY_OK;
+		if(p<Min[j] || p>Max[j]){
+			f |= SAFETY_LIMIT;
+		}
+		//a move the servo finishes within one period needs no speed field
+		u16 v = Speed ? Speed[i] : 0;
+		if(goal && (v==0 || v>MaxSpeed[j]) && (!refValid[j] || abs(p-ref[j])>stepTick[j])){
+			f |= SAFETY_SPEED;
+		}
+		if(f && joint<0){
+			joint = j;
+		}
+		fault |= f;
+	}
+
+	long long now = monoUs();
+	if(!goal){
+		const s16 *last = hist[head];
+		double dt = (now-histUs[head])/1e6;
+		int k1 = (head-(window-1)+SAFETY_HISTORY)%SAFETY_HISTORY;//window setpoints before this one
+		int k2 = (head-(2*window-1)+SAFETY_HISTORY)%SAFETY_HISTORY;
+		bool acc = streamN>=2*window;
+		double dt1 = (now-histUs[k1])/1e6;
+		double dt0 = (histUs[k1]-histUs[k2])/1e6;
+		for(int j=0; j<JOINT_N; j++){
+			if(!set[j] || !refValid[j]){
+				continue;
+			}
+			int f = SAFETY_OK;
+			if(abs(next[j]-last[j])>MaxSpeed[j]*dt+SAFETY_ROUND){
+				f |= SAFETY_SPEED;
+			}
+			if(acc && dt1>0 && dt0>0){
+				double dv = (next[j]-hist[k1][j])/dt1-(hist[k1][j]-hist[k2][j])/dt0;
+				if(fabs(dv)-SAFETY_ROUND*(1/dt1+1/dt0)>MaxAcc[j]*(dt1+dt0)/2){
+					f |= SAFETY_ACC;
+				}
+			}
+			if(f && joint<0){
+				joint = j;
+			}
+			fault |= f;
+		}
+	}
+
+	//out-of-limit grid joints have no cell; joints never seen are not checked
+	if(!(fault&SAFETY_LIMIT) && !grid.empty() && (set[1]||refValid[1]) && (set[2]||refValid[2]) && (set[3]||refValid[3])){
+		bool from = refValid[1] && refValid[2] && refValid[3];
+		if((goal && from) ? pathBlocked(ref, next) : Collides(next)){
+			fault |= SAFETY_COLLISION;
+		}
+	}
+
+	if(fault){
+		Refused++;
+		Fault = fault;
+		FaultJoint = joint;
+		return fault;
+	}
+	memcpy(ref, next, sizeof(ref));
+	for(int j=0; j<JOINT_N; j++){
+		refValid[j] = refValid[j] || set[j];
+	}
+	if(Stream){
+		head = (head+1)%SAFETY_HISTORY;
+		memcpy(hist[head], next, sizeof(next));
+		histUs[head] = now;
+		if(streamN<SAFETY_HISTORY){
+			streamN++;
+		}
+	}else{
+		streamN = 0;
+	}
+	return SAFETY_OK;
+}
+
+double SafetyModel::BlockedRatio() const
+{
+	size_t cells = (size_t)n[0]*n[1]*n[2];
+	if(!cells){
+		return 0;
+	}
+	size_t b = 0;
+	for(size_t w=0; w<grid.size(); w++){
+		b += __builtin_popcount(grid[w]);
+	}
+	return (double)b/cells;
+}
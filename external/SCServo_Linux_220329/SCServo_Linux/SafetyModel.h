@@ -0,0 +1,94 @@
+/*
+ * SafetyModel.h
+ * Table-driven setpoint validation for the KikoBot C1 arm
+ *
+ * Build() precomputes everything once: per-joint travel per control
+ * period, the acceleration window in periods, and a coarse
+ * self-collision grid over J2/J3/J4, the pitch joints that place the links
+ * in the arm plane (J1 turns that plane, J5/J6 only turn the flange). A
+ * grid cell is SAFETY_GRID_STEPS wide on each joint and blocked when the
+ * upper arm, forearm or tool link, as capsules of LinkRadiusMm, comes near
+ * the floor, the base column or (tool link) the upper arm at any of its
+ * corners (the flange itself may come down to the floor, it is the grasp
+ * point); the radius is grown by how far a link point can move inside a
+ * cell, so a free cell is free throughout. At run time a check is a few
+ * compares per joint and one bit lookup, nothing geometric.
+ *
+ * Check() takes a setpoint by servo ID (JointOfID(), one arm per model):
+ *   Stream - setpoints of a control loop, measured against the ones
+ *            accepted before: speed over the last tick, acceleration as
+ *            the change of mean speed between two windows of about
+ *            SAFETY_ACC_WINDOW_US, timed by CLOCK_MONOTONIC
+ *   goal   - a point-to-point target the servo reaches with its own
+ *            profile: the speed field must be non-zero and within
+ *            MaxSpeed, and the joint-space line from the last setpoint is
+ *            walked through the grid at half-cell spacing
+ * The first setpoint of a stream (after Reset() or a goal) is checked as
+ * a goal, unless it is within one period's travel of the reference.
+ * A refused setpoint changes nothing; accepted ones become the reference.
+ * Date: 2026.10.14
+ */
+
+#ifndef _SAFETYMODEL_H
+#define _SAFETYMODEL_H
+
+#include <stddef.h>
+#include <vector>
+#include "INST.h"
+#include "JointModel.h"
+#include "Kinematics.h"
+
+#define SAFETY_OK 0
+#define SAFETY_LIMIT 0x01//outside the joint limits
+#define SAFETY_SPEED 0x02//faster than MaxSpeed
+#define SAFETY_ACC 0x04//harder than MaxAcc
+#define SAFETY_COLLISION 0x08//in a blocked cell of the collision grid
+
+#define SAFETY_GRID_SHIFT 5
+#define SAFETY_GRID_STEPS (1<<SAFETY_GRID_SHIFT)//cell width, 32 steps = 2.8 deg
+#define SAFETY_SPEED_MAX 2400//default joint speed limit (steps/s), ArmCommand's SpeedLimit
+#define SAFETY_ACC_MAX 30000//default joint acceleration limit (steps/s^2), twice the TrajectoryEngine's
+#define SAFETY_ACC_WINDOW_US 40000//acceleration window, quantization to whole steps swamps shorter ones
+#define SAFETY_HISTORY 64//stream setpoints kept, at least two acceleration windows plus one
+
+class SafetyModel
+{
+public:
+	SafetyModel();//limits from JointModel.h, no collision grid until Build()
+	void Build(const Kinematics &Kin, unsigned long PeriodUs);//tables for a control loop of PeriodUs; again after changing any public member
+	int Check(const u8 ID[], u8 IDN, const s16 Position[], const u16 Speed[], bool Stream);//SAFETY_* bits, SAFETY_OK when accepted; Speed may be NULL (0)
+	void Reset(const u8 ID[], u8 IDN, const s16 Position[]);//present positions as reference, starts a new stream
+	void Reset();//no reference: speed and path checks wait for the first accepted setpoint
+	bool Collides(const s16 Position[JOINT_N]) const;//grid lookup, every joint in joint order
+	bool Built() const { return !grid.empty(); }
+	double BlockedRatio() const;//share of grid cells blocked
+public:
+	s16 Min[JOINT_N];//joint limits (steps)
+	s16 Max[JOINT_N];
+	u16 MaxSpeed[JOINT_N];//steps/s
+	u32 MaxAcc[JOINT_N];//steps/s^2
+	double FloorMm;//mounting surface height in the base frame
+	double BaseRadiusMm;//base column around the J1 axis, up to the shoulder
+	double LinkRadiusMm;//half thickness of every link
+	double ToolMm;//tool length past the flange (the Kinematics flange is the grasp point)
+	u32 Checked;//setpoints checked
+	u32 Refused;
+	int Fault;//SAFETY_* bits of the last refused setpoint
+	int FaultJoint;//first joint (0-based) that tripped it, -1 for the grid
+private:
+	bool collides(const Kinematics &Kin, double Q2, double Q3, double Q4, double Margin) const;
+	bool pathBlocked(const s16 From[], const s16 To[]) const;
+	std::vector<u32> grid;//one bit per cell, J4 fastest
+	int n[3];//cells per grid joint
+	s16 gridMin[3];//position of the first cell's lower corner
+	int window;//stream setpoints per acceleration window
+	double stepTick[JOINT_N];//steps a joint may move in one period
+	s16 ref[JOINT_N];//last accepted setpoint
+	bool refValid[JOINT_N];
+	s16 hist[SAFETY_HISTORY][JOINT_N];//stream setpoints, newest at head
+	long long histUs[SAFETY_HISTORY];
+	int head;
+	int streamN;//setpoints in hist since the stream started
+};
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * SerialBaud.cpp
+ * Arbitrary serial port baud rates through termios2/BOTHER
+ * Date: 2026.10.14
+ */
+
+#include <stdio.h>
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#include "SerialBaud.h"
+
+extern "C" int ioctl(int fd, unsigned long request, ...);
+
+int SerialSetBaud(int fd, int Baud)
+{
+	struct termios2 tio;
+	if(Baud<=0 || ioctl(fd, TCGETS2, &tio)<0){
+		return -1;
+	}
+	tio.c_cflag &= ~(CBAUD | (CBAUD<<IBSHIFT));
+	tio.c_cflag |= BOTHER | (BOTHER<<IBSHIFT);
+	tio.c_ispeed = Baud;
+	tio.c_ospeed = Baud;
+	if(ioctl(fd, TCSETSW2, &tio)<0){//TCSETSW2: after pending output is sent
+		perror("TCSETS2:");
+		return -1;
+	}
+	return SerialGetBaud(fd);//the UART divisor may round the rate
+}
+
+int SerialGetBaud(int fd)
+{
+	struct termios2 tio;
+	if(ioctl(fd, TCGETS2, &tio)<0){
+		return -1;
+	}
+	return tio.c_ospeed;
+}
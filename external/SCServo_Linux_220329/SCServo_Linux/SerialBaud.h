@@ -0,0 +1,17 @@
+/*
+ * SerialBaud.h
+ * Arbitrary serial port baud rates through termios2/BOTHER
+ *
+ * <asm/termbits.h> (termios2) and glibc's <termios.h> cannot be included in
+ * the same translation unit, so the ioctl lives in SerialBaud.cpp behind
+ * this plain-int interface.
+ * Date: 2026.10.14
+ */
+
+#ifndef _SERIALBAUD_H
+#define _SERIALBAUD_H
+
+int SerialSetBaud(int fd, int Baud);//drains output first, returns the rate the driver set or -1
+int SerialGetBaud(int fd);//output rate, -1 on error
+
+#endif
@@ -0,0 +1,637 @@
+/*
+ * SimulatedBus.cpp
+ * In-memory ST3215 bus behind the SCSTransport interface
+ * Date: 2026.10.14
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include "SimulatedBus.h"
+
+//SMS_STS_BAUD_RATE register value -> baud
+static const int simBaudTable[8] = {1000000, 500000, 250000, 128000, 115200, 76800, 57600, 38400};
+
+SimulatedBus::SimulatedBus(bool RealTime)
+{
+	this->RealTime = RealTime;
+	ResponseUs = SIM_BUS_RESPONSE_US;
+	SpeedMax = SIM_BUS_SPEED_MAX;
+	AccMax = SIM_BUS_ACC_MAX;
+	DropRate = 0;
+	CorruptRate = 0;
+	Packets = 0;
+	Replies = 0;
+	for(int i=0; i<256; i++){
+		index[i] = -1;
+	}
+	baud = 1000000;
+	startUs = monoUs();
+	clockUs = 0;
+	motionUs = 0;
+	busFreeUs = 0;
+	rxPos = 0;
+	rng = 0x2545F491u;
+}
+
+SimulatedBus *SimulatedBus::Create(const char *Spec)
+{
+	bool realTime;
+	if(strncmp(Spec, "simfast", 7)==0){
+		realTime = false;
+		Spec += 7;
+	}else if(strncmp(Spec, "sim", 3)==0){
+		realTime = true;
+		Spec += 3;
+	}else{
+		return NULL;
+	}
+	if(*Spec==':'){
+		Spec++;
+	}else if(*Spec==0){
+		Spec = "1-7";
+	}else{
+		return NULL;
+	}
+	SimulatedBus *Bus = new SimulatedBus(realTime);
+	if(!Bus->AddServos(Spec)){
+		delete Bus;
+		return NULL;
+	}
+	return Bus;
+}
+
+bool SimulatedBus::AddServo(u8 ID, int Pos)
+{
+	if(ID>=0xfe || index[ID]>=0){
+		return false;
+	}
+	Update(NowUs());
+	SimServo S;
+	memset(&S, 0, sizeof(S));
+	S.Mem[SMS_STS_MODEL_L] = 777&0xff;//ST3215
+	S.Mem[SMS_STS_MODEL_H] = 777>>8;
+	S.Mem[SMS_STS_ID] = ID;
+	S.Mem[SMS_STS_BAUD_RATE] = SMS_STS_1M;
+	S.Mem[SMS_STS_MAX_ANGLE_LIMIT_L] = 4095&0xff;
+	S.Mem[SMS_STS_MAX_ANGLE_LIMIT_H] = 4095>>8;
+	S.Mem[SMS_STS_TORQUE_ENABLE] = 1;
+	S.Mem[SMS_STS_GOAL_POSITION_L] = Pos&0xff;
+	S.Mem[SMS_STS_GOAL_POSITION_H] = (Pos>>8)&0xff;
+	S.Mem[SMS_STS_PRESENT_VOLTAGE] = 120;
+	S.Mem[SMS_STS_PRESENT_TEMPERATURE] = 30;
+	S.Pos = Pos;
+	Publish(S);
+	index[ID] = servo.size();
+	servo.push_back(S);
+	return true;
+}
+
+bool SimulatedBus::AddServos(const char *Spec)
+{
+	const char *p = Spec;
+	int n = 0;
+	while(*p){
+		char *end;
+		long a = strtol(p, &end, 10);
+		if(end==p){
+			return false;
+		}
+		long b = a;
+		p = end;
+		if(*p=='-'){
+			b = strtol(p+1, &end, 10);
+			if(end==p+1){
+				return false;
+			}
+			p = end;
+		}
+		if(a<0 || b>253 || a>b){
+			return false;
+		}
+		for(long ID=a; ID<=b; ID++){
+			n += AddServo((u8)ID);
+		}
+		if(*p==','){
+			p++;
+		}else if(*p){
+			return false;
+		}
+	}
+	return n>0;
+}
+
+bool SimulatedBus::RemoveServo(u8 ID)
+{
+	int i = index[ID];
+	if(i<0){
+		return false;
+	}
+	servo.erase(servo.begin()+i);
+	for(int k=0; k<256; k++){
+		if(index[k]>i){
+			index[k]--;
+		}
+	}
+	index[ID] = -1;
+	return true;
+}
+
+int SimulatedBus::Servos() const
+{
+	return servo.size();
+}
+
+void SimulatedBus::SetPosition(u8 ID, int Pos)
+{
+	if(index[ID]<0){
+		return;
+	}
+	Update(NowUs());
+	SimServo &S = servo[index[ID]];
+	S.Pos = Pos;
+	S.Vel = 0;
+	Publish(S);
+}
+
+void SimulatedBus::SetObstacle(u8 ID, int Pos)
+{
+	if(index[ID]<0){
+		return;
+	}
+	Update(NowUs());
+	SimServo &S = servo[index[ID]];
+	S.Side = Pos>=S.Pos ? 1 : -1;
+	S.Stop = Pos;
+}
+
+void SimulatedBus::ClearObstacle(u8 ID)
+{
+	if(index[ID]<0){
+		return;
+	}
+	Update(NowUs());
+	servo[index[ID]].Side = 0;
+}
+
+int SimulatedBus::Position(u8 ID)
+{
+	if(index[ID]<0){
+		return -1;
+	}
+	Update(NowUs());
+	return (int)lround(servo[index[ID]].Pos);
+}
+
+u8 *SimulatedBus::Memory(u8 ID)
+{
+	if(index[ID]<0){
+		return NULL;
+	}
+	Update(NowUs());
+	return servo[index[ID]].Mem;
+}
+
+long long SimulatedBus::monoUs() const
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000LL + ts.tv_nsec/1000;
+}
+
+long long SimulatedBus::NowUs()
+{
+	if(RealTime){
+		return monoUs()-startUs;
+	}
+	return clockUs;
+}
+
+void SimulatedBus::SleepUntil(long long Us)
+{
+	if(!RealTime){
+		if(Us>clockUs){
+			clockUs = Us;
+		}
+		return;
+	}
+	long long abs = startUs+Us;
+	struct timespec ts;
+	ts.tv_sec = abs/1000000;
+	ts.tv_nsec = (abs%1000000)*1000;
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)==EINTR){
+	}
+}
+
+void SimulatedBus::Advance(long long Us)
+{
+	SleepUntil(NowUs()+Us);
+	Update(NowUs());
+}
+
+int SimulatedBus::SetBaudRate(int Baud)
+{
+	if(Baud<=0){
+		return -1;
+	}
+	baud = Baud;
+	return 1;
+}
+
+bool SimulatedBus::Chance(double P)
+{
+	if(P<=0){
+		return false;
+	}
+	rng ^= rng<<13;
+	rng ^= rng>>17;
+	rng ^= rng<<5;
+	return rng<P*4294967296.0;
+}
+
+bool SimulatedBus::Listening(const SimServo &S) const
+{
+	u8 b = S.Mem[SMS_STS_BAUD_RATE];
+	return b<8 && simBaudTable[b]==baud;
+}
+
+//host packets go out back to back; each one is executed when its last byte is on the wire
+int SimulatedBus::Write(const u8 *nDat, int nLen)
+{
+	long long now = NowUs();
+	long long txStart = now>busFreeUs ? now : busFreeUs;
+	busFreeUs = txStart+(long long)(nLen*byteUs());
+	int i = 0;
+	while(i+6<=nLen){
+		if(nDat[i]!=0xff || nDat[i+1]!=0xff || nDat[i+2]==0xff){
+			i++;
+			continue;
+		}
+		u8 Len = nDat[i+3];
+		if(Len<2 || i+4+Len>nLen){
+			break;
+		}
+		u8 Sum = 0;
+		for(int k=2; k<3+Len; k++){
+			Sum += nDat[i+k];
+		}
+		if((u8)~Sum!=nDat[i+3+Len]){
+			i++;
+			continue;
+		}
+		i += 4+Len;
+		Packets++;
+		Execute(nDat+i-4-Len, txStart+(long long)(i*byteUs()));
+	}
+	//virtual clock: host write() is paced by the UART
+	if(!RealTime){
+		SleepUntil(txStart+(long long)(nLen*byteUs()));
+	}
+	return nLen;
+}
+
+int SimulatedBus::Read(u8 *nDat, int nLen, long TimeOutUs)
+{
+	if(nLen<=0){
+		return 0;
+	}
+	long long deadline = NowUs()+TimeOutUs;
+	if(rxPos>=rx.size()){
+		//nothing queued: a real port times out too
+		SleepUntil(deadline);
+		return 0;
+	}
+	unsigned int want = rxPos+nLen;
+	unsigned int n;
+	if(want<=rx.size() && rxAt[want-1]<=deadline){
+		SleepUntil(rxAt[want-1]);
+		n = nLen;
+	}else{
+		//short read: wait out the timeout, take whatever arrived by then
+		SleepUntil(deadline);
+		n = 0;
+		while(rxPos+n<rx.size() && (int)n<nLen && rxAt[rxPos+n]<=deadline){
+			n++;
+		}
+	}
+	memcpy(nDat, &rx[0]+rxPos, n);
+	rxPos += n;
+	if(rxPos==rx.size()){
+		FlushRx();
+	}
+	return n;
+}
+
+void SimulatedBus::FlushRx()
+{
+	rx.clear();
+	rxAt.clear();
+	rxPos = 0;
+}
+
+void SimulatedBus::Reply(u8 ID, const u8 *nDat, int nLen, long long AfterUs)
+{
+	long long start = AfterUs>busFreeUs ? AfterUs : busFreeUs;
+	u8 Frame[SCS_FRAME_MAX];
+	Frame[0] = 0xff;
+	Frame[1] = 0xff;
+	Frame[2] = ID;
+	Frame[3] = nLen+2;
+	Frame[4] = 0;//status: no error
+	if(nLen){
+		memcpy(Frame+5, nDat, nLen);//Ping answers with no data, nDat may be NULL
+	}
+	u8 Sum = 0;
+	for(int i=2; i<nLen+5; i++){
+		Sum += Frame[i];
+	}
+	Frame[nLen+5] = ~Sum;
+	if(Chance(CorruptRate)){
+		Frame[nLen+5] ^= 0x5a;
+	}
+	double bUs = byteUs();
+	for(int i=0; i<nLen+6; i++){
+		rx.push_back(Frame[i]);
+		rxAt.push_back(start+(long long)((i+1)*bUs));
+	}
+	busFreeUs = start+(long long)((nLen+6)*bUs);
+	Replies++;
+}
+
+void SimulatedBus::Execute(const u8 *Pkt, long long DoneUs)
+{
+	Update(DoneUs);
+	u8 ID = Pkt[2];
+	u8 Inst = Pkt[4];
+	const u8 *P = Pkt+5;
+	int nP = Pkt[3]-2;
+	long long replyUs = DoneUs+ResponseUs;
+
+	if(Inst==INST_SYNC_READ){
+		if(nP<2){
+			return;
+		}
+		for(int k=2; k<nP; k++){
+			int i = index[P[k]];
+			if(i<0 || !Listening(servo[i]) || Chance(DropRate)){
+				continue;
+			}
+			int n = P[1]<256-P[0] ? P[1] : 256-P[0];
+			Reply(P[k], servo[i].Mem+P[0], n, replyUs);
+		}
+		return;
+	}
+	if(Inst==INST_SYNC_WRITE){
+		if(nP<2 || P[1]==0){
+			return;
+		}
+		for(int k=2; k+P[1]<nP; k+=P[1]+1){
+			int i = index[P[k]];
+			if(i>=0 && Listening(servo[i]) && !Chance(DropRate)){
+				WriteMem(servo[i], P[0], P+k+1, P[1]);
+			}
+		}
+		return;
+	}
+
+	//addressed or broadcast instructions
+	int first = 0;
+	int last = servo.size();
+	if(ID!=0xfe){
+		if(index[ID]<0){
+			return;
+		}
+		first = index[ID];
+		last = first+1;
+	}
+	std::vector<u8> pinged;//broadcast PING: every servo answers at once
+	for(int i=first; i<last; i++){
+		SimServo &S = servo[i];
+		u8 sID = S.Mem[SMS_STS_ID];
+		if(!Listening(S) || Chance(DropRate)){
+			continue;
+		}
+		bool ack = (ID!=0xfe);
+		if(Inst==INST_PING){
+			if(ack){
+				Reply(sID, NULL, 0, replyUs);
+			}else{
+				pinged.push_back(sID);
+			}
+		}else if(Inst==INST_READ){
+			if(ack && nP==2){
+				int n = P[1]<256-P[0] ? P[1] : 256-P[0];
+				Reply(sID, S.Mem+P[0], n, replyUs);
+			}
+		}else if(Inst==INST_WRITE){
+			if(nP>=1){
+				WriteMem(S, P[0], P+1, nP-1);
+				if(ack){
+					Reply(sID, NULL, 0, replyUs);
+				}
+			}
+		}else if(Inst==INST_REG_WRITE){
+			if(nP>=1){
+				S.RegPending = true;
+				S.RegAddr = P[0];
+				S.RegLen = nP-1;
+				memcpy(S.RegDat, P+1, nP-1);
+				if(ack){
+					Reply(sID, NULL, 0, replyUs);
+				}
+			}
+		}else if(Inst==INST_REG_ACTION){
+			if(S.RegPending){
+				S.RegPending = false;
+				WriteMem(S, S.RegAddr, S.RegDat, S.RegLen);
+			}
+			if(ack){
+				Reply(sID, NULL, 0, replyUs);
+			}
+		}
+	}
+	if(pinged.size()==1){
+		Reply(pinged[0], NULL, 0, replyUs);
+	}else if(pinged.size()>1){
+		Collide(pinged, replyUs);
+	}
+}
+
+//the bus idles high and any transmitter pulls it low: overlapping frames AND together
+void SimulatedBus::Collide(const std::vector<u8> &ID, long long AfterUs)
+{
+	long long start = AfterUs>busFreeUs ? AfterUs : busFreeUs;
+	u8 Frame[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+	for(size_t k=0; k<ID.size(); k++){
+		u8 One[6] = {0xff, 0xff, ID[k], 2, 0, (u8)~(ID[k]+2)};
+		for(int i=0; i<6; i++){
+			Frame[i] &= One[i];
+		}
+	}
+	double bUs = byteUs();
+	for(int i=0; i<6; i++){
+		rx.push_back(Frame[i]);
+		rxAt.push_back(start+(long long)((i+1)*bUs));
+	}
+	busFreeUs = start+(long long)(6*bUs);
+	Replies += ID.size();
+}
+
+void SimulatedBus::WriteMem(SimServo &S, u8 MemAddr, const u8 *nDat, int nLen)
+{
+	if(MemAddr+nLen>256){
+		nLen = 256-MemAddr;
+	}
+	u8 oldID = S.Mem[SMS_STS_ID];
+	for(int k=0; k<nLen; k++){
+		int a = MemAddr+k;
+		if(a>=SMS_STS_PRESENT_POSITION_L && a<=SMS_STS_PRESENT_CURRENT_H){
+			continue;//read-only feedback block
+		}
+		if(a==SMS_STS_TORQUE_ENABLE && nDat[k]==128){
+			//CalibrationOfs(): present position becomes 2048
+			S.Pos = 2048;
+			S.Vel = 0;
+			S.Mem[SMS_STS_GOAL_POSITION_L] = 2048&0xff;
+			S.Mem[SMS_STS_GOAL_POSITION_H] = 2048>>8;
+			continue;
+		}
+		S.Mem[a] = nDat[k];
+	}
+	if(MemAddr<=SMS_STS_GOAL_POSITION_H && MemAddr+nLen>SMS_STS_GOAL_POSITION_L){
+		S.Mem[SMS_STS_TORQUE_ENABLE] = 1;//a goal position turns torque on
+	}
+	if(!S.Mem[SMS_STS_TORQUE_ENABLE]){
+		S.Vel = 0;
+	}
+	u8 newID = S.Mem[SMS_STS_ID];
+	if(newID!=oldID){
+		if(newID>=0xfe || index[newID]>=0){
+			S.Mem[SMS_STS_ID] = oldID;
+		}else{
+			index[newID] = index[oldID];
+			index[oldID] = -1;
+		}
+	}
+	Publish(S);
+}
+
+void SimulatedBus::Update(long long Us)
+{
+	if(Us<=motionUs){
+		return;
+	}
+	while(motionUs<Us){
+		long long dt = Us-motionUs;
+		if(dt>SIM_BUS_STEP_US){
+			dt = SIM_BUS_STEP_US;
+		}
+		for(size_t i=0; i<servo.size(); i++){
+			Move(servo[i], dt*1e-6);
+		}
+		motionUs += dt;
+	}
+	for(size_t i=0; i<servo.size(); i++){
+		Publish(servo[i]);
+	}
+}
+
+static int simSignMag(u16 Raw, int Bit)
+{
+	if(Raw&(1<<Bit)){
+		return -(int)(Raw&~(1<<Bit));
+	}
+	return Raw;
+}
+
+void SimulatedBus::Move(SimServo &S, double Dt)
+{
+	const u8 *M = S.Mem;
+	if(!M[SMS_STS_TORQUE_ENABLE]){
+		S.Vel = 0;
+		return;
+	}
+	double acc = M[SMS_STS_ACC] ? M[SMS_STS_ACC]*100.0 : AccMax;
+	int speed = simSignMag(M[SMS_STS_GOAL_SPEED_L]|(M[SMS_STS_GOAL_SPEED_H]<<8), 15);
+	double target;//velocity to approach
+	if(M[SMS_STS_MODE]==1){
+		target = speed;
+		if(target>SpeedMax){
+			target = SpeedMax;
+		}
+		if(target<-SpeedMax){
+			target = -SpeedMax;
+		}
+	}else{
+		int goal = simSignMag(M[SMS_STS_GOAL_POSITION_L]|(M[SMS_STS_GOAL_POSITION_H]<<8), 15);
+		int lo = M[SMS_STS_MIN_ANGLE_LIMIT_L]|(M[SMS_STS_MIN_ANGLE_LIMIT_H]<<8);
+		int hi = M[SMS_STS_MAX_ANGLE_LIMIT_L]|(M[SMS_STS_MAX_ANGLE_LIMIT_H]<<8);
+		if(hi>lo){
+			goal = goal<lo ? lo : (goal>hi ? hi : goal);
+		}
+		double d = goal-S.Pos;
+		if(S.Vel==0 && fabs(d)<0.5){
+			return;
+		}
+		double vmax = (speed>0 && speed<SpeedMax) ? speed : SpeedMax;
+		double brake = sqrt(2*acc*fabs(d));//fastest speed that still stops at the goal
+		target = d>0 ? fmin(vmax, brake) : -fmin(vmax, brake);
+		double dv = target-S.Vel;
+		double lim = acc*Dt;
+		S.Vel += dv>lim ? lim : (dv<-lim ? -lim : dv);
+		double step = S.Vel*Dt;
+		if((d>=0 && step>=d) || (d<=0 && step<=d)){
+			S.Pos = goal;
+			S.Vel = 0;
+		}else{
+			S.Pos += step;
+		}
+		if(S.Side && (S.Pos-S.Stop)*S.Side>0){
+			S.Pos = S.Stop;
+			S.Vel = 0;
+		}
+		return;
+	}
+	double dv = target-S.Vel;
+	double lim = acc*Dt;
+	S.Vel += dv>lim ? lim : (dv<-lim ? -lim : dv);
+	S.Pos = fmod(S.Pos+S.Vel*Dt, 4096.0);
+	if(S.Pos<0){
+		S.Pos += 4096.0;
+	}
+}
+
+void SimulatedBus::Publish(SimServo &S)
+{
+	u8 *M = S.Mem;
+	int Pos = (int)lround(S.Pos);
+	u16 rawPos = Pos<0 ? ((-Pos)|(1<<15)) : Pos;
+	int Vel = (int)lround(S.Vel);
+	u16 rawVel = Vel<0 ? ((-Vel)|(1<<15)) : Vel;
+	int Load = M[SMS_STS_TORQUE_ENABLE] ? (int)(fabs(S.Vel)/SpeedMax*300) : 0;
+	int Current = Load/4;
+	if(S.Side && M[SMS_STS_TORQUE_ENABLE] && !M[SMS_STS_MODE] && S.Pos==S.Stop){
+		//pushing on the obstacle: load follows the position error, about 2.6 A at full load
+		int goal = simSignMag(M[SMS_STS_GOAL_POSITION_L]|(M[SMS_STS_GOAL_POSITION_H]<<8), 15);
+		double push = (goal-S.Stop)*S.Side;
+		if(push>0){
+			Load = push*SIM_BUS_STALL_GAIN>1000 ? 1000 : (int)(push*SIM_BUS_STALL_GAIN);
+			Current = Load*2/5;
+			if(S.Side<0){
+				Load |= 1<<10;
+				Current |= 1<<15;
+			}
+		}
+	}
+	M[SMS_STS_PRESENT_POSITION_L] = rawPos&0xff;
+	M[SMS_STS_PRESENT_POSITION_H] = rawPos>>8;
+	M[SMS_STS_PRESENT_SPEED_L] = rawVel&0xff;
+	M[SMS_STS_PRESENT_SPEED_H] = rawVel>>8;
+	M[SMS_STS_PRESENT_LOAD_L] = Load&0xff;
+	M[SMS_STS_PRESENT_LOAD_H] = Load>>8;
+	M[SMS_STS_MOVING] = S.Vel!=0;
+	M[SMS_STS_PRESENT_CURRENT_L] = Current&0xff;
+	M[SMS_STS_PRESENT_CURRENT_H] = Current>>8;
+}
@@ -0,0 +1,112 @@
+/*
+ * SimulatedBus.h
+ * In-memory ST3215 bus behind the SCSTransport interface
+ *
+ * Each servo has its memory table (addresses from SMS_STS.h) and answers
+ * PING, READ, WRITE, REG_WRITE/ACTION, SYNC_READ and SYNC_WRITE like the
+ * real part. Packets and replies take their 8N1 wire time at the host baud rate,
+ * plus ResponseUs of servo turnaround, one frame at a time on the half-duplex
+ * bus. Servos whose baud register does not match the host ignore the bus.
+ * A broadcast PING is answered by every servo at once; with more than one
+ * the frames collide and arrive ANDed together, as on the real wire.
+ *
+ * Motion: in position mode a servo runs a trapezoidal profile toward its
+ * goal, limited by the goal speed (0 = SpeedMax) and by ACC x 100 steps/s^2
+ * (0 = AccMax). In wheel mode it runs at the goal speed. With torque off it
+ * stays where it is, or wherever SetPosition() puts it, like an arm moved
+ * by hand. Writing a goal position turns torque on. SetObstacle() puts an
+ * object in a servo's way (a part between the gripper jaws): it stops
+ * there, and load and current rise with how far the goal lies beyond it.
+ *
+ * RealTime clocks the bus with CLOCK_MONOTONIC and sleeps for wire time and
+ * timeouts. Otherwise the clock is virtual: it jumps by wire time, timeouts
+ * and Advance(), so trajectories run much faster than real time.
+ *
+ * SCSerial::begin(baud, "sim") creates one with servos 1-7, or use
+ * "sim:1-6,8-14" for other IDs. The "simfast" prefix gives a virtual clock.
+ * Date: 2026.10.14
+ */
+
+#ifndef _SIMULATEDBUS_H
+#define _SIMULATEDBUS_H
+
+#include <vector>
+#include "SCSTransport.h"
+#include "SMS_STS.h"
+
+#define SIM_BUS_SPEED_MAX 3400//steps/s at ACC speed 0
+#define SIM_BUS_ACC_MAX 100000//steps/s^2 at ACC 0
+#define SIM_BUS_RESPONSE_US 50//servo turnaround before a reply
+#define SIM_BUS_STEP_US 1000//motion integration step
+#define SIM_BUS_STALL_GAIN 20//load per step of goal beyond an obstacle (0~1000)
+
+struct SimServo{
+	u8 Mem[256];//memory table
+	double Pos;//steps
+	double Vel;//steps/s
+	bool RegPending;//REG_WRITE waiting for ACTION
+	u8 RegAddr;
+	u8 RegLen;
+	u8 RegDat[256];
+	int Side;//obstacle: +1 blocks motion above Stop, -1 below, 0 none
+	double Stop;
+};
+
+class SimulatedBus : public SCSTransport
+{
+public:
+	SimulatedBus(bool RealTime = true);
+	static SimulatedBus *Create(const char *Spec);//"sim[:ids]" / "simfast[:ids]", NULL if Spec is not one of those
+	bool AddServo(u8 ID, int Pos = 2048);//false if ID is taken
+	bool AddServos(const char *Spec);//"1-7" / "1,2,8-14"
+	bool RemoveServo(u8 ID);
+	bool HasServo(u8 ID) const { return index[ID]>=0; }
+	int Servos() const;
+	void SetPosition(u8 ID, int Pos);//move a servo from outside (by hand), velocity reset
+	void SetObstacle(u8 ID, int Pos);//the servo cannot move past Pos from where it is now
+	void ClearObstacle(u8 ID);
+	int Position(u8 ID);//present position, -1 if absent
+	u8 *Memory(u8 ID);//memory table, NULL if absent
+	long long NowUs();//bus clock, microseconds since construction
+	void Advance(long long Us);//let Us pass: sleeps when RealTime, jumps the clock otherwise
+	int Write(const u8 *nDat, int nLen);
+	int Read(u8 *nDat, int nLen, long TimeOutUs);
+	void FlushRx();
+	int SetBaudRate(int Baud);
+	int BaudRate() const { return baud; }
+public:
+	bool RealTime;
+	int ResponseUs;
+	double SpeedMax;
+	double AccMax;
+	double DropRate;//chance a servo ignores a packet addressed to it
+	double CorruptRate;//chance a reply goes out with a bad checksum
+	unsigned long Packets;//host packets received
+	unsigned long Replies;//servo replies sent
+private:
+	void Execute(const u8 *Pkt, long long DoneUs);
+	void Reply(u8 ID, const u8 *nDat, int nLen, long long AfterUs);
+	void Collide(const std::vector<u8> &ID, long long AfterUs);//broadcast PING replies on top of each other
+	void WriteMem(SimServo &S, u8 MemAddr, const u8 *nDat, int nLen);
+	void Update(long long Us);//integrate motion up to Us
+	void Move(SimServo &S, double Dt);
+	void Publish(SimServo &S);//Pos/Vel into the memory table
+	bool Listening(const SimServo &S) const;
+	bool Chance(double P);
+	void SleepUntil(long long Us);
+	long long monoUs() const;
+	double byteUs() const { return 10e6/baud; }
+	std::vector<SimServo> servo;
+	int index[256];//ID -> servo, -1 if absent
+	int baud;
+	long long startUs;//CLOCK_MONOTONIC at construction (RealTime)
+	long long clockUs;//virtual clock (!RealTime)
+	long long motionUs;//time motion is integrated up to
+	long long busFreeUs;//end of the last frame on the wire
+	std::vector<u8> rx;//reply bytes for the host
+	std::vector<long long> rxAt;//arrival time per reply byte
+	unsigned int rxPos;
+	unsigned int rng;
+};
+
+#endif
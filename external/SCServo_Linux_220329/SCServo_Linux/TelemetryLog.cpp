@@ -0,0 +1,490 @@
+/*
+ * TelemetryLog.cpp
+ * Servo telemetry logged to compressed columnar chunks
+ * Date: 2026.10.14
+ */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "TelemetryLog.h"
+
+static void putVar(std::vector<u8> &Out, uint64_t V)
+{
+	while(V>=0x80){
+		Out.push_back((u8)(V|0x80));
+		V >>= 7;
+	}
+	Out.push_back((u8)V);
+}
+
+static bool getVar(const u8 *&P, const u8 *End, uint64_t &V)
+{
+	V = 0;
+	for(int Shift=0; P<End && Shift<64; Shift+=7){
+		u8 b = *P++;
+		V |= (uint64_t)(b&0x7f)<<Shift;
+		if(!(b&0x80)){
+			return true;
+		}
+	}
+	return false;
+}
+
+//delta + zigzag, 0 token = run of unchanged values
+static void putColumn(std::vector<u8> &Out, const long long *V, int N)
+{
+	long long prev = 0;
+	uint64_t run = 0;
+	for(int i=0; i<N; i++){
+		long long d = V[i]-prev;
+		prev = V[i];
+		if(!d){
+			run++;
+			continue;
+		}
+		if(run){
+			putVar(Out, 0);
+			putVar(Out, run);
+			run = 0;
+		}
+		putVar(Out, ((uint64_t)d<<1)^(uint64_t)(d>>63));
+	}
+	if(run){
+		putVar(Out, 0);
+		putVar(Out, run);
+	}
+}
+
+static bool getColumn(const u8 *&P, const u8 *End, long long *V, int N)
+{
+	long long prev = 0;
+	int i = 0;
+	while(i<N){
+		uint64_t z;
+		if(!getVar(P, End, z)){
+			return false;
+		}
+		if(!z){
+			uint64_t run;
+			if(!getVar(P, End, run) || run>(uint64_t)(N-i)){
+				return false;
+			}
+			while(run--){
+				V[i++] = prev;
+			}
+			continue;
+		}
+		prev += (long long)(z>>1)^-(long long)(z&1);
+		V[i++] = prev;
+	}
+	return true;
+}
+
+TelemetryLog::TelemetryLog()
+{
+	fp = NULL;
+	joints = 0;
+	periodUs = 0;
+	nextUs = 0;
+	pending = 0;
+	ok = false;
+	lastSec = -1;
+	rows = 0;
+	chunks = 0;
+	bytes = 0;
+	quit = false;
+	running = false;
+}
+
+TelemetryLog::~TelemetryLog()
+{
+	Close();
+}
+
+bool TelemetryLog::Open(const char *Path, const u8 ID[], u8 Joints, unsigned long PeriodUs)
+{
+	Close();
+	if(!Joints || Joints>TELEM_JOINTS_MAX){
+		return false;
+	}
+	if(Path){
+		fp = fopen(Path, "wb");
+		if(!fp){
+			perror("fopen:");
+			return false;
+		}
+		setvbuf(fp, NULL, _IOFBF, 1<<16);
+	}
+	joints = Joints;
+	memcpy(id, ID, Joints);
+	periodUs = PeriodUs;
+	nextUs = 0;
+	memset(haveLast, 0, sizeof(haveLast));
+	memset(last, 0, sizeof(last));
+	colTime.assign(TELEM_CHUNK_ROWS, 0);
+	col.assign((size_t)Joints*TELEM_FIELDS*TELEM_CHUNK_ROWS, 0);
+	out.clear();
+	out.reserve(col.size()*3+TELEM_CHUNK_ROWS*3);
+	pending = 0;
+	Bucket Empty;
+	memset(&Empty, 0, sizeof(Empty));
+	Empty.Sec = -1;
+	bucket.assign((size_t)Joints*TELEM_FIELDS*TELEM_WINDOW_S, Empty);
+	total.assign((size_t)Joints*TELEM_FIELDS, Empty);
+	lastValue.assign((size_t)Joints*TELEM_FIELDS, 0);
+	missed.assign(Joints, 0);
+	lastSec = -1;
+	rows = 0;
+	chunks = 0;
+	bytes = 0;
+	Row Drop;
+	while(ring.Pop(Drop)){}
+	ring.ResetDropped();
+	ok = true;
+	if(fp){
+		TelemHeader H;
+		memset(&H, 0, sizeof(H));
+		H.Magic = TELEM_MAGIC;
+		H.Version = TELEM_VERSION;
+		H.Joints = Joints;
+		H.Fields = TELEM_FIELDS;
+		H.ChunkRows = TELEM_CHUNK_ROWS;
+		H.PeriodUs = PeriodUs;
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		H.StartUs = (int64_t)ts.tv_sec*1000000+ts.tv_nsec/1000;
+		memcpy(H.ID, ID, Joints);
+		ok = fwrite(&H, sizeof(H), 1, fp)==1;
+		bytes = sizeof(H);
+	}
+	quit = false;
+	running = true;
+	worker = std::thread(&TelemetryLog::Work, this);
+	return ok;
+}
+
+bool TelemetryLog::Close()
+{
+	if(!running){
+		return ok;
+	}
+	quit = true;
+	worker.join();
+	running = false;
+	if(fp){
+		fflush(fp);
+		if(fclose(fp)!=0){
+			ok = false;
+		}
+		fp = NULL;
+	}
+	return ok;
+}
+
+bool TelemetryLog::Due(long long NowUs)
+{
+	if(NowUs<nextUs){
+		return false;
+	}
+	nextUs += periodUs;
+	if(nextUs<=NowUs){
+		nextUs = NowUs+periodUs;
+	}
+	return true;
+}
+
+bool TelemetryLog::Push(long long TimeUs, const ServoState State[])
+{
+	if(!running){
+		return false;
+	}
+	Row R;
+	R.TimeUs = TimeUs;
+	for(u8 j=0; j<joints; j++){
+		const ServoState &S = State[j];
+		if(!S.Err){
+			last[j][TELEM_POS] = (s16)S.Pos;
+			last[j][TELEM_SPEED] = (s16)S.Speed;
+			last[j][TELEM_LOAD] = (s16)S.Load;
+			last[j][TELEM_VOLTAGE] = (s16)S.Voltage;
+			last[j][TELEM_TEMPER] = (s16)S.Temper;
+			last[j][TELEM_MOVE] = (s16)S.Move;
+			last[j][TELEM_CURRENT] = (s16)S.Current;
+			haveLast[j] = true;
+		}
+		memcpy(R.V[j], last[j], sizeof(last[j]));
+		R.V[j][TELEM_ERR] = (s16)(S.Err ? S.Err : 0);
+	}
+	return ring.Push(R);
+}
+
+void TelemetryLog::Work()
+{
+	Row R;
+	while(1){
+		bool stop = quit.load();
+		while(ring.Pop(R)){
+			Take(R);
+		}
+		if(stop){
+			break;
+		}
+		usleep(TELEM_POLL_US);
+	}
+	if(pending){
+		Flush();
+	}
+}
+
+void TelemetryLog::Add(Bucket &B, int V)
+{
+	if(!B.N || V<B.Min){
+		B.Min = V;
+	}
+	if(!B.N || V>B.Max){
+		B.Max = V;
+	}
+	B.Sum += V;
+	B.N++;
+}
+
+void TelemetryLog::Merge(Bucket &B, const Bucket &From)
+{
+	if(!From.N){
+		return;
+	}
+	if(!B.N || From.Min<B.Min){
+		B.Min = From.Min;
+	}
+	if(!B.N || From.Max>B.Max){
+		B.Max = From.Max;
+	}
+	B.Sum += From.Sum;
+	B.N += From.N;
+}
+
+void TelemetryLog::Take(const Row &R)
+{
+	long long Sec = R.TimeUs/1000000;
+	{
+		std::lock_guard<std::mutex> l(statLock);
+		lastSec = Sec;
+		for(u8 j=0; j<joints; j++){
+			if(R.V[j][TELEM_ERR]){
+				missed[j]++;
+				continue;
+			}
+			for(int f=0; f<TELEM_ERR; f++){
+				size_t k = (size_t)j*TELEM_FIELDS+f;
+				Bucket &B = bucket[k*TELEM_WINDOW_S+Sec%TELEM_WINDOW_S];
+				if(B.Sec!=Sec){
+					memset(&B, 0, sizeof(B));
+					B.Sec = Sec;
+				}
+				Add(B, R.V[j][f]);
+				Add(total[k], R.V[j][f]);
+				lastValue[k] = R.V[j][f];
+			}
+		}
+	}
+	if(fp){
+		colTime[pending] = R.TimeUs;
+		for(u8 j=0; j<joints; j++){
+			for(int f=0; f<TELEM_FIELDS; f++){
+				col[((size_t)j*TELEM_FIELDS+f)*TELEM_CHUNK_ROWS+pending] = R.V[j][f];
+			}
+		}
+		pending++;
+		if(pending==TELEM_CHUNK_ROWS){
+			Flush();
+		}
+	}
+	rows++;
+}
+
+bool TelemetryLog::Flush()
+{
+	if(!fp || !pending){
+		return true;
+	}
+	out.clear();
+	//times as deltas, so the column coder stores delta of delta
+	long long tmp[TELEM_CHUNK_ROWS];
+	tmp[0] = 0;
+	for(int i=1; i<pending; i++){
+		tmp[i] = colTime[i]-colTime[i-1];
+	}
+	putColumn(out, tmp, pending);
+	for(size_t c=0; c<(size_t)joints*TELEM_FIELDS; c++){
+		const s16 *V = &col[c*TELEM_CHUNK_ROWS];
+		for(int i=0; i<pending; i++){
+			tmp[i] = V[i];
+		}
+		putColumn(out, tmp, pending);
+	}
+	TelemChunkHeader H;
+	memset(&H, 0, sizeof(H));
+	H.Magic = TELEM_CHUNK_MAGIC;
+	H.Rows = pending;
+	H.Bytes = out.size();
+	H.T0Us = colTime[0];
+	pending = 0;
+	if(fwrite(&H, sizeof(H), 1, fp)!=1 || fwrite(&out[0], 1, out.size(), fp)!=out.size()){
+		ok = false;
+		return false;
+	}
+	//one chunk at a time reaches the disk, a crash loses at most the next one
+	fflush(fp);
+	chunks++;
+	bytes += sizeof(H)+out.size();
+	return true;
+}
+
+TelemStats TelemetryLog::Stats(const Bucket &B, u8 Joint, int Field)
+{
+	TelemStats S;
+	S.Min = B.N ? B.Min : 0;
+	S.Max = B.N ? B.Max : 0;
+	S.Mean = B.N ? (double)B.Sum/B.N : 0;
+	S.Last = lastValue[(size_t)Joint*TELEM_FIELDS+Field];
+	S.N = B.N;
+	return S;
+}
+
+TelemStats TelemetryLog::Session(u8 Joint, int Field)
+{
+	std::lock_guard<std::mutex> l(statLock);
+	if(Joint>=joints || Field<0 || Field>=TELEM_ERR || lastValue.empty()){
+		TelemStats S;
+		memset(&S, 0, sizeof(S));
+		return S;
+	}
+	return Stats(total[(size_t)Joint*TELEM_FIELDS+Field], Joint, Field);
+}
+
+TelemStats TelemetryLog::Window(u8 Joint, int Field)
+{
+	std::lock_guard<std::mutex> l(statLock);
+	Bucket B;
+	memset(&B, 0, sizeof(B));
+	if(Joint>=joints || Field<0 || Field>=TELEM_ERR || lastValue.empty()){
+		TelemStats S;
+		memset(&S, 0, sizeof(S));
+		return S;
+	}
+	const Bucket *W = &bucket[((size_t)Joint*TELEM_FIELDS+Field)*TELEM_WINDOW_S];
+	for(int i=0; i<TELEM_WINDOW_S; i++){
+		if(W[i].Sec>=0 && W[i].Sec>lastSec-TELEM_WINDOW_S){
+			Merge(B, W[i]);
+		}
+	}
+	return Stats(B, Joint, Field);
+}
+
+void TelemetryLog::Print(FILE *out)
+{
+	fprintf(out, "telemetry: %lu rows, %lu chunks, %llu bytes, %lu dropped (last %d s / session)\n",
+		Rows(), Chunks(), Bytes(), Dropped(), TELEM_WINDOW_S);
+	fprintf(out, "     ID  temp C now/max/session   volt V min/session   current max/session   load min..max   no reply\n");
+	for(u8 j=0; j<joints; j++){
+		TelemStats T = Window(j, TELEM_TEMPER), Ts = Session(j, TELEM_TEMPER);
+		TelemStats V = Window(j, TELEM_VOLTAGE), Vs = Session(j, TELEM_VOLTAGE);
+		TelemStats C = Window(j, TELEM_CURRENT), Cs = Session(j, TELEM_CURRENT);
+		TelemStats L = Session(j, TELEM_LOAD);
+		unsigned long m;
+		{
+			std::lock_guard<std::mutex> l(statLock);
+			m = missed[j];
+		}
+		if(!Ts.N){
+			fprintf(out, "  %5d  no replies%76lu\n", id[j], m);
+			continue;
+		}
+		fprintf(out, "  %5d  %3d/%3d/%3d              %4.1f/%4.1f            %5d/%5d      %5d..%-5d   %8lu\n",
+			id[j], T.Last, T.Max, Ts.Max, V.Min/10.0, Vs.Min/10.0, C.Max, Cs.Max, L.Min, L.Max, m);
+	}
+}
+
+const char *TelemetryLog::FieldName(int Field)
+{
+	static const char *Name[TELEM_FIELDS] = {"pos", "speed", "load", "voltage", "temper", "move", "current", "err"};
+	return Field>=0 && Field<TELEM_FIELDS ? Name[Field] : "?";
+}
+
+TelemetryReader::TelemetryReader()
+{
+	fp = NULL;
+	n = 0;
+	memset(&hdr, 0, sizeof(hdr));
+}
+
+TelemetryReader::~TelemetryReader()
+{
+	Close();
+}
+
+bool TelemetryReader::Open(const char *Path)
+{
+	Close();
+	fp = fopen(Path, "rb");
+	if(!fp){
+		return false;
+	}
+	if(fread(&hdr, sizeof(hdr), 1, fp)!=1 || hdr.Magic!=TELEM_MAGIC || hdr.Version!=TELEM_VERSION
+		|| !hdr.Joints || hdr.Joints>TELEM_JOINTS_MAX || hdr.Fields!=TELEM_FIELDS){
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void TelemetryReader::Close()
+{
+	if(fp){
+		fclose(fp);
+		fp = NULL;
+	}
+	n = 0;
+}
+
+bool TelemetryReader::Next()
+{
+	n = 0;
+	if(!fp){
+		return false;
+	}
+	TelemChunkHeader H;
+	if(fread(&H, sizeof(H), 1, fp)!=1 || H.Magic!=TELEM_CHUNK_MAGIC || !H.Rows || H.Rows>65536){
+		return false;
+	}
+	buf.resize(H.Bytes);
+	if(H.Bytes && fread(&buf[0], 1, H.Bytes, fp)!=H.Bytes){
+		return false;
+	}
+	int Rows = H.Rows;
+	size_t Cols = (size_t)hdr.Joints*TELEM_FIELDS;
+	t.resize(Rows);
+	v.resize(Cols*Rows);
+	std::vector<long long> tmp(Rows);
+	const u8 *P = buf.empty() ? NULL : &buf[0];
+	const u8 *End = P+H.Bytes;
+	if(!getColumn(P, End, &tmp[0], Rows)){
+		return false;
+	}
+	long long T = H.T0Us;
+	for(int i=0; i<Rows; i++){
+		T += tmp[i];
+		t[i] = T;
+	}
+	for(size_t c=0; c<Cols; c++){
+		if(!getColumn(P, End, &tmp[0], Rows)){
+			return false;
+		}
+		for(int i=0; i<Rows; i++){
+			v[c*Rows+i] = (s16)tmp[i];
+		}
+	}
+	n = Rows;
+	return true;
+}
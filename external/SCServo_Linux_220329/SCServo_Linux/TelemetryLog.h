@@ -0,0 +1,177 @@
+/*
+ * TelemetryLog.h
+ * Servo telemetry (the SyncFeedBack block, registers 56-70) logged to
+ * compressed columnar chunks, with session and rolling statistics
+ *
+ * The control loop only copies one row per Push() into a lock-free ring
+ * (no allocation, no I/O); Due() paces it to PeriodUs, so a loop can
+ * SyncFeedBack only on telemetry ticks. A writer thread drains the ring,
+ * updates the statistics and writes a chunk every TELEM_CHUNK_ROWS rows.
+ *
+ * File layout (little-endian):
+ *   TelemHeader
+ *   chunks:  TelemChunkHeader + Bytes of payload
+ * Payload, one column after another: the row times (delta of delta, us),
+ * then for every joint its TELEM_FIELDS columns. Each column is a stream
+ * of varints: zigzag(delta from the previous value, 0 before the first
+ * row), with a 0 token followed by a run length for repeated values, so
+ * voltage, temperature or MOVE that hold still cost a few bytes per
+ * chunk. Rows without a reply repeat the previous values and carry the
+ * ServoState.Err code in the TELEM_ERR column. A crash loses at most the
+ * chunk in progress.
+ *
+ * Statistics skip rows without a reply. Session() covers everything since
+ * Open(), Window() the last TELEM_WINDOW_S seconds (one-second buckets).
+ * Date: 2026.10.14
+ */
+
+#ifndef _TELEMETRYLOG_H
+#define _TELEMETRYLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SMS_STS.h"
+#include "SPSCRing.h"
+
+#define TELEM_MAGIC 0x4d4c4554//"TELM"
+#define TELEM_CHUNK_MAGIC 0x4b484354//"TCHK"
+#define TELEM_VERSION 1
+#define TELEM_JOINTS_MAX SMS_STS_SYNC_MAX
+#define TELEM_CHUNK_ROWS 256//rows per chunk
+#define TELEM_RING 512//rows queued between the loop and the writer thread
+#define TELEM_WINDOW_S 60//rolling statistics window
+#define TELEM_POLL_US 10000//writer thread wake-up interval
+
+//columns per joint, in file order
+enum TelemField{
+	TELEM_POS,
+	TELEM_SPEED,
+	TELEM_LOAD,
+	TELEM_VOLTAGE,//0.1 V
+	TELEM_TEMPER,//deg C
+	TELEM_MOVE,
+	TELEM_CURRENT,
+	TELEM_ERR,//ServoState.Err
+	TELEM_FIELDS
+};
+
+struct TelemHeader{
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t Joints;
+	uint16_t Fields;
+	uint16_t ChunkRows;
+	uint32_t PeriodUs;//nominal row interval
+	int64_t StartUs;//CLOCK_REALTIME at Open(), for matching shift logs
+	u8 ID[TELEM_JOINTS_MAX];//servo ID per joint
+};
+
+struct TelemChunkHeader{
+	uint32_t Magic;
+	uint32_t Rows;
+	uint32_t Bytes;//payload
+	uint32_t Reserved;
+	int64_t T0Us;//time of the first row, Push() clock
+};
+
+struct TelemStats{
+	int Min;
+	int Max;
+	double Mean;
+	int Last;
+	unsigned long N;//rows counted, 0 = no data
+};
+
+class TelemetryLog
+{
+public:
+	TelemetryLog();
+	~TelemetryLog();//Close()
+	bool Open(const char *Path, const u8 ID[], u8 Joints, unsigned long PeriodUs);//Path NULL keeps statistics only; starts the writer thread
+	bool Close();//writes the rows still queued, false if any write failed
+	bool IsOpen() const { return running; }
+	bool Due(long long NowUs);//loop thread: true once per PeriodUs
+	bool Push(long long TimeUs, const ServoState State[]);//loop thread: State[] in joint order; false if the ring was full
+	TelemStats Session(u8 Joint, int Field);
+	TelemStats Window(u8 Joint, int Field);
+	void Print(FILE *out = stdout);//per-joint summary of the window and the session
+	unsigned long Rows() const { return rows.load(); }//written, or counted without a file
+	unsigned long Chunks() const { return chunks.load(); }
+	unsigned long long Bytes() const { return bytes.load(); }//file size so far
+	unsigned long Dropped() const { return ring.Dropped(); }
+	u8 Joints() const { return joints; }
+	static const char *FieldName(int Field);
+private:
+	struct Row{
+		long long TimeUs;
+		s16 V[TELEM_JOINTS_MAX][TELEM_FIELDS];
+	};
+	struct Bucket{
+		long long Sec;//-1 = empty
+		int Min;
+		int Max;
+		long long Sum;
+		unsigned long N;
+	};
+	void Work();
+	void Take(const Row &R);//statistics + chunk column buffers
+	bool Flush();//write the pending chunk
+	static void Merge(Bucket &B, const Bucket &From);
+	static void Add(Bucket &B, int V);
+	TelemStats Stats(const Bucket &B, u8 Joint, int Field);
+	SPSCRing<Row, TELEM_RING> ring;
+	FILE *fp;
+	u8 joints;
+	u8 id[TELEM_JOINTS_MAX];
+	unsigned long periodUs;
+	long long nextUs;
+	s16 last[TELEM_JOINTS_MAX][TELEM_FIELDS];//loop thread: values repeated for rows without a reply
+	bool haveLast[TELEM_JOINTS_MAX];
+	//writer thread
+	std::vector<long long> colTime;
+	std::vector<s16> col;//[joint][field][row]
+	int pending;//rows in the column buffers
+	std::vector<u8> out;
+	bool ok;
+	//statistics, guarded by statLock
+	std::mutex statLock;
+	std::vector<Bucket> bucket;//[joint][field][TELEM_WINDOW_S]
+	std::vector<Bucket> total;//[joint][field], whole session
+	std::vector<int> lastValue;//[joint][field]
+	std::vector<unsigned long> missed;//[joint] rows without a reply
+	long long lastSec;
+	std::atomic<unsigned long> rows;
+	std::atomic<unsigned long> chunks;
+	std::atomic<unsigned long long> bytes;
+	std::atomic<bool> quit;
+	bool running;
+	std::thread worker;
+};
+
+//decodes a telemetry file chunk by chunk
+class TelemetryReader
+{
+public:
+	TelemetryReader();
+	~TelemetryReader();
+	bool Open(const char *Path);//false if missing or not a telemetry file
+	void Close();
+	const TelemHeader &Header() const { return hdr; }
+	bool Next();//decode the next chunk, false at the end or on a damaged chunk
+	int Rows() const { return n; }//rows in the current chunk
+	long long TimeUs(int Row) const { return t[Row]; }
+	int Value(int Row, u8 Joint, int Field) const { return v[((size_t)Joint*TELEM_FIELDS+Field)*n+Row]; }
+private:
+	FILE *fp;
+	TelemHeader hdr;
+	int n;
+	std::vector<long long> t;
+	std::vector<s16> v;
+	std::vector<u8> buf;
+};
+
+#endif
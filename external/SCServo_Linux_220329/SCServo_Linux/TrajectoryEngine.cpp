@@ -0,0 +1,304 @@
+/*
+ * TrajectoryEngine.cpp
+ * Time-parameterized playback of recorded joint samples
+ * Date: 2026.10.14
+ */
+
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <algorithm>
+#include "TrajectoryEngine.h"
+
+#define PLAN_PASSES 16//local stretch passes before falling back to a uniform slow-down
+
+TrajectoryEngine::TrajectoryEngine()
+{
+	KnotUs = TRAJ_ENGINE_KNOT_US;
+	SpeedMargin = TRAJ_ENGINE_SPEED_MARGIN;
+	SetJoints(0);
+}
+
+void TrajectoryEngine::SetJoints(u8 Joints)
+{
+	if(Joints>SMS_STS_SYNC_MAX){
+		Joints = SMS_STS_SYNC_MAX;
+	}
+	J = Joints;
+	for(u8 j=0; j<SMS_STS_SYNC_MAX; j++){
+		vMax[j] = TRAJ_ENGINE_VEL_MAX;
+		aMax[j] = TRAJ_ENGINE_ACC_MAX;
+		pMin[j] = 0;
+		pMax[j] = 4095;
+	}
+	Clear();
+}
+
+void TrajectoryEngine::SetLimits(u8 Joint, double VelMax, double AccMax)
+{
+	if(Joint>=J || VelMax<=0 || AccMax<=0){
+		return;
+	}
+	vMax[Joint] = VelMax;
+	aMax[Joint] = AccMax;
+	planned = false;
+}
+
+void TrajectoryEngine::SetRange(u8 Joint, s16 PosMin, s16 PosMax)
+{
+	if(Joint>=J || PosMin>PosMax){
+		return;
+	}
+	pMin[Joint] = PosMin;
+	pMax[Joint] = PosMax;
+}
+
+void TrajectoryEngine::Clear()
+{
+	R.clear();
+	T.clear();
+	P.clear();
+	M.clear();
+	lead = 0;
+	planned = false;
+	cur = 0;
+}
+
+bool TrajectoryEngine::Add(uint32_t TimeUs, const s16 Position[])
+{
+	if(!J){
+		return false;
+	}
+	double t = TimeUs/1e6;
+	size_t n = R.size();
+	if(n){
+		if(t<R.back()){
+			return false;
+		}
+		//the last knot stays provisional until the next one is KnotUs past
+		//its predecessor, so the final sample is always kept
+		if(t==R.back() || (n>=2 && t-R[n-2]<KnotUs/1e6)){
+			R.pop_back();
+			P.resize(P.size()-J);
+		}
+	}
+	R.push_back(t);
+	P.insert(P.end(), Position, Position+J);
+	planned = false;
+	return true;
+}
+
+//Fritsch-Carlson tangents (weighted harmonic mean of the adjacent secants,
+//zero at local extrema) keep every segment monotone, so a held pose never
+//overshoots; both ends are at rest
+void TrajectoryEngine::Tangents()
+{
+	size_t n = T.size();
+	M.assign(n*J, 0.0);
+	for(size_t k=1; k+1<n; k++){
+		double h0 = T[k]-T[k-1];
+		double h1 = T[k+1]-T[k];
+		double w1 = 2*h1+h0;
+		double w2 = h1+2*h0;
+		for(u8 j=0; j<J; j++){
+			double d0 = (P[k*J+j]-P[(k-1)*J+j])/h0;
+			double d1 = (P[(k+1)*J+j]-P[k*J+j])/h1;
+			if(d0*d1>0){
+				M[k*J+j] = (w1+w2)/(w1/d0+w2/d1);
+			}
+		}
+	}
+}
+
+//on the unit segment v(s) = 6(s-s^2)d + (3s^2-4s+1)m0 + (3s^2-2s)m1 with d the
+//secant; v peaks at an end or where the (linear) acceleration crosses zero
+double TrajectoryEngine::Stretch(size_t k) const
+{
+	double h = T[k+1]-T[k];
+	double f = 0;
+	for(u8 j=0; j<J; j++){
+		double d = (P[(k+1)*J+j]-P[k*J+j])/h;
+		double m0 = M[k*J+j];
+		double m1 = M[(k+1)*J+j];
+		double a0 = 6*d-4*m0-2*m1;
+		double a1 = -6*d+2*m0+4*m1;
+		double v = std::max(fabs(m0), fabs(m1));
+		if(a0*a1<0){
+			double s = a0/(a0-a1);
+			v = std::max(v, fabs(6*(s-s*s)*d+(3*s*s-4*s+1)*m0+(3*s*s-2*s)*m1));
+		}
+		double a = std::max(fabs(a0), fabs(a1))/h;
+		f = std::max(f, v/vMax[j]);
+		f = std::max(f, sqrt(a/aMax[j]));
+	}
+	return f;
+}
+
+bool TrajectoryEngine::Plan(const s16 Start[])
+{
+	planned = false;
+	cur = 0;
+	if(lead){
+		P.erase(P.begin(), P.begin()+J);
+		lead = 0;
+	}
+	if(R.empty()){
+		return false;
+	}
+	T.resize(R.size());
+	for(size_t k=0; k<R.size(); k++){
+		T[k] = R[k]-R[0];
+	}
+	if(Start){
+		//lead-in sized as a rest-to-rest trapezoid of the longest move, the
+		//stretch passes below correct it for the spline shape
+		double Tl = 0;
+		for(u8 j=0; j<J; j++){
+			double d = fabs((double)P[j]-Start[j]);
+			double v = vMax[j], a = aMax[j];
+			Tl = std::max(Tl, d<v*v/a ? 2*sqrt(d/a) : d/v+v/a);
+		}
+		if(Tl>0){
+			for(size_t k=0; k<T.size(); k++){
+				T[k] += Tl;
+			}
+			T.insert(T.begin(), 0.0);
+			P.insert(P.begin(), Start, Start+J);
+			lead = 1;
+		}
+	}
+	size_t n = T.size();
+	std::vector<double> H(n>1 ? n-1 : 0);
+	for(size_t k=0; k+1<n; k++){
+		H[k] = std::max(T[k+1]-T[k], 1e-3);
+	}
+	//slowing one segment changes its neighbours' tangents, so repeat until
+	//every segment fits
+	for(int pass=0; pass<=PLAN_PASSES; pass++){
+		for(size_t k=0; k+1<n; k++){
+			T[k+1] = T[k]+H[k];
+		}
+		Tangents();
+		bool fits = true;
+		for(size_t k=0; k+1<n; k++){
+			double f = Stretch(k);
+			if(f>1.0){
+				H[k] *= f;
+				fits = false;
+			}
+		}
+		if(fits){
+			planned = true;
+			return true;
+		}
+	}
+	//PCHIP is scale invariant: stretching every segment by F divides all
+	//velocities by F and accelerations by F^2, which always fits
+	for(size_t k=0; k+1<n; k++){
+		T[k+1] = T[k]+H[k];
+	}
+	Tangents();
+	double F = 1.0;
+	for(size_t k=0; k+1<n; k++){
+		F = std::max(F, Stretch(k));
+	}
+	for(size_t k=0; k<n; k++){
+		T[k] *= F;
+	}
+	Tangents();
+	planned = true;
+	return true;
+}
+
+bool TrajectoryEngine::Sample(double TimeUs, s16 Position[], double Velocity[])
+{
+	if(!planned){
+		return false;
+	}
+	size_t n = T.size();
+	double t = TimeUs/1e6;
+	if(n<2 || t>=T.back() || t<=0){
+		size_t k = (n<2 || t<=0) ? 0 : n-1;
+		for(u8 j=0; j<J; j++){
+			s16 p = P[k*J+j];
+			Position[j] = p<pMin[j] ? pMin[j] : (p>pMax[j] ? pMax[j] : p);
+			if(Velocity){
+				Velocity[j] = 0;
+			}
+		}
+		cur = k;
+		return k==0 && n>1;
+	}
+	//sequential playback moves at most one segment per tick
+	if(cur+1>=n || t<T[cur] || t>=T[cur+1]){
+		if(cur+2<n && t>=T[cur+1] && t<T[cur+2]){
+			cur++;
+		}else{
+			cur = std::upper_bound(T.begin(), T.end(), t)-T.begin()-1;
+		}
+	}
+	size_t k = cur;
+	double h = T[k+1]-T[k];
+	double s = (t-T[k])/h;
+	double s2 = s*s, s3 = s2*s;
+	double h00 = 2*s3-3*s2+1, h10 = s3-2*s2+s, h01 = -2*s3+3*s2, h11 = s3-s2;
+	for(u8 j=0; j<J; j++){
+		double p0 = P[k*J+j], p1 = P[(k+1)*J+j];
+		double m0 = M[k*J+j], m1 = M[(k+1)*J+j];
+		double p = h00*p0+h10*h*m0+h01*p1+h11*h*m1;
+		if(p<pMin[j]){
+			p = pMin[j];
+		}else if(p>pMax[j]){
+			p = pMax[j];
+		}
+		Position[j] = (s16)floor(p+0.5);
+		if(Velocity){
+			Velocity[j] = 6*(s-s2)*(p1-p0)/h+(3*s2-4*s+1)*m0+(3*s2-2*s)*m1;
+		}
+	}
+	return true;
+}
+
+//the servo chases each setpoint with its own speed profile, so the speed
+//field is the spline velocity plus a margin to stay on the curve
+bool TrajectoryEngine::Step(ArmCommand &Arm, double TimeUs)
+{
+	if(!planned || Arm.Joints()!=J){
+		return false;
+	}
+	s16 Position[SMS_STS_SYNC_MAX];
+	double Velocity[SMS_STS_SYNC_MAX];
+	u16 Speed[SMS_STS_SYNC_MAX];
+	u8 ACC[SMS_STS_SYNC_MAX];
+	bool more = Sample(TimeUs, Position, Velocity);
+	for(u8 j=0; j<J; j++){
+		double V = fabs(Velocity[j])+SpeedMargin;
+		if(V>Arm.SpeedLimit){
+			V = Arm.SpeedLimit;
+		}
+		Speed[j] = V<1.0 ? 1 : (u16)V;
+		ACC[j] = 0;
+	}
+	//a setpoint refused by the arm's SafetyModel ends the playback
+	return Arm.Write(Position, Speed, ACC)>=0 && more;
+}
+
+void TrajectoryEngine::Play(ArmCommand &Arm, unsigned long PeriodUs)
+{
+	struct timespec t0, deadline;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	deadline = t0;
+	while(1){
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double t = (now.tv_sec-t0.tv_sec)*1e6+(now.tv_nsec-t0.tv_nsec)/1e3;
+		if(!Step(Arm, t)){
+			break;
+		}
+		//absolute deadlines: bus time does not add up over the ticks
+		deadline.tv_nsec += (long)(PeriodUs%1000000)*1000;
+		deadline.tv_sec += PeriodUs/1000000+deadline.tv_nsec/1000000000;
+		deadline.tv_nsec %= 1000000000;
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)==EINTR);
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ * TrajectoryEngine.h
+ * Time-parameterized playback of recorded joint samples
+ * A monotone cubic (PCHIP) spline runs through every sample, segments are
+ * stretched until no joint exceeds its velocity/acceleration limit, and the
+ * result is resampled at the control-loop rate for streaming sync writes
+ * Date: 2026.10.14
+ */
+
+#ifndef _TRAJECTORYENGINE_H
+#define _TRAJECTORYENGINE_H
+
+#include <stdint.h>
+#include <vector>
+#include "ArmCommand.h"
+
+#define TRAJ_ENGINE_VEL_MAX 1200.0//default joint speed limit (steps/s)
+#define TRAJ_ENGINE_ACC_MAX 15000.0//default joint acceleration limit (steps/s^2)
+#define TRAJ_ENGINE_SPEED_MARGIN 200//steps/s added to the feed-forward speed of each setpoint
+#define TRAJ_ENGINE_KNOT_US 50000//default minimum spacing between spline knots
+
+class TrajectoryEngine
+{
+public:
+	TrajectoryEngine();
+	void SetJoints(u8 Joints);//clears samples, resets limits to the defaults
+	void SetLimits(u8 Joint, double VelMax, double AccMax);//steps/s, steps/s^2
+	void SetRange(u8 Joint, s16 PosMin, s16 PosMax);//setpoints are clamped to [PosMin, PosMax]
+	void Clear();//drop samples and plan, keep joints and limits
+	bool Add(uint32_t TimeUs, const s16 Position[]);//timestamps must not decrease; a sample closer than KnotUs to the previous knot replaces the last one
+	bool Plan(const s16 Start[] = NULL);//fit and time-scale, Start adds a lead-in from the current pose; may be called again
+	bool Sample(double TimeUs, s16 Position[], double Velocity[] = NULL);//false once past the end
+	bool Step(ArmCommand &Arm, double TimeUs);//sample and send one sync write, false once past the end or refused by Arm.Safety
+	void Play(ArmCommand &Arm, unsigned long PeriodUs);//Step() every PeriodUs on the calling thread until the end, for programs without a ControlLoop
+	u8 Joints() const { return J; }
+	uint32_t Count() const { return (uint32_t)R.size(); }
+	double DurationUs() const { return T.empty() ? 0 : T.back()*1e6; }
+	double RecordedUs() const { return R.empty() ? 0 : (R.back()-R[0])*1e6; }//duration as timestamped by Add()
+	uint32_t Segment() const { return cur<lead ? 0 : cur-lead; }//sample reached by the last Sample(), for progress display
+public:
+	uint32_t KnotUs;//dense recordings are thinned to this spacing, sensor noise between knots would otherwise dominate the acceleration limit
+	u16 SpeedMargin;//Step(): speed field = |spline velocity| + SpeedMargin, capped at Arm.SpeedLimit
+private:
+	void Tangents();
+	double Stretch(size_t k) const;//factor segment k must slow down by, <= 1 if within limits
+	u8 J;
+	std::vector<double> R;//sample times as added (s)
+	std::vector<double> T;//planned knot times (s), from 0
+	std::vector<s16> P;//knot positions, J per knot, lead-in knot first
+	std::vector<double> M;//knot tangents (steps/s), J per knot
+	uint32_t lead;//1 if P starts with a lead-in knot
+	double vMax[SMS_STS_SYNC_MAX];
+	double aMax[SMS_STS_SYNC_MAX];
+	s16 pMin[SMS_STS_SYNC_MAX];
+	s16 pMax[SMS_STS_SYNC_MAX];
+	bool planned;
+	uint32_t cur;
+};
+
+#endif
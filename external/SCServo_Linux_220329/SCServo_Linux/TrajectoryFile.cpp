@@ -0,0 +1,267 @@
+/*
+ * TrajectoryFile.cpp
+ * Versioned binary trajectory file, written streaming and read via mmap
+ * Date: 2026.10.14
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "TrajectoryFile.h"
+
+TrajectoryWriter::TrajectoryWriter()
+{
+	fp = NULL;
+	keys = NULL;
+	keyCap = 0;
+	ok = false;
+	memset(&hdr, 0, sizeof(hdr));
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+	Close();
+}
+
+bool TrajectoryWriter::Open(const char *Path, uint16_t Joints, uint32_t RateHz, bool Delta, uint16_t KeyInterval)
+{
+	Close();
+	if(!Joints || Joints>TRAJ_JOINTS_MAX || (Delta && !KeyInterval)){
+		return false;
+	}
+	fp = fopen(Path, "wb");
+	if(!fp){
+		perror("fopen:");
+		return false;
+	}
+	setvbuf(fp, NULL, _IOFBF, 1<<16);
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.Magic = TRAJ_MAGIC;
+	hdr.Version = TRAJ_VERSION;
+	hdr.Flags = Delta ? TRAJ_FLAG_DELTA : 0;
+	hdr.Joints = Joints;
+	hdr.KeyInterval = Delta ? KeyInterval : 0;
+	hdr.RateHz = RateHz;
+	sinceKey = 0;
+	ok = fwrite(&hdr, sizeof(hdr), 1, fp)==1;
+	return ok;
+}
+
+bool TrajectoryWriter::Append(uint32_t TimeUs, const s16 Position[])
+{
+	if(!fp){
+		return false;
+	}
+	u8 rec[4+2*TRAJ_JOINTS_MAX];
+	uint32_t n = 4;
+	memcpy(rec, &TimeUs, 4);
+	if(hdr.Flags&TRAJ_FLAG_DELTA){
+		bool key = (hdr.Count==0 || sinceKey>=hdr.KeyInterval);
+		for(uint16_t j=0; j<hdr.Joints && !key; j++){
+			int d = Position[j]-last[j];
+			if(d<-128 || d>127){
+				key = true;
+			}
+		}
+		for(uint16_t j=0; j<hdr.Joints; j++){
+			rec[n++] = key ? 0 : (u8)(int8_t)(Position[j]-last[j]);
+		}
+		if(key){
+			uint32_t keySize = 4+2*hdr.Joints;
+			if(hdr.KeyCount==keyCap){
+				uint32_t cap = keyCap ? keyCap*2 : 64;
+				u8 *p = (u8*)realloc(keys, (size_t)cap*keySize);
+				if(!p){
+					ok = false;
+					return false;
+				}
+				keys = p;
+				keyCap = cap;
+			}
+			u8 *k = keys+(size_t)hdr.KeyCount*keySize;
+			memcpy(k, &hdr.Count, 4);
+			memcpy(k+4, Position, 2*hdr.Joints);
+			hdr.KeyCount++;
+			sinceKey = 0;
+		}
+		sinceKey++;
+	}else{
+		memcpy(rec+4, Position, 2*hdr.Joints);
+		n += 2*hdr.Joints;
+	}
+	memcpy(last, Position, 2*hdr.Joints);
+	if(fwrite(rec, n, 1, fp)!=1){
+		ok = false;
+		return false;
+	}
+	hdr.Count++;
+	return true;
+}
+
+bool TrajectoryWriter::Close()
+{
+	if(!fp){
+		return false;
+	}
+	if(hdr.Flags&TRAJ_FLAG_DELTA){
+		hdr.KeyOffset = sizeof(hdr)+hdr.Count*(4+hdr.Joints);
+		if(hdr.KeyCount && fwrite(keys, (size_t)hdr.KeyCount*(4+2*hdr.Joints), 1, fp)!=1){
+			ok = false;
+		}
+	}
+	if(fseek(fp, 0, SEEK_SET)!=0 || fwrite(&hdr, sizeof(hdr), 1, fp)!=1){
+		ok = false;
+	}
+	if(fclose(fp)!=0){
+		ok = false;
+	}
+	fp = NULL;
+	free(keys);
+	keys = NULL;
+	keyCap = 0;
+	return ok;
+}
+
+TrajectoryReader::TrajectoryReader()
+{
+	hdr = NULL;
+	base = NULL;
+	mapLen = 0;
+	data = NULL;
+	keyTab = NULL;
+	recLen = keyLen = 0;
+	cur = nextKey = 0;
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+	Close();
+}
+
+bool TrajectoryReader::Open(const char *Path)
+{
+	Close();
+	int fd = open(Path, O_RDONLY);
+	if(fd==-1){
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st)!=0 || st.st_size<(off_t)sizeof(TrajHeader)){
+		close(fd);
+		return false;
+	}
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(p==MAP_FAILED){
+		return false;
+	}
+	madvise(p, st.st_size, MADV_SEQUENTIAL);
+	const TrajHeader *h = (const TrajHeader*)p;
+	bool delta = (h->Flags&TRAJ_FLAG_DELTA)!=0;
+	size_t rl = 4+(delta ? 1 : 2)*(size_t)h->Joints;
+	size_t kl = 4+2*(size_t)h->Joints;
+	bool valid = h->Magic==TRAJ_MAGIC && h->Version==TRAJ_VERSION
+		&& h->Joints && h->Joints<=TRAJ_JOINTS_MAX
+		&& sizeof(TrajHeader)+h->Count*rl<=(size_t)st.st_size;
+	if(valid && delta){
+		valid = h->Count==0 || (h->KeyCount && h->KeyOffset>=sizeof(TrajHeader)+h->Count*rl
+			&& h->KeyOffset+h->KeyCount*kl<=(size_t)st.st_size);
+	}
+	if(!valid){
+		munmap(p, st.st_size);
+		return false;
+	}
+	base = (const u8*)p;
+	mapLen = st.st_size;
+	hdr = h;
+	data = base+sizeof(TrajHeader);
+	recLen = rl;
+	keyLen = kl;
+	keyTab = delta ? base+h->KeyOffset : NULL;
+	cur = h->Count;
+	nextKey = 0;
+	return true;
+}
+
+void TrajectoryReader::Close()
+{
+	if(base){
+		munmap((void*)base, mapLen);
+	}
+	hdr = NULL;
+	base = NULL;
+	mapLen = 0;
+	data = NULL;
+	keyTab = NULL;
+}
+
+uint32_t TrajectoryReader::TimeUs(uint32_t i) const
+{
+	uint32_t t;
+	memcpy(&t, record(i), 4);
+	return t;
+}
+
+uint32_t TrajectoryReader::findKey(uint32_t i) const
+{
+	uint32_t lo = 0, hi = hdr->KeyCount;
+	while(hi-lo>1){
+		uint32_t mid = (lo+hi)/2;
+		uint32_t r;
+		memcpy(&r, keyTab+(size_t)mid*keyLen, 4);
+		if(r<=i){
+			lo = mid;
+		}else{
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+void TrajectoryReader::seekKey(uint32_t k)
+{
+	const u8 *key = keyTab+(size_t)k*keyLen;
+	memcpy(&cur, key, 4);
+	memcpy(pos, key+4, 2*hdr->Joints);
+	nextKey = k+1;
+}
+
+void TrajectoryReader::Get(uint32_t i, s16 Position[])
+{
+	if(!hdr || i>=hdr->Count){
+		return;
+	}
+	if(!keyTab){
+		memcpy(Position, record(i)+4, 2*hdr->Joints);
+		return;
+	}
+	if(cur>=hdr->Count || i<cur){
+		seekKey(findKey(i));
+	}else if(i>cur+1){
+		//jump ahead when a key lies between cur and i
+		uint32_t k = findKey(i);
+		if(k>=nextKey){
+			seekKey(k);
+		}
+	}
+	while(cur<i){
+		cur++;
+		uint32_t r = hdr->Count;
+		if(nextKey<hdr->KeyCount){
+			memcpy(&r, keyTab+(size_t)nextKey*keyLen, 4);
+		}
+		if(r==cur){
+			memcpy(pos, keyTab+(size_t)nextKey*keyLen+4, 2*hdr->Joints);
+			nextKey++;
+		}else{
+			const int8_t *d = (const int8_t*)(record(cur)+4);//s8 is plain char, unsigned on ARM
+			for(uint16_t j=0; j<hdr->Joints; j++){
+				pos[j] += d[j];
+			}
+		}
+	}
+	memcpy(Position, pos, 2*hdr->Joints);
+}
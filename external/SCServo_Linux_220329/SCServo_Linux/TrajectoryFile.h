@@ -0,0 +1,91 @@
+/*
+ * TrajectoryFile.h
+ * Versioned binary trajectory file, written streaming and read via mmap
+ *
+ * Layout (little-endian, fixed-width fields):
+ *   TrajHeader (32 bytes)
+ *   Count records:  uint32_t t_us + s16 pos[Joints]            (absolute)
+ *               or  uint32_t t_us + int8_t dpos[Joints]        (TRAJ_FLAG_DELTA)
+ *   Delta files end with KeyCount keys: uint32_t record + s16 pos[Joints]; a key
+ *   replaces the deltas of its record, so playback can start at any key
+ * Date: 2026.10.14
+ */
+
+#ifndef _TRAJECTORYFILE_H
+#define _TRAJECTORYFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "INST.h"
+
+#define TRAJ_MAGIC 0x4a415254//"TRAJ"
+#define TRAJ_VERSION 1
+#define TRAJ_JOINTS_MAX 32
+#define TRAJ_FLAG_DELTA 0x0001//int8_t position deltas, absolute keys at the end
+#define TRAJ_KEY_INTERVAL 256//default records between keys in delta files
+
+struct TrajHeader{
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t Flags;
+	uint16_t Joints;
+	uint16_t KeyInterval;//delta files: a key at least every KeyInterval records
+	uint32_t RateHz;//nominal sample rate, 0 if irregular
+	uint32_t Count;//records
+	uint32_t KeyCount;//delta files: number of keys
+	uint32_t KeyOffset;//delta files: byte offset of the key table
+	uint32_t Reserved;
+};
+
+class TrajectoryWriter
+{
+public:
+	TrajectoryWriter();
+	~TrajectoryWriter();
+	bool Open(const char *Path, uint16_t Joints, uint32_t RateHz, bool Delta = false, uint16_t KeyInterval = TRAJ_KEY_INTERVAL);
+	bool Append(uint32_t TimeUs, const s16 Position[]);//timestamps must not decrease
+	bool Close();//writes key table and final header
+	uint32_t Count() const { return hdr.Count; }
+private:
+	FILE *fp;
+	TrajHeader hdr;
+	s16 last[TRAJ_JOINTS_MAX];
+	u8 *keys;//pending key table
+	uint32_t keyCap;
+	uint32_t sinceKey;
+	bool ok;
+};
+
+class TrajectoryReader
+{
+public:
+	TrajectoryReader();
+	~TrajectoryReader();
+	bool Open(const char *Path);//false if missing, not a trajectory file or truncated
+	void Close();
+	bool IsOpen() const { return base!=NULL; }
+	uint32_t Count() const { return hdr ? hdr->Count : 0; }
+	uint16_t Joints() const { return hdr ? hdr->Joints : 0; }
+	uint32_t RateHz() const { return hdr ? hdr->RateHz : 0; }
+	bool Delta() const { return hdr && (hdr->Flags&TRAJ_FLAG_DELTA); }
+	uint32_t TimeUs(uint32_t i) const;//record timestamp
+	uint32_t DurationUs() const { return Count() ? TimeUs(Count()-1) : 0; }
+	void Get(uint32_t i, s16 Position[]);//O(1) when reading sequentially, otherwise rewinds to the nearest key
+private:
+	const u8 *record(uint32_t i) const { return data+(size_t)i*recLen; }
+	uint32_t findKey(uint32_t i) const;//index of last key at or before record i
+	void seekKey(uint32_t k);//load key k into pos[]
+	const TrajHeader *hdr;
+	const u8 *base;
+	size_t mapLen;
+	const u8 *data;
+	uint32_t recLen;
+	const u8 *keyTab;
+	uint32_t keyLen;
+	uint32_t cur;//record held in pos[], Count() if none
+	uint32_t nextKey;//key index following cur
+	s16 pos[TRAJ_JOINTS_MAX];
+};
+
+#endif
@@ -0,0 +1,289 @@
+/*
+ * TrajectorySimplify.cpp
+ * Keyframe reduction of recorded joint samples
+ * Date: 2026.10.14
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <utility>
+#include "TrajectorySimplify.h"
+
+TrajectorySimplify::TrajectorySimplify()
+{
+	Tolerance = TRAJ_SIMPLIFY_TOL;
+	HoldSteps = TRAJ_SIMPLIFY_HOLD_STEPS;
+	HoldUs = TRAJ_SIMPLIFY_HOLD_US;
+	Spline = true;
+	T = NULL;
+	P = NULL;
+	J = 0;
+	maxErr = 0;
+	holds = 0;
+	passes = 0;
+}
+
+//largest joint deviation of sample i from the straight segment a-b, both
+//taken at the time of sample i
+double TrajectorySimplify::lineError(size_t i, size_t a, size_t b) const
+{
+	double h = (double)T[b]-T[a];
+	double s = h>0 ? (T[i]-T[a])/h : 0;
+	double e = 0;
+	for(u8 j=0; j<J; j++){
+		double p = P[a*J+j]+(P[b*J+j]-P[a*J+j])*s;
+		e = std::max(e, fabs(P[i*J+j]-p));
+	}
+	return e;
+}
+
+//the same Fritsch-Carlson tangents as TrajectoryEngine::Tangents(), on the
+//keyframes K
+void TrajectorySimplify::tangents(const std::vector<size_t> &K)
+{
+	size_t n = K.size();
+	M.assign(n*J, 0.0);
+	for(size_t k=1; k+1<n; k++){
+		double h0 = (double)T[K[k]]-T[K[k-1]];
+		double h1 = (double)T[K[k+1]]-T[K[k]];
+		if(h0<=0 || h1<=0){
+			continue;
+		}
+		double w1 = 2*h1+h0;
+		double w2 = h1+2*h0;
+		for(u8 j=0; j<J; j++){
+			double d0 = (P[K[k]*J+j]-P[K[k-1]*J+j])/h0;
+			double d1 = (P[K[k+1]*J+j]-P[K[k]*J+j])/h1;
+			if(d0*d1>0){
+				M[k*J+j] = (w1+w2)/(w1/d0+w2/d1);
+			}
+		}
+	}
+}
+
+//deviation of sample i from the spline segment K[k]-K[k+1]
+double TrajectorySimplify::splineError(size_t i, const std::vector<size_t> &K, size_t k) const
+{
+	size_t a = K[k], b = K[k+1];
+	double h = (double)T[b]-T[a];
+	if(h<=0){
+		return lineError(i, a, b);
+	}
+	double s = (T[i]-T[a])/h;
+	double s2 = s*s, s3 = s2*s;
+	double h00 = 2*s3-3*s2+1, h10 = s3-2*s2+s, h01 = -2*s3+3*s2, h11 = s3-s2;
+	double e = 0;
+	for(u8 j=0; j<J; j++){
+		double p = h00*P[a*J+j]+h10*h*M[k*J+j]+h01*P[b*J+j]+h11*h*M[(k+1)*J+j];
+		e = std::max(e, fabs(P[i*J+j]-p));
+	}
+	return e;
+}
+
+size_t TrajectorySimplify::Run(const uint32_t TimeUs[], const s16 Position[], size_t Count, u8 Joints, std::vector<size_t> &Keep)
+{
+	Keep.clear();
+	maxErr = 0;
+	holds = 0;
+	passes = 0;
+	if(!Count || !Joints){
+		return 0;
+	}
+	T = TimeUs;
+	P = Position;
+	J = Joints;
+	std::vector<char> keep(Count, 0);
+	keep[0] = keep[Count-1] = 1;
+
+	//holds: extend from s while every joint stays within HoldSteps of sample s
+	size_t s = 0;
+	while(s+1<Count){
+		size_t e = s+1;
+		for(; e<Count; e++){
+			u8 j = 0;
+			while(j<J && abs(P[e*J+j]-P[s*J+j])<=HoldSteps){
+				j++;
+			}
+			if(j<J){
+				break;
+			}
+		}
+		if(e-1>s && T[e-1]-T[s]>=HoldUs){
+			keep[s] = keep[e-1] = 1;
+			holds++;
+			s = e-1;
+		}else{
+			s++;
+		}
+	}
+
+	//Douglas-Peucker between consecutive forced keyframes, iterative so a
+	//long recording cannot exhaust the stack
+	std::vector<std::pair<size_t, size_t> > stack;
+	size_t a = 0;
+	for(size_t i=1; i<Count; i++){
+		if(keep[i]){
+			stack.push_back(std::make_pair(a, i));
+			a = i;
+		}
+	}
+	while(!stack.empty()){
+		size_t l = stack.back().first, r = stack.back().second;
+		stack.pop_back();
+		size_t worst = l;
+		double e = Tolerance;
+		for(size_t i=l+1; i<r; i++){
+			double d = lineError(i, l, r);
+			if(d>e){
+				e = d;
+				worst = i;
+			}
+		}
+		if(worst!=l){
+			keep[worst] = 1;
+			stack.push_back(std::make_pair(l, worst));
+			stack.push_back(std::make_pair(worst, r));
+		}
+	}
+
+	std::vector<size_t> K;
+	for(size_t i=0; i<Count; i++){
+		if(keep[i]){
+			K.push_back(i);
+		}
+	}
+	if(!Spline){
+		for(size_t k=0; k+1<K.size(); k++){
+			for(size_t i=K[k]+1; i<K[k+1]; i++){
+				maxErr = std::max(maxErr, lineError(i, K[k], K[k+1]));
+			}
+		}
+		Keep.swap(K);
+		return Keep.size();
+	}
+
+	//a keyframe changes its neighbours' tangents, so check again until every
+	//segment fits; each pass adds one, and with every sample kept the spline
+	//passes through all of them
+	while(1){
+		passes++;
+		tangents(K);
+		bool fits = true;
+		maxErr = 0;
+		for(size_t k=0; k+1<K.size(); k++){
+			size_t worst = 0;
+			double e = 0;
+			for(size_t i=K[k]+1; i<K[k+1]; i++){
+				double d = splineError(i, K, k);
+				if(d>e){
+					e = d;
+					worst = i;
+				}
+			}
+			maxErr = std::max(maxErr, e);
+			if(e>Tolerance){
+				keep[worst] = 1;
+				fits = false;
+			}
+		}
+		if(fits){
+			break;
+		}
+		K.clear();
+		for(size_t i=0; i<Count; i++){
+			if(keep[i]){
+				K.push_back(i);
+			}
+		}
+	}
+	Keep.swap(K);
+	return Keep.size();
+}
+
+KeyframeStream::KeyframeStream()
+{
+	Tolerance = TRAJ_SIMPLIFY_TOL;
+	Window = TRAJ_SIMPLIFY_WINDOW;
+	Start(0);
+}
+
+void KeyframeStream::Start(u8 Joints)
+{
+	J = Joints;
+	bt.clear();
+	bp.clear();
+	rt.clear();
+	rp.clear();
+	head = 0;
+	samples = 0;
+	keyframes = 0;
+}
+
+void KeyframeStream::emit(size_t i)
+{
+	rt.push_back(bt[i]);
+	rp.insert(rp.end(), bp.begin()+i*J, bp.begin()+(i+1)*J);
+	keyframes++;
+}
+
+bool KeyframeStream::Push(uint32_t TimeUs, const s16 Position[])
+{
+	if(!J){
+		return false;
+	}
+	samples++;
+	bt.push_back(TimeUs);
+	bp.insert(bp.end(), Position, Position+J);
+	size_t n = bt.size();
+	if(n==1){
+		emit(0);
+		return true;
+	}
+	//does the segment from the last keyframe to this sample still cover
+	//everything in between?
+	bool fits = n<=Window;
+	double h = (double)bt[n-1]-bt[0];
+	for(size_t i=1; fits && i+1<n; i++){
+		double s = h>0 ? (bt[i]-bt[0])/h : 0;
+		for(u8 j=0; j<J; j++){
+			double p = bp[j]+(bp[(n-1)*J+j]-bp[j])*s;
+			if(fabs(bp[i*J+j]-p)>Tolerance){
+				fits = false;
+				break;
+			}
+		}
+	}
+	if(fits){
+		return head<rt.size();
+	}
+	//the previous sample was the last one it covered
+	emit(n-2);
+	bt.erase(bt.begin(), bt.begin()+(n-2));
+	bp.erase(bp.begin(), bp.begin()+(n-2)*J);
+	return true;
+}
+
+bool KeyframeStream::Pop(uint32_t &TimeUs, s16 Position[])
+{
+	if(head>=rt.size()){
+		return false;
+	}
+	TimeUs = rt[head];
+	std::copy(rp.begin()+head*J, rp.begin()+(head+1)*J, Position);
+	if(++head==rt.size()){
+		rt.clear();
+		rp.clear();
+		head = 0;
+	}
+	return true;
+}
+
+void KeyframeStream::Flush()
+{
+	if(bt.size()>=2){
+		emit(bt.size()-1);
+	}
+	bt.clear();
+	bp.clear();
+}
@@ -0,0 +1,91 @@
+/*
+ * TrajectorySimplify.h
+ * Keyframe reduction of recorded joint samples
+ *
+ * TrajectorySimplify (offline) keeps the samples a TrajectoryEngine needs
+ * to replay the recording within Tolerance steps of every sample on every
+ * joint:
+ *   - holds (every joint within HoldSteps of the hold's first sample for
+ *     at least HoldUs) keep only their two ends, so the arm stops and
+ *     starts where it did
+ *   - Ramer-Douglas-Peucker between those ends, with the distance taken
+ *     at the sample's own time (position against the time-linear
+ *     interpolation of the segment), so speed changes along a straight
+ *     path keep keyframes too, not only corners
+ *   - with Spline set the result is then checked against the engine's
+ *     monotone cubic through the keyframes at the recorded timing, and
+ *     the worst sample of each segment that misses is added until all fit
+ * KeyframeStream (online) decides while recording, one sample behind:
+ * a sample becomes a keyframe once the segment from the previous
+ * keyframe to the newest sample no longer passes within Tolerance of
+ * every sample in between. It only checks against straight segments.
+ * Feed keyframes to a TrajectoryEngine with KnotUs = 0, its own thinning
+ * would merge keyframes closer than KnotUs.
+ * Date: 2026.10.14
+ */
+
+#ifndef _TRAJECTORYSIMPLIFY_H
+#define _TRAJECTORYSIMPLIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "INST.h"
+
+#define TRAJ_SIMPLIFY_TOL 4//steps, ~0.35 degree
+#define TRAJ_SIMPLIFY_HOLD_STEPS 2//sensor jitter of a joint at rest
+#define TRAJ_SIMPLIFY_HOLD_US 200000//shortest stop kept as a hold
+#define TRAJ_SIMPLIFY_WINDOW 256//KeyframeStream: most samples between keyframes
+
+class TrajectorySimplify
+{
+public:
+	TrajectorySimplify();
+	size_t Run(const uint32_t TimeUs[], const s16 Position[], size_t Count, u8 Joints, std::vector<size_t> &Keep);//Keep: ascending sample indices, first and last included; returns Keep.size()
+	double MaxError() const { return maxErr; }//largest deviation of a sample from the result, steps
+	size_t Holds() const { return holds; }
+	int Passes() const { return passes; }//spline check passes
+public:
+	u16 Tolerance;
+	u16 HoldSteps;
+	uint32_t HoldUs;
+	bool Spline;
+private:
+	double lineError(size_t i, size_t a, size_t b) const;
+	void tangents(const std::vector<size_t> &K);
+	double splineError(size_t i, const std::vector<size_t> &K, size_t k) const;
+	const uint32_t *T;
+	const s16 *P;
+	u8 J;
+	std::vector<double> M;//tangents per keyframe and joint, steps/us
+	double maxErr;
+	size_t holds;
+	int passes;
+};
+
+class KeyframeStream
+{
+public:
+	KeyframeStream();
+	void Start(u8 Joints);
+	bool Push(uint32_t TimeUs, const s16 Position[]);//true when a keyframe is ready for Pop
+	bool Pop(uint32_t &TimeUs, s16 Position[]);
+	void Flush();//end of recording: the last sample becomes a keyframe
+	size_t Samples() const { return samples; }
+	size_t Keyframes() const { return keyframes; }
+public:
+	u16 Tolerance;
+	u16 Window;
+private:
+	void emit(size_t i);
+	u8 J;
+	std::vector<uint32_t> bt;//samples since the last keyframe, which is bt[0]
+	std::vector<s16> bp;
+	std::vector<uint32_t> rt;//keyframes not popped yet
+	std::vector<s16> rp;
+	size_t head;
+	size_t samples;
+	size_t keyframes;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * BusBaud.cpp
+ * Switch every servo on the bus, and the host, to another baud rate
+ *
+ * The servos are reprogrammed one by one at the current rate (EPROM
+ * unlocked, SMS_STS_BAUD_RATE written), then the host port follows and
+ * each servo is pinged at the new rate before its EPROM is locked again.
+ * Servos that do not answer at the current rate are left alone.
+ *
+ * Servo rates: 1000000, 500000, 250000, 128000, 115200, 76800, 57600, 38400.
+ * The host side uses termios2 for the non-standard ones (250000, 128000,
+ * 76800), so the USB-serial adapter has to support them.
+ *
+ * --find pings the servos at every supported rate and reports where they
+ * answer, for a bus whose rate is unknown.
+ *
+ * Usage:
+ *   ./BusBaud [--port P] [--baud CURRENT] [--ids 1-7] TARGET
+ *   ./BusBaud [--port P] [--ids 1-7] --find
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include "SCServo.h"
+
+SMS_STS bus;
+u8 servo_ids[SMS_STS_SYNC_MAX];
+int servo_count = 0;
+
+static const int RATES[8] = {1000000, 500000, 250000, 128000, 115200, 76800, 57600, 38400};
+
+// "1-7" or "1,2,8-14"
+bool parseIds(const char* spec) {
+    servo_count = 0;
+    const char* p = spec;
+    while(*p) {
+        char* end;
+        long a = strtol(p, &end, 10);
+        if(end == p) return false;
+        long b = a;
+        p = end;
+        if(*p == '-') {
+            b = strtol(p + 1, &end, 10);
+            if(end == p + 1) return false;
+            p = end;
+        }
+        if(a < 0 || b > 253 || a > b) return false;
+        for(long id = a; id <= b; id++) {
+            if(servo_count == SMS_STS_SYNC_MAX) return false;
+            servo_ids[servo_count++] = (u8)id;
+        }
+        if(*p == ',') p++;
+        else if(*p) return false;
+    }
+    return servo_count > 0;
+}
+
+// Servos answering a ping at the current host rate
+int countAnswering(bool print) {
+    int n = 0;
+    for(int i = 0; i < servo_count; i++) {
+        bool ok = false;
+        for(int tries = 0; tries < 2 && !ok; tries++) ok = bus.Ping(servo_ids[i]) == servo_ids[i];
+        if(ok) n++;
+        if(print) std::cout << "  ID " << (int)servo_ids[i] << (ok ? "  ✓" : "  ✗ no reply") << std::endl;
+    }
+    return n;
+}
+
+void usage() {
+    std::cerr << "Usage: ./BusBaud [--port P] [--baud CURRENT] [--ids 1-7] TARGET" << std::endl;
+    std::cerr << "       ./BusBaud [--port P] [--ids 1-7] --find" << std::endl;
+    std::cerr << "Rates: 1000000 500000 250000 128000 115200 76800 57600 38400" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const char* port = "/dev/ttyACM0";
+    int baud = 1000000;
+    int target = 0;
+    bool find = false;
+    parseIds("1-7");
+
+    for(int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool has = i + 1 < argc;
+        if(a == "--find") find = true;
+        else if(a == "--port" && has) port = argv[++i];
+        else if(a == "--baud" && has) baud = atoi(argv[++i]);
+        else if(a == "--ids" && has) {
+            if(!parseIds(argv[++i])) {
+                std::cerr << "ERROR: bad ID list " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if(a[0] != '-' && !target) {
+            target = atoi(a.c_str());
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if(!find && SMS_STS::BaudRateCode(target) < 0) {
+        usage();
+        return 1;
+    }
+
+    // Short timeout: a missing servo costs this much per ping
+    bus.IOTimeOut = 20;
+    if(!bus.begin(find ? RATES[0] : baud, port)) {
+        std::cerr << "ERROR: Failed to initialize serial port " << port << std::endl;
+        return 1;
+    }
+
+    if(find) {
+        std::cout << "Searching " << servo_count << " servos at every rate..." << std::endl;
+        int found = 0;
+        for(int r = 0; r < 8; r++) {
+            if(bus.setBaudRate(RATES[r]) < 0) {
+                std::cout << "  " << RATES[r] << ": not supported by the serial port" << std::endl;
+                continue;
+            }
+            int n = countAnswering(false);
+            std::cout << "  " << RATES[r] << ": " << n << "/" << servo_count << " answering" << std::endl;
+            if(n) found++;
+        }
+        bus.end();
+        return found ? 0 : 1;
+    }
+
+    std::cout << "=== Bus baud rate " << baud << " -> " << target << " ===" << std::endl;
+    std::cout << "Servos at " << baud << ":" << std::endl;
+    int before = countAnswering(true);
+    if(!before) {
+        std::cerr << "ERROR: no servo answers at " << baud << " (try --find)" << std::endl;
+        bus.end();
+        return 1;
+    }
+    if(target == baud) {
+        std::cout << "Already at " << target << std::endl;
+        bus.end();
+        return 0;
+    }
+
+    int ok = bus.ChangeBaudRate(servo_ids, servo_count, target);
+    if(ok < 0) {
+        std::cerr << "ERROR: this adapter cannot run at " << target << " baud, servos left at " << baud << std::endl;
+        bus.end();
+        return 1;
+    }
+    std::cout << "Servos at " << target << ":" << std::endl;
+    countAnswering(true);
+    if(ok < before) {
+        std::cerr << "✗ Only " << ok << " of " << before << " servos verified at " << target
+                  << "; run ./BusBaud --find to locate the others" << std::endl;
+        bus.end();
+        return 1;
+    }
+    std::cout << "✓ " << ok << " servos now at " << target << " baud" << std::endl;
+    std::cout << "  Wire time per byte: " << 10e6 / baud << " us -> " << 10e6 / target << " us" << std::endl;
+    bus.end();
+    return 0;
+}
@@ -0,0 +1,427 @@
+/*
+ * BusDaemon.cpp
+ * Shared servo bus server: one process owns the serial port, every other
+ * program (C++ BusClient, bus_client.py) talks to it instead
+ *
+ *   - A ControlLoop thread sync-reads all servos at a fixed rate and
+ *     publishes the result in shared memory (BusShm.h, seqlock), so any
+ *     number of readers get the latest joint state without a syscall
+ *   - Commands arrive as text lines on a Unix socket (protocol in
+ *     BusClient.h). The socket thread hands them to the loop thread through
+ *     a lock-free ring; they run between two sync reads and the reply goes
+ *     back the same way, so the bus is never shared between threads
+ *
+ * Usage:
+ *   sudo ./BusDaemon [port] [rate_hz] [ids] [rt_priority]
+ *
+ *   ids: servo IDs to publish, e.g. "1-7" (default) or "1-6,8-14"
+ *   rt_priority (1-99) runs the loop under SCHED_FIFO with memory locked
+ *
+ * Stop with Ctrl+C; the socket and the shared memory are removed on exit.
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <atomic>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "SCServo.h"
+
+// The control loop owns the servo bus
+ControlLoop control;
+SMS_STS& sm_st = control.Bus;
+BusShm state;
+
+u8 servo_ids[BUS_SHM_JOINTS];
+u8 servo_count = 0;
+
+// Socket thread -> loop thread and back; slot/serial route the reply to
+// the client that sent the line, even if its fd was reused meanwhile
+struct Request {
+    int slot;
+    unsigned serial;
+    bool too_long;  // answered with an error, in order with the lines around it
+    char line[BUS_LINE_MAX];
+};
+struct Reply {
+    int slot;
+    unsigned serial;
+    char line[8 + BUS_READ_MAX * 4];  // longest: "ok" + BUS_READ_MAX bytes
+};
+SPSCRing<Request, 256> requests;
+SPSCRing<Reply, 256> replies;
+int wake_fd = -1;  // eventfd: loop thread signals pending replies
+
+// At most this many commands per tick, so a burst (or pings to absent
+// IDs, each costing a timeout) can't starve the sync read
+const int COMMANDS_PER_TICK = 8;
+
+const int MAX_CLIENTS = 16;
+struct Client {
+    int fd;
+    unsigned serial;
+    char buf[BUS_LINE_MAX * 4];
+    int len;
+    bool overlong;  // dropping the rest of a line that filled buf
+};
+Client clients[MAX_CLIENTS];
+
+std::atomic<bool> quit(false);
+
+void onSignal(int) {
+    quit = true;
+}
+
+// Parse "1-7" / "1,2,8-14" into servo_ids
+bool parseIds(const char* spec) {
+    servo_count = 0;
+    const char* p = spec;
+    while(*p) {
+        char* end;
+        long a = strtol(p, &end, 10);
+        if(end == p) return false;
+        long b = a;
+        p = end;
+        if(*p == '-') {
+            b = strtol(p + 1, &end, 10);
+            if(end == p + 1) return false;
+            p = end;
+        }
+        if(a < 0 || b > 253 || a > b) return false;
+        for(long id = a; id <= b; id++) {
+            if(servo_count == BUS_SHM_JOINTS) return false;
+            servo_ids[servo_count++] = (u8)id;
+        }
+        if(*p == ',') p++;
+        else if(*p) return false;
+    }
+    return servo_count > 0;
+}
+
+// Positions for arm joints (IDs 1-7 and 8-14, JointModel.h) are clamped to
+// the joint limits, so no client can drive a joint into a collision
+int clampPos(int id, int pos) {
+    int j = JointOfID(id);
+    return j < 0 ? pos : JointClamp(j, pos);
+}
+
+// Raw writes to arm joints must not get around the clamp: goal position
+// only through pos/sync, and nothing that moves the limits, the servo's
+// zero, its mode or its ID
+struct Protected {
+    int addr;
+    int len;
+};
+const Protected PROTECTED[] = {
+    {SMS_STS_ID, 1},
+    {SMS_STS_MIN_ANGLE_LIMIT_L, 4},
+    {SMS_STS_OFS_L, 3},  // offset and mode
+    {SMS_STS_GOAL_POSITION_L, 2},
+};
+
+bool rawWriteAllowed(int id, int addr, int len) {
+    if(JointOfID(id) < 0) return true;
+    for(size_t i = 0; i < sizeof(PROTECTED)/sizeof(PROTECTED[0]); i++) {
+        if(addr < PROTECTED[i].addr + PROTECTED[i].len && PROTECTED[i].addr < addr + len) return false;
+    }
+    return true;
+}
+
+// Runs on the loop thread: the only place that touches the bus
+void execute(char* line, char* out, int out_len) {
+    char* argv[2 + BUS_SHM_JOINTS + 2];
+    int argc = 0;
+    char* save = NULL;
+    for(char* tok = strtok_r(line, " \t\r", &save); tok; tok = strtok_r(NULL, " \t\r", &save)) {
+        if(argc == (int)(sizeof(argv)/sizeof(argv[0]))) {
+            snprintf(out, out_len, "err too many arguments");
+            return;
+        }
+        argv[argc++] = tok;
+    }
+    int v[sizeof(argv)/sizeof(argv[0])];
+    for(int i = 1; i < argc; i++) {
+        char* end;
+        v[i] = (int)strtol(argv[i], &end, 10);
+        if(*end) {
+            snprintf(out, out_len, "err bad number '%s'", argv[i]);
+            return;
+        }
+    }
+    if(argc == 0) {
+        snprintf(out, out_len, "err empty");
+    } else if(strcmp(argv[0], "sync") && argc >= 2 && (v[1] < 0 || v[1] > 253)) {
+        // every command but sync starts with a servo ID; no broadcast
+        snprintf(out, out_len, "err bad id %d", v[1]);
+    } else if(!strcmp(argv[0], "ping") && argc == 2) {
+        int id = sm_st.Ping(v[1]);
+        if(id == -1) snprintf(out, out_len, "err no reply");
+        else snprintf(out, out_len, "ok %d", id);
+    } else if(!strcmp(argv[0], "read") && argc == 4 && v[3] > 0 && v[3] <= BUS_READ_MAX) {
+        u8 data[BUS_READ_MAX];
+        int n = sm_st.Read(v[1], v[2], data, v[3]);
+        if(n != v[3]) {
+            snprintf(out, out_len, "err no reply");
+            return;
+        }
+        int len = snprintf(out, out_len, "ok");
+        for(int i = 0; i < n; i++) len += snprintf(out + len, out_len - len, " %d", data[i]);
+    } else if(!strcmp(argv[0], "write") && argc >= 4) {
+        u8 data[BUS_SHM_JOINTS + 2];
+        int n = argc - 3;
+        if(!rawWriteAllowed(v[1], v[2], n)) {
+            snprintf(out, out_len, "err protected register, use pos or sync");
+            return;
+        }
+        for(int i = 0; i < n; i++) data[i] = (u8)v[3 + i];
+        if(sm_st.genWrite(v[1], v[2], data, n)) snprintf(out, out_len, "ok");
+        else snprintf(out, out_len, "err no ack");
+    } else if(!strcmp(argv[0], "pos") && argc == 5) {
+        if(sm_st.WritePosEx(v[1], clampPos(v[1], v[2]), v[3], v[4])) snprintf(out, out_len, "ok");
+        else snprintf(out, out_len, "err no ack");
+    } else if(!strcmp(argv[0], "sync") && argc == 3 + servo_count) {
+        s16 pos[BUS_SHM_JOINTS];
+        u16 speed[BUS_SHM_JOINTS];
+        u8 acc[BUS_SHM_JOINTS];
+        for(int i = 0; i < servo_count; i++) {
+            pos[i] = clampPos(servo_ids[i], v[3 + i]);
+            speed[i] = v[1];
+            acc[i] = v[2];
+        }
+        sm_st.SyncWritePosEx(servo_ids, servo_count, pos, speed, acc);
+        snprintf(out, out_len, "ok");
+    } else if(!strcmp(argv[0], "torque") && argc == 3) {
+        if(sm_st.EnableTorque(v[1], v[2] ? 1 : 0)) snprintf(out, out_len, "ok");
+        else snprintf(out, out_len, "err no ack");
+    } else {
+        snprintf(out, out_len, "err unknown command '%s'", argv[0]);
+    }
+}
+
+// Loop task: a few queued commands, then one sync read published to shm
+bool busTick(SMS_STS&, unsigned long tick) {
+    Request req;
+    bool replied = false;
+    for(int n = 0; n < COMMANDS_PER_TICK && requests.Pop(req); n++) {
+        Reply rep;
+        rep.slot = req.slot;
+        rep.serial = req.serial;
+        if(req.too_long) snprintf(rep.line, sizeof(rep.line), "err line too long");
+        else execute(req.line, rep.line, sizeof(rep.line));
+        replies.Push(rep);
+        replied = true;
+    }
+    if(replied) {
+        uint64_t one = 1;
+        if(write(wake_fd, &one, sizeof(one)) < 0) {}
+    }
+
+    ServoState st[BUS_SHM_JOINTS];
+    int n = sm_st.SyncFeedBack(servo_ids, servo_count, st);
+    state.Publish(st, n < 0 ? 0 : n, tick, ControlLoop::NowUs());
+    return !quit;
+}
+
+// A second daemon would take the socket and the shared memory over from
+// a running one; a socket file nobody listens on is left by a crash
+bool socketAnswers(const sockaddr_un& addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) return false;
+    bool answers = connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0;
+    close(fd);
+    return answers;
+}
+
+void sendLine(Client& c, const char* line) {
+    char buf[sizeof(Reply::line) + 1];
+    int n = snprintf(buf, sizeof(buf), "%s\n", line);
+    // Replies are short and clients wait for each one, so the socket buffer
+    // never fills; a client that stops reading just loses its replies
+    if(send(c.fd, buf, n, MSG_NOSIGNAL | MSG_DONTWAIT) != n) {}
+}
+
+void dropClient(Client& c) {
+    close(c.fd);
+    c.fd = -1;
+    c.len = 0;
+    c.overlong = false;
+}
+
+// Move complete lines from a client's buffer into the request ring; stops
+// (and leaves the rest buffered) when the ring is full. Lines that are too
+// long go through the ring as well, so their error comes back in order
+void queueLines(int slot) {
+    Client& c = clients[slot];
+    int start = 0;
+    for(;;) {
+        char* eol = (char*)memchr(c.buf + start, '\n', c.len - start);
+        if(!eol) break;
+        int len = eol - (c.buf + start);
+        Request req;
+        req.slot = slot;
+        req.serial = c.serial;
+        req.too_long = c.overlong || len >= BUS_LINE_MAX;
+        if(req.too_long) len = 0;
+        memcpy(req.line, c.buf + start, len);
+        req.line[len] = 0;
+        if(!requests.Push(req)) break;
+        c.overlong = false;
+        start = eol + 1 - c.buf;
+    }
+    c.len -= start;
+    memmove(c.buf, c.buf + start, c.len);
+    if(c.len == (int)sizeof(c.buf) && !memchr(c.buf, '\n', c.len)) {
+        // no end of line in sight: drop what we have, answer at the newline
+        c.len = 0;
+        c.overlong = true;
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* port = "/dev/ttyACM0";
+    int rate_hz = 100;
+    const char* ids = "1-7";
+
+    if(argc >= 2) port = argv[1];
+    if(argc >= 3) rate_hz = atoi(argv[2]);
+    if(argc >= 4) ids = argv[3];
+    if(argc >= 5) {
+        control.Priority = atoi(argv[4]);
+        control.LockMemory = true;
+    }
+    if(rate_hz <= 0 || rate_hz > 1000) rate_hz = 100;
+    if(!parseIds(ids)) {
+        std::cerr << "Invalid servo ID list '" << ids << "'" << std::endl;
+        return 1;
+    }
+
+    std::cout << "=== SCServo Bus Daemon ===" << std::endl;
+    std::cout << "Port: " << port << ", " << rate_hz << " Hz, "
+              << (int)servo_count << " servos (" << ids << ")" << std::endl;
+
+    // Checked before the port is touched: begin() would reconfigure it
+    // under the running daemon
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, BUS_SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    if(socketAnswers(addr)) {
+        std::cerr << "ERROR: Another BusDaemon is answering on " << BUS_SOCKET_PATH << std::endl;
+        return 1;
+    }
+    if(!state.Create(BUS_SHM_NAME, servo_ids, servo_count, rate_hz)) {
+        std::cerr << "ERROR: Cannot create shared memory " << BUS_SHM_NAME << std::endl;
+        return 1;
+    }
+
+    sm_st.LowLatency = true;
+    if(!sm_st.begin(1000000, port)) {
+        std::cerr << "ERROR: Failed to initialize serial on " << port << std::endl;
+        return 1;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(BUS_SOCKET_PATH);
+    if(listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 8) < 0) {
+        perror("socket");
+        return 1;
+    }
+    chmod(BUS_SOCKET_PATH, 0666);  // daemon runs as root, clients need not
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    for(int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    control.Start(1000000 / rate_hz, busTick);
+    std::cout << "Publishing to /dev/shm" << BUS_SHM_NAME << ", commands on " << BUS_SOCKET_PATH << std::endl;
+
+    unsigned next_serial = 1;
+    while(!quit && control.Running()) {
+        pollfd pfd[MAX_CLIENTS + 2];
+        int slot_of[MAX_CLIENTS + 2];
+        int n = 0;
+        pfd[n].fd = listen_fd; pfd[n].events = POLLIN; slot_of[n++] = -1;
+        pfd[n].fd = wake_fd; pfd[n].events = POLLIN; slot_of[n++] = -1;
+        bool backlog = false;
+        for(int i = 0; i < MAX_CLIENTS; i++) {
+            if(clients[i].fd == -1) continue;
+            // a buffer held full by the ring is not read: recv() would return 0
+            pfd[n].fd = clients[i].fd;
+            pfd[n].events = clients[i].len < (int)sizeof(clients[i].buf) ? POLLIN : 0;
+            slot_of[n++] = i;
+            if(memchr(clients[i].buf, '\n', clients[i].len)) backlog = true;
+        }
+        // Lines held back by a full ring are retried every millisecond
+        if(poll(pfd, n, backlog ? 1 : 100) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        if(pfd[0].revents & POLLIN) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            int i = 0;
+            while(fd >= 0 && i < MAX_CLIENTS && clients[i].fd != -1) i++;
+            if(fd >= 0 && i == MAX_CLIENTS) {
+                const char* full = "err too many clients\n";
+                if(send(fd, full, strlen(full), MSG_NOSIGNAL) < 0) {}
+                close(fd);
+            } else if(fd >= 0) {
+                clients[i].fd = fd;
+                clients[i].serial = next_serial++;
+                clients[i].len = 0;
+                clients[i].overlong = false;
+            }
+        }
+
+        if(pfd[1].revents & POLLIN) {
+            uint64_t count;
+            if(read(wake_fd, &count, sizeof(count)) < 0) {}
+        }
+        Reply rep;
+        while(replies.Pop(rep)) {
+            Client& c = clients[rep.slot];
+            if(c.fd != -1 && c.serial == rep.serial) sendLine(c, rep.line);
+        }
+
+        for(int k = 2; k < n; k++) {
+            Client& c = clients[slot_of[k]];
+            if(c.fd == -1) continue;
+            if(pfd[k].revents & POLLIN) {
+                int got = recv(c.fd, c.buf + c.len, sizeof(c.buf) - c.len, 0);
+                if(got <= 0) {
+                    if(got < 0 && errno == EINTR) continue;
+                    dropClient(c);
+                    continue;
+                }
+                c.len += got;
+            } else if(pfd[k].revents & (POLLHUP | POLLERR)) {
+                dropClient(c);
+                continue;
+            }
+            queueLines(slot_of[k]);
+        }
+    }
+
+    std::cout << "\nShutting down..." << std::endl;
+    control.Stop();
+    control.PrintStats();
+    for(int i = 0; i < MAX_CLIENTS; i++) {
+        if(clients[i].fd != -1) dropClient(clients[i]);
+    }
+    close(listen_fd);
+    unlink(BUS_SOCKET_PATH);
+    close(wake_fd);
+    state.Close();
+    sm_st.end();
+    return 0;
+}
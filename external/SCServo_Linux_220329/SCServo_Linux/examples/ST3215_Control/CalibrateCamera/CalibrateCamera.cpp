@@ -1,228 +1,372 @@
 /*
  * CalibrateCamera.cpp - CAMERA-ROBOT COORDINATE CALIBRATION
  * ===========================================================
- * 
+ *
  * PURPOSE: Collect calibration data by moving robot to known positions
  *          while capturing corresponding camera frames.
- * 
+ *
  * PROCESS:
  *   1. Move robot to home position
  *   2. Move to a grid of calibration points in workspace
  *   3. At each point, capture frame and record robot joint angles
  *   4. Save calibration data for processing
- * 
- * OUTPUT: calibration_data.txt with format:
- *   <timestamp> <J1> <J2> <J3> <J4> <J5> <J6> <gripper> <frame_file>
- * 
+ *
+ * PIPELINE:
+ *   Each pose is one sync write (ArmCommand); the move ends when every
+ *   joint has settled (WaitMotionComplete). The joint angles are then
+ *   sync-read, not taken from the command, and stamped with CLOCK_MONOTONIC,
+ *   the clock of V4L2 frame timestamps and Python's time.monotonic().
+ *   A "pose" event goes out on a Unix socket to the capture client
+ *   (calibration/camera_capture.py). The arm holds still only until the
+ *   client answers "captured" - the moment the frame is grabbed - and is
+ *   already on its way to the next pose while that frame is decoded,
+ *   detected and saved. A second sync read at release measures how far
+ *   the arm drifted while the frame was taken.
+ *
+ *   Socket protocol, one text line each (CALIB_SOCKET_PATH):
+ *     robot -> client:  start <points>
+ *                       pose <i> <t_us> <J1> .. <J6> <gripper> <frame_file>
+ *                       end
+ *     client -> robot:  captured <i> <frame_t_us>
+ *   Angles in degrees (measured), times in CLOCK_MONOTONIC microseconds.
+ *   Without a client every pose is only written to the data file, then
+ *   held for --hold-ms (for a program that still polls the file).
+ *
+ * OUTPUT: calibration_data.txt (or --out) with format:
+ *   <timestamp> <J1> <J2> <J3> <J4> <J5> <J6> <gripper> <frame_file> <frame_t_us> <drift_steps>
+ *   frame_t_us is -1 when no client captured the pose
+ *
  * USAGE:
- *   ./CalibrateCamera [port]
+ *   ./CalibrateCamera [port] [--out FILE] [--wait-ms MS] [--hold-ms MS]
+ *                     [--speed STEPS/S] [--socket PATH]
  */
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
 #include <unistd.h>
-#include <sys/time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "SCServo.h"
 
-// Joint limits
-static const int JOINT_MIN_DEG[7] = {-165, -125, -140, -140, -140, -175, -180};
-static const int JOINT_MAX_DEG[7] = { 165,  125,  140,  140,  140,  175,  180};
+static const char* CALIB_SOCKET_PATH = "/tmp/scservo_calib.sock";
+static const u8 ARM_IDS[7] = {1, 2, 3, 4, 5, 6, 7};
+static const u16 SETTLE_STEPS = 10;
 
-// Coordinate transform
-static const double J1_OFFSET = 90.0;
+// Calibration point structure
+struct CalibrationPoint {
+    double j1, j2, j3, j4, j5, j6;
+    std::string description;
+};
+
+// Joint angles read back at a pose
+struct Measured {
+    long long t_us;     // CLOCK_MONOTONIC, middle of the sync read
+    double deg[7];
+    s16 pos[7];
+    bool ok;
+};
+
+// The capture client: at most one, line based
+struct CaptureClient {
+    int listen_fd;
+    int fd;
+    std::string rx;
+};
 
-// Convert degrees to servo steps
-static int degreesToSteps(double deg){
-    double steps = 2048.0 + (deg / 360.0) * 4096.0;
-    while(steps < 0) steps += 4096.0;
-    while(steps >= 4096.0) steps -= 4096.0;
-    return (int)(steps + 0.5);
+CaptureClient client = {-1, -1, ""};
+
+bool openSocket(const char* path) {
+    client.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if(client.listen_fd < 0 || bind(client.listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(client.listen_fd, 1) < 0) {
+        perror("socket");
+        return false;
+    }
+    return true;
 }
 
-// Get current time in microseconds
-long long getCurrentTimeMicros() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (long long)tv.tv_sec * 1000000LL + (long long)tv.tv_usec;
+void dropClient() {
+    if(client.fd != -1) close(client.fd);
+    client.fd = -1;
+    client.rx.clear();
 }
 
-// Move single joint with coordinate transform
-bool moveJoint(SMS_STS& sm_st, int id, double target_deg, int speed = 600){
-    const char* joint_names[] = {"J1", "J2", "J3", "J4", "J5", "J6", "Gripper"};
-    
-    // Apply coordinate transform for J1
-    double adjusted_deg = target_deg;
-    if(id == 1){
-        adjusted_deg += J1_OFFSET;
-    }
-    
-    // Clamp to limits
-    int idx = id - 1;
-    if(adjusted_deg < JOINT_MIN_DEG[idx]){
-        adjusted_deg = JOINT_MIN_DEG[idx];
+// Take a waiting connection, if any (a new one replaces the old)
+void acceptClient() {
+    int fd = accept4(client.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if(fd < 0) return;
+    dropClient();
+    client.fd = fd;
+    std::cout << "  📷 Capture client connected" << std::endl;
+}
+
+void sendLine(const std::string& line) {
+    if(client.fd == -1) return;
+    std::string out = line + "\n";
+    if(send(client.fd, out.data(), out.size(), MSG_NOSIGNAL) != (ssize_t)out.size()) {
+        std::cerr << "  ⚠️  Capture client went away" << std::endl;
+        dropClient();
     }
-    if(adjusted_deg > JOINT_MAX_DEG[idx]){
-        adjusted_deg = JOINT_MAX_DEG[idx];
+}
+
+// Wait up to timeout_ms for "captured <index> <t_us>"; -1 if none came
+long long waitCaptured(int index, int timeout_ms) {
+    long long deadline = ControlLoop::NowUs() + (long long)timeout_ms * 1000;
+    while(client.fd != -1) {
+        size_t eol;
+        while((eol = client.rx.find('\n')) != std::string::npos) {
+            std::string line = client.rx.substr(0, eol);
+            client.rx.erase(0, eol + 1);
+            int i;
+            long long t;
+            if(sscanf(line.c_str(), "captured %d %lld", &i, &t) == 2 && i == index) return t;
+        }
+        long long left = deadline - ControlLoop::NowUs();
+        if(left <= 0) break;
+        pollfd pfd = {client.fd, POLLIN, 0};
+        if(poll(&pfd, 1, (int)(left / 1000) + 1) < 0 && errno != EINTR) break;
+        if(!(pfd.revents & (POLLIN | POLLHUP | POLLERR))) continue;
+        char buf[512];
+        int got = recv(client.fd, buf, sizeof(buf), 0);
+        if(got <= 0) {
+            if(got < 0 && errno == EINTR) continue;
+            std::cerr << "  ⚠️  Capture client went away" << std::endl;
+            dropClient();
+            break;
+        }
+        client.rx.append(buf, got);
     }
-    
-    int steps = degreesToSteps(adjusted_deg);
-    
-    sm_st.EnableTorque(id, 1);
-    int result = sm_st.WritePosEx(id, steps, speed, 50);
-    
-    if(result == -1){
-        std::cerr << "❌ Failed to send command to " << joint_names[idx] << std::endl;
-        return false;
+    return -1;
+}
+
+// Sync read of all 7 servos, stamped in the middle of the transaction
+bool measure(SMS_STS& sm_st, Measured& m) {
+    ServoState st[7];
+    long long t0 = ControlLoop::NowUs();
+    int n = sm_st.SyncFeedBack((u8*)ARM_IDS, 7, st);
+    m.t_us = (t0 + ControlLoop::NowUs()) / 2;
+    m.ok = n == 7;
+    for(int j = 0; j < 7; j++) {
+        m.pos[j] = st[j].Err ? 0 : st[j].Pos;
+        m.deg[j] = st[j].Err ? 0 : JointDeg(j, st[j].Pos);
     }
-    
-    return true;
+    return m.ok;
 }
 
-// Move to specific position
-void moveToPosition(SMS_STS& sm_st, double j1, double j2, double j3, double j4, double j5, double j6){
-    std::cout << "  Moving to: J1=" << j1 << "° J2=" << j2 << "° J3=" << j3 
-              << "° J4=" << j4 << "° J5=" << j5 << "° J6=" << j6 << "°" << std::endl;
-    
-    moveJoint(sm_st, 1, j1, 400);
-    usleep(100000);
-    moveJoint(sm_st, 2, j2, 400);
-    usleep(100000);
-    moveJoint(sm_st, 3, j3, 400);
-    usleep(100000);
-    moveJoint(sm_st, 4, j4, 300);
-    usleep(100000);
-    moveJoint(sm_st, 5, j5, 300);
-    usleep(100000);
-    moveJoint(sm_st, 6, j6, 300);
-    
-    // Wait for movement to complete
-    sleep(3);
+// One sync write to the pose, then wait until every joint has settled
+void moveToPosition(ArmCommand& arm, const CalibrationPoint& cp, u16 speed) {
+    double deg[6] = {cp.j1, cp.j2, cp.j3, cp.j4, cp.j5, cp.j6};
+    s16 goal[6];
+    for(int j = 0; j < 6; j++) goal[j] = JointSteps(j, deg[j]);
+    arm.MoveTo(goal, speed, 50);
+    int ms = arm.WaitMotionComplete(SETTLE_STEPS, 6000);
+    if(ms < 0) std::cerr << "  ⚠️  Joints did not settle within 6 s" << std::endl;
+    else std::cout << "  Settled after " << ms << " ms" << std::endl;
 }
 
-// Calibration point structure
-struct CalibrationPoint {
-    double j1, j2, j3, j4, j5, j6;
-    std::string description;
-};
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [port] [--out FILE] [--wait-ms MS] [--hold-ms MS]" << std::endl;
+    std::cerr << "       " << std::string(strlen(prog), ' ') << " [--speed STEPS/S] [--socket PATH]" << std::endl;
+}
 
 int main(int argc, char** argv){
     const char* port = "/dev/ttyACM0";
-    if(argc >= 2) port = argv[1];
-    
+    const char* out_path = "calibration_data.txt";
+    const char* socket_path = CALIB_SOCKET_PATH;
+    int wait_ms = 2000;         // longest a capture may take
+    int hold_ms = 0;            // pause per pose without a capture client
+    int speed = 1000;
+    for(int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool has = i + 1 < argc;
+        if(a == "--out" && has) out_path = argv[++i];
+        else if(a == "--socket" && has) socket_path = argv[++i];
+        else if(a == "--wait-ms" && has) wait_ms = atoi(argv[++i]);
+        else if(a == "--hold-ms" && has) hold_ms = atoi(argv[++i]);
+        else if(a == "--speed" && has) speed = atoi(argv[++i]);
+        else if(a[0] != '-') port = argv[i];
+        else { usage(argv[0]); return 1; }
+    }
+    if(speed <= 0 || wait_ms <= 0 || hold_ms < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
     std::cout << "\n" << std::string(70, '=') << std::endl;
     std::cout << "CAMERA-ROBOT CALIBRATION DATA COLLECTION" << std::endl;
     std::cout << std::string(70, '=') << std::endl;
     std::cout << "\nThis program will move the robot through a series of" << std::endl;
     std::cout << "calibration positions while Python captures camera frames." << std::endl;
     std::cout << "\nPort: " << port << std::endl;
+    std::cout << "Capture socket: " << socket_path << std::endl;
     std::cout << std::string(70, '=') << std::endl;
-    
+
     // Initialize servo controller
     SMS_STS sm_st;
+    sm_st.LowLatency = true;
+    sm_st.AdaptiveTimeOut = true;
     if(!sm_st.begin(1000000, port)){
         std::cerr << "❌ Failed to initialize serial on " << port << std::endl;
         return 1;
     }
-    
+    if(!openSocket(socket_path)) return 1;
+    ArmCommand arm(sm_st, ARM_IDS, 6);
+    arm.ReadPositions();    // start point for the first move
+    if(arm.EnableTorque(1) != 6) {
+        std::cerr << "⚠️  Not every servo acknowledged torque on" << std::endl;
+    }
+
     std::cout << "\n✅ Connected to robot\n" << std::endl;
-    
+
     // Define calibration grid points
     // We'll create a grid in the robot's workspace
     std::vector<CalibrationPoint> calibration_points;
-    
+
     // Home position
     calibration_points.push_back({0, 0, 0, 0, 0, 0, "Home - Center"});
-    
+
     // Grid points in horizontal plane (varying J1 and J2/J3)
     // J1 (base rotation): -60, -30, 0, 30, 60 degrees
     // J2/J3 (reach): combinations for different distances
-    
+
     double j1_values[] = {-60, -30, 0, 30, 60};
     double reach_configs[][2] = {
         {20, 20},   // Close
         {35, 35},   // Medium
         {50, 50}    // Far
     };
-    
+
     for(double j1 : j1_values){
         for(auto& reach : reach_configs){
             double j2 = reach[0];
             double j3 = reach[1];
-            
+
             std::stringstream ss;
             ss << "J1=" << j1 << " Reach=" << j2 << "/" << j3;
-            
+
             calibration_points.push_back({j1, j2, j3, 0, 0, 0, ss.str()});
         }
     }
-    
+
     // Add some elevated points
     calibration_points.push_back({0, -20, -20, 0, 0, 0, "Elevated center"});
     calibration_points.push_back({-45, -20, -20, 0, 0, 0, "Elevated left"});
     calibration_points.push_back({45, -20, -20, 0, 0, 0, "Elevated right"});
-    
+
     std::cout << "Total calibration points: " << calibration_points.size() << std::endl;
     std::cout << "\n⚠️  SAFETY: Ensure workspace is clear!" << std::endl;
+    std::cout << "Start the capture client now (python3 calibration/camera_capture.py)" << std::endl;
     std::cout << "\nPress ENTER to start calibration sequence...";
     std::cin.get();
-    
+    acceptClient();
+    if(client.fd == -1) {
+        std::cout << "No capture client connected: poses go to " << out_path << " only";
+        if(hold_ms) std::cout << ", held " << hold_ms << " ms each";
+        std::cout << std::endl;
+    }
+
     // Open output file
-    std::ofstream outfile("/home/dev/Six Axis Manipulator/VLM/calibration_data.txt");
+    std::ofstream outfile(out_path);
     if(!outfile.is_open()){
-        std::cerr << "❌ Failed to open calibration_data.txt" << std::endl;
+        std::cerr << "❌ Failed to open " << out_path << std::endl;
         return 1;
     }
-    
+
     std::cout << "\n" << std::string(70, '=') << std::endl;
     std::cout << "STARTING CALIBRATION SEQUENCE" << std::endl;
     std::cout << std::string(70, '=') << std::endl;
-    
+
+    sendLine("start " + std::to_string(calibration_points.size()));
+    long long run_start = ControlLoop::NowUs();
+    int captured = 0, failed = 0;
+    int worst_drift = 0;
+
     // Move through each calibration point
     for(size_t i = 0; i < calibration_points.size(); i++){
         CalibrationPoint& cp = calibration_points[i];
-        
-        std::cout << "\n[" << (i+1) << "/" << calibration_points.size() << "] " 
+
+        std::cout << "\n[" << (i+1) << "/" << calibration_points.size() << "] "
                   << cp.description << std::endl;
-        
-        // Move to position
-        moveToPosition(sm_st, cp.j1, cp.j2, cp.j3, cp.j4, cp.j5, cp.j6);
-        
-        // Get timestamp
-        long long timestamp = getCurrentTimeMicros();
-        
-        // Write to file (Python will capture frame based on this)
-        outfile << timestamp << " "
-                << cp.j1 << " " << cp.j2 << " " << cp.j3 << " "
-                << cp.j4 << " " << cp.j5 << " " << cp.j6 << " "
-                << "0 "  // gripper position
-                << "frame_" << i << ".jpg" << std::endl;
-        outfile.flush();
-        
-        std::cout << "  ✓ Position reached" << std::endl;
-        std::cout << "  ⏸️  Waiting for camera capture..." << std::endl;
-        
-        // Wait for camera to capture
-        sleep(2);
-        
-        std::cout << "  ✓ Point " << (i+1) << " complete" << std::endl;
+
+        moveToPosition(arm, cp, speed);
+        acceptClient();     // a client may also join mid-run
+
+        Measured m;
+        if(!measure(sm_st, m)) {
+            std::cerr << "  ❌ Could not read every joint, point skipped" << std::endl;
+            failed++;
+            continue;
+        }
+
+        std::string frame = "frame_" + std::to_string(i) + ".jpg";
+        std::ostringstream ev;
+        ev << std::fixed << std::setprecision(3) << "pose " << i << " " << m.t_us;
+        for(int j = 0; j < 7; j++) ev << " " << m.deg[j];
+        ev << " " << frame;
+        long long frame_t = -1;
+        if(client.fd != -1) {
+            sendLine(ev.str());
+            frame_t = waitCaptured(i, wait_ms);
+            if(frame_t < 0) std::cerr << "  ⚠️  No capture within " << wait_ms << " ms" << std::endl;
+        } else if(hold_ms) {
+            usleep(hold_ms * 1000);
+        }
+
+        // How far the arm moved between the reading and the release
+        Measured after;
+        int drift = 0;
+        if(measure(sm_st, after)) {
+            for(int j = 0; j < 6; j++) drift = std::max(drift, std::abs(after.pos[j] - m.pos[j]));
+        }
+        worst_drift = std::max(worst_drift, drift);
+
+        outfile << m.t_us << std::fixed << std::setprecision(3);
+        for(int j = 0; j < 7; j++) outfile << " " << m.deg[j];
+        outfile << " " << frame << " " << frame_t << " " << drift << std::endl;
+
+        if(frame_t >= 0) {
+            captured++;
+            std::cout << "  ✓ Captured " << (frame_t - m.t_us) / 1000.0 << " ms after the reading" << std::endl;
+        }
+        std::cout << "  ✓ Measured J1=" << std::setprecision(2) << m.deg[0] << "° J2=" << m.deg[1]
+                  << "° J3=" << m.deg[2] << "° (drift " << drift << " steps)" << std::endl;
     }
-    
+    sendLine("end");
+    double run_s = (ControlLoop::NowUs() - run_start) / 1e6;
+
     outfile.close();
-    
+
     // Return to home
     std::cout << "\n" << std::string(70, '=') << std::endl;
     std::cout << "CALIBRATION COMPLETE - Returning to home" << std::endl;
     std::cout << std::string(70, '=') << std::endl;
-    
-    moveToPosition(sm_st, 0, 0, 0, 0, 0, 0);
-    
+
+    moveToPosition(arm, calibration_points[0], speed);
+
+    dropClient();
+    close(client.listen_fd);
+    unlink(socket_path);
     sm_st.end();
-    
+
     std::cout << "\n✅ Calibration data collection complete!" << std::endl;
-    std::cout << "Data saved to: /home/dev/Six Axis Manipulator/VLM/calibration_data.txt" << std::endl;
+    std::cout << calibration_points.size() - failed << " points in " << std::fixed << std::setprecision(1) << run_s << " s, "
+              << captured << " captured, largest drift while capturing " << worst_drift << " steps" << std::endl;
+    std::cout << "Data saved to: " << out_path << std::endl;
     std::cout << "\nNext step: Run Python script to process calibration data" << std::endl;
-    
+
     return 0;
 }
@@ -6,31 +6,61 @@
  *   - Continuously samples servo positions at high frequency (default 100ms)
  *   - Records smooth, fluid trajectories as you move the arm
  *   - Replays with smooth acceleration/deceleration
+ *   - Both sampling and playback run on a fixed-period ControlLoop thread
+ *     (absolute deadlines, so bus latency doesn't stretch the period)
+ *   - The sampling thread only enqueues into a lock-free ring; the main
+ *     thread drains it into memory, the autosave file and the display,
+ *     so terminal and disk speed never delay a sample
+ *   - Adaptive reply timeouts and a per-servo circuit breaker keep a
+ *     silent joint from stalling the sampler; it holds its last position
+ *   - Optional telemetry ('t'): load, current, voltage and temperature of
+ *     every joint at its own rate, logged to telemetry_<time>.tlm with
+ *     rolling min/max/mean (TelemetryLog.h, dump with TelemetryDump)
+ *   - Optional keyframes ('k'): holds collapse to their ends and only the
+ *     samples the spline needs to stay within N steps of the recording are
+ *     kept (TrajectorySimplify.h); the autosave then streams keyframes
  * 
  * RECORD MODE:
  *   - Disables torque on all servos for manual movement
  *   - Auto-records positions every 100ms
+ *   - Streams every sample to continuous_autosave.traj while recording
  *   - Press 'q' to stop recording
  * 
  * PLAYBACK MODE:
  *   - Enables torque and smoothly replays the trajectory
- *   - Smooth interpolation between recorded positions
+ *   - A monotone cubic spline through the samples (TrajectoryEngine) is
+ *     resampled every loop period and streamed as one sync write; segments
+ *     that would exceed a joint's speed/acceleration limit are slowed down,
+ *     everything else keeps the recorded timing
+ *   - Every setpoint passes the arm's SafetyModel before the sync write:
+ *     joint limits, speed, acceleration and a precomputed self-collision
+ *     grid; a refused setpoint is not sent and stops the playback
  * 
  * Usage:
- *   sudo ./ContinuousTeach [port] [sample_interval_ms]
+ *   sudo ./ContinuousTeach [port] [sample_interval_ms] [rt_priority]
  *   
  * Default sample interval: 100ms (10 samples per second)
+ * rt_priority (1-99) runs the loop under SCHED_FIFO with memory locked;
+ * loop timing statistics are printed after each record/playback run.
+ * 
+ * FILES:
+ *   - *.traj: binary trajectory (TrajectoryFile.h), read straight from
+ *     the memory-mapped file without loading it first
+ *   - *.txt:  legacy text format, "<count>" then "<t_us> p1 .. p7" per line
+ *   - TrajectoryConvert converts between the two
  */
 
 #include <iostream>
 #include <vector>
 #include <string>
 #include <fstream>
+#include <cstdio>
 #include <unistd.h>
 #include <termios.h>
 #include <fcntl.h>
-#include <sys/time.h>
 #include <cmath>
+#include <atomic>
+#include <ctime>
 #include "SCServo.h"
 
 // Trajectory point structure
@@ -41,13 +71,101 @@ struct TrajectoryPoint {
 
 // Global trajectory storage
 std::vector<TrajectoryPoint> trajectory;
-SMS_STS sm_st;
 
-// Get current time in microseconds
-long long getCurrentTimeMicros() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (long long)tv.tv_sec * 1000000LL + (long long)tv.tv_usec;
+// Playback source when a .traj file is loaded (trajectory stays empty then)
+TrajectoryReader traj_file;
+
+// The control loop owns the servo bus; everything else talks through it
+ControlLoop control;
+SMS_STS& sm_st = control.Bus;
+
+// Playback loop period: 4ms = 250Hz
+const unsigned long PLAYBACK_PERIOD_US = 4000;
+
+// Resamples the recording at the playback rate within joint speed/acc limits
+TrajectoryEngine engine;
+
+// Keyframe reduction, 0 = keep every sample ('k' in the menu)
+u16 keyframe_tol = 0;
+bool keyframed = false;     // the current trajectory holds keyframes, not samples
+TrajectorySimplify simplifier;
+
+// Samples travel from the loop thread to the main thread through this ring
+// (4096 slots = 20s of backlog at 200Hz)
+SPSCRing<TrajectoryPoint, 4096> sample_ring;
+const char* AUTOSAVE_FILE = "continuous_autosave.traj";
+
+// Servo IDs 1-7 (6 joints + gripper), in trajectory order
+u8 SERVO_IDS[7] = {1, 2, 3, 4, 5, 6, 7};
+ArmCommand arm(sm_st, SERVO_IDS, 7);
+
+// Limits and collision grid, built once for the playback period and
+// checked on every setpoint the arm sends
+SafetyModel safety;
+
+// Telemetry log, fed from the loop thread while open ('t' in the menu).
+// Recording reuses the sample's sync read; playback adds one on telemetry ticks only.
+TelemetryLog telemetry;
+std::string telemetry_file;
+
+// Samples of the current trajectory, from memory or the mapped file
+size_t sampleCount() {
+    return traj_file.IsOpen() ? traj_file.Count() : trajectory.size();
+}
+
+long long sampleTime(size_t i) {
+    return traj_file.IsOpen() ? (long long)traj_file.TimeUs(i) : trajectory[i].timestamp_us;
+}
+
+void sampleGoal(size_t i, s16 goal[7]) {
+    if(traj_file.IsOpen()) {
+        traj_file.Get(i, goal);
+    } else {
+        for(int j = 0; j < 7; j++) goal[j] = trajectory[i].positions[j];
+    }
+}
+
+// Replace the current trajectory by its keyframes (into memory)
+void simplifyTrajectory() {
+    size_t count = sampleCount();
+    if(count == 0) return;
+    std::vector<uint32_t> times(count);
+    std::vector<s16> positions(count * 7);
+    for(size_t i = 0; i < count; i++) {
+        times[i] = (uint32_t)sampleTime(i);
+        sampleGoal(i, &positions[i * 7]);
+    }
+    std::vector<size_t> keep;
+    simplifier.Tolerance = keyframe_tol;
+    simplifier.Run(&times[0], &positions[0], count, 7, keep);
+    
+    trajectory.clear();
+    traj_file.Close();
+    for(size_t k = 0; k < keep.size(); k++) {
+        TrajectoryPoint tp;
+        tp.timestamp_us = times[keep[k]];
+        for(int j = 0; j < 7; j++) tp.positions[j] = positions[keep[k] * 7 + j];
+        trajectory.push_back(tp);
+    }
+    keyframed = true;
+    std::cout << "✓ Keyframes: " << count << " samples -> " << keep.size()
+              << " (" << (keep.size() * 100.0 / count) << "%), " << simplifier.Holds() << " holds, "
+              << "max deviation " << simplifier.MaxError() << " steps" << std::endl;
+}
+
+bool isTextFile(const std::string& filename) {
+    return filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".txt") == 0;
+}
+
+// SAFETY_* bits as text
+std::string safetyFault(int fault) {
+    std::string s;
+    if(fault & SAFETY_LIMIT) s += "joint limit ";
+    if(fault & SAFETY_SPEED) s += "speed ";
+    if(fault & SAFETY_ACC) s += "acceleration ";
+    if(fault & SAFETY_COLLISION) s += "self-collision ";
+    if(!s.empty()) s.erase(s.size() - 1);
+    return s;
 }
 
 // Set terminal to non-blocking mode for input
@@ -78,19 +196,45 @@ char getKeyPress() {
     return 0;
 }
 
-// Read current positions of all 7 servos
-bool readAllPositions(TrajectoryPoint& tp) {
+// Read current positions of all 7 servos (single sync read transaction)
+// A joint that misses a read keeps its last position (counted in held_reads),
+// so one flaky servo costs a few ms per tick instead of the whole sample;
+// the sample only fails while some joint has never answered.
+// verbose=false keeps console I/O out of the sampling thread
+int held_positions[7];
+bool held_valid[7];
+unsigned long held_reads[7];
+
+void resetHeldPositions() {
+    for(int i = 0; i < 7; i++) {
+        held_valid[i] = false;
+        held_reads[i] = 0;
+    }
+}
+
+bool readAllPositions(TrajectoryPoint& tp, bool verbose = true) {
+    ServoState state[7];
+    sm_st.SyncFeedBack(SERVO_IDS, 7, state);
+    if(telemetry.IsOpen()) {
+        long long now = ControlLoop::NowUs();
+        if(telemetry.Due(now)) telemetry.Push(now, state);
+    }
+    bool ok = true;
     for(int i = 0; i < 7; i++) {
-        int id = i + 1;
-        if(sm_st.FeedBack(id) != -1) {
-            tp.positions[i] = sm_st.ReadPos(-1);
+        if(!state[i].Err) {
+            held_positions[i] = state[i].Pos;
+            held_valid[i] = true;
         } else {
-            std::cerr << "Failed to read servo " << id << std::endl;
-            return false;
+            held_reads[i]++;
+            if(verbose) {
+                std::cerr << "Failed to read servo " << (int)SERVO_IDS[i]
+                          << (state[i].Err == 2 ? " (dropped, not answering)" : "") << std::endl;
+            }
+            if(!held_valid[i]) ok = false;
         }
-        usleep(2000); // 2ms between reads (faster than waypoint mode)
+        tp.positions[i] = held_positions[i];
     }
-    return true;
+    return ok;
 }
 
 // Display current positions
@@ -110,9 +254,9 @@ void recordContinuous(int sample_interval_ms) {
     
     // Disable torque on all servos for manual movement
     std::cout << "Disabling torque on all servos..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 0);
-        usleep(50000);
+    // One queued bus pass, each write goes out as soon as the previous ACK arrives
+    if(arm.EnableTorque(0) != 7) {
+        std::cerr << "Warning: not every servo acknowledged torque off" << std::endl;
     }
     
     std::cout << "\n✓ Torque disabled - Move the arm to start position!\n" << std::endl;
@@ -120,43 +264,130 @@ void recordContinuous(int sample_interval_ms) {
     std::cin.get();
     
     trajectory.clear();
+    traj_file.Close();
+    keyframed = false;
     enableRawMode();
     
     std::cout << "\n🔴 RECORDING... (Press 'q' to stop)\n" << std::endl;
     
-    long long start_time = getCurrentTimeMicros();
-    int sample_count = 0;
-    char key = 0;
+    // Stream to the autosave file as samples arrive (positions are s16 on disk);
+    // with keyframes on only the ones picked while recording, at irregular times
+    TrajectoryWriter autosave;
+    KeyframeStream keys;
+    keys.Tolerance = keyframe_tol;
+    keys.Start(keyframe_tol ? 7 : 0);
+    bool autosave_ok = autosave.Open(AUTOSAVE_FILE, 7, keyframe_tol ? 0 : 1000 / sample_interval_ms, true);
+    if(!autosave_ok) {
+        std::cerr << "Warning: cannot write " << AUTOSAVE_FILE << ", recording to memory only" << std::endl;
+    }
+    
+    long long start_time = ControlLoop::NowUs();
+    std::atomic<unsigned long> read_failures(0);
+    TrajectoryPoint drop;
+    while(sample_ring.Pop(drop)) {}
+    sample_ring.ResetDropped();
+    resetHeldPositions();
     
-    while(key != 'q' && key != 'Q') {
+    // Loop thread: bus read + enqueue, nothing else
+    control.Start(sample_interval_ms * 1000, [&](SMS_STS&, unsigned long) -> bool {
         TrajectoryPoint tp;
-        tp.timestamp_us = getCurrentTimeMicros() - start_time;
+        tp.timestamp_us = ControlLoop::NowUs() - start_time;
         
-        if(readAllPositions(tp)) {
+        if(readAllPositions(tp, false)) {
+            sample_ring.Push(tp);
+        } else {
+            read_failures++;
+        }
+        return true;
+    });
+    
+    // Main thread: drain the ring into memory and the file, refresh the display
+    // at most 10 times a second, and watch for the quit key
+    char key = 0;
+    bool stopping = false;
+    long long last_display = 0;
+    while(true) {
+        TrajectoryPoint tp;
+        bool got = false;
+        while(sample_ring.Pop(tp)) {
             trajectory.push_back(tp);
-            sample_count++;
-            displayPositions(tp, sample_count);
+            if(autosave_ok) {
+                s16 pos[7];
+                for(int j = 0; j < 7; j++) pos[j] = tp.positions[j];
+                if(keyframe_tol) {
+                    uint32_t t;
+                    keys.Push((uint32_t)tp.timestamp_us, pos);
+                    while(keys.Pop(t, pos)) autosave.Append(t, pos);
+                } else {
+                    autosave.Append((uint32_t)tp.timestamp_us, pos);
+                }
+            }
+            got = true;
         }
+        long long now = ControlLoop::NowUs();
+        if(got && now - last_display >= 100000) {
+            displayPositions(trajectory.back(), trajectory.size());
+            last_display = now;
+        }
+        if(stopping) break;
         
-        // Check for quit key
         key = getKeyPress();
-        
-        // Wait for next sample
-        usleep(sample_interval_ms * 1000);
+        if(key == 'q' || key == 'Q') {
+            control.Stop();
+            stopping = true;    // one more pass picks up the last samples
+            continue;
+        }
+        usleep(10000);
     }
     
     disableRawMode();
+    if(autosave_ok && keyframe_tol) {
+        uint32_t t;
+        s16 pos[7];
+        keys.Flush();
+        while(keys.Pop(t, pos)) autosave.Append(t, pos);
+    }
+    if(autosave_ok && !autosave.Close()) {
+        std::cerr << "\nWarning: failed to finish " << AUTOSAVE_FILE << std::endl;
+    }
+    
+    if(read_failures || sample_ring.Dropped()) {
+        std::cerr << "\n⚠ " << read_failures << " failed bus reads, "
+                  << sample_ring.Dropped() << " samples dropped (ring full)" << std::endl;
+    }
+    
+    for(int i = 0; i < 7; i++) {
+        if(!held_reads[i]) continue;
+        const SCSLink& link = sm_st.getLink(SERVO_IDS[i]);
+        std::cerr << "⚠ Servo " << (int)SERVO_IDS[i] << ": " << held_reads[i]
+                  << " samples held at its last position (" << link.Timeouts << " timeouts, "
+                  << link.Trips << " times dropped from the sync read)" << std::endl;
+    }
+    
+    if(trajectory.empty()) {
+        std::cout << "\n\n⚠ No samples captured!" << std::endl;
+        return;
+    }
     
     std::cout << "\n\n✓ Recording stopped!" << std::endl;
     std::cout << "Captured " << trajectory.size() << " samples over " 
               << (trajectory.back().timestamp_us / 1000000.0) << " seconds" << std::endl;
     std::cout << "Sample rate: " << (trajectory.size() / (trajectory.back().timestamp_us / 1000000.0)) 
               << " Hz" << std::endl;
+    if(autosave_ok) {
+        std::cout << "Autosaved to '" << AUTOSAVE_FILE << "'";
+        if(keyframe_tol) std::cout << " (" << keys.Keyframes() << " keyframes)";
+        std::cout << std::endl;
+    }
+    control.PrintStats();
+    // Offline pass over the full recording, checked against the playback spline
+    if(keyframe_tol) simplifyTrajectory();
 }
 
-// Smooth playback mode with interpolation
+// Smooth playback mode: spline interpolation streamed at the loop rate
 void playbackContinuous(bool loop = false) {
-    if(trajectory.size() == 0) {
+    size_t count = sampleCount();
+    if(count == 0) {
         std::cout << "\n⚠ No trajectory to playback!" << std::endl;
         return;
     }
@@ -167,73 +398,74 @@ void playbackContinuous(bool loop = false) {
     
     // Enable torque on all servos
     std::cout << "Enabling torque on all servos..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 1);
-        usleep(50000);
+    // One queued bus pass, each write goes out as soon as the previous ACK arrives
+    if(arm.EnableTorque(1) != 7) {
+        std::cerr << "Warning: not every servo acknowledged torque on" << std::endl;
     }
     
-    float duration = trajectory.back().timestamp_us / 1000000.0;
-    std::cout << "\n✓ Starting playback of " << trajectory.size() 
-              << " samples (" << duration << "s)...\n" << std::endl;
+    // Spline through every sample, time-scaled to the joint speed/acc limits;
+    // keyframes go in as they are, the engine's own thinning would merge them
+    engine.SetJoints(7);
+    engine.KnotUs = keyframed ? 0 : TRAJ_ENGINE_KNOT_US;
+    s16 goal[7];
+    for(size_t i = 0; i < count; i++) {
+        sampleGoal(i, goal);
+        engine.Add(sampleTime(i), goal);
+    }
+    
+    std::cout << "\n✓ Starting playback of " << count << (keyframed ? " keyframes (" : " samples (")
+              << engine.RecordedUs() / 1000000.0 << "s recorded)...\n" << std::endl;
     
     int iteration = 0;
     do {
         if(loop) std::cout << "\n--- Loop " << (++iteration) << " ---" << std::endl;
         
-        long long playback_start = getCurrentTimeMicros();
-        size_t next_idx = 0;
+        // Lead in from wherever the arm is now
+        bool at_start = (arm.ReadPositions() == 7);
+        if(!at_start) {
+            std::cerr << "Warning: could not read all positions, starting without lead-in" << std::endl;
+        }
+        engine.Plan(at_start ? arm.Goal() : NULL);
+        std::cout << "Planned " << engine.DurationUs() / 1000000.0 << "s" << std::endl;
         
-        // Smooth playback with acceleration control
-        while(next_idx < trajectory.size()) {
-            long long elapsed_us = getCurrentTimeMicros() - playback_start;
-            
-            // Find the trajectory point(s) for current time
-            while(next_idx < trajectory.size() && 
-                  trajectory[next_idx].timestamp_us <= elapsed_us) {
-                
-                const TrajectoryPoint& tp = trajectory[next_idx];
-                
-                // Calculate speed based on time to next point
-                int speed, acc;
-                if(next_idx < trajectory.size() - 1) {
-                    long long time_to_next_us = trajectory[next_idx + 1].timestamp_us - tp.timestamp_us;
-                    
-                    // Adaptive speed: faster for longer intervals, slower for short intervals
-                    if(time_to_next_us > 200000) {  // > 200ms
-                        speed = 1200;  // Medium speed
-                        acc = 80;      // Medium acceleration
-                    } else if(time_to_next_us > 100000) {  // > 100ms
-                        speed = 800;   // Slower speed
-                        acc = 120;     // Higher acceleration for smoothness
-                    } else {
-                        speed = 600;   // Very slow for fine movements
-                        acc = 150;     // Very smooth acceleration
-                    }
-                } else {
-                    speed = 400;   // Very slow for final position
-                    acc = 150;     // Very smooth
-                }
-                
-                // Send positions to all servos with smooth motion
-                for(int j = 0; j < 7; j++) {
-                    int id = j + 1;
-                    sm_st.WritePosEx(id, tp.positions[j], speed, acc);
-                }
-                
-                // Progress indicator
-                if(next_idx % 10 == 0) {
-                    float progress = (float)next_idx / trajectory.size() * 100.0;
-                    std::cout << "\rProgress: " << (int)progress << "% " 
-                              << "[" << (next_idx+1) << "/" << trajectory.size() << "]   " << std::flush;
-                }
-                
-                next_idx++;
+        long long playback_start = ControlLoop::NowUs();
+        size_t knots = engine.Count();
+        u32 refused = safety.Refused;
+        std::atomic<uint32_t> segment(0);
+        
+        // Loop thread: one resampled setpoint per period, all joints in one
+        // sync write; the segment is only published for the display
+        control.Start(PLAYBACK_PERIOD_US, [&](SMS_STS&, unsigned long) -> bool {
+            long long now = ControlLoop::NowUs();
+            bool more = engine.Step(arm, now - playback_start);
+            segment.store((uint32_t)engine.Segment(), std::memory_order_relaxed);
+            if(telemetry.IsOpen() && telemetry.Due(now)) {
+                ServoState state[7];
+                sm_st.SyncFeedBack(SERVO_IDS, 7, state);
+                telemetry.Push(now, state);
             }
-            
-            usleep(1000);  // 1ms update rate for smooth playback
+            return more;
+        });
+        
+        // Main thread: progress indicator at 10Hz until the loop ends
+        while(control.Running()) {
+            uint32_t seg = segment.load(std::memory_order_relaxed);
+            std::cout << "\rProgress: " << (int)(seg * 100 / knots) << "% " 
+                      << "[" << (seg + 1) << "/" << knots << "]   " << std::flush;
+            usleep(100000);
         }
+        control.Wait();
         
+        if(safety.Refused != refused) {
+            std::cout << "\n⚠ Playback stopped: setpoint refused by the safety model ("
+                      << safetyFault(safety.Fault)
+                      << (safety.FaultJoint >= 0 ? ", joint " + std::to_string(safety.FaultJoint + 1) : std::string())
+                      << ")" << std::endl;
+            control.PrintStats();
+            break;
+        }
         std::cout << "\rProgress: 100% ✓                          " << std::endl;
+        control.PrintStats();
         
         if(loop) {
             std::cout << "\nPress ENTER to continue loop, or 'q' to stop: ";
@@ -247,35 +479,73 @@ void playbackContinuous(bool loop = false) {
     std::cout << "\n✓ Playback finished!" << std::endl;
 }
 
-// Save trajectory to file
+// Save trajectory to file: text for *.txt, binary .traj otherwise
 void saveTrajectory(const std::string& filename) {
-    std::ofstream file(filename);
-    if(!file.is_open()) {
-        std::cerr << "Failed to open file for writing!" << std::endl;
-        return;
-    }
+    size_t count = sampleCount();
+    s16 goal[7];
     
-    file << trajectory.size() << std::endl;
-    for(const auto& tp : trajectory) {
-        file << tp.timestamp_us;
-        for(int i = 0; i < 7; i++) {
-            file << " " << tp.positions[i];
+    if(isTextFile(filename)) {
+        std::ofstream file(filename);
+        if(!file.is_open()) {
+            std::cerr << "Failed to open file for writing!" << std::endl;
+            return;
+        }
+        file << count << '\n';
+        for(size_t i = 0; i < count; i++) {
+            sampleGoal(i, goal);
+            file << sampleTime(i);
+            for(int j = 0; j < 7; j++) {
+                file << " " << goal[j];
+            }
+            file << '\n';
+        }
+        file.close();
+    } else {
+        // Write beside the target and rename, so the mapped source file stays intact
+        std::string tmp = filename + ".tmp";
+        long long duration_us = sampleTime(count - 1);
+        unsigned rate = duration_us > 0 && !keyframed ? (unsigned)((count - 1) * 1000000LL / duration_us) : 0;
+        TrajectoryWriter writer;
+        if(!writer.Open(tmp.c_str(), 7, rate, true)) {
+            std::cerr << "Failed to open file for writing!" << std::endl;
+            return;
+        }
+        for(size_t i = 0; i < count; i++) {
+            sampleGoal(i, goal);
+            writer.Append(sampleTime(i), goal);
+        }
+        if(!writer.Close() || rename(tmp.c_str(), filename.c_str()) != 0) {
+            std::cerr << "Failed to write '" << filename << "'!" << std::endl;
+            remove(tmp.c_str());
+            return;
         }
-        file << std::endl;
     }
-    
-    file.close();
-    std::cout << "✓ Saved " << trajectory.size() << " samples to '" << filename << "'" << std::endl;
+    std::cout << "✓ Saved " << count << " samples to '" << filename << "'" << std::endl;
 }
 
-// Load trajectory from file
+// Load trajectory from file: .traj files are mapped, text files parsed into memory
 bool loadTrajectory(const std::string& filename) {
+    TrajectoryReader reader;
+    if(reader.Open(filename.c_str())) {
+        if(reader.Joints() != 7) {
+            std::cerr << "Trajectory has " << reader.Joints() << " joints, expected 7" << std::endl;
+            return false;
+        }
+        trajectory.clear();
+        traj_file.Open(filename.c_str());
+        keyframed = false;
+        std::cout << "✓ Mapped " << traj_file.Count() << " samples from '" << filename << "'" << std::endl;
+        if(keyframe_tol) simplifyTrajectory();
+        return true;
+    }
+    
     std::ifstream file(filename);
     if(!file.is_open()) {
         return false;
     }
     
     trajectory.clear();
+    traj_file.Close();
     int count;
     file >> count;
     
@@ -289,16 +559,72 @@ bool loadTrajectory(const std::string& filename) {
     }
     
     file.close();
+    keyframed = false;
     std::cout << "✓ Loaded " << trajectory.size() << " samples from '" << filename << "'" << std::endl;
+    if(keyframe_tol) simplifyTrajectory();
     return true;
 }
 
+// Set the keyframe tolerance and reduce the current trajectory with it
+void setKeyframes() {
+    std::cout << "Keyframe tolerance in steps (0 = keep every sample, default: " << TRAJ_SIMPLIFY_TOL << "): ";
+    std::string input;
+    std::getline(std::cin, input);
+    int tol = input.empty() ? TRAJ_SIMPLIFY_TOL : atoi(input.c_str());
+    if(tol < 0 || tol > 4095) {
+        std::cout << "⚠ Invalid tolerance!" << std::endl;
+        return;
+    }
+    keyframe_tol = (u16)tol;
+    if(!keyframe_tol) {
+        std::cout << "✓ Keyframes off, new recordings keep every sample" << std::endl;
+        return;
+    }
+    std::cout << "✓ Keyframes within " << keyframe_tol << " steps (" << keyframe_tol * 360.0 / 4096 << "°)" << std::endl;
+    simplifyTrajectory();
+}
+
+// Start or stop the telemetry log
+void toggleTelemetry() {
+    if(telemetry.IsOpen()) {
+        bool ok = telemetry.Close();
+        std::cout << "\n✓ Telemetry stopped, " << telemetry_file << std::endl;
+        if(!ok) std::cerr << "Warning: some telemetry chunks could not be written" << std::endl;
+        telemetry.Print();
+        return;
+    }
+    std::cout << "Telemetry rate in Hz (default: 10): ";
+    std::string input;
+    std::getline(std::cin, input);
+    double hz = input.empty() ? 10 : atof(input.c_str());
+    if(hz <= 0) {
+        std::cout << "⚠ Invalid rate!" << std::endl;
+        return;
+    }
+    char name[64];
+    time_t t = time(NULL);
+    strftime(name, sizeof(name), "telemetry_%Y%m%d_%H%M%S.tlm", localtime(&t));
+    telemetry_file = name;
+    if(!telemetry.Open(name, SERVO_IDS, 7, (unsigned long)(1000000 / hz))) {
+        std::cerr << "ERROR: cannot write " << name << std::endl;
+        telemetry.Close();
+        return;
+    }
+    std::cout << "✓ Telemetry at " << hz << " Hz to '" << name << "'"
+              << " (logged while recording or playing back; 't' again to stop)" << std::endl;
+}
+
 int main(int argc, char** argv) {
     const char* port = "/dev/ttyACM0";
     int sample_interval_ms = 100; // 100ms = 10Hz sampling by default
     
     if(argc >= 2) port = argv[1];
     if(argc >= 3) sample_interval_ms = atoi(argv[2]);
+    if(argc >= 4) {
+        control.Priority = atoi(argv[3]);
+        control.LockMemory = true;
+    }
+    if(sample_interval_ms <= 0) sample_interval_ms = 100;
     
     std::cout << "╔═══════════════════════════════════════════════════════════════╗" << std::endl;
     std::cout << "║      CONTINUOUS TEACH MODE - Fluid Trajectory Recording       ║" << std::endl;
@@ -306,14 +632,28 @@ int main(int argc, char** argv) {
     std::cout << "\nPort: " << port << std::endl;
     std::cout << "Sample interval: " << sample_interval_ms << "ms (" 
               << (1000.0/sample_interval_ms) << " Hz)" << std::endl;
+    if(control.Priority > 0) {
+        std::cout << "Real-time: SCHED_FIFO priority " << control.Priority << std::endl;
+    }
     std::cout << "Controlling: 7 servos (6 joints + gripper)\n" << std::endl;
     
-    // Initialize serial
+    // Initialize serial (epoll/ring-buffer receive, USB latency timer off)
+    sm_st.LowLatency = true;
+    // Reply timeouts from the baud rate and measured latency (IOTimeOut is the cap);
+    // a servo that misses 3 sync reads in a row is skipped for a second
+    sm_st.AdaptiveTimeOut = true;
+    sm_st.BreakerMisses = SCSERIAL_BREAKER_MISSES;
     if(!sm_st.begin(1000000, port)) {
         std::cerr << "ERROR: Failed to initialize serial on " << port << std::endl;
         return 1;
     }
     
+    Kinematics kin;
+    safety.Build(kin, PLAYBACK_PERIOD_US);
+    arm.Safety = &safety;
+    std::cout << "Safety model: " << (int)(safety.BlockedRatio() * 100 + 0.5)
+              << "% of the J2/J3/J4 range blocked by the collision grid" << std::endl;
+    
     // Main menu
     while(true) {
         std::cout << "\n╔═══════════════════════════════════════════════════════════════╗" << std::endl;
@@ -325,6 +665,8 @@ int main(int argc, char** argv) {
         std::cout << "  s - Save trajectory to file" << std::endl;
         std::cout << "  o - Open (load) trajectory from file" << std::endl;
         std::cout << "  i - Show trajectory info" << std::endl;
+        std::cout << "  k - Keyframes: " << (keyframe_tol ? "on, " + std::to_string(keyframe_tol) + " steps" : std::string("off")) << std::endl;
+        std::cout << "  t - " << (telemetry.IsOpen() ? "Stop" : "Start") << " telemetry log (load/current/voltage/temperature)" << std::endl;
         std::cout << "  q - Quit" << std::endl;
         std::cout << "\nChoice: ";
         
@@ -351,24 +693,24 @@ int main(int argc, char** argv) {
                 
             case 's':
             case 'S': {
-                if(trajectory.size() == 0) {
+                if(sampleCount() == 0) {
                     std::cout << "⚠ No trajectory to save!" << std::endl;
                     break;
                 }
-                std::cout << "Enter filename (default: continuous_trajectory.txt): ";
+                std::cout << "Enter filename (.txt for text, default: continuous_trajectory.traj): ";
                 std::string filename;
                 std::getline(std::cin, filename);
-                if(filename.empty()) filename = "continuous_trajectory.txt";
+                if(filename.empty()) filename = "continuous_trajectory.traj";
                 saveTrajectory(filename);
                 break;
             }
                 
             case 'o':
             case 'O': {
-                std::cout << "Enter filename to load (default: continuous_trajectory.txt): ";
+                std::cout << "Enter filename to load (default: continuous_trajectory.traj): ";
                 std::string filename;
                 std::getline(std::cin, filename);
-                if(filename.empty()) filename = "continuous_trajectory.txt";
+                if(filename.empty()) filename = "continuous_trajectory.traj";
                 if(!loadTrajectory(filename)) {
                     std::cout << "⚠ Failed to load file '" << filename << "'" << std::endl;
                 }
@@ -377,23 +719,39 @@ int main(int argc, char** argv) {
                 
             case 'i':
             case 'I':
-                if(trajectory.size() == 0) {
+                if(sampleCount() == 0) {
                     std::cout << "\n⚠ No trajectory loaded" << std::endl;
                 } else {
-                    float duration = trajectory.back().timestamp_us / 1000000.0;
-                    float sample_rate = trajectory.size() / duration;
+                    float duration = sampleTime(sampleCount() - 1) / 1000000.0;
+                    float sample_rate = sampleCount() / duration;
                     std::cout << "\n╔═══════════════════════════════════════════════════════════════╗" << std::endl;
                     std::cout << "║                  TRAJECTORY INFORMATION                       ║" << std::endl;
                     std::cout << "╚═══════════════════════════════════════════════════════════════╝" << std::endl;
-                    std::cout << "  Samples: " << trajectory.size() << std::endl;
+                    std::cout << "  " << (keyframed ? "Keyframes: " : "Samples: ") << sampleCount() << std::endl;
                     std::cout << "  Duration: " << duration << " seconds" << std::endl;
                     std::cout << "  Sample rate: " << sample_rate << " Hz" << std::endl;
-                    std::cout << "  Memory: " << (trajectory.size() * sizeof(TrajectoryPoint) / 1024) << " KB" << std::endl;
+                    if(traj_file.IsOpen()) {
+                        std::cout << "  Source: memory-mapped .traj file"
+                                  << (traj_file.Delta() ? " (delta encoded)" : "") << std::endl;
+                    } else {
+                        std::cout << "  Memory: " << (trajectory.size() * sizeof(TrajectoryPoint) / 1024) << " KB" << std::endl;
+                    }
                 }
                 break;
                 
+            case 'k':
+            case 'K':
+                setKeyframes();
+                break;
+                
+            case 't':
+            case 'T':
+                toggleTelemetry();
+                break;
+                
             case 'q':
             case 'Q':
+                if(telemetry.IsOpen()) toggleTelemetry();
                 std::cout << "\nExiting...\n" << std::endl;
                 sm_st.end();
                 return 0;
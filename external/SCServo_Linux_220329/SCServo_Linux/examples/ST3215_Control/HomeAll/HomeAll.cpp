@@ -37,78 +37,35 @@
 #include "SCServo.h"   // Feetech/Waveshare servo control library
 
 // ============================================================================
-// JOINT SAFETY LIMITS (in degrees)
+// JOINT MODEL: limits, J1 offset and degree <-> step conversion
 // ============================================================================
-// 
-// WHY LIMITS?
-// - Physical constraints: Robot parts would collide if joints moved too far
-// - Mechanical protection: Prevents damage to gears, brackets, wiring
-// - Safety: Keeps robot movements predictable and controlled
-//
-// HOW TO READ THIS:
-// Array index 0 = Joint 1 (base rotation)
-// Array index 1 = Joint 2 (shoulder)
-// Array index 2 = Joint 3 (elbow)
-// Array index 3 = Joint 4 (wrist pitch)
-// Array index 4 = Joint 5 (wrist roll)
-// Array index 5 = Joint 6 (flange rotation)
-// Array index 6 = Gripper
 //
-// EXAMPLE: Joint 1 can move from -165° to +165° (330° total range)
-//          Joint 2 can move from -125° to +125° (250° total range)
-//
-static const int JOINT_MIN_DEG[7] = {-165, -125, -140, -140, -140, -175, -180};
-static const int JOINT_MAX_DEG[7] = { 165,  125,  140,  140,  140,  175,  180};
-
-// ============================================================================
-// COORDINATE TRANSFORM
-// ============================================================================
-// Physical robot is mounted with 90° clockwise rotation from zero position
-// To align with camera/code coordinates, we apply +90° offset to J1 commands
-static const double J1_OFFSET = 90.0;
-
-// ============================================================================
-// CONVERSION FUNCTION: Degrees → Servo Steps
-// ============================================================================
+// These live in JointModel.h (included by SCServo.h) so every example uses
+// the same numbers:
 //
-// PURPOSE: Convert human-readable angles (degrees) to servo position values
+// JOINT SAFETY LIMITS - JOINT_MIN_DEG / JOINT_MAX_DEG
+// - Physical constraints: Robot parts would collide if joints moved too far
+// - Mechanical protection: Prevents damage to gears, brackets, wiring
+//   EXAMPLE: Joint 1 can move from -165° to +165° (330° total range)
+//            Joint 2 can move from -125° to +125° (250° total range)
 //
-// CONCEPT:
-// - We think in degrees: "move joint to 45°"
-// - Servo understands steps: "go to position 2560"
-// - This function translates between the two
+// COORDINATE TRANSFORM - JOINT_OFFSET_DEG
+// - Physical robot is mounted with 90° clockwise rotation from zero position
+// - To align with camera/code coordinates, J1 commands get +90°
 //
-// MATH BREAKDOWN:
+// CONVERSION - JointSteps(joint, degrees)
 // 1. Start with center: 2048 steps = 0°
-// 2. Calculate offset: (deg / 360°) × 4096 steps
+// 2. Add the offset: (deg / 360°) × 4096 steps
 //    - Example: 45° / 360° = 0.125 rotations
 //    - 0.125 × 4096 = 512 steps from center
-// 3. Add to center: 2048 + 512 = 2560 steps
+// 3. Clamp to the joint limits (precomputed in steps, no floating point
+//    compare per command)
 //
-// WRAPPING:
-// - If result < 0, add 4096 (wrap around)
-// - If result >= 4096, subtract 4096 (wrap around)
-// - This handles the circular nature of rotation
-//
-// EXAMPLE CONVERSIONS:
+// EXAMPLE CONVERSIONS (J2, no offset):
 //   0° → 2048 steps (center)
 //  45° → 2560 steps (2048 + 512)
-//  90° → 3072 steps (2048 + 1024)
 // -45° → 1536 steps (2048 - 512)
-// -90° → 1024 steps (2048 - 1024)
 //
-static int degreesToSteps(double deg){
-    // Calculate servo position: center (2048) + offset
-    double steps = 2048.0 + (deg / 360.0) * 4096.0;
-    
-    // Normalize to valid range [0, 4095]
-    // This handles cases where calculation goes outside bounds
-    while(steps < 0) steps += 4096.0;          // Wrap negative values
-    while(steps >= 4096.0) steps -= 4096.0;    // Wrap values >= 4096
-    
-    // Round to nearest integer (0.5 ensures proper rounding)
-    return (int)(steps + 0.5);
-}
 
 // ============================================================================
 // MAIN PROGRAM
@@ -210,6 +167,8 @@ int main(int argc, char** argv){
     // 4. Send position command
     // 5. Small delay before next servo (prevents bus congestion)
     //
+    u8 ids[7] = {1, 2, 3, 4, 5, 6, 7};
+    s16 goals[7];
     for(int i=0; i<7; i++){
         // Get servo ID (servos are numbered 1-7, not 0-6)
         int id = i+1;
@@ -219,31 +178,16 @@ int main(int argc, char** argv){
         // ----------------------------------------------------------------
         double want_deg = 0.0;
         
-        // ----------------------------------------------------------------
-        // Apply coordinate transform for J1 (base rotation)
-        // ----------------------------------------------------------------
-        // Physical robot is rotated 90° clockwise, compensate with offset
-        if(i == 0){  // J1 only
-            want_deg += J1_OFFSET;
-        }
-        
-        // ----------------------------------------------------------------
-        // SAFETY: Clamp to joint limits
-        // ----------------------------------------------------------------
-        // WHY? Some joints might not be able to reach 0° due to:
-        // - Mechanical constraints
-        // - Assembly variations
-        // - Calibration offsets
-        //
-        // This ensures we never command an impossible position
-        //
-        if(want_deg < JOINT_MIN_DEG[i]) want_deg = JOINT_MIN_DEG[i];
-        if(want_deg > JOINT_MAX_DEG[i]) want_deg = JOINT_MAX_DEG[i];
-        
         // ----------------------------------------------------------------
         // Convert angle to servo steps
         // ----------------------------------------------------------------
-        int steps = degreesToSteps(want_deg);
+        // JointSteps() applies the J1 coordinate transform (physical robot
+        // is rotated 90° clockwise) and clamps to the joint limits, so we
+        // never command a position the joint can't reach
+        //
+        int steps = JointSteps(i, want_deg);
+        want_deg = ServoDeg(steps);
+        goals[i] = steps;  // remembered for the wait below
         
         // Print what we're about to do
         const char* label = (i < 6) ? "Joint" : "Gripper";
@@ -305,18 +249,20 @@ int main(int argc, char** argv){
     // - Takes time to physically move to target (depends on distance & speed)
     // - If we read positions immediately, we'd get intermediate values
     //
-    // HOW LONG?
-    // - 2 seconds is generous for homing (0° is usually close to start position)
-    // - At 1000 steps/sec, worst case:
-    //   * Max distance: ~2048 steps (from one extreme to center)
-    //   * Time needed: 2048/1000 = ~2 seconds
-    //
-    // ALTERNATIVE:
-    // - Could poll each servo's "moving" flag until all stop
-    // - But simple sleep() is more reliable and easier to understand
+    // HOW?
+    // - WaitMotionComplete() sync-reads every servo's MOVING flag and
+    //   position about every 2 ms (one packet for all 7 servos)
+    // - Returns as soon as all of them have stopped within 10 steps
+    //   (~0.9°) of their goal, usually well before a fixed sleep would
+    // - Gives up after 5 seconds (servo jammed, blocked or not answering)
     //
     std::cout << "Waiting for motion to complete..." << std::endl;
-    sleep(2);  // Block program for 2 seconds
+    int waited_ms = sm_st.WaitMotionComplete(ids, 7, goals, 10, 5000);
+    if(waited_ms < 0){
+        std::cerr << "Timed out: not every servo reached its target" << std::endl;
+    }else{
+        std::cout << "Settled after " << waited_ms << " ms" << std::endl;
+    }
 
     // ------------------------------------------------------------------------
     // STEP 6: Read back actual positions (VERIFICATION)
@@ -328,57 +274,44 @@ int main(int argc, char** argv){
     // - Good practice: always verify critical movements
     //
     // HOW IT WORKS:
-    // 1. FeedBack(id) - Request status packet from servo
-    //    * Servo sends back: position, speed, load, voltage, temperature, etc.
-    //    * Returns -1 if communication fails
-    //    * Returns 0 if successful (data cached in library)
+    // 1. SyncFeedBack(ids, 7, state) - Request status from ALL servos at once
+    //    * One INST_SYNC_READ packet goes out, every servo answers in turn
+    //    * Each servo reports: position, speed, load, voltage, temperature, etc.
+    //    * Returns the number of servos that answered
+    //    * state[i].Err is 1 if servo ids[i] didn't answer
     //
-    // 2. ReadPos(-1) - Read position from cached data
-    //    * -1 means "use last FeedBack data" (no new request)
-    //    * More efficient than requesting position again
+    // 2. state[i].Pos - Position decoded from that servo's reply
+    //    * Same value FeedBack(id) + ReadPos(-1) would give, without
+    //      7 separate round trips
     //
     // 3. Convert steps → degrees → centered angle
     //    * steps (0-4095) → angle (0-360°) → centered (-180° to +180°)
     //
+    ServoState state[7];
+    sm_st.SyncFeedBack(ids, 7, state);
+
     for(int i=0; i<7; i++){
-        int id = i+1;
+        int id = ids[i];
         const char* label = (i < 6) ? "Joint" : "Gripper";
         
         // ----------------------------------------------------------------
-        // Request feedback from servo
+        // Check this servo's reply
         // ----------------------------------------------------------------
-        if(sm_st.FeedBack(id) != -1){
+        if(!state[i].Err){
             // Successfully received data
             
             // ----------------------------------------------------------------
-            // Read position from cached feedback
-            // ----------------------------------------------------------------
-            int pos = sm_st.ReadPos(-1);  // -1 = read from cache (don't query again)
-            
-            // ----------------------------------------------------------------
-            // Convert steps to degrees
+            // Read position from sync read result
             // ----------------------------------------------------------------
-            // Formula: degrees = (steps / 4096) × 360°
-            // Example: 2048 steps → (2048/4096) × 360° = 0.5 × 360° = 180°
-            //
-            double angle = (pos / 4096.0) * 360.0;
+            int pos = state[i].Pos;
             
             // ----------------------------------------------------------------
-            // Normalize angle to -180° to +180° range
+            // Convert steps to degrees, centered on 2048 = 0°
             // ----------------------------------------------------------------
-            // WHY?
-            // - Above calculation gives 0° to 360°
-            // - More intuitive to think: -90° (left) vs 270° (also left)
-            // - Centered around 0° matches our "home" concept
-            //
-            // LOGIC:
-            // - If angle >= 360°: subtract 360° (shouldn't happen, but safety)
-            // - If angle > 180°: subtract 360° (convert to negative)
-            //   Example: 270° → 270° - 360° = -90°
+            // Formula: degrees = ((steps - 2048) / 4096) × 360°
+            // Example: 2048 steps → 0°, 1024 steps → -90°
             //
-            double centered = angle;
-            if(centered >= 360.0) centered -= 360.0;
-            if(centered > 180.0) centered -= 360.0;
+            double centered = ServoDeg(pos);
             
             // Print current position
             std::cout << label <<" "<<id<<" current steps="<<pos<<" angle="<<centered<<"°"<<std::endl;
@@ -0,0 +1,449 @@
+/*
+ * LeaderFollower.cpp
+ * Native leader-follower teleoperation (C++ counterpart of
+ * examples/leader_follower.py)
+ *
+ *   - Leader arm (IDs 1-6): torque off, moved by hand
+ *   - Follower arm (IDs 8-13): mirrors the leader; its gripper (14) is left alone
+ *
+ * ONE PORT (both arms on the same bus):
+ *   Every ControlLoop tick sync-reads the leader and sync-writes the
+ *   follower, so a leader sample reaches the follower within one tick
+ *
+ * TWO PORTS (follower_port given):
+ *   The loop thread only reads the leader. Each sample goes through a
+ *   lock-free ring to a follower thread, which writes it as soon as it
+ *   arrives, in parallel with the next leader read
+ *
+ * Offsets (follower - leader, degrees per joint) are shared with
+ * leader_follower.py through leader_follower_offsets.json.
+ *
+ * After each run the loop timing (period jitter, wake latency) and the
+ * end-to-end latency are printed. Latency runs from tick start, before the
+ * leader read, to the follower write leaving the host.
+ *
+ * Usage:
+ *   sudo ./LeaderFollower [port] [rate_hz] [follower_port] [rt_priority]
+ *
+ * Default rate: 200Hz. Use "-" as follower_port to stay on one bus.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "SCServo.h"
+
+// Same IDs as leader_follower.py
+const int JOINTS = 6;
+u8 LEADER_IDS[JOINTS] = {1, 2, 3, 4, 5, 6};
+u8 FOLLOWER_IDS[JOINTS] = {8, 9, 10, 11, 12, 13};
+
+const char* OFFSETS_FILE = "leader_follower_offsets.json";
+double offsets_deg[JOINTS] = {0};
+
+// Follower speed cap: a servo never chases the leader faster than this,
+// even after a glitch or when starting far apart
+const int FOLLOW_SPEED = 2400;  // steps/s
+
+// The loop owns the leader bus; the follower shares it or has its own port
+ControlLoop control;
+SMS_STS& leader_bus = control.Bus;
+SMS_STS follower_port_bus;
+
+// Leader samples for the follower thread (two-port mode)
+struct LeaderSample {
+    long long tick_start_us;
+    s16 target[JOINTS];
+};
+SPSCRing<LeaderSample, 64> sample_ring;
+int sample_fd = -1;  // eventfd: one count per pushed sample
+
+std::atomic<bool> running(false);
+std::atomic<int> shown_pos[JOINTS];  // latest leader positions for the display
+
+int offset_steps[JOINTS] = {0};  // offsets_deg in steps, set when mirroring starts
+
+// Display angle, same convention as servo_limits_config.py (0 steps = 0°)
+double stepsToDegrees(int steps) {
+    double angle = steps / 4096.0 * 360.0;
+    if(angle > 180.0) angle -= 360.0;
+    return angle;
+}
+
+// Offsets are rounded to steps once, so the mirror loop is an integer add
+// and wrap (JointModel.h) instead of a round trip through degrees
+void updateOffsetSteps() {
+    for(int j = 0; j < JOINTS; j++) offset_steps[j] = JointRound(offsets_deg[j] * JOINT_STEPS_PER_DEG);
+}
+
+s16 leaderToFollower(int j, int leader_steps) {
+    return JointShift(leader_steps, offset_steps[j]);
+}
+
+// leader_follower_offsets.json: {"offsets_deg": [o1, .., o6]}
+bool loadOffsets() {
+    std::ifstream file(OFFSETS_FILE);
+    if(!file.is_open()) return false;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::string text = ss.str();
+    size_t key = text.find("\"offsets_deg\"");
+    if(key == std::string::npos) return false;
+    size_t open = text.find('[', key);
+    if(open == std::string::npos) return false;
+    const char* p = text.c_str() + open + 1;
+    double values[JOINTS];
+    for(int j = 0; j < JOINTS; j++) {
+        char* end;
+        values[j] = strtod(p, &end);
+        if(end == p) return false;
+        p = end;
+        while(*p == ',' || *p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') p++;
+    }
+    memcpy(offsets_deg, values, sizeof(values));
+    return true;
+}
+
+bool saveOffsets() {
+    std::ofstream file(OFFSETS_FILE);
+    if(!file.is_open()) return false;
+    file << "{\n  \"offsets_deg\": [";
+    for(int j = 0; j < JOINTS; j++) {
+        file << (j ? ", " : "") << offsets_deg[j];
+    }
+    file << "]\n}\n";
+    return !file.fail();
+}
+
+// Set terminal to non-blocking mode for input
+struct termios orig_termios;
+
+void disableRawMode() {
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
+}
+
+void enableRawMode() {
+    tcgetattr(STDIN_FILENO, &orig_termios);
+
+    struct termios raw = orig_termios;
+    raw.c_lflag &= ~(ECHO | ICANON);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+}
+
+// Check if key was pressed (non-blocking)
+char getKeyPress() {
+    char c = 0;
+    if(read(STDIN_FILENO, &c, 1) == 1) {
+        return c;
+    }
+    return 0;
+}
+
+// End-to-end latency, 50us bins up to 25ms for percentiles
+struct LatencyStats {
+    static const int BIN_US = 50;
+    static const int BINS = 500;
+    unsigned long count;
+    long long sum_us;
+    long min_us;
+    long max_us;
+    unsigned long hist[BINS];
+
+    void reset() {
+        count = 0;
+        sum_us = 0;
+        min_us = 0;
+        max_us = 0;
+        memset(hist, 0, sizeof(hist));
+    }
+    void add(long us) {
+        if(count == 0 || us < min_us) min_us = us;
+        if(us > max_us) max_us = us;
+        sum_us += us;
+        count++;
+        int bin = us / BIN_US;
+        hist[bin < BINS ? bin : BINS - 1]++;
+    }
+    long percentile(double p) const {
+        unsigned long want = (unsigned long)ceil(count * p), seen = 0;
+        for(int i = 0; i < BINS; i++) {
+            seen += hist[i];
+            if(seen >= want) return (i + 1) * BIN_US;
+        }
+        return max_us;
+    }
+    void print() const {
+        if(count == 0) {
+            std::cout << "End-to-end latency: no samples" << std::endl;
+            return;
+        }
+        printf("End-to-end latency (%lu samples): min %ld / mean %.0f / p50 <%ld / p99 <%ld / max %ld us\n",
+               count, min_us, (double)sum_us / count, percentile(0.5), percentile(0.99), max_us);
+    }
+};
+LatencyStats latency;
+
+// Follower side: rate-limit each joint toward its target, one sync write
+struct Follower {
+    ArmCommand arm;
+    s16 goal[JOINTS];
+    u16 speed[JOINTS];
+    u8 acc[JOINTS];
+    int max_step;  // steps per update at FOLLOW_SPEED
+
+    // The leader's readings jitter by a step at rest: leave such joints out
+    // of the write, a still leader then costs no follower traffic at all
+    Follower(SMS_STS& bus) : arm(bus, FOLLOWER_IDS, JOINTS) { arm.Deadband = 1; }
+
+    bool start(int rate_hz) {
+        max_step = FOLLOW_SPEED / rate_hz;
+        if(max_step < 1) max_step = 1;
+        for(int j = 0; j < JOINTS; j++) {
+            speed[j] = FOLLOW_SPEED;
+            acc[j] = 0;
+        }
+        if(arm.ReadPositions() != JOINTS) return false;
+        memcpy(goal, arm.Goal(), sizeof(goal));
+        return true;
+    }
+
+    // Targets are wrapped into 0-4095 (JointShift), so the step goes the
+    // short way round; the goal itself is not wrapped back, a servo sent
+    // 4100 stops at its limit where 4 would turn it the long way
+    void follow(const s16 target[]) {
+        for(int j = 0; j < JOINTS; j++) {
+            int d = JointDelta(target[j], goal[j]);
+            if(d > max_step) d = max_step;
+            if(d < -max_step) d = -max_step;
+            goal[j] += d;
+        }
+        arm.Write(goal, speed, acc);
+    }
+};
+
+// Leader read: unanswered joints keep their previous target
+bool readLeader(s16 target[]) {
+    ServoState state[JOINTS];
+    leader_bus.SyncFeedBack(LEADER_IDS, JOINTS, state);
+    bool any = false;
+    for(int j = 0; j < JOINTS; j++) {
+        if(state[j].Err) continue;
+        target[j] = leaderToFollower(j, state[j].Pos);
+        shown_pos[j] = state[j].Pos;
+        any = true;
+    }
+    return any;
+}
+
+void setTorque(SMS_STS& bus, const u8 ids[], u8 enable) {
+    ArmCommand arm(bus, ids, JOINTS);
+    if(arm.EnableTorque(enable) != JOINTS) {
+        std::cerr << "Warning: not every servo acknowledged torque " << (enable ? "on" : "off") << std::endl;
+    }
+}
+
+void runMirroring(SMS_STS& follower_bus, int rate_hz, bool two_ports) {
+    Follower follower(follower_bus);
+    updateOffsetSteps();
+
+    std::cout << "\nLeader: torque OFF - move it by hand" << std::endl;
+    setTorque(leader_bus, LEADER_IDS, 0);
+    std::cout << "Follower: torque ON" << std::endl;
+    setTorque(follower_bus, FOLLOWER_IDS, 1);
+
+    if(!follower.start(rate_hz)) {
+        std::cerr << "✗ Could not read the follower's position" << std::endl;
+        setTorque(leader_bus, LEADER_IDS, 1);
+        return;
+    }
+    s16 target[JOINTS];
+    memcpy(target, follower.goal, sizeof(target));
+
+    latency.reset();
+    control.ResetStats();
+    running = true;
+
+    std::thread writer;
+    if(two_ports) {
+        LeaderSample drop;
+        while(sample_ring.Pop(drop)) {}
+        // Follower thread: sleeps on the eventfd, writes the newest sample
+        writer = std::thread([&]() {
+            if(control.Priority > 0) {
+                sched_param sp;
+                sp.sched_priority = control.Priority;
+                pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+            }
+            while(running) {
+                pollfd pfd = {sample_fd, POLLIN, 0};
+                if(poll(&pfd, 1, 100) <= 0) continue;
+                uint64_t n;
+                if(read(sample_fd, &n, sizeof(n)) < 0) continue;
+                LeaderSample s;
+                bool got = false;
+                while(sample_ring.Pop(s)) got = true;
+                if(!got) continue;
+                follower.follow(s.target);
+                latency.add(ControlLoop::NowUs() - s.tick_start_us);
+            }
+        });
+    }
+
+    control.Start(1000000 / rate_hz, [&](SMS_STS&, unsigned long) -> bool {
+        long long t0 = ControlLoop::NowUs();
+        if(!readLeader(target)) return running;
+        if(two_ports) {
+            LeaderSample s;
+            s.tick_start_us = t0;
+            memcpy(s.target, target, sizeof(target));
+            sample_ring.Push(s);
+            uint64_t one = 1;
+            if(write(sample_fd, &one, sizeof(one)) < 0) {}
+        } else {
+            follower.follow(target);
+            latency.add(ControlLoop::NowUs() - t0);
+        }
+        return running;
+    });
+
+    std::cout << "\n✅ Mirroring at " << rate_hz << "Hz" << (two_ports ? " (two ports)" : "")
+              << " - press 'q' to stop\n" << std::endl;
+    enableRawMode();
+    while(true) {
+        char key = getKeyPress();
+        if(key == 'q' || key == 'Q') break;
+        printf("\rLeader:");
+        for(int j = 0; j < 3; j++) printf(" %6.1f°", stepsToDegrees(shown_pos[j]));
+        printf(" ... → Follower   ");
+        fflush(stdout);
+        usleep(100000);
+    }
+    disableRawMode();
+
+    running = false;
+    control.Stop();
+    if(writer.joinable()) writer.join();
+
+    std::cout << "\n\nRe-enabling torque on leader..." << std::endl;
+    setTorque(leader_bus, LEADER_IDS, 1);
+
+    control.PrintStats();
+    latency.print();
+    if(sample_ring.Dropped()) {
+        std::cout << sample_ring.Dropped() << " leader samples dropped (follower thread behind)" << std::endl;
+        sample_ring.ResetDropped();
+    }
+}
+
+// Measure follower - leader with both arms held in the same pose
+void calibrateOffsets(SMS_STS& follower_bus) {
+    std::cout << "\nMove both robots to the same physical pose, then press ENTER...";
+    std::string line;
+    std::getline(std::cin, line);
+
+    ServoState lead[JOINTS], foll[JOINTS];
+    if(leader_bus.SyncFeedBack(LEADER_IDS, JOINTS, lead) != JOINTS ||
+       follower_bus.SyncFeedBack(FOLLOWER_IDS, JOINTS, foll) != JOINTS) {
+        std::cerr << "✗ Failed to read positions" << std::endl;
+        return;
+    }
+    printf("\n%-10s %-12s %-12s %-12s\n", "Joint", "Leader", "Follower", "Offset");
+    for(int j = 0; j < JOINTS; j++) {
+        double l = stepsToDegrees(lead[j].Pos);
+        double f = stepsToDegrees(foll[j].Pos);
+        double o = f - l;
+        if(o > 180.0) o -= 360.0;
+        if(o <= -180.0) o += 360.0;
+        offsets_deg[j] = o;
+        printf("Joint %-4d %10.1f° %10.1f° %10.1f°\n", j + 1, l, f, o);
+    }
+    if(saveOffsets()) std::cout << "\n✓ Saved to " << OFFSETS_FILE << std::endl;
+    else std::cerr << "\n✗ Could not write " << OFFSETS_FILE << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const char* port = "/dev/ttyACM0";
+    int rate_hz = 200;
+    const char* follower_port = NULL;
+
+    if(argc >= 2) port = argv[1];
+    if(argc >= 3) rate_hz = atoi(argv[2]);
+    if(argc >= 4 && strcmp(argv[3], "-") != 0) follower_port = argv[3];
+    if(argc >= 5) {
+        control.Priority = atoi(argv[4]);
+        control.LockMemory = true;
+    }
+    if(rate_hz <= 0 || rate_hz > 1000) rate_hz = 200;
+
+    std::cout << "╔═══════════════════════════════════════════════════════════════╗" << std::endl;
+    std::cout << "║             LEADER-FOLLOWER TELEOPERATION                     ║" << std::endl;
+    std::cout << "╚═══════════════════════════════════════════════════════════════╝" << std::endl;
+    std::cout << "\nLeader IDs 1-6 on " << port << ", follower IDs 8-13 on "
+              << (follower_port ? follower_port : port) << std::endl;
+
+    // Initialize serial (epoll/ring-buffer receive, USB latency timer off)
+    leader_bus.LowLatency = true;
+    if(!leader_bus.begin(1000000, port)) {
+        std::cerr << "ERROR: Failed to initialize serial on " << port << std::endl;
+        return 1;
+    }
+    SMS_STS* follower_bus = &leader_bus;
+    if(follower_port) {
+        follower_port_bus.LowLatency = true;
+        if(!follower_port_bus.begin(1000000, follower_port)) {
+            std::cerr << "ERROR: Failed to initialize serial on " << follower_port << std::endl;
+            return 1;
+        }
+        follower_bus = &follower_port_bus;
+        sample_fd = eventfd(0, EFD_CLOEXEC);
+    }
+
+    if(loadOffsets()) {
+        std::cout << "✓ Loaded offsets from " << OFFSETS_FILE << ":";
+        for(int j = 0; j < JOINTS; j++) printf(" %.1f°", offsets_deg[j]);
+        std::cout << std::endl;
+    }
+
+    while(true) {
+        std::cout << "\n  r - Run leader-follower (" << rate_hz << "Hz)" << std::endl;
+        std::cout << "  c - Calibrate offsets" << std::endl;
+        std::cout << "  z - Zero offsets" << std::endl;
+        std::cout << "  q - Quit" << std::endl;
+        std::cout << "\nChoice: ";
+
+        std::string choice;
+        if(!std::getline(std::cin, choice)) break;
+        if(choice.empty()) continue;
+
+        if(choice[0] == 'r') {
+            runMirroring(*follower_bus, rate_hz, follower_port != NULL);
+        } else if(choice[0] == 'c') {
+            calibrateOffsets(*follower_bus);
+        } else if(choice[0] == 'z') {
+            memset(offsets_deg, 0, sizeof(offsets_deg));
+            if(saveOffsets()) std::cout << "✓ Offsets cleared" << std::endl;
+        } else if(choice[0] == 'q') {
+            break;
+        }
+    }
+
+    if(sample_fd != -1) close(sample_fd);
+    if(follower_port) follower_port_bus.end();
+    leader_bus.end();
+    return 0;
+}
@@ -12,7 +12,11 @@
  * - Read feedback from each servo
  * - Home all servos to center position
  * - Quick presets for common positions
- * - Trace circular patterns in horizontal plane
+ * - Trace Cartesian circles in a chosen plane
+ *
+ * Single-servo commands, feedback and pings go through a BusExecutor: the
+ * menu is drawn while the bus works, and a servo that doesn't answer costs
+ * its timeout on the I/O thread instead of freezing the screen.
  */
 
 #include <iostream>
@@ -28,6 +32,7 @@
 #endif
 
 SMS_STS sm_st;
+BusExecutor bus_io(sm_st);  // owns sm_st while jobs are pending; Drain() before direct use
 
 // Configuration
 const int NUM_SERVOS = 7;
@@ -42,6 +47,15 @@ const char* JOINT_NAMES[NUM_SERVOS] = {
     "Joint 7 (Gripper)"
 };
 
+// Same IDs in the form the bus library takes, for whole-arm sync read/write
+u8 ARM_IDS[NUM_SERVOS] = {1, 2, 3, 4, 5, 6, 7};
+ArmCommand arm(sm_st, ARM_IDS, NUM_SERVOS);
+
+// Arm model for the Cartesian circle: offsets and limits from JointModel.h
+Kinematics kin;
+CartesianPath path(kin);
+const unsigned long CIRCLE_PERIOD_US = 10000;  // 100 Hz setpoint streaming
+
 // Default parameters
 const int DEFAULT_SPEED = 2400;    // steps/sec (0-2400)
 const int DEFAULT_ACC = 50;         // acceleration (50*100 steps/sec²)
@@ -69,7 +83,7 @@ void displayMenu() {
     std::cout << "  5. Quick Presets" << std::endl;
     std::cout << "  6. Test Servo Connection (Ping)" << std::endl;
     std::cout << "  7. Set Default Speed & Acceleration" << std::endl;
-    std::cout << "  8. Circle Motion (Horizontal Plane) ★ NEW" << std::endl;
+    std::cout << "  8. Circle Motion (Cartesian) ★ NEW" << std::endl;
     std::cout << "  0. Exit" << std::endl;
     std::cout << std::endl;
     std::cout << "Enter choice: ";
@@ -92,8 +106,11 @@ void displayServoMenu() {
 void controlServo(int servoIndex, int currentSpeed, int currentAcc) {
     int servo_id = SERVO_IDS[servoIndex];
     std::string joint_name = JOINT_NAMES[servoIndex];
+    std::future<int> lastWrite;  // acknowledgement of the last position command
     
     while(true) {
+        // Read the position while the screen is drawn (queued after any write)
+        std::future<ServoState> feedback = bus_io.FeedBack(servo_id);
         clearScreen();
         std::cout << "═══════════════════════════════════════════" << std::endl;
         std::cout << "  Controlling: " << joint_name << std::endl;
@@ -101,8 +118,13 @@ void controlServo(int servoIndex, int currentSpeed, int currentAcc) {
         std::cout << "═══════════════════════════════════════════" << std::endl;
         std::cout << std::endl;
         
-        // Read current position
-        int currentPos = sm_st.ReadPos(servo_id);
+        if(lastWrite.valid()) {
+            std::cout << "Last command: " << (lastWrite.get() != 0 ? "acknowledged" : "NO ACK") << std::endl << std::endl;
+        }
+        
+        // Current position
+        ServoState current = feedback.get();
+        int currentPos = current.Err ? -1 : current.Pos;
         if(currentPos != -1) {
             std::cout << "Current Position: " << currentPos << " / 4095" << std::endl;
             float percentage = (currentPos * 100.0) / 4095.0;
@@ -127,7 +149,10 @@ void controlServo(int servoIndex, int currentSpeed, int currentAcc) {
         int choice;
         std::cin >> choice;
         
-        if(choice == 0) break;
+        if(choice == 0) {
+            bus_io.Drain();  // the other menus use the bus directly
+            break;
+        }
         
         switch(choice) {
             case 1: {
@@ -139,36 +164,37 @@ void controlServo(int servoIndex, int currentSpeed, int currentAcc) {
                     std::cout << "Invalid position! Must be 0-4095" << std::endl;
                 } else {
                     std::cout << "Moving to position " << position << "..." << std::endl;
-                    sm_st.WritePosEx(servo_id, position, currentSpeed, currentAcc);
-                    std::cout << "Command sent!" << std::endl;
+                    lastWrite = bus_io.WritePosEx(servo_id, position, currentSpeed, currentAcc);
+                    std::cout << "Command queued!" << std::endl;
                 }
                 break;
             }
             case 2:
                 std::cout << "Moving to center position (2048)..." << std::endl;
-                sm_st.WritePosEx(servo_id, CENTER_POSITION, currentSpeed, currentAcc);
-                std::cout << "Command sent!" << std::endl;
+                lastWrite = bus_io.WritePosEx(servo_id, CENTER_POSITION, currentSpeed, currentAcc);
+                std::cout << "Command queued!" << std::endl;
                 break;
             case 3:
                 std::cout << "Moving to minimum position (0)..." << std::endl;
-                sm_st.WritePosEx(servo_id, MIN_POSITION, currentSpeed, currentAcc);
-                std::cout << "Command sent!" << std::endl;
+                lastWrite = bus_io.WritePosEx(servo_id, MIN_POSITION, currentSpeed, currentAcc);
+                std::cout << "Command queued!" << std::endl;
                 break;
             case 4:
                 std::cout << "Moving to maximum position (4095)..." << std::endl;
-                sm_st.WritePosEx(servo_id, MAX_POSITION, currentSpeed, currentAcc);
-                std::cout << "Command sent!" << std::endl;
+                lastWrite = bus_io.WritePosEx(servo_id, MAX_POSITION, currentSpeed, currentAcc);
+                std::cout << "Command queued!" << std::endl;
                 break;
             case 5: {
                 std::cout << std::endl << "Reading detailed feedback..." << std::endl;
-                if(sm_st.FeedBack(servo_id) != -1) {
-                    int Pos = sm_st.ReadPos(-1);
-                    int Speed = sm_st.ReadSpeed(-1);
-                    int Load = sm_st.ReadLoad(-1);
-                    int Voltage = sm_st.ReadVoltage(-1);
-                    int Temper = sm_st.ReadTemper(-1);
-                    int Move = sm_st.ReadMove(-1);
-                    int Current = sm_st.ReadCurrent(-1);
+                ServoState fb = bus_io.FeedBack(servo_id).get();
+                if(!fb.Err) {
+                    int Pos = fb.Pos;
+                    int Speed = fb.Speed;
+                    int Load = fb.Load;
+                    int Voltage = fb.Voltage;
+                    int Temper = fb.Temper;
+                    int Move = fb.Move;
+                    int Current = fb.Current;
                     
                     std::cout << "┌─────────────────────────────────┐" << std::endl;
                     std::cout << "│ Servo Feedback Data             │" << std::endl;
@@ -203,8 +229,8 @@ void controlServo(int servoIndex, int currentSpeed, int currentAcc) {
                 if(newPos > 4095) newPos = 4095;
                 
                 std::cout << "Moving from " << currentPos << " to " << newPos << "..." << std::endl;
-                sm_st.WritePosEx(servo_id, newPos, currentSpeed, currentAcc);
-                std::cout << "Command sent!" << std::endl;
+                lastWrite = bus_io.WritePosEx(servo_id, newPos, currentSpeed, currentAcc);
+                std::cout << "Command queued!" << std::endl;
                 break;
             }
             default:
@@ -219,6 +245,9 @@ void controlServo(int servoIndex, int currentSpeed, int currentAcc) {
 
 // Read all servo status
 void readAllServos() {
+    // Snapshot all servos in one sync read transaction, taken while the
+    // header is printed
+    std::future<BusSnapshot> snapshot = bus_io.SyncFeedBack(ARM_IDS, NUM_SERVOS);
     clearScreen();
     std::cout << "═══════════════════════════════════════════════════════════════════════" << std::endl;
     std::cout << "                    ALL SERVO STATUS REPORT                            " << std::endl;
@@ -233,25 +262,22 @@ void readAllServos() {
               << std::setw(8) << "Moving" << std::endl;
     std::cout << "─────────────────────────────────────────────────────────────────────" << std::endl;
     
+    BusSnapshot snap = snapshot.get();
+    const ServoState* state = snap.State;
+    
     for(int i = 0; i < NUM_SERVOS; i++) {
         int id = SERVO_IDS[i];
         std::cout << std::left << std::setw(20) << JOINT_NAMES[i] 
                   << std::setw(6) << id;
         
-        if(sm_st.FeedBack(id) != -1) {
-            int Pos = sm_st.ReadPos(-1);
-            int Voltage = sm_st.ReadVoltage(-1);
-            int Temper = sm_st.ReadTemper(-1);
-            int Move = sm_st.ReadMove(-1);
-            
-            std::cout << std::setw(10) << Pos
-                      << std::setw(8) << Temper
-                      << std::setw(10) << std::fixed << std::setprecision(1) << Voltage/10.0
-                      << std::setw(8) << (Move ? "Yes" : "No") << std::endl;
+        if(!state[i].Err) {
+            std::cout << std::setw(10) << state[i].Pos
+                      << std::setw(8) << state[i].Temper
+                      << std::setw(10) << std::fixed << std::setprecision(1) << state[i].Voltage/10.0
+                      << std::setw(8) << (state[i].Move ? "Yes" : "No") << std::endl;
         } else {
             std::cout << "[ERROR - No response]" << std::endl;
         }
-        usleep(50000); // Small delay between reads
     }
     
     std::cout << "─────────────────────────────────────────────────────────────────────" << std::endl;
@@ -266,11 +292,13 @@ void homeAllServos(int speed, int acc) {
     std::cout << "Homing all servos to center position (2048)..." << std::endl;
     std::cout << std::endl;
     
+    s16 goal[NUM_SERVOS];
     for(int i = 0; i < NUM_SERVOS; i++) {
         std::cout << "Homing " << JOINT_NAMES[i] << " (ID " << SERVO_IDS[i] << ")..." << std::endl;
-        sm_st.WritePosEx(SERVO_IDS[i], CENTER_POSITION, speed, acc);
-        usleep(50000);
+        goal[i] = CENTER_POSITION;
     }
+    arm.ReadPositions();
+    arm.MoveTo(goal, speed, acc);
     
     std::cout << std::endl << "All servos homed!" << std::endl;
     std::cout << "Press Enter to continue...";
@@ -294,11 +322,13 @@ void moveAllServos(int speed, int acc) {
     
     std::cout << std::endl << "Moving all servos to position " << position << "..." << std::endl;
     
+    s16 goal[NUM_SERVOS];
     for(int i = 0; i < NUM_SERVOS; i++) {
         std::cout << "Moving " << JOINT_NAMES[i] << " (ID " << SERVO_IDS[i] << ")..." << std::endl;
-        sm_st.WritePosEx(SERVO_IDS[i], position, speed, acc);
-        usleep(50000);
+        goal[i] = position;
     }
+    arm.ReadPositions();
+    arm.MoveTo(goal, speed, acc);
     
     std::cout << std::endl << "All servos moved!" << std::endl;
     std::cout << "Press Enter to continue...";
@@ -372,11 +402,13 @@ void quickPresets(int speed, int acc) {
     }
     
     std::cout << std::endl << "Executing preset..." << std::endl;
+    s16 goal[NUM_SERVOS];
     for(int i = 0; i < NUM_SERVOS; i++) {
         std::cout << "Moving " << JOINT_NAMES[i] << " to " << positions[i] << "..." << std::endl;
-        sm_st.WritePosEx(SERVO_IDS[i], positions[i], speed, acc);
-        usleep(50000);
+        goal[i] = positions[i];
     }
+    arm.ReadPositions();
+    arm.MoveTo(goal, speed, acc);
     
     std::cout << std::endl << "Preset executed!" << std::endl;
     std::cout << "Press Enter to continue...";
@@ -392,18 +424,22 @@ void pingServos() {
     std::cout << "═══════════════════════════════════════════" << std::endl;
     std::cout << std::endl;
     
+    // All pings are queued at once; each line prints as soon as its reply
+    // (or timeout) is in
+    std::future<int> pings[NUM_SERVOS];
+    for(int i = 0; i < NUM_SERVOS; i++) pings[i] = bus_io.Ping(SERVO_IDS[i]);
+    
     for(int i = 0; i < NUM_SERVOS; i++) {
         int id = SERVO_IDS[i];
         std::cout << std::left << std::setw(25) << JOINT_NAMES[i] 
-                  << " (ID " << id << "): ";
+                  << " (ID " << id << "): " << std::flush;
         
-        int result = sm_st.Ping(id);
+        int result = pings[i].get();
         if(result != -1) {
             std::cout << "✓ Connected" << std::endl;
         } else {
             std::cout << "✗ No response" << std::endl;
         }
-        usleep(50000);
     }
     
     std::cout << std::endl << "Press Enter to continue...";
@@ -443,139 +479,118 @@ void setDefaultParams(int& speed, int& acc) {
     std::cin.get();
 }
 
-// Circle motion in horizontal plane
+// Circle motion: a true circle of the tool point, solved by inverse kinematics
+// and streamed at CIRCLE_PERIOD_US, one sync write per tick
 void traceCircle(int speed, int acc) {
     clearScreen();
     std::cout << "═══════════════════════════════════════════════════════════════" << std::endl;
-    std::cout << "           CIRCLE MOTION - HORIZONTAL PLANE                    " << std::endl;
+    std::cout << "           CIRCLE MOTION - CARTESIAN                           " << std::endl;
     std::cout << "═══════════════════════════════════════════════════════════════" << std::endl;
     std::cout << std::endl;
-    std::cout << "This feature moves servos in coordinated motion to trace a" << std::endl;
-    std::cout << "circle in the horizontal plane using joints 1 and 2." << std::endl;
-    std::cout << std::endl;
-    std::cout << "Joint 1 (Base): Rotates to change angle around circle" << std::endl;
-    std::cout << "Joint 2 (Shoulder): Adjusts to maintain circular radius" << std::endl;
-    std::cout << "Other joints: Remain at current/specified positions" << std::endl;
+    std::cout << "The tool point traces a circle around its present position," << std::endl;
+    std::cout << "in the plane you choose. Joints 1-4 follow the circle, the wrist" << std::endl;
+    std::cout << "roll and gripper hold their present positions." << std::endl;
     std::cout << std::endl;
     std::cout << "───────────────────────────────────────────────────────────────" << std::endl;
     std::cout << std::endl;
     
+    // Where the tool is now
+    if(arm.ReadPositions() != NUM_SERVOS) {
+        std::cout << "ERROR: Failed to read the arm pose!" << std::endl;
+        std::cout << "Press Enter to continue...";
+        std::cin.ignore();
+        std::cin.get();
+        return;
+    }
+    double q[4], here[4];
+    for(int j = 0; j < 4; j++) q[j] = path.Angle(j, arm.Goal()[j]);
+    kin.Position(q, here);
+    
     // Get circle parameters
-    int centerBase, radius, numPoints, loops;
-    bool useOtherJoints;
+    int plane, loops;
+    double radius, mmPerSec;
     
+    std::cout << "Tool point: (" << std::fixed << std::setprecision(1) << here[0] << ", " << here[1]
+              << ", " << here[2] << ") mm" << std::endl;
+    std::cout << std::endl;
     std::cout << "CIRCLE PARAMETERS:" << std::endl;
     std::cout << std::endl;
     
-    std::cout << "Center position for Joint 1/Base (0-4095, default 2048): ";
-    std::cin >> centerBase;
-    if(centerBase < 0 || centerBase > 4095) centerBase = CENTER_POSITION;
+    std::cout << "Plane (1=Horizontal, 2=Vertical facing the arm, 3=Vertical along the arm, default 1): ";
+    std::cin >> plane;
+    if(plane < 1 || plane > 3) plane = 1;
     
-    std::cout << "Radius in servo steps (50-1000, default 500): ";
+    std::cout << "Radius in mm (5-150, default 40): ";
     std::cin >> radius;
-    if(radius < 50 || radius > 1000) radius = 500;
+    if(radius < 5 || radius > 150) radius = 40;
     
-    std::cout << "Number of points per circle (8-360, default 36): ";
-    std::cin >> numPoints;
-    if(numPoints < 8 || numPoints > 360) numPoints = 36;
+    std::cout << "Tool speed in mm/s (5-200, default 50): ";
+    std::cin >> mmPerSec;
+    if(mmPerSec < 5 || mmPerSec > 200) mmPerSec = 50;
     
     std::cout << "Number of loops/circles to trace (1-100, default 1): ";
     std::cin >> loops;
     if(loops < 1 || loops > 100) loops = 1;
     
-    std::cout << std::endl;
-    std::cout << "Keep other joints (3-7) at center position? (1=Yes, 0=No): ";
-    int keepCenter;
-    std::cin >> keepCenter;
-    useOtherJoints = (keepCenter == 1);
+    // Plane normal: vertical, along the arm (radial) or across it
+    double reach = sqrt(here[0] * here[0] + here[1] * here[1]);
+    double radial[2] = {reach > 1e-6 ? here[0] / reach : 1.0, reach > 1e-6 ? here[1] / reach : 0.0};
+    double normal[3] = {0, 0, 1};
+    if(plane == 2) { normal[0] = radial[0]; normal[1] = radial[1]; normal[2] = 0; }
+    if(plane == 3) { normal[0] = -radial[1]; normal[1] = radial[0]; normal[2] = 0; }
+    
+    path.Start(here);
+    path.Circle(here, normal, radius, mmPerSec, loops);
+    path.Line(here, mmPerSec);
+    
+    TrajectoryEngine engine;
+    engine.SetJoints(NUM_SERVOS);
+    for(int j = 0; j < NUM_SERVOS; j++) engine.SetLimits(j, speed > 0 ? speed : TRAJ_ENGINE_VEL_MAX, acc > 0 ? acc * 100.0 : TRAJ_ENGINE_ACC_MAX);
+    int points = path.Plan(engine, arm.Goal(), NUM_SERVOS);
     
     std::cout << std::endl;
     std::cout << "───────────────────────────────────────────────────────────────" << std::endl;
     std::cout << "Configuration Summary:" << std::endl;
-    std::cout << "  Center (Joint 1): " << centerBase << std::endl;
-    std::cout << "  Radius: " << radius << " steps" << std::endl;
-    std::cout << "  Points per circle: " << numPoints << std::endl;
+    const char* planeNames[3] = {"Horizontal", "Vertical, facing the arm", "Vertical, along the arm"};
+    std::cout << "  Plane: " << planeNames[plane - 1] << std::endl;
+    std::cout << "  Radius: " << radius << " mm" << std::endl;
+    std::cout << "  Tool speed: " << mmPerSec << " mm/s" << std::endl;
     std::cout << "  Number of loops: " << loops << std::endl;
-    std::cout << "  Speed: " << speed << " steps/sec" << std::endl;
-    std::cout << "  Acceleration: " << acc << std::endl;
-    std::cout << "  Other joints: " << (useOtherJoints ? "Centered" : "Unchanged") << std::endl;
+    std::cout << "  Joint limits: " << speed << " steps/sec, acceleration " << acc << std::endl;
+    if(points > 0) {
+        std::cout << "  Path: " << path.Length() << " mm, " << points << " points, "
+                  << engine.DurationUs() / 1e6 << " s" << std::endl;
+    }
     std::cout << "───────────────────────────────────────────────────────────────" << std::endl;
     std::cout << std::endl;
-    std::cout << "Press Enter to start (Ctrl+C to abort)...";
-    std::cin.ignore();
-    std::cin.get();
     
-    // Position other joints if requested
-    if(useOtherJoints) {
-        std::cout << std::endl << "Positioning joints 3-7 to center..." << std::endl;
-        for(int i = 2; i < NUM_SERVOS; i++) {
-            sm_st.WritePosEx(SERVO_IDS[i], CENTER_POSITION, speed, acc);
-            usleep(30000);
+    if(points <= 0) {
+        if(points == CART_PATH_UNREACHABLE) {
+            std::cout << "ERROR: Circle leaves the workspace or the joint limits" << std::endl;
+        } else if(points == CART_PATH_FLIP) {
+            std::cout << "ERROR: Circle would flip the elbow" << std::endl;
+        } else {
+            std::cout << "ERROR: Circle passes too close to a singularity" << std::endl;
         }
-        sleep(1); // Wait for positioning
+        std::cout << "Try a smaller radius or another plane." << std::endl;
+        std::cout << std::endl << "Press Enter to continue...";
+        std::cin.ignore();
+        std::cin.get();
+        return;
     }
     
-    std::cout << std::endl << "Starting circular motion..." << std::endl;
-    std::cout << "Press Ctrl+C to stop" << std::endl << std::endl;
-    
-    // Calculate time delay between points (in microseconds)
-    // Rough estimation: time = distance / speed
-    // Average distance between points on circle = (2 * PI * radius) / numPoints
-    double arcLength = (2.0 * M_PI * radius) / numPoints;
-    int delayUs = (int)((arcLength / speed) * 1000000.0);
-    if(delayUs < 50000) delayUs = 50000; // Minimum 50ms
-    if(delayUs > 2000000) delayUs = 2000000; // Maximum 2s
-    
-    int totalPoints = 0;
+    std::cout << "Press Enter to start (Ctrl+C to abort)...";
+    std::cin.ignore();
+    std::cin.get();
     
-    // Execute circular motion
-    for(int loop = 0; loop < loops; loop++) {
-        std::cout << "Loop " << (loop + 1) << "/" << loops << std::endl;
-        
-        for(int point = 0; point < numPoints; point++) {
-            // Calculate angle for this point
-            double angle = (2.0 * M_PI * point) / numPoints;
-            
-            // Calculate positions
-            // Joint 1 (Base) rotates around the circle
-            int basePos = centerBase + (int)(radius * cos(angle));
-            
-            // Joint 2 (Shoulder) moves to create circular motion
-            // This creates motion in the horizontal plane
-            int shoulderPos = CENTER_POSITION + (int)(radius * sin(angle));
-            
-            // Clamp positions to valid range
-            if(basePos < MIN_POSITION) basePos = MIN_POSITION;
-            if(basePos > MAX_POSITION) basePos = MAX_POSITION;
-            if(shoulderPos < MIN_POSITION) shoulderPos = MIN_POSITION;
-            if(shoulderPos > MAX_POSITION) shoulderPos = MAX_POSITION;
-            
-            // Move servos
-            sm_st.WritePosEx(SERVO_IDS[0], basePos, speed, acc);      // Joint 1 (Base)
-            sm_st.WritePosEx(SERVO_IDS[1], shoulderPos, speed, acc);  // Joint 2 (Shoulder)
-            
-            totalPoints++;
-            
-            // Progress indicator every 10 points
-            if(totalPoints % 10 == 0) {
-                std::cout << "  Points: " << totalPoints << " | Angle: " 
-                          << (int)(angle * 180.0 / M_PI) << "°" << std::endl;
-            }
-            
-            // Wait for movement
-            usleep(delayUs);
-        }
-    }
+    std::cout << std::endl << "Tracing circle..." << std::endl;
+    u32 sent = arm.Sent, skipped = arm.Skipped;
+    engine.Play(arm, CIRCLE_PERIOD_US);
     
     std::cout << std::endl << "Circle motion completed!" << std::endl;
-    std::cout << "Total points traced: " << totalPoints << std::endl;
-    std::cout << std::endl;
-    
-    // Return to center
-    std::cout << "Returning to center position..." << std::endl;
-    sm_st.WritePosEx(SERVO_IDS[0], centerBase, speed, acc);
-    sm_st.WritePosEx(SERVO_IDS[1], CENTER_POSITION, speed, acc);
-    sleep(2);
+    std::cout << "Total points traced: " << points << std::endl;
+    std::cout << "Joint writes: " << arm.Sent - sent << " sent, " << arm.Skipped - skipped
+              << " unchanged and left out" << std::endl;
     
     std::cout << std::endl << "Press Enter to continue...";
     std::cin.ignore();
@@ -619,6 +634,7 @@ int main(int argc, char **argv)
     }
     
     std::cout << "✓ Serial port initialized successfully!" << std::endl;
+    bus_io.Start();
     std::cout << std::endl;
     std::cout << "Press Enter to start...";
     std::cin.get();
@@ -676,6 +692,7 @@ int main(int argc, char **argv)
         }
     }
     
+    bus_io.Stop();
     sm_st.end();
     std::cout << "Program ended." << std::endl;
     return 0;
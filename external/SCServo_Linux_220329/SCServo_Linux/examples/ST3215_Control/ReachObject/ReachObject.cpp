@@ -1,242 +1,342 @@
 /*
- * ReachObject.cpp - MOVE ARM TO DETECTED OBJECT WITH VERIFICATION
- * ================================================================
- * 
- * PURPOSE: Move robot arm to reach a detected object with multiple attempts
- *          and verification steps
- * 
+ * ReachObject.cpp - MOVE ARM TO DETECTED OBJECT ALONG A PLANNED STRAIGHT LINE
+ * ===========================================================================
+ *
+ * PURPOSE: Move robot arm to reach a detected object and pick it up
+ *
+ * The target is given as joint angles (as computed by the camera scripts)
+ * or as a Cartesian point. With the closed-form kinematics of the KikoBot C1
+ * the approach is planned once:
+ *   1. joint move from home to a pre-grasp point, APPROACH mm back along
+ *      the tool axis
+ *   2. straight line from there to the object, solved by inverse kinematics
+ *      every 2 mm (CartesianPath) and streamed through the TrajectoryEngine
+ *   3. close the gripper, then lift straight up
+ * The whole line is checked for reachability, joint limits, singularities
+ * and elbow flips before anything moves.
+ *
+ * The grasp is closed-loop (Gripper.h): while the jaws close, the gripper's
+ * current and load are sync-read every 5 ms; a current spike means contact,
+ * the gripper then holds with a small squeeze and the result is known tens
+ * of milliseconds after the jaws touch. After the lift the grip is checked
+ * again, so a part that slipped out is reported.
+ *
  * USAGE:
- *   ./ReachObject <j1> <j2> <j3> [attempts]
- * 
+ *   ./ReachObject <j1> <j2> <j3> [port]
+ *   ./ReachObject --xyz <x> <y> <z> [--pitch DEG] [port]
+ *   options: --approach MM (default 40), --speed MM/S (default 50),
+ *            --grip-current N (contact threshold, 6.5 mA units, default 150),
+ *            --sim-object DEG (on a "sim" port: object stops the jaws at DEG)
+ *
  * Example:
- *   ./ReachObject 15.5 35.0 35.0 3
- * 
- * This makes up to 3 attempts to reach and pick up the object.
+ *   ./ReachObject 15.5 35.0 35.0
+ *   ./ReachObject --xyz 250 80 40 --pitch 90 sim
  */
 
 #include <iostream>
+#include <string>
+#include <vector>
 #include <unistd.h>
 #include <cstdlib>
+#include <cmath>
 #include "SCServo.h"
 
-// Joint limits
-static const int JOINT_MIN_DEG[7] = {-165, -125, -140, -140, -140, -175, -180};
-static const int JOINT_MAX_DEG[7] = { 165,  125,  140,  140,  140,  175,  180};
+static const double DEG = M_PI / 180.0;
+static const double LIFT_MM = 50.0;            // straight up after the grasp
+static const unsigned long LINE_PERIOD_US = 10000;  // 100 Hz setpoint streaming
 
-// Coordinate transform offset
-static const double J1_OFFSET = 90.0;
+static const u8 ARM_IDS[6] = {1, 2, 3, 4, 5, 6};
+static const u8 GRIPPER_ID[1] = {7};
+static const u16 SETTLE_STEPS = 10;            // "arrived" within ~0.9° of the goal
+static const double GRIPPER_CLOSED_DEG = -30.0; // fully closed, nothing in between
+static const u32 GRIP_TIMEOUT_MS = 2000;
+static s16 joint_goal[7];                      // last moveJoint() target per servo
 
-// Convert degrees to servo steps
-static int degreesToSteps(double deg){
-    double steps = 2048.0 + (deg / 360.0) * 4096.0;
-    while(steps < 0) steps += 4096.0;
-    while(steps >= 4096.0) steps -= 4096.0;
-    return (int)(steps + 0.5);
-}
-
-// Move single joint and verify
+// Move single joint and verify (offsets and limits from JointModel.h).
+// Torque is switched on once in main(), not before every move
 bool moveJoint(SMS_STS& sm_st, int id, double target_deg, int speed = 600){
     const char* joint_names[] = {"J1", "J2", "J3", "J4", "J5", "J6", "Gripper"};
-    
-    // Apply coordinate transform for J1
-    double adjusted_deg = target_deg;
-    if(id == 1){
-        adjusted_deg += J1_OFFSET;
-    }
-    
-    // Clamp to limits
+
     int idx = id - 1;
-    if(adjusted_deg < JOINT_MIN_DEG[idx]){
-        std::cout << "⚠️  " << joint_names[idx] << " clamped: " << adjusted_deg << "° → " << JOINT_MIN_DEG[idx] << "°" << std::endl;
-        adjusted_deg = JOINT_MIN_DEG[idx];
-    }
-    if(adjusted_deg > JOINT_MAX_DEG[idx]){
-        std::cout << "⚠️  " << joint_names[idx] << " clamped: " << adjusted_deg << "° → " << JOINT_MAX_DEG[idx] << "°" << std::endl;
-        adjusted_deg = JOINT_MAX_DEG[idx];
-    }
-    
-    int steps = degreesToSteps(adjusted_deg);
-    
-    sm_st.EnableTorque(id, 1);
+    double servo_deg = target_deg + JOINT_OFFSET_DEG[idx];
+    int steps = JointSteps(idx, target_deg);
+    if(servo_deg < JOINT_MIN_DEG[idx] || servo_deg > JOINT_MAX_DEG[idx]){
+        std::cout << "⚠️  " << joint_names[idx] << " clamped: " << servo_deg << "° → " << ServoDeg(steps) << "°" << std::endl;
+    }
+
+    joint_goal[idx] = steps;
     int result = sm_st.WritePosEx(id, steps, speed, 50);
-    
+
     if(result == -1){
         std::cerr << "❌ Failed to send command to " << joint_names[idx] << std::endl;
         return false;
     }
-    
-    std::cout << "  " << joint_names[idx] << ": " << target_deg << "° → " << adjusted_deg << "° (steps: " << steps << ")" << std::endl;
+
+    std::cout << "  " << joint_names[idx] << ": " << target_deg << "° → " << ServoDeg(steps) << "° (steps: " << steps << ")" << std::endl;
     return true;
 }
 
-// Move to home position
-void moveHome(SMS_STS& sm_st){
-    std::cout << "\n🏠 Returning to HOME position..." << std::endl;
-    for(int i = 0; i < 7; i++){
-        moveJoint(sm_st, i + 1, 0.0);
-        usleep(50000);
+// Wait until the servos stopped at their moveJoint() targets
+void waitJoints(SMS_STS& sm_st, std::vector<u8> ids, u32 timeout_ms){
+    s16 goal[7];
+    for(size_t i = 0; i < ids.size(); i++) goal[i] = joint_goal[ids[i] - 1];
+    if(sm_st.WaitMotionComplete(&ids[0], ids.size(), goal, SETTLE_STEPS, timeout_ms) < 0){
+        std::cerr << "⚠️  Joints did not settle within " << timeout_ms << " ms" << std::endl;
     }
-    sleep(2);
 }
 
-// Approach sequence with multiple steps
-bool approachObject(SMS_STS& sm_st, double j1, double j2, double j3, int attempt){
-    std::cout << "\n" << std::string(70, '=') << std::endl;
-    std::cout << "ATTEMPT " << attempt << " - APPROACHING OBJECT" << std::endl;
-    std::cout << std::string(70, '=') << std::endl;
-    
-    // Step 1: Position base (J1) first
-    std::cout << "\nStep 1: Rotating base to align with object..." << std::endl;
-    if(!moveJoint(sm_st, 1, j1, 400)){
-        return false;
+// Coordinated joint move of J1-J6 (arm coordinates, rad)
+void moveJoints(ArmCommand& arm, const double q[6], u32 time_ms){
+    s16 goal[6];
+    for(int j = 0; j < 6; j++) goal[j] = JointStepsRad(j, q[j]);
+    arm.MoveTimed(goal, time_ms, 50);
+    if(arm.WaitMotionComplete(SETTLE_STEPS, time_ms + 1000) < 0){
+        std::cerr << "⚠️  Arm did not settle within " << time_ms + 1000 << " ms" << std::endl;
     }
-    sleep(2);
-    
-    // Step 2: Extend arm partially (70% of target)
-    std::cout << "\nStep 2: Extending arm partially..." << std::endl;
-    double j2_partial = j2 * 0.7;
-    double j3_partial = j3 * 0.7;
-    
-    moveJoint(sm_st, 2, j2_partial, 400);
-    usleep(100000);
-    moveJoint(sm_st, 3, j3_partial, 400);
-    sleep(2);
-    
-    // Step 3: Full extension to target
-    std::cout << "\nStep 3: Extending to full target position..." << std::endl;
-    moveJoint(sm_st, 2, j2, 300);
-    usleep(100000);
-    moveJoint(sm_st, 3, j3, 300);
-    sleep(2);
-    
-    // Step 4: Fine adjustment - try slight variations
-    if(attempt > 1){
-        std::cout << "\nStep 4: Fine adjustment (attempt " << attempt << ")..." << std::endl;
-        double offset = (attempt - 1) * 3.0;  // ±3° per attempt
-        moveJoint(sm_st, 2, j2 + offset, 200);
-        usleep(100000);
-        moveJoint(sm_st, 3, j3 + offset, 200);
-        sleep(2);
-    }
-    
-    // Step 5: Close gripper to attempt pickup
-    std::cout << "\nStep 5: Closing gripper to grasp object..." << std::endl;
-    moveJoint(sm_st, 7, -30, 300);  // Close gripper (negative angle)
-    sleep(2);
-    
-    // Step 6: Lift slightly to test if object is held
-    std::cout << "\nStep 6: Lifting to verify grasp..." << std::endl;
-    moveJoint(sm_st, 2, j2 - 10, 200);  // Lift shoulder
-    sleep(2);
-    
-    // Read gripper position to check if it closed fully (object in grip)
-    std::cout << "\nVerifying gripper state..." << std::endl;
-    if(sm_st.FeedBack(7) != -1){
-        int gripper_pos = sm_st.ReadPos(-1);
-        double gripper_angle = (gripper_pos / 4096.0) * 360.0;
-        if(gripper_angle > 180.0) gripper_angle -= 360.0;
-        
-        std::cout << "Gripper position: " << gripper_angle << "°" << std::endl;
-        
-        // If gripper didn't close completely, object might be in grip
-        // (gripper stops when it hits resistance)
-        if(gripper_angle > -25){  // Didn't reach full -30°
-            std::cout << "✅ Object appears to be grasped! (gripper stopped early)" << std::endl;
-            return true;
-        } else {
-            std::cout << "❌ Gripper closed fully - likely missed object" << std::endl;
-            
-            // Open gripper and retry
-            std::cout << "Opening gripper..." << std::endl;
-            moveJoint(sm_st, 7, 0, 300);
-            sleep(1);
-            return false;
+}
+
+// Unit vector of the tool axis at pose P
+static void toolAxis(const double P[4], double u[3]){
+    double r = std::sqrt(P[0] * P[0] + P[1] * P[1]);
+    double c1 = r > 1e-9 ? P[0] / r : 1.0, s1 = r > 1e-9 ? P[1] / r : 0.0;
+    u[0] = std::cos(P[3]) * c1;
+    u[1] = std::cos(P[3]) * s1;
+    u[2] = -std::sin(P[3]);    // positive pitch points below horizontal
+}
+
+// Straight line from P0 (joint pose q0) to P1, loaded into the engine.
+// Returns false, before anything moves, if any point on it is unusable.
+bool planLine(CartesianPath& path, const double q0[6], const double P0[4], const double P1[4],
+              double speed_mm_s, TrajectoryEngine& engine, double q_end[6]){
+    s16 pose[6];
+    for(int j = 0; j < 6; j++) pose[j] = JointStepsRad(j, q0[j]);
+    engine.SetJoints(6);
+    for(int j = 0; j < 6; j++) engine.SetRange(j, JOINT_MIN_STEPS[j], JOINT_MAX_STEPS[j]);
+
+    path.Start(P0);
+    path.Line(P1, speed_mm_s);
+    int n = path.Plan(engine, pose, 6);
+    if(n <= 0){
+        if(n == CART_PATH_UNREACHABLE){
+            std::cerr << "❌ Point " << path.Bad << " of the line is out of reach or outside the joint limits" << std::endl;
+        }else if(n == CART_PATH_FLIP){
+            std::cerr << "❌ Line needs a " << path.WorstJointStep / DEG << "° joint jump (elbow flip)" << std::endl;
+        }else if(n == CART_PATH_SINGULAR){
+            std::cerr << "❌ Line passes too close to a singularity" << std::endl;
         }
+        return false;
     }
-    
-    return false;
+    std::cout << "  line " << path.Length() << " mm, " << n << " points, " << path.DurationUs() / 1e6 << " s"
+              << ", largest joint step " << path.WorstJointStep / DEG << "°, min manipulability " << path.WorstManipulability << std::endl;
+    path.Joint(n - 1, q_end);
+    for(int j = 4; j < 6; j++) q_end[j] = q0[j];
+    return true;
+}
+
+// Stream the planned line at LINE_PERIOD_US
+void playLine(ControlLoop& control, ArmCommand& arm, TrajectoryEngine& engine){
+    long long start = ControlLoop::NowUs();
+    control.Start(LINE_PERIOD_US, [&](SMS_STS&, unsigned long) -> bool {
+        return engine.Step(arm, ControlLoop::NowUs() - start);
+    });
+    control.Wait();
+    arm.WaitMotionComplete(SETTLE_STEPS, 1000);  // let the servos settle on the last setpoint
+}
+
+static void usage(const char* prog){
+    std::cerr << "Usage: " << prog << " <j1_angle> <j2_angle> <j3_angle> [port]" << std::endl;
+    std::cerr << "       " << prog << " --xyz <x_mm> <y_mm> <z_mm> [--pitch DEG] [port]" << std::endl;
+    std::cerr << "Options: --approach MM (default 40)  --speed MM/S (default 50)" << std::endl;
+    std::cerr << "         --grip-current N (default 150)  --sim-object DEG (sim port only)" << std::endl;
+    std::cerr << "\nExample:" << std::endl;
+    std::cerr << "  " << prog << " 15.5 35.0 35.0" << std::endl;
 }
 
 int main(int argc, char** argv){
-    if(argc < 4){
-        std::cerr << "Usage: " << argv[0] << " <j1_angle> <j2_angle> <j3_angle> [max_attempts]" << std::endl;
-        std::cerr << "\nExample:" << std::endl;
-        std::cerr << "  " << argv[0] << " 15.5 35.0 35.0 3" << std::endl;
-        std::cerr << "\nThis tries up to 3 times to reach and grasp the object." << std::endl;
+    const char* port = "/dev/ttyACM0";
+    bool xyz = false;
+    double target[3] = {0, 0, 0};
+    double pitch_deg = 90.0;
+    double approach_mm = 40.0;
+    double speed_mm_s = 50.0;
+    int grip_current = GRIPPER_CURRENT;
+    bool sim_object = false;
+    double sim_object_deg = 0;
+    std::vector<double> angles;
+    for(int i = 1; i < argc; i++){
+        std::string a = argv[i];
+        if(a == "--xyz" && i + 3 < argc){
+            xyz = true;
+            for(int k = 0; k < 3; k++) target[k] = atof(argv[++i]);
+        }else if(a == "--pitch" && i + 1 < argc) pitch_deg = atof(argv[++i]);
+        else if(a == "--approach" && i + 1 < argc) approach_mm = atof(argv[++i]);
+        else if(a == "--speed" && i + 1 < argc) speed_mm_s = atof(argv[++i]);
+        else if(a == "--grip-current" && i + 1 < argc) grip_current = atoi(argv[++i]);
+        else if(a == "--sim-object" && i + 1 < argc){
+            sim_object = true;
+            sim_object_deg = atof(argv[++i]);
+        }
+        else if(!xyz && angles.size() < 3) angles.push_back(atof(argv[i]));
+        else if(a[0] != '-') port = argv[i];
+        else { usage(argv[0]); return 1; }
+    }
+    if(!xyz && angles.size() < 3){
+        usage(argv[0]);
         return 1;
     }
-    
-    // Parse arguments
-    double j1 = atof(argv[1]);
-    double j2 = atof(argv[2]);
-    double j3 = atof(argv[3]);
-    int max_attempts = (argc >= 5) ? atoi(argv[4]) : 3;  // Default 3 attempts
-    
-    const char* port = "/dev/ttyACM0";
-    if(argc >= 6) port = argv[5];
-    
+    if(speed_mm_s <= 0) speed_mm_s = 50.0;
+
+    Kinematics kin;
+    CartesianPath path(kin);
+
+    // Object pose (x, y, z, pitch)
+    double P_obj[4];
+    if(xyz){
+        for(int k = 0; k < 3; k++) P_obj[k] = target[k];
+        P_obj[3] = pitch_deg * DEG;
+    }else{
+        double q[6] = {angles[0] * DEG, angles[1] * DEG, angles[2] * DEG, 0, 0, 0};
+        kin.Position(q, P_obj);
+    }
+    double u[3];
+    toolAxis(P_obj, u);
+    double P_pre[4] = {P_obj[0] - approach_mm * u[0], P_obj[1] - approach_mm * u[1], P_obj[2] - approach_mm * u[2], P_obj[3]};
+    double P_lift[4] = {P_obj[0], P_obj[1], P_obj[2] + LIFT_MM, P_obj[3]};
+
     std::cout << "\n" << std::string(70, '=') << std::endl;
-    std::cout << "REACH AND GRASP OBJECT - Multi-Attempt System" << std::endl;
+    std::cout << "REACH AND GRASP OBJECT - Straight-Line Approach" << std::endl;
     std::cout << std::string(70, '=') << std::endl;
-    std::cout << "Target angles:" << std::endl;
-    std::cout << "  J1 (base): " << j1 << "°" << std::endl;
-    std::cout << "  J2 (shoulder): " << j2 << "°" << std::endl;
-    std::cout << "  J3 (elbow): " << j3 << "°" << std::endl;
-    std::cout << "Max attempts: " << max_attempts << std::endl;
+    if(!xyz){
+        std::cout << "Target angles: J1 " << angles[0] << "°, J2 " << angles[1] << "°, J3 " << angles[2] << "°" << std::endl;
+    }
+    std::cout << "Object:    (" << P_obj[0] << ", " << P_obj[1] << ", " << P_obj[2] << ") mm, pitch " << P_obj[3] / DEG << "°" << std::endl;
+    std::cout << "Pre-grasp: (" << P_pre[0] << ", " << P_pre[1] << ", " << P_pre[2] << ") mm, " << approach_mm << " mm back along the tool axis" << std::endl;
     std::cout << "Port: " << port << std::endl;
     std::cout << std::string(70, '=') << std::endl;
-    
+
+    // Plan everything before moving: pre-grasp pose, then the approach line
+    double q_pre[6] = {0, 0, 0, 0, 0, 0};
+    double q_home[6] = {0, 0, 0, 0, 0, 0};
+    if(kin.Inverse(P_pre, q_pre, q_home) != 1){
+        std::cerr << "❌ Pre-grasp point is out of reach or outside the joint limits" << std::endl;
+        return 1;
+    }
+    std::cout << "\nPlanning approach..." << std::endl;
+    TrajectoryEngine approach;
+    double q_obj[6];
+    if(!planLine(path, q_pre, P_pre, P_obj, speed_mm_s, approach, q_obj)){
+        return 1;
+    }
+
     // Initialize servo controller
-    SMS_STS sm_st;
+    ControlLoop control;
+    SMS_STS& sm_st = control.Bus;
     if(!sm_st.begin(1000000, port)){
         std::cerr << "❌ Failed to initialize serial on " << port << std::endl;
         return 1;
     }
-    
+    ArmCommand arm(sm_st, ARM_IDS, 6);
+    ArmCommand gripper_arm(sm_st, GRIPPER_ID, 1);
+    Gripper gripper(sm_st, 7);
+    gripper.CurrentLimit = grip_current;
     std::cout << "✅ Connected to robot\n" << std::endl;
-    
+    if(arm.EnableTorque(1) != 6 || gripper_arm.EnableTorque(1) != 1){
+        std::cerr << "⚠️  Not every servo acknowledged torque on" << std::endl;
+    }
+
     // Start from home
-    moveHome(sm_st);
-    
-    // Try multiple attempts
+    std::cout << "🏠 Moving to HOME position..." << std::endl;
+    moveJoints(arm, q_home, 2000);
+    moveJoint(sm_st, 7, 0.0, 300);
+    waitJoints(sm_st, {7}, 2000);
+
+    std::cout << "\nStep 1: Joint move to pre-grasp pose..." << std::endl;
+    moveJoints(arm, q_pre, 2000);
+
+    std::cout << "\nStep 2: Straight-line approach (" << approach.DurationUs() / 1e6 << " s)..." << std::endl;
+    playLine(control, arm, approach);
+
+    // A part between the simulated jaws, for trying the grasp without hardware
+    SimulatedBus* sim = dynamic_cast<SimulatedBus*>(sm_st.getTransport());
+    if(sim_object && sim) sim->SetObstacle(7, JointSteps(6, sim_object_deg));
+
+    // Step 3: Close the gripper until the current says it touched the object
+    std::cout << "\nStep 3: Closing gripper to grasp object..." << std::endl;
+    GripReport grip;
+    int result = gripper.Close(JointSteps(6, GRIPPER_CLOSED_DEG), 300, 50, GRIP_TIMEOUT_MS, &grip);
+    std::cout << "Gripper at " << JointDeg(6, grip.Pos) << "° after " << grip.TimeUs / 1000 << " ms"
+              << " (peak current " << grip.PeakCurrent << ", load " << grip.PeakLoad << ", "
+              << grip.Samples << " reads)" << std::endl;
     bool success = false;
-    for(int attempt = 1; attempt <= max_attempts; attempt++){
-        success = approachObject(sm_st, j1, j2, j3, attempt);
-        
-        if(success){
-            std::cout << "\n" << std::string(70, '=') << std::endl;
-            std::cout << "✅ SUCCESS! Object grasped on attempt " << attempt << std::endl;
-            std::cout << std::string(70, '=') << std::endl;
-            
-            // Move to a safe position with object
-            std::cout << "\nMoving to safe position with object..." << std::endl;
-            moveJoint(sm_st, 2, 0, 300);
-            usleep(100000);
-            moveJoint(sm_st, 3, 0, 300);
-            sleep(2);
-            
-            break;
-        } else if(attempt < max_attempts){
-            std::cout << "\n⚠️  Attempt " << attempt << " failed. Retrying..." << std::endl;
-            // Return to home before next attempt
-            moveHome(sm_st);
+    int held = 1;  // Gripper::Holding() after the lift
+    if(result == GRIP_HOLDING){
+        std::cout << "✅ Object grasped, " << (grip.TimeUs - grip.ContactUs) / 1000 << " ms after contact (current "
+                  << grip.Current << ", holding " << gripper.HoldSteps << " steps past it)" << std::endl;
+        success = true;
+    }else if(result == GRIP_EMPTY){
+        std::cout << "❌ Gripper closed fully - missed object" << std::endl;
+    }else if(result == GRIP_TIMEOUT){
+        std::cout << "❌ Gripper still moving after " << GRIP_TIMEOUT_MS << " ms" << std::endl;
+    }else{
+        std::cout << "❌ No reply from the gripper" << std::endl;
+    }
+
+    if(success){
+        // Step 4: Lift straight up
+        std::cout << "\nStep 4: Lifting " << LIFT_MM << " mm..." << std::endl;
+        TrajectoryEngine lift;
+        double q_lift[6];
+        if(planLine(path, q_obj, P_obj, P_lift, speed_mm_s, lift, q_lift)){
+            playLine(control, arm, lift);
+        }else{
+            moveJoint(sm_st, 2, q_obj[1] / DEG - 10, 200);  // Lift shoulder
+            waitJoints(sm_st, {2}, 3000);
         }
+        // The lift would have pulled a loose part out of the jaws; no
+        // reply (-1) is a bus error, not a grasp
+        held = gripper.Holding();
+        success = held == 1;
     }
-    
-    if(!success){
+
+    if(success){
         std::cout << "\n" << std::string(70, '=') << std::endl;
-        std::cout << "❌ Failed to grasp object after " << max_attempts << " attempts" << std::endl;
+        std::cout << "✅ SUCCESS! Object grasped" << std::endl;
+        std::cout << std::string(70, '=') << std::endl;
+
+        // Move to a safe position with object
+        std::cout << "\nMoving to safe position with object..." << std::endl;
+        moveJoint(sm_st, 2, 0, 300);
+        usleep(100000);
+        moveJoint(sm_st, 3, 0, 300);
+        waitJoints(sm_st, {2, 3}, 5000);
+    }else{
+        if(result == GRIP_HOLDING && held == 0) std::cout << "❌ Object slipped out during the lift" << std::endl;
+        if(result == GRIP_HOLDING && held < 0) std::cout << "❌ No reply from the gripper after the lift" << std::endl;
+        std::cout << "Opening gripper..." << std::endl;
+        if(sim) sim->ClearObstacle(7);
+        joint_goal[6] = JointSteps(6, 0);
+        gripper.Open(joint_goal[6], 300, 50);
+        waitJoints(sm_st, {7}, 2000);
+
+        // Back out along the approach line before going home (not after a lift)
+        TrajectoryEngine retreat;
+        double q_back[6];
+        if(result != GRIP_HOLDING && planLine(path, q_obj, P_obj, P_pre, speed_mm_s, retreat, q_back)){
+            playLine(control, arm, retreat);
+        }
+        std::cout << "\n" << std::string(70, '=') << std::endl;
+        std::cout << "❌ Failed to grasp object" << std::endl;
         std::cout << std::string(70, '=') << std::endl;
         std::cout << "\nSuggestions:" << std::endl;
         std::cout << "  - Verify object position with camera" << std::endl;
-        std::cout << "  - Adjust target angles manually" << std::endl;
+        std::cout << "  - Adjust target angles or --approach / --pitch" << std::endl;
         std::cout << "  - Check if object is graspable" << std::endl;
-        
-        // Return to home
-        moveHome(sm_st);
+
+        std::cout << "\n🏠 Returning to HOME position..." << std::endl;
+        moveJoints(arm, q_home, 2000);
     }
-    
+
     sm_st.end();
-    
+
     return success ? 0 : 1;
 }
@@ -0,0 +1,263 @@
+/*
+ * ScanBus.cpp
+ * Find every servo on one or more ports, at every baud rate, in seconds
+ *
+ * For each rate a broadcast ping goes out first. Servos answering it at
+ * the same time collide on the wire, so every frame that still parses is
+ * kept and the rest counts as noise. Only rates where something answered
+ * (a frame or noise) are then swept ID by ID. Misses cost the adaptive
+ * timeout (SCSerial::AdaptiveTimeOut): wire time of the ping and its reply
+ * plus the latency measured on the first servo that answered, about 1 ms
+ * at 1M baud instead of a fixed IOTimeOut. --timeout caps it until then.
+ * Each port is scanned on its own thread, so several buses take as long
+ * as the slowest one.
+ *
+ * Output is a bus map: port, baud rate, ID and model number
+ * (SMS_STS_MODEL_L/H) of every servo found.
+ *
+ * Usage:
+ *   ./ScanBus [--baud all|R1,R2,..] [--ids 0-253] [--timeout MS]
+ *             [--retries N] [--full] [--quick] [PORT ...]
+ *
+ *   --full   sweep every rate, even where the broadcast got no answer
+ *   --quick  trust a broadcast with no noise, skip the sweep there
+ *   PORT defaults to /dev/ttyACM0; "sim", "sim:1-6,9" scan a SimulatedBus
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include "SCServo.h"
+
+static const int RATES[8] = {1000000, 500000, 250000, 128000, 115200, 76800, 57600, 38400};
+
+struct Found {
+    std::string port;
+    int baud;
+    int id;
+    int model;      // -1 if the model read failed
+};
+
+struct PortScan {
+    std::string port;
+    bool opened;
+    std::vector<Found> found;
+    std::vector<std::string> notes;     // per-rate summary lines
+    double seconds;
+};
+
+std::vector<int> scan_rates(RATES, RATES + 8);
+bool scan_ids[254];
+unsigned long timeout_ms = 20;
+int retries = 0;
+bool full = false;
+bool quick = false;
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// "0-253" or "1,2,8-14"
+bool parseIds(const char* spec) {
+    memset(scan_ids, 0, sizeof(scan_ids));
+    int n = 0;
+    const char* p = spec;
+    while(*p) {
+        char* end;
+        long a = strtol(p, &end, 10);
+        if(end == p) return false;
+        long b = a;
+        p = end;
+        if(*p == '-') {
+            b = strtol(p + 1, &end, 10);
+            if(end == p + 1) return false;
+            p = end;
+        }
+        if(a < 0 || b > 253 || a > b) return false;
+        for(long id = a; id <= b; id++, n++) scan_ids[id] = true;
+        if(*p == ',') p++;
+        else if(*p) return false;
+    }
+    return n > 0;
+}
+
+bool parseRates(const char* spec) {
+    scan_rates.clear();
+    if(strcmp(spec, "all") == 0) {
+        scan_rates.assign(RATES, RATES + 8);
+        return true;
+    }
+    const char* p = spec;
+    while(*p) {
+        char* end;
+        long r = strtol(p, &end, 10);
+        if(end == p || SMS_STS::BaudRateCode((int)r) < 0) return false;
+        scan_rates.push_back((int)r);
+        p = end;
+        if(*p == ',') p++;
+        else if(*p) return false;
+    }
+    return !scan_rates.empty();
+}
+
+// Whole scan of one port; runs on its own thread with its own bus object
+void scanPort(PortScan* S) {
+    double t0 = nowSec();
+    SMS_STS bus;
+    bus.LowLatency = true;
+    bus.AdaptiveTimeOut = true;
+    bus.IOTimeOut = timeout_ms;
+    bus.Retries = retries;
+    S->opened = bus.begin(scan_rates[0], S->port.c_str());
+    if(!S->opened) {
+        S->seconds = nowSec() - t0;
+        return;
+    }
+    for(size_t r = 0; r < scan_rates.size(); r++) {
+        int baud = scan_rates[r];
+        std::string note = std::to_string(baud) + ": ";
+        if(bus.setBaudRate(baud) < 0) {
+            S->notes.push_back(note + "not supported by the serial port");
+            continue;
+        }
+        u8 heard[254];
+        int noise = 0;
+        int n = bus.PingBroadcast(heard, 254, &noise);
+        bool sweep = full || n > 0 || noise > 0;
+        if(quick && noise == 0 && n > 0) sweep = false;
+        bool present[254];
+        memset(present, 0, sizeof(present));
+        for(int i = 0; i < n; i++) {
+            if(heard[i] < 254) present[heard[i]] = true;
+        }
+        // Broadcast answers first: confirms them and calibrates the timeout
+        for(int id = 0; id < 254; id++) {
+            if(present[id] && bus.Ping(id) != id) present[id] = false;
+        }
+        if(sweep) {
+            for(int id = 0; id < 254; id++) {
+                if(scan_ids[id] && !present[id] && bus.Ping(id) == id) present[id] = true;
+            }
+        }
+        int count = 0;
+        for(int id = 0; id < 254; id++) {
+            if(!present[id]) continue;
+            Found F;
+            F.port = S->port;
+            F.baud = baud;
+            F.id = id;
+            F.model = bus.readWord(id, SMS_STS_MODEL_L);
+            S->found.push_back(F);
+            count++;
+        }
+        note += std::to_string(count) + " servo(s), broadcast " + std::to_string(n)
+              + (noise ? " + noise (collisions)" : "") + (sweep ? "" : ", no sweep");
+        S->notes.push_back(note);
+    }
+    bus.end();
+    S->seconds = nowSec() - t0;
+}
+
+void usage() {
+    std::cerr << "Usage: ./ScanBus [--baud all|R1,R2,..] [--ids 0-253] [--timeout MS]" << std::endl;
+    std::cerr << "                 [--retries N] [--full] [--quick] [PORT ...]" << std::endl;
+    std::cerr << "Rates: 1000000 500000 250000 128000 115200 76800 57600 38400" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::vector<PortScan> ports;
+    parseIds("0-253");
+
+    for(int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool has = i + 1 < argc;
+        if(a == "--full") full = true;
+        else if(a == "--quick") quick = true;
+        else if(a == "--timeout" && has) timeout_ms = strtoul(argv[++i], NULL, 10);
+        else if(a == "--retries" && has) retries = atoi(argv[++i]);
+        else if(a == "--baud" && has) {
+            if(!parseRates(argv[++i])) {
+                std::cerr << "ERROR: bad baud rate list " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if(a == "--ids" && has) {
+            if(!parseIds(argv[++i])) {
+                std::cerr << "ERROR: bad ID list " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if(a[0] != '-') {
+            PortScan S;
+            S.port = a;
+            S.opened = false;
+            S.seconds = 0;
+            ports.push_back(S);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if(ports.empty()) {
+        PortScan S;
+        S.port = "/dev/ttyACM0";
+        S.opened = false;
+        S.seconds = 0;
+        ports.push_back(S);
+    }
+    if(timeout_ms == 0 || retries < 0) {
+        usage();
+        return 1;
+    }
+
+    std::cout << "=== Scanning " << ports.size() << " port(s) at " << scan_rates.size() << " baud rate(s) ===" << std::endl;
+    double t0 = nowSec();
+    std::vector<std::thread> workers;
+    for(size_t p = 0; p < ports.size(); p++) {
+        workers.push_back(std::thread(scanPort, &ports[p]));
+    }
+    for(size_t p = 0; p < workers.size(); p++) {
+        workers[p].join();
+    }
+    double total = nowSec() - t0;
+
+    std::vector<Found> map;
+    bool any_open = false;
+    for(size_t p = 0; p < ports.size(); p++) {
+        const PortScan& S = ports[p];
+        if(!S.opened) {
+            std::cout << "\n" << S.port << ": ✗ cannot open" << std::endl;
+            continue;
+        }
+        any_open = true;
+        std::cout << "\n" << S.port << " (" << std::fixed << std::setprecision(2) << S.seconds << " s)" << std::endl;
+        for(size_t k = 0; k < S.notes.size(); k++) {
+            std::cout << "  " << S.notes[k] << std::endl;
+        }
+        map.insert(map.end(), S.found.begin(), S.found.end());
+    }
+
+    std::cout << "\n=== Bus map ===" << std::endl;
+    if(map.empty()) {
+        std::cout << "No servos found" << std::endl;
+    } else {
+        std::cout << std::left << std::setw(16) << "PORT" << std::setw(10) << "BAUD"
+                  << std::setw(6) << "ID" << "MODEL" << std::endl;
+        for(size_t k = 0; k < map.size(); k++) {
+            const Found& F = map[k];
+            std::cout << std::setw(16) << F.port << std::setw(10) << F.baud << std::setw(6) << F.id;
+            if(F.model < 0) std::cout << "?";
+            else std::cout << F.model << " (0x" << std::hex << std::setw(4) << std::setfill('0') << std::right
+                           << F.model << std::dec << std::setfill(' ') << std::left << ")";
+            std::cout << std::endl;
+        }
+    }
+    std::cout << "\n" << map.size() << " servo(s) in " << std::fixed << std::setprecision(2) << total << " s" << std::endl;
+    return (any_open && !map.empty()) ? 0 : 1;
+}
@@ -0,0 +1,472 @@
+/*
+ * ServoBench.cpp
+ * Bus transaction benchmark for the SCServo library
+ *
+ * Times every basic transaction (Ping, Read, genWrite, FeedBack, snycWrite,
+ * sync read) and a full-arm snapshot, and reports per call:
+ *   - latency percentiles and transactions/sec
+ *   - bytes on the wire (sent + received) vs. payload bytes
+ *   - timeouts and checksum failures
+ *   - estimated wire time at other baud rates, from the byte counts
+ *
+ * --mock replaces the serial port with a SimulatedBus on a virtual clock,
+ * so the numbers are the CPU cost of the protocol layer (plus the simulator).
+ * It needs no hardware and can run in CI. --drop / --corrupt inject lost
+ * and corrupted replies to exercise the error paths.
+ *
+ * On hardware only harmless transactions are sent: reads and re-writes of
+ * each servo's current acceleration register.
+ *
+ * --split P2 moves the --split-ids servos (default 5-7, wrist + gripper)
+ * to a second port and adds the same snapshot through ArmBus, once with
+ * the buses driven one after another and once in parallel. With --mock
+ * both buses are real-time simulated ones (the virtual clock has no wall
+ * time to save), and P2 is ignored. Its byte counts are not recorded.
+ *
+ * Usage:
+ *   ./ServoBench [--port P] [--mock] [--baud B] [--ids 1-7] [--iters N]
+ *                [--low-latency] [--drop P] [--corrupt P]
+ *                [--split P2] [--split-ids 5-7]
+ *                [--json FILE] [--csv FILE]
+ *
+ *   FILE "-" writes to stdout instead of the table
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include "SCServo.h"
+
+u8 servo_ids[SMS_STS_SYNC_MAX];
+int servo_count = 0;
+
+// SMS_STS with byte and checksum-error accounting on every receive path
+class BenchBus : public SMS_STS {
+public:
+    unsigned long tx_bytes;
+    unsigned long rx_bytes;
+
+    BenchBus() : tx_bytes(0), rx_bytes(0), wireLen(0) {}
+
+    // Checksum failures seen so far
+    unsigned long badSum() const {
+        // select receive: readFrame() goes through readSCS(), already seen by wireParser
+        return wireParser.BadSum + (epfd != -1 ? rxParser.BadSum : 0);
+    }
+
+protected:
+    int writeSCS(unsigned char* nDat, int nLen) {
+        tx_bytes += nLen;
+        return SMS_STS::writeSCS(nDat, nLen);
+    }
+    int writeSCS(unsigned char bDat) {
+        tx_bytes++;
+        return SMS_STS::writeSCS(bDat);
+    }
+    int readSCS(unsigned char* nDat, int nLen) {
+        int n = SMS_STS::readSCS(nDat, nLen);
+        if(n > 0) {
+            rx_bytes += n;
+            scan(nDat, n);
+        }
+        return n;
+    }
+    void wFlushSCS() {
+        wireLen = 0;
+        wireParser.Reset();
+        SMS_STS::wFlushSCS();
+    }
+    int readFrame(u8 ID, SCSFrame* Frame, int frameLen) {
+        int got = SMS_STS::readFrame(ID, Frame, frameLen);
+        // epoll receive parses the ring in place, bypassing readSCS()
+        if(got && epfd != -1) rx_bytes += Frame->Size;
+        return got;
+    }
+
+private:
+    // Feed received bytes to a side parser that only counts bad checksums
+    void scan(const u8* nDat, int n) {
+        if(wireLen + n > (int)sizeof(wireBuf)) wireLen = 0;
+        memcpy(wireBuf + wireLen, nDat, n);
+        wireLen += n;
+        SCSFrame Frame;
+        int pos = 0;
+        while(true) {
+            int used;
+            int got = wireParser.Parse(wireBuf + pos, wireLen - pos, &Frame, &used);
+            pos += used;
+            if(!got) break;
+        }
+        memmove(wireBuf, wireBuf + pos, wireLen - pos);
+        wireLen -= pos;
+    }
+
+    SCSParser wireParser;
+    u8 wireBuf[SMS_STS_SYNC_MAX * (SCS_FRAME_MAX + 6)];
+    int wireLen;
+};
+
+BenchBus bus;
+SimulatedBus sim(false);  // --mock: virtual clock, no sleeping
+
+struct BenchResult {
+    std::string name;
+    int replies;        // replies expected per call
+    int payload;        // data bytes carried per call
+    long calls;
+    long ok;            // calls with every reply received
+    long timeouts;      // replies missing
+    long bad_sum;       // replies rejected by checksum
+    double seconds;
+    double tx_bytes;    // per call
+    double rx_bytes;
+    double min_us, mean_us, p50_us, p90_us, p99_us, p999_us, max_us;
+};
+
+static double nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if(sorted.empty()) return 0;
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+// call() runs one transaction and returns the number of replies missing
+template<typename F>
+BenchResult run(const char* name, int replies, int payload, long iters, F call) {
+    BenchResult r;
+    r.name = name;
+    r.replies = replies;
+    r.payload = payload;
+    r.calls = iters;
+    r.ok = r.timeouts = r.bad_sum = 0;
+
+    for(long i = 0; i < iters / 20 + 1; i++) call(i);  // warm-up
+
+    std::vector<double> lat;
+    lat.reserve(iters);
+    unsigned long tx0 = bus.tx_bytes, rx0 = bus.rx_bytes;
+    double start = nowUs();
+    for(long i = 0; i < iters; i++) {
+        unsigned long bad0 = bus.badSum();
+        double t0 = nowUs();
+        int missing = call(i);
+        lat.push_back(nowUs() - t0);
+        if(missing == 0) {
+            r.ok++;
+            continue;
+        }
+        long bad = std::min((long)(bus.badSum() - bad0), (long)missing);
+        r.bad_sum += bad;
+        r.timeouts += missing - bad;
+    }
+    r.seconds = (nowUs() - start) / 1e6;
+    r.tx_bytes = (double)(bus.tx_bytes - tx0) / iters;
+    r.rx_bytes = (double)(bus.rx_bytes - rx0) / iters;
+
+    std::sort(lat.begin(), lat.end());
+    double sum = 0;
+    for(size_t i = 0; i < lat.size(); i++) sum += lat[i];
+    r.min_us = lat.front();
+    r.mean_us = sum / lat.size();
+    r.p50_us = percentile(lat, 0.50);
+    r.p90_us = percentile(lat, 0.90);
+    r.p99_us = percentile(lat, 0.99);
+    r.p999_us = percentile(lat, 0.999);
+    r.max_us = lat.back();
+    return r;
+}
+
+// Wire time for the bytes of one call: 10 bits per byte (8N1)
+const int WIRE_BAUDS[] = {1000000, 500000, 115200};
+const char* WIRE_NAMES[] = {"1M", "500k", "115200"};
+const int WIRE_N = 3;
+
+static double wireUs(const BenchResult& r, int baud) {
+    return (r.tx_bytes + r.rx_bytes) * 10.0 * 1e6 / baud;
+}
+
+static double efficiency(const BenchResult& r) {
+    double wire = r.tx_bytes + r.rx_bytes;
+    return wire > 0 ? r.payload / wire : 0;
+}
+
+void printTable(const std::vector<BenchResult>& results) {
+    printf("\n%-18s %9s %8s %8s %8s %8s %8s %7s %7s %6s %6s %9s\n",
+           "benchmark", "tx/s", "p50 us", "p90 us", "p99 us", "p99.9", "max us",
+           "wire B", "data B", "t/o", "bad", "wire@1M");
+    printf("--------------------------------------------------------------------------------------------------------------\n");
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        printf("%-18s %9.0f %8.1f %8.1f %8.1f %8.1f %8.1f %7.1f %7d %6ld %6ld %9.1f\n",
+               r.name.c_str(), r.calls / r.seconds, r.p50_us, r.p90_us, r.p99_us, r.p999_us, r.max_us,
+               r.tx_bytes + r.rx_bytes, r.payload, r.timeouts, r.bad_sum, wireUs(r, WIRE_BAUDS[0]));
+    }
+    printf("\nwire B = bytes sent + received per call, data B = payload bytes per call,\n"
+           "t/o = missing replies, bad = replies with a bad checksum, wire@1M = time those bytes take at 1Mbps\n"
+           "(ArmBus rows run on their own buses, their bytes are not counted)\n");
+}
+
+void writeJson(FILE* out, const std::vector<BenchResult>& results, const char* transport, int baud, long iters) {
+    fprintf(out, "{\n  \"transport\": \"%s\",\n  \"baud\": %d,\n  \"servos\": %d,\n  \"iterations\": %ld,\n",
+            transport, baud, servo_count, iters);
+    fprintf(out, "  \"ids\": [");
+    for(int i = 0; i < servo_count; i++) fprintf(out, "%s%d", i ? ", " : "", servo_ids[i]);
+    fprintf(out, "],\n  \"benchmarks\": [\n");
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"calls\": %ld, \"ok\": %ld, \"tx_per_s\": %.1f,\n",
+                r.name.c_str(), r.calls, r.ok, r.calls / r.seconds);
+        fprintf(out, "     \"latency_us\": {\"min\": %.2f, \"mean\": %.2f, \"p50\": %.2f, \"p90\": %.2f, "
+                     "\"p99\": %.2f, \"p999\": %.2f, \"max\": %.2f},\n",
+                r.min_us, r.mean_us, r.p50_us, r.p90_us, r.p99_us, r.p999_us, r.max_us);
+        fprintf(out, "     \"tx_bytes\": %.2f, \"rx_bytes\": %.2f, \"payload_bytes\": %d, \"payload_ratio\": %.3f,\n",
+                r.tx_bytes, r.rx_bytes, r.payload, efficiency(r));
+        fprintf(out, "     \"replies_per_call\": %d, \"timeouts\": %ld, \"checksum_errors\": %ld,\n",
+                r.replies, r.timeouts, r.bad_sum);
+        fprintf(out, "     \"timeout_rate\": %.6f, \"checksum_error_rate\": %.6f,\n",
+                r.replies ? (double)r.timeouts / (r.calls * r.replies) : 0.0,
+                r.replies ? (double)r.bad_sum / (r.calls * r.replies) : 0.0);
+        fprintf(out, "     \"wire_us\": {");
+        for(int b = 0; b < WIRE_N; b++) {
+            fprintf(out, "%s\"%d\": %.1f", b ? ", " : "", WIRE_BAUDS[b], wireUs(r, WIRE_BAUDS[b]));
+        }
+        fprintf(out, "}}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+void writeCsv(FILE* out, const std::vector<BenchResult>& results, const char* transport, int baud) {
+    fprintf(out, "transport,baud,servos,name,calls,ok,tx_per_s,min_us,mean_us,p50_us,p90_us,p99_us,p999_us,max_us,"
+                 "tx_bytes,rx_bytes,payload_bytes,payload_ratio,timeouts,checksum_errors");
+    for(int b = 0; b < WIRE_N; b++) fprintf(out, ",wire_us_%s", WIRE_NAMES[b]);
+    fprintf(out, "\n");
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(out, "%s,%d,%d,%s,%ld,%ld,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%.3f,%ld,%ld",
+                transport, baud, servo_count, r.name.c_str(), r.calls, r.ok, r.calls / r.seconds,
+                r.min_us, r.mean_us, r.p50_us, r.p90_us, r.p99_us, r.p999_us, r.max_us,
+                r.tx_bytes, r.rx_bytes, r.payload, efficiency(r), r.timeouts, r.bad_sum);
+        for(int b = 0; b < WIRE_N; b++) fprintf(out, ",%.1f", wireUs(r, WIRE_BAUDS[b]));
+        fprintf(out, "\n");
+    }
+}
+
+// Parse "1-7" / "1,2,8-14" into ids
+bool parseIds(const char* spec, u8* ids, int& count) {
+    count = 0;
+    const char* p = spec;
+    while(*p) {
+        char* end;
+        long a = strtol(p, &end, 10);
+        if(end == p) return false;
+        long b = a;
+        p = end;
+        if(*p == '-') {
+            b = strtol(p + 1, &end, 10);
+            if(end == p + 1) return false;
+            p = end;
+        }
+        if(a < 0 || b > 253 || a > b) return false;
+        for(long id = a; id <= b; id++) {
+            if(count == SMS_STS_SYNC_MAX) return false;
+            ids[count++] = (u8)id;
+        }
+        if(*p == ',') p++;
+        else if(*p) return false;
+    }
+    return count > 0;
+}
+
+// "sim:1,2,3": a real-time simulated bus with these servos
+std::string simPort(const u8* ids, int count) {
+    std::ostringstream s;
+    s << "sim:";
+    for(int i = 0; i < count; i++) s << (i ? "," : "") << (int)ids[i];
+    return s.str();
+}
+
+bool writeOutput(const char* path, const std::vector<BenchResult>& results, bool json,
+                 const char* transport, int baud, long iters) {
+    FILE* out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if(!out) {
+        perror("fopen:");
+        return false;
+    }
+    if(json) writeJson(out, results, transport, baud, iters);
+    else writeCsv(out, results, transport, baud);
+    if(out != stdout) {
+        fclose(out);
+        std::cerr << "✓ Wrote " << path << std::endl;
+    }
+    return true;
+}
+
+void usage() {
+    std::cerr << "Usage: ./ServoBench [--port P] [--mock] [--baud B] [--ids 1-7] [--iters N]\n"
+                 "                    [--low-latency] [--drop P] [--corrupt P] [--split P2] [--split-ids 5-7]\n"
+                 "                    [--json FILE] [--csv FILE]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const char* port = "/dev/ttyACM0";
+    int baud = 1000000;
+    long iters = 1000;
+    const char* json_path = NULL;
+    const char* csv_path = NULL;
+    double drop_rate = 0, corrupt_rate = 0;
+    bool mock = false;
+    const char* split_port = NULL;
+    u8 split_ids[SMS_STS_SYNC_MAX];
+    int split_count = 0;
+    parseIds("1-7", servo_ids, servo_count);
+    parseIds("5-7", split_ids, split_count);
+
+    for(int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool has = i + 1 < argc;
+        if(a == "--mock") mock = true;
+        else if(a == "--low-latency") bus.LowLatency = true;
+        else if(a == "--port" && has) port = argv[++i];
+        else if(a == "--baud" && has) baud = atoi(argv[++i]);
+        else if(a == "--iters" && has) iters = atol(argv[++i]);
+        else if(a == "--drop" && has) drop_rate = atof(argv[++i]);
+        else if(a == "--corrupt" && has) corrupt_rate = atof(argv[++i]);
+        else if(a == "--json" && has) json_path = argv[++i];
+        else if(a == "--csv" && has) csv_path = argv[++i];
+        else if(a == "--split" && has) split_port = argv[++i];
+        else if(a == "--split-ids" && has) {
+            if(!parseIds(argv[++i], split_ids, split_count)) {
+                std::cerr << "ERROR: bad ID list " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if(a == "--ids" && has) {
+            if(!parseIds(argv[++i], servo_ids, servo_count)) {
+                std::cerr << "ERROR: bad ID list " << argv[i] << std::endl;
+                return 1;
+            }
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if(iters < 1) iters = 1;
+
+    // --split: servos in split_ids go to the second bus, the rest stay on the first
+    u8 bus_ids[2][SMS_STS_SYNC_MAX];
+    int bus_count[2] = {0, 0};
+    if(split_port) {
+        for(int i = 0; i < servo_count; i++) {
+            int b = std::find(split_ids, split_ids + split_count, servo_ids[i]) != split_ids + split_count;
+            bus_ids[b][bus_count[b]++] = servo_ids[i];
+        }
+        if(!bus_count[0] || !bus_count[1]) {
+            std::cerr << "ERROR: --split needs servos on both buses" << std::endl;
+            return 1;
+        }
+    }
+    bool quiet = (json_path && strcmp(json_path, "-") == 0) || (csv_path && strcmp(csv_path, "-") == 0);
+    const char* transport = mock ? "mock" : (bus.LowLatency ? "serial-epoll" : "serial");
+
+    if(mock) {
+        for(int i = 0; i < servo_count; i++) sim.AddServo(servo_ids[i]);
+        bus.begin(baud, &sim);
+    } else if(!bus.begin(baud, port)) {
+        std::cerr << "ERROR: Failed to initialize serial port " << port << std::endl;
+        return 1;
+    }
+    if(!quiet) {
+        std::cout << "=== ServoBench ===" << std::endl;
+        std::cout << "Transport: " << transport << (mock ? "" : std::string(" ") + port)
+                  << ", " << servo_count << " servos, " << iters << " calls per benchmark" << std::endl;
+    }
+
+    // Current acceleration per servo: re-written unchanged by the write benchmarks
+    u8 acc[256] = {0};
+    for(int i = 0; i < servo_count; i++) {
+        int a = -1;
+        for(int tries = 0; tries < 3 && a < 0; tries++) a = bus.readByte(servo_ids[i], SMS_STS_ACC);
+        if(a < 0) {
+            std::cerr << "ERROR: servo " << (int)servo_ids[i] << " did not answer" << std::endl;
+            bus.end();
+            return 1;
+        }
+        acc[servo_ids[i]] = a;
+    }
+    u8 sync_acc[SMS_STS_SYNC_MAX];
+    for(int i = 0; i < servo_count; i++) sync_acc[i] = acc[servo_ids[i]];
+
+    sim.DropRate = drop_rate;
+    sim.CorruptRate = corrupt_rate;
+
+    const int FB = SMS_STS_PRESENT_CURRENT_H - SMS_STS_PRESENT_POSITION_L + 1;  // FeedBack block
+    std::vector<BenchResult> results;
+
+    results.push_back(run("Ping", 1, 0, iters, [&](long i) {
+        return bus.Ping(servo_ids[i % servo_count]) == -1 ? 1 : 0;
+    }));
+    results.push_back(run("Read(pos)", 1, 2, iters, [&](long i) {
+        u8 d[2];
+        return bus.Read(servo_ids[i % servo_count], SMS_STS_PRESENT_POSITION_L, d, 2) == 2 ? 0 : 1;
+    }));
+    results.push_back(run("genWrite(acc)", 1, 1, iters, [&](long i) {
+        u8 id = servo_ids[i % servo_count];
+        return bus.genWrite(id, SMS_STS_ACC, &acc[id], 1) ? 0 : 1;
+    }));
+    results.push_back(run("FeedBack", 1, FB, iters, [&](long i) {
+        return bus.FeedBack(servo_ids[i % servo_count]) == -1 ? 1 : 0;
+    }));
+    results.push_back(run("snycWrite(acc)", 0, servo_count, iters, [&](long) {
+        bus.snycWrite(servo_ids, servo_count, SMS_STS_ACC, sync_acc, 1);
+        return 0;
+    }));
+    // Full-arm snapshot: one servo at a time vs. one sync read
+    results.push_back(run("Snapshot(FeedBack)", servo_count, FB * servo_count, iters, [&](long) {
+        int missing = 0;
+        for(int k = 0; k < servo_count; k++) missing += bus.FeedBack(servo_ids[k]) == -1;
+        return missing;
+    }));
+    results.push_back(run("Snapshot(SyncRead)", servo_count, FB * servo_count, iters, [&](long) {
+        ServoState st[SMS_STS_SYNC_MAX];
+        int n = bus.SyncFeedBack(servo_ids, servo_count, st);
+        return n < 0 ? servo_count : servo_count - n;
+    }));
+    bus.end();
+
+    // The same snapshot with the arm split across two buses; bus 0 reopens
+    // the port released above
+    if(split_port) {
+        ArmBus arm;
+        arm.LowLatency = bus.LowLatency;
+        std::string port0 = mock ? simPort(bus_ids[0], bus_count[0]) : port;
+        std::string port1 = mock ? simPort(bus_ids[1], bus_count[1]) : split_port;
+        if(arm.AddBus(port0.c_str(), baud, bus_ids[0], bus_count[0]) < 0
+           || arm.AddBus(port1.c_str(), baud, bus_ids[1], bus_count[1]) < 0) {
+            std::cerr << "ERROR: Failed to open " << port0 << " and " << port1 << " for ArmBus" << std::endl;
+            return 1;
+        }
+        auto snapshot = [&](long) {
+            ServoState st[SMS_STS_SYNC_MAX];
+            return servo_count - arm.Snapshot(st);
+        };
+        results.push_back(run("ArmBus(one thread)", servo_count, FB * servo_count, iters, snapshot));
+        arm.Start();
+        results.push_back(run("ArmBus(parallel)", servo_count, FB * servo_count, iters, snapshot));
+        arm.End();
+    }
+
+    if(!quiet) printTable(results);
+    if(json_path) writeOutput(json_path, results, true, transport, baud, iters);
+    if(csv_path) writeOutput(csv_path, results, false, transport, baud, iters);
+    return 0;
+}
@@ -5,7 +5,8 @@
  * Workflow:
  *   1. Record janky circular motion manually (teach mode)
  *   2. Analyze recorded path to detect circular plane & center
- *   3. Generate refined perfect circular motion on same plane
+ *   3. Fit a circle to the tool path (plane, center, radius) and
+ *      regenerate it as a true Cartesian circle through inverse kinematics
  *   4. Playback original or refined version
  * 
  * Usage:
@@ -28,18 +29,26 @@ std::vector<Waypoint> recorded_trajectory;
 std::vector<Waypoint> refined_trajectory;
 SMS_STS sm_st;
 
+u8 SERVO_IDS[7] = {1, 2, 3, 4, 5, 6, 7};
+ArmCommand arm(sm_st, SERVO_IDS, 7);
+
+// Arm model for the Cartesian circle fit: offsets and limits from JointModel.h
+Kinematics kin;
+CartesianPath path(kin);
+const int REFINED_SAMPLE_MS = 10;                  // refined circle sample spacing
+const unsigned long PLAYBACK_PERIOD_US = 10000;    // 100 Hz setpoint streaming
+
 bool readAllPositions(Waypoint& wp) {
+    ServoState state[7];
+    bool ok = (sm_st.SyncFeedBack(SERVO_IDS, 7, state) == 7);
     for(int i = 0; i < 7; i++) {
-        int id = i + 1;
-        if(sm_st.FeedBack(id) != -1) {
-            wp.positions[i] = sm_st.ReadPos(-1);
+        if(state[i].Err) {
+            std::cerr << "Failed to read servo " << (int)SERVO_IDS[i] << std::endl;
         } else {
-            std::cerr << "Failed to read servo " << id << std::endl;
-            return false;
+            wp.positions[i] = state[i].Pos;
         }
-        usleep(10000);
     }
-    return true;
+    return ok;
 }
 
 void displayPositions(const Waypoint& wp) {
@@ -58,10 +67,7 @@ void recordSwirl() {
     
     // Disable torque for manual movement
     std::cout << "Disabling torque..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 0);
-        usleep(50000);
-    }
+    arm.EnableTorque(0);  // One queued pass; the arm remembers the torque state
     
     std::cout << "\n✓ Torque disabled - Move arm freely!\n" << std::endl;
     std::cout << "Instructions:" << std::endl;
@@ -119,13 +125,13 @@ void recordSwirl() {
     // Save raw recording
     std::ofstream file("swirl_recorded.txt");
     if(file.is_open()) {
-        file << recorded_trajectory.size() << std::endl;
+        file << recorded_trajectory.size() << '\n';
         for(const auto& wp : recorded_trajectory) {
             file << wp.timestamp_ms;
             for(int i = 0; i < 7; i++) {
                 file << " " << wp.positions[i];
             }
-            file << std::endl;
+            file << '\n';
         }
         file.close();
         std::cout << "✓ Saved to 'swirl_recorded.txt'" << std::endl;
@@ -224,6 +230,13 @@ void analyzeAndRefine() {
     std::cout << "  • Duration: " << recorded_trajectory.back().timestamp_ms << "ms" << std::endl;
 }
 
+// Tool point of a recorded waypoint
+void toolPoint(const Waypoint& wp, double P[4]) {
+    double q[4];
+    for(int j = 0; j < 4; j++) q[j] = path.Angle(j, wp.positions[j]);
+    kin.Position(q, P);
+}
+
 void generateRefinedCircle() {
     if(recorded_trajectory.size() < 3) {
         std::cout << "\n⚠ Need recorded trajectory first!" << std::endl;
@@ -234,77 +247,131 @@ void generateRefinedCircle() {
     std::cout << "║        GENERATING REFINED CIRCULAR MOTION               ║" << std::endl;
     std::cout << "╚═════════════════════════════════════════════════════════╝\n" << std::endl;
     
-    // Calculate center and variance
-    double mean[7] = {0};
-    double variance[7] = {0};
+    // Tool points of the recording and their centroid
+    size_t n = recorded_trajectory.size();
+    std::vector<double> pts(4 * n);
+    double centroid[3] = {0, 0, 0}, pitch = 0;
+    for(size_t i = 0; i < n; i++) {
+        toolPoint(recorded_trajectory[i], &pts[4 * i]);
+        for(int k = 0; k < 3; k++) centroid[k] += pts[4 * i + k] / n;
+        pitch += pts[4 * i + 3] / n;
+    }
     
-    for(const auto& wp : recorded_trajectory) {
-        for(int i = 0; i < 7; i++) {
-            mean[i] += wp.positions[i];
-        }
+    // Best-fit plane: the normal is the direction of least spread
+    double xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+    for(size_t i = 0; i < n; i++) {
+        double x = pts[4 * i] - centroid[0], y = pts[4 * i + 1] - centroid[1], z = pts[4 * i + 2] - centroid[2];
+        xx += x * x; xy += x * y; xz += x * z;
+        yy += y * y; yz += y * z; zz += z * z;
     }
-    for(int i = 0; i < 7; i++) {
-        mean[i] /= recorded_trajectory.size();
+    double dx = yy * zz - yz * yz, dy = xx * zz - xz * xz, dz = xx * yy - xy * xy;
+    double normal[3];
+    if(dx >= dy && dx >= dz) {
+        normal[0] = dx; normal[1] = xz * yz - xy * zz; normal[2] = xy * yz - xz * yy;
+    } else if(dy >= dz) {
+        normal[0] = xz * yz - xy * zz; normal[1] = dy; normal[2] = xy * xz - yz * xx;
+    } else {
+        normal[0] = xy * yz - xz * yy; normal[1] = xy * xz - yz * xx; normal[2] = dz;
     }
-    
-    for(const auto& wp : recorded_trajectory) {
-        for(int i = 0; i < 7; i++) {
-            double diff = wp.positions[i] - mean[i];
-            variance[i] += diff * diff;
+    double len = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if(len < 1e-9) {
+        std::cout << "⚠ Recorded motion is a straight line, no circle to fit" << std::endl;
+        return;
+    }
+    for(int k = 0; k < 3; k++) normal[k] /= len;
+    
+    // In-plane axes u, v, then a least-squares circle x² + y² = 2ax + 2by + c
+    double u[3] = {1, 0, 0};
+    if(fabs(normal[0]) > 0.9) { u[0] = 0; u[1] = 1; }
+    double un = u[0] * normal[0] + u[1] * normal[1] + u[2] * normal[2];
+    for(int k = 0; k < 3; k++) u[k] -= un * normal[k];
+    len = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+    for(int k = 0; k < 3; k++) u[k] /= len;
+    double v[3] = {normal[1] * u[2] - normal[2] * u[1], normal[2] * u[0] - normal[0] * u[2], normal[0] * u[1] - normal[1] * u[0]};
+    
+    double A[3][3] = {{0}}, B[3] = {0};
+    std::vector<double> px(n), py(n);
+    for(size_t i = 0; i < n; i++) {
+        double d[3] = {pts[4 * i] - centroid[0], pts[4 * i + 1] - centroid[1], pts[4 * i + 2] - centroid[2]};
+        px[i] = d[0] * u[0] + d[1] * u[1] + d[2] * u[2];
+        py[i] = d[0] * v[0] + d[1] * v[1] + d[2] * v[2];
+        double row[3] = {2 * px[i], 2 * py[i], 1}, rhs = px[i] * px[i] + py[i] * py[i];
+        for(int r = 0; r < 3; r++) {
+            for(int k = 0; k < 3; k++) A[r][k] += row[r] * row[k];
+            B[r] += row[r] * rhs;
         }
     }
-    for(int i = 0; i < 7; i++) {
-        variance[i] /= recorded_trajectory.size();
+    double det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1])
+               - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0])
+               + A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+    if(fabs(det) < 1e-9) {
+        std::cout << "⚠ Could not fit a circle to the recorded motion" << std::endl;
+        return;
     }
-    
-    // Find top 2 motion axes
-    int primary = 0, secondary = 1;
-    for(int i = 0; i < 7; i++) {
-        if(variance[i] > variance[primary]) {
-            secondary = primary;
-            primary = i;
-        } else if(variance[i] > variance[secondary] && i != primary) {
-            secondary = i;
-        }
+    double sol[3];
+    for(int c = 0; c < 3; c++) {
+        double M[3][3];
+        for(int r = 0; r < 3; r++) for(int k = 0; k < 3; k++) M[r][k] = k == c ? B[r] : A[r][k];
+        sol[c] = (M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+                - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+                + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0])) / det;
     }
-    
-    // Calculate radius
-    double total_radius = 0;
-    for(const auto& wp : recorded_trajectory) {
-        double dx = wp.positions[primary] - mean[primary];
-        double dy = wp.positions[secondary] - mean[secondary];
-        total_radius += sqrt(dx*dx + dy*dy);
+    double radius = sqrt(sol[2] + sol[0] * sol[0] + sol[1] * sol[1]);
+    double center[3];
+    for(int k = 0; k < 3; k++) center[k] = centroid[k] + sol[0] * u[k] + sol[1] * v[k];
+    
+    // Turning direction and number of turns as recorded
+    double turned = 0;
+    for(size_t i = 1; i < n; i++) {
+        double a0 = atan2(py[i - 1] - sol[1], px[i - 1] - sol[0]);
+        double a1 = atan2(py[i] - sol[1], px[i] - sol[0]);
+        double d = a1 - a0;
+        if(d > M_PI) d -= 2 * M_PI;
+        if(d < -M_PI) d += 2 * M_PI;
+        turned += d;
+    }
+    if(turned < 0) {
+        for(int k = 0; k < 3; k++) normal[k] = -normal[k];
     }
-    double radius = total_radius / recorded_trajectory.size();
+    double turns = floor(fabs(turned) / (2 * M_PI) + 0.5);
+    if(turns < 1) turns = 1;
+    int duration_ms = recorded_trajectory.back().timestamp_ms;
+    double mm_per_s = duration_ms > 0 ? 2 * M_PI * radius * turns / (duration_ms / 1000.0) : 50.0;
     
     std::cout << "Generating perfect circle:" << std::endl;
-    std::cout << "  • Center: J" << (primary+1) << "=" << (int)mean[primary] 
-              << ", J" << (secondary+1) << "=" << (int)mean[secondary] << std::endl;
-    std::cout << "  • Radius: " << (int)radius << " steps" << std::endl;
-    std::cout << "  • Resolution: 36 waypoints (10° intervals)" << std::endl;
+    std::cout << "  • Center: (" << (int)center[0] << ", " << (int)center[1] << ", " << (int)center[2] << ") mm" << std::endl;
+    std::cout << "  • Plane normal: (" << normal[0] << ", " << normal[1] << ", " << normal[2] << ")" << std::endl;
+    std::cout << "  • Radius: " << (int)radius << " mm" << std::endl;
+    std::cout << "  • Turns: " << turns << " at " << (int)mm_per_s << " mm/s" << std::endl;
+    
+    // Start where the recording started; wrist and gripper hold their mean
+    s16 pose[7];
+    for(int j = 0; j < 7; j++) {
+        double mean = 0;
+        for(const auto& wp : recorded_trajectory) mean += wp.positions[j];
+        pose[j] = j < 4 ? recorded_trajectory[0].positions[j] : (s16)(mean / n + 0.5);
+    }
+    double start[4] = {pts[0], pts[1], pts[2], pitch};
+    path.Start(start);
+    path.Circle(center, normal, radius, mm_per_s, turns);
+    TrajectoryEngine engine;
+    int points = path.Plan(engine, pose, 7);
+    if(points <= 0) {
+        std::cout << "⚠ Circle leaves the workspace, the joint limits or passes a singularity" << std::endl;
+        return;
+    }
     
-    // Generate perfect circle
+    // Dense joint samples of the circle
     refined_trajectory.clear();
-    int num_points = 36; // 36 points = 10° per step
-    int duration_ms = recorded_trajectory.back().timestamp_ms;
-    int interval_ms = duration_ms / num_points;
-    
-    for(int i = 0; i < num_points; i++) {
+    double duration_us = engine.DurationUs();
+    for(double t = 0; ; t += REFINED_SAMPLE_MS * 1000.0) {
         Waypoint wp;
-        double angle = (2.0 * M_PI * i) / num_points;
-        
-        for(int j = 0; j < 7; j++) {
-            if(j == primary) {
-                wp.positions[j] = (int)(mean[j] + radius * cos(angle));
-            } else if(j == secondary) {
-                wp.positions[j] = (int)(mean[j] + radius * sin(angle));
-            } else {
-                wp.positions[j] = (int)mean[j]; // Keep other joints at center
-            }
-        }
-        
-        wp.timestamp_ms = i * interval_ms;
+        s16 pos[7];
+        bool more = engine.Sample(t, pos);
+        for(int j = 0; j < 7; j++) wp.positions[j] = pos[j];
+        wp.timestamp_ms = (int)(t / 1000.0);
         refined_trajectory.push_back(wp);
+        if(!more || t > duration_us) break;
     }
     
     std::cout << "✓ Generated " << refined_trajectory.size() << " waypoints for perfect circle" << std::endl;
@@ -312,20 +379,20 @@ void generateRefinedCircle() {
     // Save refined trajectory
     std::ofstream file("swirl_refined.txt");
     if(file.is_open()) {
-        file << refined_trajectory.size() << std::endl;
+        file << refined_trajectory.size() << '\n';
         for(const auto& wp : refined_trajectory) {
             file << wp.timestamp_ms;
             for(int i = 0; i < 7; i++) {
                 file << " " << wp.positions[i];
             }
-            file << std::endl;
+            file << '\n';
         }
         file.close();
         std::cout << "✓ Saved to 'swirl_refined.txt'" << std::endl;
     }
 }
 
-void playback(const std::vector<Waypoint>& trajectory, const std::string& name) {
+void playback(const std::vector<Waypoint>& trajectory, const std::string& name, uint32_t knot_us) {
     if(trajectory.size() == 0) {
         std::cout << "\n⚠ No trajectory to playback!" << std::endl;
         return;
@@ -337,36 +404,26 @@ void playback(const std::vector<Waypoint>& trajectory, const std::string& name)
     
     // Enable torque
     std::cout << "Enabling torque..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 1);
-        usleep(50000);
+    arm.EnableTorque(1);
+    arm.ReadPositions();
+    
+    // Spline through the waypoints, streamed at the control rate
+    TrajectoryEngine engine;
+    engine.SetJoints(7);
+    engine.KnotUs = knot_us;
+    for(const auto& wp : trajectory) {
+        s16 goal[7];
+        for(int j = 0; j < 7; j++) goal[j] = wp.positions[j];
+        engine.Add((uint32_t)wp.timestamp_ms * 1000, goal);
     }
+    engine.Plan(arm.Goal());
     
-    std::cout << "\n✓ Playing " << trajectory.size() << " waypoints...\n" << std::endl;
+    std::cout << "\n✓ Playing " << trajectory.size() << " waypoints (" << engine.DurationUs() / 1e6 << " s)...\n" << std::endl;
+    u32 sent = arm.Sent, skipped = arm.Skipped;
+    engine.Play(arm, PLAYBACK_PERIOD_US);
     
-    for(size_t i = 0; i < trajectory.size(); i++) {
-        const Waypoint& wp = trajectory[i];
-        
-        std::cout << "\rWaypoint " << (i+1) << "/" << trajectory.size() << std::flush;
-        
-        // Smooth motion parameters
-        int speed = 1200;
-        int acc = 150;
-        
-        for(int j = 0; j < 7; j++) {
-            sm_st.WritePosEx(j+1, wp.positions[j], speed, acc);
-        }
-        
-        // Wait for next waypoint
-        if(i < trajectory.size() - 1) {
-            int delay_ms = trajectory[i+1].timestamp_ms - wp.timestamp_ms;
-            if(delay_ms > 0) {
-                usleep(delay_ms * 1000);
-            }
-        }
-    }
-    
-    std::cout << "\n\n✓ Playback complete!" << std::endl;
+    std::cout << "\n✓ Playback complete! (" << arm.Skipped - skipped << " of "
+              << arm.Sent - sent + arm.Skipped - skipped << " joint writes unchanged, not sent)" << std::endl;
 }
 
 int main(int argc, char** argv) {
@@ -408,10 +465,10 @@ int main(int argc, char** argv) {
             generateRefinedCircle();
         }
         else if(choice == "4") {
-            playback(recorded_trajectory, "RECORDED (ORIGINAL)");
+            playback(recorded_trajectory, "RECORDED (ORIGINAL)", TRAJ_ENGINE_KNOT_US);
         }
         else if(choice == "5") {
-            playback(refined_trajectory, "REFINED (PERFECT CIRCLE)");
+            playback(refined_trajectory, "REFINED (PERFECT CIRCLE)", 0);
         }
         else if(choice == "q" || choice == "Q") {
             break;
@@ -420,10 +477,7 @@ int main(int argc, char** argv) {
     
     // Re-enable torque before exit
     std::cout << "\nRe-enabling torque..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 1);
-        usleep(50000);
-    }
+    arm.EnableTorque(1);
     
     sm_st.end();
     std::cout << "\n✓ Goodbye!" << std::endl;
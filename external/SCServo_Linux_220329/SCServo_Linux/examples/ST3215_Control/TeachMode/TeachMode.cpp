@@ -9,6 +9,8 @@
  * 
  * PLAYBACK MODE:
  *   - Enables torque and replays the recorded trajectory
+ *   - Waypoints are reached at their recorded times along a smooth spline,
+ *     slowed down only where a joint would exceed its speed/acc limit
  *   - Can loop the trajectory or play once
  * 
  * Usage:
@@ -19,6 +21,9 @@
  *   - Press ENTER to save current position as waypoint
  *   - Type 'q' and press ENTER to finish recording
  *   - Type 'p' to start playback
+ * 
+ * Files ending in .traj use the binary trajectory format (TrajectoryFile.h),
+ * anything else the text format "<count>" then "<t_ms> p1 .. p7" per line.
  */
 
 #include <iostream>
@@ -38,7 +43,18 @@ struct Waypoint {
 
 // Global trajectory storage
 std::vector<Waypoint> trajectory;
-SMS_STS sm_st;
+
+// Playback streams from a fixed-period loop that owns the bus
+ControlLoop control;
+SMS_STS& sm_st = control.Bus;
+const unsigned long PLAYBACK_PERIOD_US = 4000;  // 250Hz
+
+// Waypoints are joined by a spline that respects joint speed/acc limits
+TrajectoryEngine engine;
+
+// Servo IDs 1-7 (6 joints + gripper), in waypoint order
+u8 SERVO_IDS[7] = {1, 2, 3, 4, 5, 6, 7};
+ArmCommand arm(sm_st, SERVO_IDS, 7);
 
 // Set terminal to non-blocking mode for input
 void setNonBlocking(bool enable) {
@@ -55,19 +71,18 @@ void setNonBlocking(bool enable) {
     }
 }
 
-// Read current positions of all 7 servos
+// Read current positions of all 7 servos (single sync read transaction)
 bool readAllPositions(Waypoint& wp) {
+    ServoState state[7];
+    bool ok = (sm_st.SyncFeedBack(SERVO_IDS, 7, state) == 7);
     for(int i = 0; i < 7; i++) {
-        int id = i + 1;
-        if(sm_st.FeedBack(id) != -1) {
-            wp.positions[i] = sm_st.ReadPos(-1);
+        if(state[i].Err) {
+            std::cerr << "Failed to read servo " << (int)SERVO_IDS[i] << std::endl;
         } else {
-            std::cerr << "Failed to read servo " << id << std::endl;
-            return false;
+            wp.positions[i] = state[i].Pos;
         }
-        usleep(10000); // 10ms between reads
     }
-    return true;
+    return ok;
 }
 
 // Display current positions
@@ -79,6 +94,37 @@ void displayPositions(const Waypoint& wp) {
     std::cout << "Gripper:" << wp.positions[6] << std::endl;
 }
 
+// Save trajectory to file (binary for *.traj, text otherwise)
+bool saveTrajectory(const std::string& filename) {
+    if(filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".traj") == 0) {
+        TrajectoryWriter writer;
+        if(!writer.Open(filename.c_str(), 7, 0)) {
+            return false;
+        }
+        for(const auto& wp : trajectory) {
+            s16 pos[7];
+            for(int i = 0; i < 7; i++) pos[i] = wp.positions[i];
+            writer.Append((uint32_t)wp.timestamp_ms * 1000, pos);
+        }
+        return writer.Close();
+    }
+    
+    std::ofstream file(filename);
+    if(!file.is_open()) {
+        return false;
+    }
+    file << trajectory.size() << '\n';
+    for(const auto& wp : trajectory) {
+        file << wp.timestamp_ms;
+        for(int i = 0; i < 7; i++) {
+            file << " " << wp.positions[i];
+        }
+        file << '\n';
+    }
+    file.close();
+    return !file.fail();
+}
+
 // Record mode - manual movement and waypoint capture
 void recordMode(int interval_ms) {
     std::cout << "\n╔═══════════════════════════════════════════════════════════════╗" << std::endl;
@@ -87,10 +133,7 @@ void recordMode(int interval_ms) {
     
     // Disable torque on all servos for manual movement
     std::cout << "Disabling torque on all servos..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 0);
-        usleep(50000);
-    }
+    arm.EnableTorque(0);  // One queued pass; the arm remembers the torque state
     
     std::cout << "\n✓ Torque disabled - You can now move the arm manually!\n" << std::endl;
     std::cout << "Instructions:" << std::endl;
@@ -143,20 +186,8 @@ void recordMode(int interval_ms) {
     }
     
     // Save to file
-    if(trajectory.size() > 0) {
-        std::ofstream file("trajectory.txt");
-        if(file.is_open()) {
-            file << trajectory.size() << std::endl;
-            for(const auto& wp : trajectory) {
-                file << wp.timestamp_ms;
-                for(int i = 0; i < 7; i++) {
-                    file << " " << wp.positions[i];
-                }
-                file << std::endl;
-            }
-            file.close();
-            std::cout << "\n✓ Trajectory saved to 'trajectory.txt'" << std::endl;
-        }
+    if(trajectory.size() > 0 && saveTrajectory("trajectory.txt")) {
+        std::cout << "\n✓ Trajectory saved to 'trajectory.txt'" << std::endl;
     }
 }
 
@@ -173,9 +204,14 @@ void playbackMode(bool loop = false) {
     
     // Enable torque on all servos
     std::cout << "Enabling torque on all servos..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 1);
-        usleep(50000);
+    arm.EnableTorque(1);
+    
+    engine.SetJoints(7);
+    engine.KnotUs = 0;  // every waypoint is a knot, however close
+    s16 goal[7];
+    for(const auto& wp : trajectory) {
+        for(int j = 0; j < 7; j++) goal[j] = wp.positions[j];
+        engine.Add((uint32_t)wp.timestamp_ms * 1000, goal);
     }
     
     std::cout << "\n✓ Starting playback of " << trajectory.size() << " waypoints...\n" << std::endl;
@@ -184,34 +220,26 @@ void playbackMode(bool loop = false) {
     do {
         if(loop) std::cout << "\n--- Loop " << (++iteration) << " ---" << std::endl;
         
-        for(size_t i = 0; i < trajectory.size(); i++) {
-            const Waypoint& wp = trajectory[i];
-            
-            std::cout << "Waypoint " << (i+1) << "/" << trajectory.size() 
-                      << " (t=" << wp.timestamp_ms << "ms)" << std::endl;
-            
-            // Calculate smooth motion parameters
-            // For smoother motion: lower speed, higher acceleration value
-            int speed = 1200;   // Slower speed for smoother motion (was 1500)
-            int acc = 150;     // Higher acceleration for smoother curves (was 50)
-            
-            for(int j = 0; j < 7; j++) {
-                int id = j + 1;
-                sm_st.WritePosEx(id, wp.positions[j], speed, acc);
-            }
-            
-            displayPositions(wp);
+        // Lead in from the current pose, then stream one setpoint per period
+        engine.Plan(arm.ReadPositions() == 7 ? arm.Goal() : NULL);
+        std::cout << "Duration: " << engine.DurationUs() / 1000000.0 << "s" << std::endl;
+        
+        long long playback_start = ControlLoop::NowUs();
+        size_t shown = trajectory.size();
+        control.Start(PLAYBACK_PERIOD_US, [&](SMS_STS&, unsigned long) -> bool {
+            bool more = engine.Step(arm, ControlLoop::NowUs() - playback_start);
             
-            // Wait for next waypoint
-            if(i < trajectory.size() - 1) {
-                int delay_ms = trajectory[i+1].timestamp_ms - wp.timestamp_ms;
-                if(delay_ms > 0) {
-                    usleep(delay_ms * 1000);
-                }
-            } else {
-                sleep(1); // pause at end
+            // Announce each waypoint as the spline passes it
+            size_t i = engine.Segment();
+            if(i != shown && i < trajectory.size()) {
+                shown = i;
+                std::cout << "Waypoint " << (i+1) << "/" << trajectory.size() 
+                          << " (t=" << trajectory[i].timestamp_ms << "ms)" << std::endl;
+                displayPositions(trajectory[i]);
             }
-        }
+            return more;
+        });
+        control.Wait();
         
         if(loop) {
             std::cout << "\nPress ENTER to continue loop, or 'q' to stop: ";
@@ -225,8 +253,26 @@ void playbackMode(bool loop = false) {
     std::cout << "\n✓ Playback finished!" << std::endl;
 }
 
-// Load trajectory from file
+// Load trajectory from file (binary .traj or text)
 bool loadTrajectory(const std::string& filename) {
+    TrajectoryReader reader;
+    if(reader.Open(filename.c_str())) {
+        if(reader.Joints() != 7) {
+            return false;
+        }
+        trajectory.clear();
+        for(uint32_t i = 0; i < reader.Count(); i++) {
+            Waypoint wp;
+            s16 pos[7];
+            reader.Get(i, pos);
+            for(int j = 0; j < 7; j++) wp.positions[j] = pos[j];
+            wp.timestamp_ms = reader.TimeUs(i) / 1000;
+            trajectory.push_back(wp);
+        }
+        std::cout << "✓ Loaded " << trajectory.size() << " waypoints from '" << filename << "'" << std::endl;
+        return true;
+    }
+    
     std::ifstream file(filename);
     if(!file.is_open()) {
         return false;
@@ -297,22 +343,12 @@ int main(int argc, char** argv) {
         }
         else if(choice == "s" || choice == "S") {
             if(trajectory.size() > 0) {
-                std::cout << "Filename (default: trajectory.txt): ";
+                std::cout << "Filename (.traj for binary, default: trajectory.txt): ";
                 std::string filename;
                 std::getline(std::cin, filename);
                 if(filename.empty()) filename = "trajectory.txt";
                 
-                std::ofstream file(filename);
-                if(file.is_open()) {
-                    file << trajectory.size() << std::endl;
-                    for(const auto& wp : trajectory) {
-                        file << wp.timestamp_ms;
-                        for(int i = 0; i < 7; i++) {
-                            file << " " << wp.positions[i];
-                        }
-                        file << std::endl;
-                    }
-                    file.close();
+                if(saveTrajectory(filename)) {
                     std::cout << "✓ Saved to '" << filename << "'" << std::endl;
                 } else {
                     std::cerr << "✗ Failed to save!" << std::endl;
@@ -338,10 +374,7 @@ int main(int argc, char** argv) {
     
     // Re-enable torque before exit
     std::cout << "\nRe-enabling torque on all servos..." << std::endl;
-    for(int i = 1; i <= 7; i++) {
-        sm_st.EnableTorque(i, 1);
-        usleep(50000);
-    }
+    arm.EnableTorque(1);
     
     sm_st.end();
     std::cout << "\n✓ Exiting teach mode. Goodbye!" << std::endl;
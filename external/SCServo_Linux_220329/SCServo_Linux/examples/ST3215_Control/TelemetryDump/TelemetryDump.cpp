@@ -0,0 +1,131 @@
+/*
+ * TelemetryDump.cpp
+ * Summarise or export the telemetry logs written by ContinuousTeach
+ * (TelemetryLog.h, telemetry_<date>_<time>.tlm)
+ *
+ * The summary gives per joint the min/mean/max of temperature, voltage,
+ * current and load over the whole file, when the temperature peaked and
+ * how many rows the servo did not answer. --csv writes every row, one
+ * line per sample, for a spreadsheet or plotting script.
+ *
+ * Usage:
+ *   ./TelemetryDump file.tlm                 (summary)
+ *   ./TelemetryDump file.tlm --csv out.csv   (summary + CSV export)
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <ctime>
+#include "SCServo.h"
+
+struct FieldStats {
+    int min, max;
+    long long sum;
+    unsigned long n;
+    long long max_us;   // time of the maximum, from the first row
+};
+
+void add(FieldStats& F, int v, long long t_us) {
+    if(!F.n || v < F.min) F.min = v;
+    if(!F.n || v > F.max) {
+        F.max = v;
+        F.max_us = t_us;
+    }
+    F.sum += v;
+    F.n++;
+}
+
+int main(int argc, char** argv) {
+    if(argc != 2 && !(argc == 4 && strcmp(argv[2], "--csv") == 0)) {
+        std::cerr << "Usage: ./TelemetryDump file.tlm [--csv out.csv]" << std::endl;
+        return 1;
+    }
+    TelemetryReader reader;
+    if(!reader.Open(argv[1])) {
+        std::cerr << "Not a telemetry file: " << argv[1] << std::endl;
+        return 1;
+    }
+    const TelemHeader& H = reader.Header();
+    int joints = H.Joints;
+
+    std::ofstream csv;
+    if(argc == 4) {
+        csv.open(argv[3]);
+        if(!csv.is_open()) {
+            std::cerr << "Failed to open " << argv[3] << std::endl;
+            return 1;
+        }
+        csv << "t_s";
+        for(int j = 0; j < joints; j++) {
+            for(int f = 0; f < TELEM_FIELDS; f++) {
+                csv << ",id" << (int)H.ID[j] << "_" << TelemetryLog::FieldName(f);
+            }
+        }
+        csv << "\n";
+    }
+
+    FieldStats stats[TELEM_JOINTS_MAX][TELEM_ERR];
+    unsigned long missed[TELEM_JOINTS_MAX];
+    memset(stats, 0, sizeof(stats));
+    memset(missed, 0, sizeof(missed));
+    unsigned long rows = 0, chunks = 0;
+    long long t0 = 0, t_last = 0;
+    while(reader.Next()) {
+        chunks++;
+        for(int r = 0; r < reader.Rows(); r++) {
+            long long t = reader.TimeUs(r);
+            if(!rows) t0 = t;
+            t_last = t;
+            rows++;
+            for(int j = 0; j < joints; j++) {
+                if(reader.Value(r, j, TELEM_ERR)) {
+                    missed[j]++;
+                    continue;
+                }
+                for(int f = 0; f < TELEM_ERR; f++) add(stats[j][f], reader.Value(r, j, f), t - t0);
+            }
+            if(csv.is_open()) {
+                csv << std::fixed << std::setprecision(6) << (t - t0) / 1000000.0;
+                for(int j = 0; j < joints; j++) {
+                    for(int f = 0; f < TELEM_FIELDS; f++) csv << "," << reader.Value(r, j, f);
+                }
+                csv << "\n";
+            }
+        }
+    }
+
+    time_t start = (time_t)(H.StartUs / 1000000);
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&start));
+    std::cout << argv[1] << ":\n"
+              << "  Started:  " << when << '\n'
+              << "  Joints:   " << joints << '\n'
+              << "  Rate:     " << (H.PeriodUs ? 1000000.0 / H.PeriodUs : 0) << " Hz\n"
+              << "  Rows:     " << rows << " in " << chunks << " chunks\n"
+              << "  Duration: " << std::fixed << std::setprecision(1) << (t_last - t0) / 1000000.0 << " s" << std::endl;
+    if(!rows) return 0;
+
+    std::cout << "\n   ID  temp C min/mean/max (peak at)   volt V min/max   current max   load min..max   no reply" << std::endl;
+    for(int j = 0; j < joints; j++) {
+        const FieldStats& T = stats[j][TELEM_TEMPER];
+        const FieldStats& V = stats[j][TELEM_VOLTAGE];
+        const FieldStats& C = stats[j][TELEM_CURRENT];
+        const FieldStats& L = stats[j][TELEM_LOAD];
+        std::cout << "  " << std::setw(3) << (int)H.ID[j] << "  ";
+        if(!T.n) {
+            std::cout << "no replies" << std::setw(62) << missed[j] << std::endl;
+            continue;
+        }
+        std::cout << std::setw(3) << T.min << "/" << std::setw(5) << std::setprecision(1) << (double)T.sum / T.n
+                  << "/" << std::setw(3) << T.max << " (" << std::setw(7) << T.max_us / 1000000.0 << " s)"
+                  << "   " << std::setw(4) << V.min / 10.0 << "/" << std::setw(4) << V.max / 10.0
+                  << "   " << std::setw(11) << C.max
+                  << "   " << std::setw(5) << L.min << ".." << std::setw(5) << L.max
+                  << "   " << std::setw(8) << missed[j] << std::endl;
+    }
+    if(csv.is_open()) std::cout << "\n✓ " << rows << " rows written to " << argv[3] << std::endl;
+    return 0;
+}
@@ -18,45 +18,35 @@
 #include <unistd.h>
 #include "SCServo.h"
 
-// Joint limits
-static const int JOINT_MIN_DEG[7] = {-165, -125, -140, -140, -140, -175, -180};
-static const int JOINT_MAX_DEG[7] = { 165,  125,  140,  140,  140,  175,  180};
-
-// COORDINATE TRANSFORM: Physical robot is rotated 90° clockwise from zero
-// To align with camera/code coordinates, we add 90° to J1 commands
-static const double J1_OFFSET = 90.0;  // Compensate for clockwise physical rotation
-
-// Convert degrees to servo steps
-static int degreesToSteps(double deg){
-    double steps = 2048.0 + (deg / 360.0) * 4096.0;
-    while(steps < 0) steps += 4096.0;
-    while(steps >= 4096.0) steps -= 4096.0;
-    return (int)(steps + 0.5);
-}
-
 // Move multiple joints to target positions
-void moveJoints(SMS_STS& sm_st, const double* target_deg, int speed = 800, int acc = 50){
-    // Send commands to all joints
+void moveJoints(ArmCommand& arm, const double* target_deg, int speed = 800, int acc = 50){
+    s16 goal[7];
+    
+    // Compute step targets for all joints: the J1 offset (physical robot is
+    // rotated 90° clockwise) and the limits come from JointModel.h
     for(int i = 0; i < 7; i++){
         int id = i + 1;
-        double deg = target_deg[i];
-        
-        // Apply coordinate transform for J1 (base rotation)
-        // Physical robot is rotated 90° clockwise, so we compensate
-        if(i == 0){  // J1 (base joint)
-            deg += J1_OFFSET;
-            std::cout << "  J1 transform: " << target_deg[i] << "° → " << deg << "° (offset: " << J1_OFFSET << "°)" << std::endl;
+        goal[i] = JointSteps(i, target_deg[i]);
+        if(JOINT_OFFSET_DEG[i] != 0){
+            std::cout << "  J" << id << " transform: " << target_deg[i] << "° → " << ServoDeg(goal[i]) << "° (offset: " << JOINT_OFFSET_DEG[i] << "°)" << std::endl;
         }
-        
-        // Clamp to limits
-        if(deg < JOINT_MIN_DEG[i]) deg = JOINT_MIN_DEG[i];
-        if(deg > JOINT_MAX_DEG[i]) deg = JOINT_MAX_DEG[i];
-        
-        int steps = degreesToSteps(deg);
-        sm_st.EnableTorque(id, 1);
-        sm_st.WritePosEx(id, steps, speed, acc);
-        usleep(50000); // 50ms between commands
     }
+    
+    // Only the first call touches the bus: the arm remembers torque is on
+    arm.EnableTorque(1);
+    
+    // Send all joints in one sync write so they start and arrive together
+    arm.MoveTo(goal, speed, acc);
+}
+
+// Wait until the arm has stopped at the goal, then hold it there so the
+// camera view can be checked
+void settleAndHold(ArmCommand& arm, int hold_s){
+    int ms = arm.WaitMotionComplete(10, 6000);
+    if(ms < 0) std::cout << "⚠️  Arm did not settle within 6 s" << std::endl;
+    else std::cout << "✓ Arrived after " << ms << " ms" << std::endl;
+    std::cout << "⏱️  Holding " << hold_s << " seconds...\n" << std::endl;
+    sleep(hold_s);
 }
 
 // Print current movement
@@ -84,7 +74,7 @@ int main(int argc, char** argv){
     std::cout << "  5. HOME - Return" << std::endl;
     std::cout << "\n🔄 COORDINATE TRANSFORM ACTIVE:" << std::endl;
     std::cout << "  Physical robot rotated 90° clockwise from zero" << std::endl;
-    std::cout << "  J1 offset: " << J1_OFFSET << "° (compensates for physical rotation)" << std::endl;
+    std::cout << "  J1 offset: " << JOINT_OFFSET_DEG[0] << "° (compensates for physical rotation)" << std::endl;
     std::cout << "\n⚠️  SAFETY: Ensure workspace is clear!" << std::endl;
     std::cout << "\nPort: " << port << std::endl;
     std::cout << std::string(70, '=') << std::endl;
@@ -101,6 +91,10 @@ int main(int argc, char** argv){
     
     std::cout << "\n✅ Connected to robot\n" << std::endl;
     
+    u8 ids[7] = {1, 2, 3, 4, 5, 6, 7};
+    ArmCommand arm(sm_st, ids, 7);
+    arm.ReadPositions();
+    
     // Define positions for each test
     // Format: {J1, J2, J3, J4, J5, J6, Gripper}
     
@@ -109,7 +103,7 @@ int main(int argc, char** argv){
     double left[7]  = {-45, 35, 35, 0, 0, 0, 0}; // J1 rotate left (negative after transform)
     double right[7] = {45, 35, 35, 0, 0, 0, 0}; // J1 rotate right (positive after transform)
     
-    int wait_time = 4; // seconds between movements
+    int hold_time = 2; // seconds to watch each position once reached
     
     // ========================================================================
     // STEP 1: HOME
@@ -120,9 +114,8 @@ int main(int argc, char** argv){
         "Watch: Robot should return to neutral position"
     );
     
-    moveJoints(sm_st, home);
-    std::cout << "⏱️  Waiting " << wait_time << " seconds...\n" << std::endl;
-    sleep(wait_time);
+    moveJoints(arm, home);
+    settleAndHold(arm, hold_time);
     
     // ========================================================================
     // STEP 2: FRONT
@@ -133,9 +126,8 @@ int main(int argc, char** argv){
         "Watch camera: Arm should extend FORWARD/AWAY from base"
     );
     
-    moveJoints(sm_st, front);
-    std::cout << "⏱️  Waiting " << wait_time << " seconds...\n" << std::endl;
-    sleep(wait_time);
+    moveJoints(arm, front);
+    settleAndHold(arm, hold_time);
     
     // ========================================================================
     // STEP 3: LEFT
@@ -146,9 +138,8 @@ int main(int argc, char** argv){
         "Watch camera: Arm should swing to the LEFT"
     );
     
-    moveJoints(sm_st, left);
-    std::cout << "⏱️  Waiting " << wait_time << " seconds...\n" << std::endl;
-    sleep(wait_time);
+    moveJoints(arm, left);
+    settleAndHold(arm, hold_time);
     
     // ========================================================================
     // STEP 4: RIGHT
@@ -159,9 +150,8 @@ int main(int argc, char** argv){
         "Watch camera: Arm should swing to the RIGHT"
     );
     
-    moveJoints(sm_st, right);
-    std::cout << "⏱️  Waiting " << wait_time << " seconds...\n" << std::endl;
-    sleep(wait_time);
+    moveJoints(arm, right);
+    settleAndHold(arm, hold_time);
     
     // ========================================================================
     // STEP 5: RETURN HOME
@@ -172,9 +162,8 @@ int main(int argc, char** argv){
         "Watch: Robot returns to start position"
     );
     
-    moveJoints(sm_st, home);
-    std::cout << "⏱️  Waiting " << wait_time << " seconds...\n" << std::endl;
-    sleep(wait_time);
+    moveJoints(arm, home);
+    settleAndHold(arm, hold_time);
     
     // Cleanup
     sm_st.end();
@@ -0,0 +1,221 @@
+/*
+ * TrajectoryConvert.cpp
+ * Convert recorded trajectories between the text formats written by
+ * ContinuousTeach / TeachMode / SwirlTeach and the binary .traj format
+ * 
+ * Text files: first line is the sample count, then one sample per line,
+ * "<time> p1 p2 ... p7". ContinuousTeach writes microseconds; TeachMode
+ * and SwirlTeach write milliseconds (pass --ms).
+ * 
+ * Usage:
+ *   ./TrajectoryConvert input.txt output.traj [--ms] [--raw] [--simplify N]
+ *   ./TrajectoryConvert input.traj output.txt [--ms] [--simplify N]
+ *   ./TrajectoryConvert input.traj output.traj [--raw] [--simplify N]
+ *   ./TrajectoryConvert input.traj              (print header info)
+ * 
+ *   --ms          text timestamps are milliseconds (default: microseconds)
+ *   --raw         absolute int16 records instead of delta encoding
+ *   --simplify N  keep only the keyframes that replay within N steps of
+ *                 every sample (TrajectorySimplify.h)
+ * 
+ * A written .traj is read back and compared sample by sample; a mismatch
+ * fails the conversion.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include "SCServo.h"
+
+const int NUM_JOINTS = 7;
+
+int printInfo(const char* path) {
+    TrajectoryReader reader;
+    if(!reader.Open(path)) {
+        std::cerr << "Not a trajectory file: " << path << std::endl;
+        return 1;
+    }
+    std::cout << path << ":\n"
+              << "  Joints:   " << reader.Joints() << '\n'
+              << "  Samples:  " << reader.Count() << '\n'
+              << "  Rate:     " << reader.RateHz() << " Hz\n"
+              << "  Duration: " << reader.DurationUs() / 1000000.0 << " s\n"
+              << "  Encoding: " << (reader.Delta() ? "delta" : "absolute") << std::endl;
+    return 0;
+}
+
+// Reduce times/positions to their keyframes in place
+void simplify(std::vector<uint32_t>& times, std::vector<s16>& positions, int tol) {
+    if(times.empty()) return;
+    TrajectorySimplify simplifier;
+    simplifier.Tolerance = (u16)tol;
+    std::vector<size_t> keep;
+    simplifier.Run(&times[0], &positions[0], times.size(), NUM_JOINTS, keep);
+    std::cout << "Keyframes: " << times.size() << " samples -> " << keep.size()
+              << ", " << simplifier.Holds() << " holds, max deviation "
+              << simplifier.MaxError() << " steps" << std::endl;
+    for(size_t k = 0; k < keep.size(); k++) {
+        times[k] = times[keep[k]];
+        for(int j = 0; j < NUM_JOINTS; j++) positions[k * NUM_JOINTS + j] = positions[keep[k] * NUM_JOINTS + j];
+    }
+    times.resize(keep.size());
+    positions.resize(keep.size() * NUM_JOINTS);
+}
+
+// Read the written file back: every sample must decode to what went in,
+// delta records included (negative deltas need a signed byte on every host)
+int verifyBinary(const char* path, const std::vector<uint32_t>& times, const std::vector<s16>& positions) {
+    TrajectoryReader reader;
+    if(!reader.Open(path) || reader.Count() != times.size()) {
+        std::cerr << "Verify failed: cannot read back " << path << std::endl;
+        return 1;
+    }
+    s16 pos[NUM_JOINTS];
+    for(uint32_t i = 0; i < reader.Count(); i++) {
+        reader.Get(i, pos);
+        if(reader.TimeUs(i) != times[i] || memcmp(pos, &positions[i * NUM_JOINTS], sizeof(pos)) != 0) {
+            std::cerr << "Verify failed: sample " << i << " of " << path << " reads back different" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int writeBinary(const char* out, const std::vector<uint32_t>& times, const std::vector<s16>& positions, bool delta, bool keyframes) {
+    // Keyframes are irregular, the header says so with rate 0
+    uint32_t rate = 0;
+    if(!keyframes && times.size() > 1 && times.back() > times.front()) {
+        rate = (uint32_t)((times.size() - 1) * 1000000ULL / (times.back() - times.front()));
+    }
+    TrajectoryWriter writer;
+    if(!writer.Open(out, NUM_JOINTS, rate, delta)) {
+        std::cerr << "Failed to create " << out << std::endl;
+        return 1;
+    }
+    for(size_t i = 0; i < times.size(); i++) {
+        writer.Append(times[i], &positions[i * NUM_JOINTS]);
+    }
+    if(!writer.Close()) {
+        std::cerr << "Failed to write " << out << std::endl;
+        return 1;
+    }
+    return verifyBinary(out, times, positions);
+}
+
+int textToBinary(const char* in, const char* out, bool ms, bool delta, int tol) {
+    std::ifstream file(in);
+    if(!file.is_open()) {
+        std::cerr << "Failed to open " << in << std::endl;
+        return 1;
+    }
+    long count;
+    if(!(file >> count) || count < 0) {
+        std::cerr << "Bad sample count in " << in << std::endl;
+        return 1;
+    }
+    
+    // Read everything first so the header can carry the real sample rate
+    std::vector<uint32_t> times;
+    std::vector<s16> positions;
+    times.reserve(count);
+    positions.reserve(count * NUM_JOINTS);
+    for(long i = 0; i < count; i++) {
+        long long t;
+        int p[NUM_JOINTS];
+        if(!(file >> t)) break;
+        for(int j = 0; j < NUM_JOINTS; j++) file >> p[j];
+        if(!file) break;
+        times.push_back((uint32_t)(ms ? t * 1000 : t));
+        for(int j = 0; j < NUM_JOINTS; j++) positions.push_back((s16)p[j]);
+    }
+    if((long)times.size() != count) {
+        std::cerr << "Warning: header says " << count << " samples, read " << times.size() << std::endl;
+    }
+    
+    if(tol) simplify(times, positions, tol);
+    if(writeBinary(out, times, positions, delta, tol != 0)) return 1;
+    std::cout << "✓ " << times.size() << " samples: " << in << " -> " << out << std::endl;
+    return printInfo(out);
+}
+
+// .traj input: text output, or .traj again (re-encode / simplify)
+int fromBinary(const char* in, const char* out, bool ms, bool delta, int tol) {
+    TrajectoryReader reader;
+    if(!reader.Open(in)) {
+        std::cerr << "Not a trajectory file: " << in << std::endl;
+        return 1;
+    }
+    if(reader.Joints() != NUM_JOINTS) {
+        std::cerr << "Expected " << NUM_JOINTS << " joints, file has " << reader.Joints() << std::endl;
+        return 1;
+    }
+    std::vector<uint32_t> times(reader.Count());
+    std::vector<s16> positions(reader.Count() * NUM_JOINTS);
+    for(uint32_t i = 0; i < reader.Count(); i++) {
+        times[i] = reader.TimeUs(i);
+        reader.Get(i, &positions[i * NUM_JOINTS]);
+    }
+    // Keyframe files stay marked as irregular when re-encoded
+    bool keyframes = tol != 0 || (reader.RateHz() == 0 && reader.Count() > 1);
+    reader.Close();
+    if(tol) simplify(times, positions, tol);
+    
+    size_t len = strlen(out);
+    if(len >= 5 && strcmp(out + len - 5, ".traj") == 0) {
+        if(writeBinary(out, times, positions, delta, keyframes)) return 1;
+        std::cout << "✓ " << times.size() << " samples: " << in << " -> " << out << std::endl;
+        return printInfo(out);
+    }
+    
+    std::ofstream file(out);
+    if(!file.is_open()) {
+        std::cerr << "Failed to create " << out << std::endl;
+        return 1;
+    }
+    file << times.size() << '\n';
+    for(size_t i = 0; i < times.size(); i++) {
+        file << (ms ? times[i] / 1000 : times[i]);
+        for(int j = 0; j < NUM_JOINTS; j++) file << ' ' << positions[i * NUM_JOINTS + j];
+        file << '\n';
+    }
+    file.close();
+    if(file.fail()) {
+        std::cerr << "Failed to write " << out << std::endl;
+        return 1;
+    }
+    std::cout << "✓ " << times.size() << " samples: " << in << " -> " << out << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> files;
+    bool ms = false;
+    bool delta = true;
+    int tol = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--ms") == 0) ms = true;
+        else if(strcmp(argv[i], "--raw") == 0) delta = false;
+        else if(strcmp(argv[i], "--simplify") == 0 && i + 1 < argc) tol = atoi(argv[++i]);
+        else files.push_back(argv[i]);
+    }
+    
+    if(files.size() == 1) {
+        return printInfo(files[0]);
+    }
+    if(files.size() != 2 || tol < 0) {
+        std::cerr << "Usage: " << argv[0] << " input output [--ms] [--raw] [--simplify steps]" << std::endl;
+        std::cerr << "       " << argv[0] << " file.traj" << std::endl;
+        return 1;
+    }
+    
+    // Direction follows the input: binary if it parses as a .traj file
+    TrajectoryReader probe;
+    if(probe.Open(files[0])) {
+        probe.Close();
+        return fromBinary(files[0], files[1], ms, delta, tol);
+    }
+    return textToBinary(files[0], files[1], ms, delta, tol);
+}
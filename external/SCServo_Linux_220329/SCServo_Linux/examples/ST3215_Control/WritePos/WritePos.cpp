@@ -43,17 +43,26 @@ int main(int argc, char **argv)
     std::cout << "Press Ctrl+C to stop" << std::endl << std::endl;
     
     // Main control loop - oscillate between two positions
+    u8 ids[1] = {(u8)servo_id};
     while(1){
         // Move to position 4095 (max position)
         // Parameters: ID, Position (0-4095), Speed (0-2400 steps/sec), Acceleration (50*100 steps/sec²)
-        sm_st.WritePosEx(servo_id, 4095, 2400, 50);
+        s16 goal = 4095;
+        sm_st.WritePosEx(servo_id, goal, 2400, 50);
         std::cout << "Position: 4095 (Max)" << std::endl;
-        usleep(2187 * 1000);  // Wait for movement to complete: [(4095-0)/2400]*1000 + [2400/(50*100)]*1000
+        // Wait for movement to complete: polls the MOVING flag and position,
+        // returns as soon as the servo stops within 10 steps of the goal
+        int ms = sm_st.WaitMotionComplete(ids, 1, &goal, 10, 5000);
+        if(ms < 0) std::cout << "  Timed out before reaching the goal" << std::endl;
+        else std::cout << "  Reached in " << ms << " ms" << std::endl;
         
         // Move to position 0 (min position)
-        sm_st.WritePosEx(servo_id, 0, 2400, 50);
+        goal = 0;
+        sm_st.WritePosEx(servo_id, goal, 2400, 50);
         std::cout << "Position: 0 (Min)" << std::endl;
-        usleep(2187 * 1000);  // Wait for movement to complete
+        ms = sm_st.WaitMotionComplete(ids, 1, &goal, 10, 5000);
+        if(ms < 0) std::cout << "  Timed out before reaching the goal" << std::endl;
+        else std::cout << "  Reached in " << ms << " ms" << std::endl;
     }
     
     sm_st.end();
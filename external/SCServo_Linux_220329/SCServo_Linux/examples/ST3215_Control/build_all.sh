@@ -1,6 +1,11 @@
 #!/bin/bash
 # Build script for ST3215 Control Examples
-# This script builds all three examples: Ping, WritePos, and FeedBack
+# Configures this directory once: the SCServo library is built a single
+# time and every example links against it.
+#
+#   ./build_all.sh                         # Release (-O3)
+#   BUILD_TYPE=Profile ./build_all.sh      # -O3 with symbols and frame pointers
+#   ./build_all.sh -DSCSERVO_LTO=ON -DSCSERVO_NATIVE=ON   # extra options go to cmake
 
 set -e  # Exit on error
 
@@ -13,85 +18,15 @@ echo ""
 SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
 cd "$SCRIPT_DIR"
 
-# First, ensure the main library is built
-echo "Step 1: Building SCServo library..."
-LIB_DIR="$SCRIPT_DIR/../.."
-cd "$LIB_DIR"
-echo "Library directory: $(pwd)"
-if [ ! -f "libSCServo.a" ]; then
-    echo "Library not found. Building..."
-    mkdir -p build
-    cd build
-    cmake ..
-    make
-    # Copy library to root for easier linking
-    cp libSCServo.a ..
-    cd ..
-    echo "Library built successfully!"
-else
-    echo "Library already exists."
-fi
+BUILD_TYPE="${BUILD_TYPE:-Release}"
+JOBS="$(nproc 2>/dev/null || echo 2)"
 
-# Return to ST3215_Control directory
-cd "$SCRIPT_DIR"
-
-# Create main build directory
-mkdir -p build
-cd build
-
-echo ""
-echo "Step 2: Building Ping example..."
-mkdir -p Ping
-cd Ping
-cmake ../../Ping
-make
-cd ..
-echo "✓ Ping built successfully!"
-
-echo ""
-echo "Step 3: Building WritePos example..."
-mkdir -p WritePos
-cd WritePos
-cmake ../../WritePos
-make
-cd ..
-echo "✓ WritePos built successfully!"
-
-echo ""
-echo "Step 4: Building FeedBack example..."
-mkdir -p FeedBack
-cd FeedBack
-cmake ../../FeedBack
-make
-cd ..
-echo "✓ FeedBack built successfully!"
-
-echo ""
-echo "Step 5: Building HomeAll example..."
-mkdir -p HomeAll
-cd HomeAll
-cmake ../../HomeAll
-make
-cd ..
-echo "✓ HomeAll built successfully!"
-
-echo ""
-echo "Step 6: Building TeachMode..."
-mkdir -p TeachMode
-cd TeachMode
-cmake ../../TeachMode
-make
-cd ..
-echo "✓ TeachMode built successfully!"
+echo "Step 1: Configuring ($BUILD_TYPE)..."
+cmake -S . -B build -DCMAKE_BUILD_TYPE="$BUILD_TYPE" "$@"
 
 echo ""
-echo "Step 7: Building ContinuousTeach..."
-mkdir -p ContinuousTeach
-cd ContinuousTeach
-cmake ../../ContinuousTeach
-make
-cd ..
-echo "✓ ContinuousTeach built successfully!"
+echo "Step 2: Building SCServo library and all examples..."
+cmake --build build -j "$JOBS"
 
 echo ""
 echo "======================================"
@@ -105,6 +40,19 @@ echo "  - build/FeedBack/FeedBack"
 echo "  - build/HomeAll/HomeAll"
 echo "  - build/TeachMode/TeachMode           (waypoint-based teaching)"
 echo "  - build/ContinuousTeach/ContinuousTeach (continuous recording)"
+echo "  - build/TrajectoryConvert/TrajectoryConvert (text <-> .traj files)"
+echo "  - build/BusDaemon/BusDaemon           (shared bus for several programs)"
+echo "  - build/LeaderFollower/LeaderFollower (native teleoperation)"
+echo "  - build/ServoBench/ServoBench         (bus transaction benchmark)"
+echo "  - build/BusBaud/BusBaud               (switch the bus baud rate)"
+echo "  - build/ScanBus/ScanBus               (find every servo, ID, model and baud rate)"
+echo "  - build/TelemetryDump/TelemetryDump   (summary / CSV of telemetry logs)"
+echo "  - build/ManualControl/ManualControl   (interactive joint control)"
+echo "  - build/SwirlTeach/SwirlTeach"
+echo "  - build/TestAlignment/TestAlignment"
+echo "  - build/ReachObject/ReachObject"
+echo "  - build/CalibrateCamera/CalibrateCamera"
+echo "  - build/SCServo/libSCServo.a"
 echo ""
 echo "To run examples:"
 echo "  ./build/Ping/Ping"
@@ -14,20 +14,31 @@ echo ""
 FOUND=0
 FOUND_IDS=()
 
-for ID in {1..7}; do
-    echo -n "Testing ID $ID... "
-    
-    # Run ping and capture output
-    OUTPUT=$(./build/Ping/Ping "$PORT" "$ID" 2>&1)
-    
-    if echo "$OUTPUT" | grep -q "SUCCESS"; then
-        echo "✓ FOUND!"
+if [ -x ./build/ScanBus/ScanBus ]; then
+    # One broadcast ping, then 1-7 with a short calibrated timeout (every baud rate)
+    ./build/ScanBus/ScanBus --ids 1-7 "$PORT" > /tmp/scan_servo_ids.$$ 2>&1
+    while read -r P BAUD ID MODEL; do
+        echo "ID $ID: ✓ FOUND at $BAUD baud (model $MODEL)"
         FOUND=$((FOUND + 1))
         FOUND_IDS+=($ID)
-    else
-        echo "✗ No response"
-    fi
-done
+    done < <(sed -n '/^PORT /,/^$/p' /tmp/scan_servo_ids.$$ | sed '1d;/^$/d')
+    rm -f /tmp/scan_servo_ids.$$
+else
+    for ID in {1..7}; do
+        echo -n "Testing ID $ID... "
+        
+        # Run ping and capture output
+        OUTPUT=$(./build/Ping/Ping "$PORT" "$ID" 2>&1)
+        
+        if echo "$OUTPUT" | grep -q "SUCCESS"; then
+            echo "✓ FOUND!"
+            FOUND=$((FOUND + 1))
+            FOUND_IDS+=($ID)
+        else
+            echo "✗ No response"
+        fi
+    done
+fi
 
 echo ""
 echo "═══════════════════════════════════════════════════════════"
@@ -39,7 +50,7 @@ if [ $FOUND -eq 0 ]; then
     echo "Troubleshooting:"
     echo "  1. Check servo power (12V DC connected and ON)"
     echo "  2. Check USB cable connection"
-    echo "  3. Try different baud rates (servo might be configured differently)"
+    echo "  3. Scan every ID and baud rate: ./build/ScanBus/ScanBus $PORT"
     echo "  4. Check if device is at different port:"
     echo "     ls -l /dev/ttyACM* /dev/ttyUSB*"
     echo ""
@@ -0,0 +1,594 @@
+/*
+ * scservo_module.cpp
+ * Python module "scservo": SMS_STS bindings (CPython API, -DSCSERVO_PYTHON=ON)
+ *
+ *   import numpy as np, scservo
+ *   bus = scservo.Bus()
+ *   bus.begin(1000000, "/dev/ttyACM0")
+ *   ids = np.arange(1, 8, dtype=np.uint8)
+ *   n, state = bus.SyncFeedBack(ids)               # state["Pos"], state["Load"], ...
+ *   bus.SyncWritePosEx(ids, state["Pos"], 1500, 50)
+ *
+ * Every bus call drops the GIL while it is on the wire, so other Python
+ * threads keep running, and takes the Bus's own mutex, so calls from
+ * several threads do not interleave on the port. Arrays go through the
+ * buffer protocol and are not copied: SyncFeedBack() decodes straight
+ * into a NumPy array of ServoState records (out= reuses one, any writable
+ * buffer of whole records works), the sync writes read the caller's
+ * arrays in place when they are already C-contiguous uint8 IDs, int16
+ * positions, uint16 speeds and uint8 accelerations (any other sequence of
+ * integers is converted once). A scalar speed/acc applies to every servo.
+ * NumPy is only needed at run time: without it ServoState is None and
+ * SyncFeedBack() without out= returns a bytearray of records.
+ * Date: 2026.10.14
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stddef.h>
+#include <mutex>
+#include <string>
+#include "SCServo.h"
+
+static PyObject *npZeros = NULL;//numpy.zeros, NULL without NumPy
+static PyObject *stateDtype = NULL;//numpy dtype of ServoState
+
+struct PyBus{
+	PyObject_HEAD
+	SMS_STS *Bus;
+	std::mutex *Lock;
+};
+
+//GIL released for the lifetime of the object
+struct NoGil{
+	PyThreadState *ts;
+	NoGil() : ts(PyEval_SaveThread()) {}
+	~NoGil(){ PyEval_RestoreThread(ts); }
+};
+
+//run f on the bus without the GIL, one call at a time
+template<class F> static auto onBus(PyBus *B, F f) -> decltype(f())
+{
+	NoGil nogil;
+	std::lock_guard<std::mutex> lock(*B->Lock);
+	return f();
+}
+
+//integer array argument: the caller's buffer in place when it already has
+//T's layout, otherwise a copy of a scalar or a sequence of integers
+template<class T> class Values
+{
+public:
+	Values() : held(false), data(NULL), n(0) {}
+	~Values(){ if(held) PyBuffer_Release(&view); }
+	bool Parse(PyObject *Obj, long Min, long Max, char Format, const char *Name);
+	const T *Data() const { return data; }
+	Py_ssize_t Size() const { return n; }
+private:
+	Py_buffer view;
+	bool held;
+	const T *data;
+	Py_ssize_t n;
+	T copy[SMS_STS_SYNC_MAX];
+};
+
+template<class T> bool Values<T>::Parse(PyObject *Obj, long Min, long Max, char Format, const char *Name)
+{
+	if(PyObject_CheckBuffer(Obj) && PyObject_GetBuffer(Obj, &view, PyBUF_C_CONTIGUOUS|PyBUF_FORMAT)==0){
+		const char *f = view.format ? view.format : "B";
+		size_t fl = strlen(f);
+		bool native = fl==1 || (fl==2 && (f[0]=='@' || f[0]=='=' || f[0]=='<'));
+		if(native && f[fl-1]==Format && view.itemsize==(Py_ssize_t)sizeof(T)){
+			held = true;
+			data = (const T*)view.buf;
+			n = view.len/view.itemsize;
+			return true;
+		}
+		PyBuffer_Release(&view);
+	}
+	PyErr_Clear();
+	PyObject *seq = NULL;
+	if(PyIndex_Check(Obj)){
+		seq = PyTuple_Pack(1, Obj);
+	}else{
+		seq = PySequence_Fast(Obj, "");
+	}
+	if(!seq){
+		PyErr_Format(PyExc_TypeError, "%s: integer or sequence of integers", Name);
+		return false;
+	}
+	n = PySequence_Fast_GET_SIZE(seq);
+	if(n>SMS_STS_SYNC_MAX){
+		Py_DECREF(seq);
+		PyErr_Format(PyExc_ValueError, "%s: at most %d values", Name, SMS_STS_SYNC_MAX);
+		return false;
+	}
+	for(Py_ssize_t i=0; i<n; i++){
+		long v = PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+		if(v==-1 && PyErr_Occurred()){
+			Py_DECREF(seq);
+			PyErr_Format(PyExc_TypeError, "%s: integer or sequence of integers", Name);
+			return false;
+		}
+		if(v<Min || v>Max){
+			Py_DECREF(seq);
+			PyErr_Format(PyExc_ValueError, "%s: %ld out of range %ld..%ld", Name, v, Min, Max);
+			return false;
+		}
+		copy[i] = (T)v;
+	}
+	Py_DECREF(seq);
+	data = copy;
+	return true;
+}
+
+static bool syncCount(const Values<u8> &ID, u8 &IDN)
+{
+	if(ID.Size()<1 || ID.Size()>SMS_STS_SYNC_MAX){
+		PyErr_Format(PyExc_ValueError, "1..%d servo IDs", SMS_STS_SYNC_MAX);
+		return false;
+	}
+	IDN = (u8)ID.Size();
+	return true;
+}
+
+//one value per servo, or one for all (copied into Buf)
+template<class T> static const T *perServo(const Values<T> &V, u8 IDN, T Buf[], const char *Name)
+{
+	if(V.Size()==IDN){
+		return V.Data();
+	}
+	if(V.Size()!=1){
+		PyErr_Format(PyExc_ValueError, "%s: one value per servo, or one for all", Name);
+		return NULL;
+	}
+	for(u8 i=0; i<IDN; i++){
+		Buf[i] = V.Data()[0];
+	}
+	return Buf;
+}
+
+static PyObject *Bus_new(PyTypeObject *Type, PyObject *, PyObject *)
+{
+	PyBus *self = (PyBus*)Type->tp_alloc(Type, 0);
+	if(!self){
+		return NULL;
+	}
+	self->Bus = new SMS_STS();
+	self->Lock = new std::mutex();
+	return (PyObject*)self;
+}
+
+static void Bus_dealloc(PyBus *self)
+{
+	PyTypeObject *type = Py_TYPE(self);
+	delete self->Bus;
+	delete self->Lock;
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);//heap type
+}
+
+static PyObject *Bus_begin(PyBus *self, PyObject *args, PyObject *kw)
+{
+	static const char *kwl[] = {"baudRate", "port", NULL};
+	int baudRate;
+	const char *port;
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "is", (char**)kwl, &baudRate, &port)){
+		return NULL;
+	}
+	std::string p(port);
+	bool ok = onBus(self, [&](){ return self->Bus->begin(baudRate, p.c_str()); });
+	return PyBool_FromLong(ok);
+}
+
+static PyObject *Bus_end(PyBus *self, PyObject *)
+{
+	onBus(self, [&](){ self->Bus->end(); });
+	Py_RETURN_NONE;
+}
+
+static PyObject *Bus_Ping(PyBus *self, PyObject *args)
+{
+	unsigned char ID;
+	if(!PyArg_ParseTuple(args, "b", &ID)){
+		return NULL;
+	}
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->Ping(ID); }));
+}
+
+static PyObject *Bus_Read(PyBus *self, PyObject *args)
+{
+	unsigned char ID, MemAddr, nLen;
+	if(!PyArg_ParseTuple(args, "bbb", &ID, &MemAddr, &nLen)){
+		return NULL;
+	}
+	u8 buf[256];
+	int n = onBus(self, [&](){ return self->Bus->Read(ID, MemAddr, buf, nLen); });
+	if(n!=nLen){
+		Py_RETURN_NONE;
+	}
+	return PyBytes_FromStringAndSize((const char*)buf, n);
+}
+
+static PyObject *Bus_Write(PyBus *self, PyObject *args, PyObject *kw)
+{
+	static const char *kwl[] = {"ID", "MemAddr", "data", NULL};
+	unsigned char ID, MemAddr;
+	Py_buffer data;
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "bby*", (char**)kwl, &ID, &MemAddr, &data)){
+		return NULL;
+	}
+	if(data.len>255){
+		PyBuffer_Release(&data);
+		PyErr_SetString(PyExc_ValueError, "data: at most 255 bytes");
+		return NULL;
+	}
+	u8 buf[255];
+	u8 n = (u8)data.len;
+	memcpy(buf, data.buf, n);
+	PyBuffer_Release(&data);
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->genWrite(ID, MemAddr, buf, n); }));
+}
+
+static PyObject *Bus_WritePosEx(PyBus *self, PyObject *args, PyObject *kw)
+{
+	static const char *kwl[] = {"ID", "Position", "Speed", "ACC", NULL};
+	unsigned char ID, ACC = 0;
+	short Position;
+	unsigned short Speed;
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "bhH|b", (char**)kwl, &ID, &Position, &Speed, &ACC)){
+		return NULL;
+	}
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->WritePosEx(ID, Position, Speed, ACC); }));
+}
+
+static PyObject *Bus_WriteSpe(PyBus *self, PyObject *args, PyObject *kw)
+{
+	static const char *kwl[] = {"ID", "Speed", "ACC", NULL};
+	unsigned char ID, ACC = 0;
+	short Speed;
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "bh|b", (char**)kwl, &ID, &Speed, &ACC)){
+		return NULL;
+	}
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->WriteSpe(ID, Speed, ACC); }));
+}
+
+static PyObject *Bus_WheelMode(PyBus *self, PyObject *args)
+{
+	unsigned char ID;
+	if(!PyArg_ParseTuple(args, "b", &ID)){
+		return NULL;
+	}
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->WheelMode(ID); }));
+}
+
+static PyObject *Bus_EnableTorque(PyBus *self, PyObject *args)
+{
+	unsigned char ID, Enable;
+	if(!PyArg_ParseTuple(args, "bb", &ID, &Enable)){
+		return NULL;
+	}
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->EnableTorque(ID, Enable); }));
+}
+
+static PyObject *Bus_SyncWritePosEx(PyBus *self, PyObject *args, PyObject *kw)
+{
+	static const char *kwl[] = {"ID", "Position", "Speed", "ACC", NULL};
+	PyObject *oID, *oPos, *oSpeed = NULL, *oACC = NULL;
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "OO|OO", (char**)kwl, &oID, &oPos, &oSpeed, &oACC)){
+		return NULL;
+	}
+	Values<u8> ID;
+	Values<s16> Position;
+	Values<u16> Speed;
+	Values<u8> ACC;
+	PyObject *zero = PyLong_FromLong(0);
+	bool ok = ID.Parse(oID, 0, 253, 'B', "ID")
+		&& Position.Parse(oPos, -32767, 32767, 'h', "Position")
+		&& Speed.Parse(oSpeed ? oSpeed : zero, 0, 65535, 'H', "Speed")
+		&& ACC.Parse(oACC ? oACC : zero, 0, 255, 'B', "ACC");
+	Py_DECREF(zero);
+	u8 n;
+	if(!ok || !syncCount(ID, n)){
+		return NULL;
+	}
+	if(Position.Size()!=n){
+		PyErr_SetString(PyExc_ValueError, "Position: one value per servo");
+		return NULL;
+	}
+	u16 speedBuf[SMS_STS_SYNC_MAX];
+	u8 accBuf[SMS_STS_SYNC_MAX];
+	const u16 *speed = perServo(Speed, n, speedBuf, "Speed");
+	const u8 *acc = speed ? perServo(ACC, n, accBuf, "ACC") : NULL;
+	if(!acc){
+		return NULL;
+	}
+	onBus(self, [&](){ self->Bus->SyncWritePosEx((u8*)ID.Data(), n, (s16*)Position.Data(), (u16*)speed, (u8*)acc); });
+	Py_RETURN_NONE;
+}
+
+static PyObject *Bus_SyncFeedBack(PyBus *self, PyObject *args, PyObject *kw)
+{
+	static const char *kwl[] = {"ID", "out", NULL};
+	PyObject *oID, *out = Py_None;
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "O|O", (char**)kwl, &oID, &out)){
+		return NULL;
+	}
+	Values<u8> ID;
+	u8 n;
+	if(!ID.Parse(oID, 0, 253, 'B', "ID") || !syncCount(ID, n)){
+		return NULL;
+	}
+	if(out==Py_None){
+		if(npZeros){
+			out = PyObject_CallFunction(npZeros, "iO", (int)n, stateDtype);
+		}else{
+			out = PyByteArray_FromStringAndSize(NULL, (Py_ssize_t)n*sizeof(ServoState));
+		}
+		if(!out){
+			return NULL;
+		}
+	}else{
+		Py_INCREF(out);
+	}
+	Py_buffer view;
+	if(PyObject_GetBuffer(out, &view, PyBUF_WRITABLE|PyBUF_C_CONTIGUOUS)!=0){
+		Py_DECREF(out);
+		PyErr_SetString(PyExc_TypeError, "out: writable C-contiguous array of scservo.ServoState");
+		return NULL;
+	}
+	if((view.itemsize!=1 && view.itemsize!=(Py_ssize_t)sizeof(ServoState)) || view.len<(Py_ssize_t)(n*sizeof(ServoState))){
+		PyBuffer_Release(&view);
+		Py_DECREF(out);
+		PyErr_SetString(PyExc_ValueError, "out: one ServoState record per servo");
+		return NULL;
+	}
+	ServoState *p = (ServoState*)view.buf;
+	int answered = onBus(self, [&](){ return self->Bus->SyncFeedBack((u8*)ID.Data(), n, p); });
+	PyBuffer_Release(&view);
+	return Py_BuildValue("(iN)", answered, out);
+}
+
+static PyObject *Bus_WaitMotionComplete(PyBus *self, PyObject *args, PyObject *kw)
+{
+	static const char *kwl[] = {"ID", "Goal", "Tolerance", "TimeOut", NULL};
+	PyObject *oID, *oGoal;
+	unsigned short Tolerance = 0;
+	unsigned int TimeOut = 0;
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "OOHI", (char**)kwl, &oID, &oGoal, &Tolerance, &TimeOut)){
+		return NULL;
+	}
+	Values<u8> ID;
+	Values<s16> Goal;
+	u8 n;
+	if(!ID.Parse(oID, 0, 253, 'B', "ID") || !syncCount(ID, n)){
+		return NULL;
+	}
+	//None: wait for MOVING=0 only, as Goal=NULL in C++
+	if(oGoal!=Py_None){
+		if(!Goal.Parse(oGoal, -32767, 32767, 'h', "Goal")){
+			return NULL;
+		}
+		if(Goal.Size()!=n){
+			PyErr_SetString(PyExc_ValueError, "Goal: one value per servo");
+			return NULL;
+		}
+	}
+	const s16 *goal = oGoal!=Py_None ? Goal.Data() : NULL;
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->WaitMotionComplete((u8*)ID.Data(), n, goal, Tolerance, TimeOut); }));
+}
+
+static PyObject *Bus_FeedBack(PyBus *self, PyObject *args)
+{
+	int ID;
+	if(!PyArg_ParseTuple(args, "i", &ID)){
+		return NULL;
+	}
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->FeedBack(ID); }));
+}
+
+//ReadPos() .. ReadCurrent(): ID=-1 reads the last FeedBack()
+#define READ_X(Name) \
+static PyObject *Bus_##Name(PyBus *self, PyObject *args, PyObject *kw) \
+{ \
+	static const char *kwl[] = {"ID", NULL}; \
+	int ID = -1; \
+	if(!PyArg_ParseTupleAndKeywords(args, kw, "|i", (char**)kwl, &ID)){ \
+		return NULL; \
+	} \
+	return PyLong_FromLong(onBus(self, [&](){ return self->Bus->Name(ID); })); \
+}
+READ_X(ReadPos)
+READ_X(ReadSpeed)
+READ_X(ReadLoad)
+READ_X(ReadVoltage)
+READ_X(ReadTemper)
+READ_X(ReadMove)
+READ_X(ReadCurrent)
+
+static PyObject *Bus_ClearCache(PyBus *self, PyObject *)
+{
+	onBus(self, [&](){ self->Bus->ClearCache(); });
+	Py_RETURN_NONE;
+}
+
+static PyObject *Bus_getErr(PyBus *self, PyObject *)
+{
+	return PyLong_FromLong(self->Bus->getErr());
+}
+
+static PyObject *Bus_getBaudRate(PyBus *self, PyObject *)
+{
+	return PyLong_FromLong(self->Bus->getBaudRate());
+}
+
+#define KW (PyCFunction)(void(*)(void))
+static PyMethodDef Bus_methods[] = {
+	{"begin", KW Bus_begin, METH_VARARGS|METH_KEYWORDS, "begin(baudRate, port): open a serial port, or \"sim\"/\"simfast[:ids]\" for SimulatedBus"},
+	{"end", (PyCFunction)Bus_end, METH_NOARGS, NULL},
+	{"Ping", (PyCFunction)Bus_Ping, METH_VARARGS, "Ping(ID): ID, -1 on no reply"},
+	{"Read", (PyCFunction)Bus_Read, METH_VARARGS, "Read(ID, MemAddr, nLen): register block as bytes, None on no reply"},
+	{"Write", KW Bus_Write, METH_VARARGS|METH_KEYWORDS, "Write(ID, MemAddr, data)"},
+	{"WritePosEx", KW Bus_WritePosEx, METH_VARARGS|METH_KEYWORDS, "WritePosEx(ID, Position, Speed, ACC=0)"},
+	{"WriteSpe", KW Bus_WriteSpe, METH_VARARGS|METH_KEYWORDS, "WriteSpe(ID, Speed, ACC=0)"},
+	{"WheelMode", (PyCFunction)Bus_WheelMode, METH_VARARGS, NULL},
+	{"EnableTorque", (PyCFunction)Bus_EnableTorque, METH_VARARGS, "EnableTorque(ID, Enable)"},
+	{"SyncWritePosEx", KW Bus_SyncWritePosEx, METH_VARARGS|METH_KEYWORDS, "SyncWritePosEx(ID, Position, Speed=0, ACC=0): Speed/ACC one per servo or one for all"},
+	{"SyncFeedBack", KW Bus_SyncFeedBack, METH_VARARGS|METH_KEYWORDS, "SyncFeedBack(ID, out=None): (servos answered, ServoState array); Err=1 no reply, 2 skipped by the circuit breaker"},
+	{"WaitMotionComplete", KW Bus_WaitMotionComplete, METH_VARARGS|METH_KEYWORDS, "WaitMotionComplete(ID, Goal, Tolerance, TimeOut): ms waited, -1 on timeout; Goal=None waits for MOVING=0 only"},
+	{"FeedBack", (PyCFunction)Bus_FeedBack, METH_VARARGS, NULL},
+	{"ReadPos", KW Bus_ReadPos, METH_VARARGS|METH_KEYWORDS, NULL},
+	{"ReadSpeed", KW Bus_ReadSpeed, METH_VARARGS|METH_KEYWORDS, NULL},
+	{"ReadLoad", KW Bus_ReadLoad, METH_VARARGS|METH_KEYWORDS, NULL},
+	{"ReadVoltage", KW Bus_ReadVoltage, METH_VARARGS|METH_KEYWORDS, NULL},
+	{"ReadTemper", KW Bus_ReadTemper, METH_VARARGS|METH_KEYWORDS, NULL},
+	{"ReadMove", KW Bus_ReadMove, METH_VARARGS|METH_KEYWORDS, NULL},
+	{"ReadCurrent", KW Bus_ReadCurrent, METH_VARARGS|METH_KEYWORDS, NULL},
+	{"ClearCache", (PyCFunction)Bus_ClearCache, METH_NOARGS, NULL},
+	{"getErr", (PyCFunction)Bus_getErr, METH_NOARGS, NULL},
+	{"getBaudRate", (PyCFunction)Bus_getBaudRate, METH_NOARGS, NULL},
+	{NULL, NULL, 0, NULL}
+};
+
+//settings: public members of SMS_STS, written under the Bus's mutex
+template<class T> static PyObject *getSetting(const T &Member)
+{
+	return PyLong_FromUnsignedLong((unsigned long)Member);
+}
+
+static PyObject *getSetting(const bool &Member)
+{
+	return PyBool_FromLong(Member);
+}
+
+template<class T> static int setSetting(PyBus *self, PyObject *Value, T &Member, const char *Name)
+{
+	if(!Value){
+		PyErr_Format(PyExc_AttributeError, "cannot delete %s", Name);
+		return -1;
+	}
+	unsigned long v = PyLong_AsUnsignedLong(Value);
+	if(v==(unsigned long)-1 && PyErr_Occurred()){
+		return -1;
+	}
+	if(v>(unsigned long)(T)-1){
+		PyErr_Format(PyExc_ValueError, "%s: 0..%lu", Name, (unsigned long)(T)-1);
+		return -1;
+	}
+	std::lock_guard<std::mutex> lock(*self->Lock);
+	Member = (T)v;
+	return 0;
+}
+
+static int setSetting(PyBus *self, PyObject *Value, bool &Member, const char *Name)
+{
+	int b = Value ? PyObject_IsTrue(Value) : -1;
+	if(b<0){
+		if(!Value){
+			PyErr_Format(PyExc_AttributeError, "cannot delete %s", Name);
+		}
+		return -1;
+	}
+	std::lock_guard<std::mutex> lock(*self->Lock);
+	Member = b!=0;
+	return 0;
+}
+
+#define SETTING(Name) \
+static PyObject *get_##Name(PyBus *self, void *){ return getSetting(self->Bus->Name); } \
+static int set_##Name(PyBus *self, PyObject *Value, void *){ return setSetting(self, Value, self->Bus->Name, #Name); }
+#define READONLY(Name) \
+static PyObject *get_##Name(PyBus *self, void *){ return getSetting(self->Bus->Name); }
+SETTING(IOTimeOut)
+SETTING(LowLatency)
+SETTING(AdaptiveTimeOut)
+SETTING(BreakerMisses)
+SETTING(BreakerMs)
+SETTING(Retries)
+SETTING(Level)
+SETTING(CacheUs)
+READONLY(CacheHits)
+READONLY(CacheMisses)
+
+#define GETSET(Name) {(char*)#Name, (getter)get_##Name, (setter)set_##Name, NULL, NULL}
+#define GETONLY(Name) {(char*)#Name, (getter)get_##Name, NULL, NULL, NULL}
+static PyGetSetDef Bus_getset[] = {
+	GETSET(IOTimeOut),
+	GETSET(LowLatency),
+	GETSET(AdaptiveTimeOut),
+	GETSET(BreakerMisses),
+	GETSET(BreakerMs),
+	GETSET(Retries),
+	GETSET(Level),
+	GETSET(CacheUs),
+	GETONLY(CacheHits),
+	GETONLY(CacheMisses),
+	{NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot Bus_slots[] = {
+	{Py_tp_doc, (void*)"SMS_STS servo bus"},
+	{Py_tp_new, (void*)Bus_new},
+	{Py_tp_dealloc, (void*)Bus_dealloc},
+	{Py_tp_methods, Bus_methods},
+	{Py_tp_getset, Bus_getset},
+	{0, NULL}
+};
+
+static PyType_Spec Bus_spec = {"scservo.Bus", sizeof(PyBus), 0, Py_TPFLAGS_DEFAULT, Bus_slots};
+
+static PyModuleDef scservoModule = {
+	PyModuleDef_HEAD_INIT,
+	"scservo",
+	"Feetech SMS/STS servo bus (SCServo C++ library)",
+	-1,
+	NULL, NULL, NULL, NULL, NULL
+};
+
+//ServoState as a NumPy record dtype, when NumPy is installed
+static bool makeDtype()
+{
+	PyObject *np = PyImport_ImportModule("numpy");
+	if(!np){
+		PyErr_Clear();
+		return true;
+	}
+	static const char *names[] = {"Pos", "Speed", "Load", "Voltage", "Temper", "Move", "Current", "Err"};
+	static const size_t offsets[] = {offsetof(ServoState, Pos), offsetof(ServoState, Speed), offsetof(ServoState, Load), offsetof(ServoState, Voltage),
+		offsetof(ServoState, Temper), offsetof(ServoState, Move), offsetof(ServoState, Current), offsetof(ServoState, Err)};
+	PyObject *n = PyList_New(8), *f = PyList_New(8), *o = PyList_New(8);
+	for(int i=0; i<8; i++){
+		PyList_SET_ITEM(n, i, PyUnicode_FromString(names[i]));
+		PyList_SET_ITEM(f, i, PyUnicode_FromString("=i4"));
+		PyList_SET_ITEM(o, i, PyLong_FromSize_t(offsets[i]));
+	}
+	PyObject *spec = Py_BuildValue("{sNsNsNsn}", "names", n, "formats", f, "offsets", o, "itemsize", (Py_ssize_t)sizeof(ServoState));
+	PyObject *dtypeFn = PyObject_GetAttrString(np, "dtype");
+	stateDtype = spec && dtypeFn ? PyObject_CallFunctionObjArgs(dtypeFn, spec, NULL) : NULL;
+	npZeros = PyObject_GetAttrString(np, "zeros");
+	Py_XDECREF(dtypeFn);
+	Py_XDECREF(spec);
+	Py_DECREF(np);
+	return stateDtype && npZeros;
+}
+
+PyMODINIT_FUNC PyInit_scservo(void)
+{
+	static_assert(sizeof(int)==4, "ServoState dtype assumes 32-bit int");
+	PyObject *m = PyModule_Create(&scservoModule);
+	if(!m){
+		return NULL;
+	}
+	PyObject *busType = PyType_FromSpec(&Bus_spec);
+	if(!busType || !makeDtype()){
+		Py_XDECREF(busType);
+		Py_DECREF(m);
+		return NULL;
+	}
+	PyModule_AddObject(m, "Bus", busType);
+	PyObject *dt = stateDtype ? stateDtype : Py_None;
+	Py_INCREF(dt);
+	PyModule_AddObject(m, "ServoState", dt);
+	PyModule_AddIntConstant(m, "SYNC_MAX", SMS_STS_SYNC_MAX);
+	return m;
+}
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Native Robot Controller
+RobotController on the C++ SCServo library through its Python module
+(external/SCServo_Linux_220329/SCServo_Linux/python/scservo_module.cpp)
+
+Build the module once (needs only the Python headers, python3-dev):
+    cd external/SCServo_Linux_220329/SCServo_Linux
+    cmake -S . -B build -DSCSERVO_PYTHON=ON && cmake --build build
+
+Joint positions come from one sync read of all servos and goals go out
+as one sync write, instead of a packet and a 10 ms sleep per servo. Bus
+calls release the GIL, so other threads keep running while the bus is
+busy. Per-servo reads (read_position) answer from the library's feedback
+cache, refreshed for the whole arm by one sync read once it is older than
+cache_us. The module is found on sys.path or in the library's build directory.
+
+bus_client.make_robot_controller() picks it whenever the module is built.
+"""
+
+import os
+import sys
+import time
+import numpy as np
+from robot_controller import RobotController, INST_PING, INST_WRITE
+from servo_limits_config import steps_to_degrees
+
+_BUILD_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          'external', 'SCServo_Linux_220329', 'SCServo_Linux', 'build')
+
+try:
+    import scservo
+except ImportError:
+    sys.path.append(_BUILD_DIR)
+    try:
+        import scservo
+    except ImportError:
+        scservo = None
+
+
+def native_available():
+    """True if the scservo module was built"""
+    return scservo is not None
+
+
+class NativeRobotController(RobotController):
+    """
+    RobotController backed by scservo.Bus (C++ SMS_STS)
+    Same interface; whole-arm reads and writes are single sync transactions
+    """
+
+    def __init__(self, port='/dev/ttyACM0', baudrate=1000000):
+        super().__init__(port, baudrate)
+        if scservo is None:
+            raise ImportError(f"scservo module not built (see {__file__})")
+        self.bus = scservo.Bus()
+        self.ids = np.array([config[0] for config in self.servo_config], dtype=np.uint8)
+        self.state = np.zeros(len(self.ids), dtype=scservo.ServoState)   # reused by every read
+        self.state_time = 0.0
+        self.cache_us = 20000   # max age of cached feedback
+
+    def connect(self):
+        """Open the port with low-latency receive and adaptive timeouts"""
+        self.bus.LowLatency = True
+        self.bus.AdaptiveTimeOut = True
+        self.bus.CacheUs = self.cache_us
+        if not self.bus.begin(self.baudrate, self.port):
+            print(f"✗ Connection error: cannot open {self.port}")
+            self.connected = False
+            return False
+        self.connected = True
+        print(f"✓ Connected to robot on {self.port} (native)")
+
+        answered = self.read_state()
+        online = [int(sid) for sid, err in zip(self.ids, self.state['Err']) if not err]
+        print(f"✓ Found {answered}/{self.num_servos} servos online: {online}")
+        return True
+
+    def disconnect(self):
+        if self.connected:
+            self.bus.end()
+        self.connected = False
+
+    def read_state(self):
+        """
+        One sync read of every servo into self.state
+
+        Returns:
+            Number of servos that answered. self.state is a NumPy record
+            array, fields Pos, Speed, Load, Voltage, Temper, Move, Current
+            and Err (nonzero: no reply)
+        """
+        if not self.connected:
+            return 0
+        answered, _ = self.bus.SyncFeedBack(self.ids, out=self.state)
+        self.state_time = time.monotonic()
+        return answered
+
+    def write_packet(self, servo_id, instruction, params):
+        """Raw WRITE and PING packets, for callers that build their own"""
+        if not self.connected:
+            return False
+        if instruction == INST_WRITE and params:
+            return self.bus.Write(servo_id, params[0], bytes(params[1:])) == 1
+        if instruction == INST_PING:
+            return self.bus.Ping(servo_id) >= 0
+        print(f"✗ Instruction {instruction} not supported by the native controller")
+        return False
+
+    def ping(self, servo_id):
+        return self.connected and self.bus.Ping(servo_id) >= 0
+
+    def write_position(self, servo_id, position, speed=None, acc=None):
+        if not self.connected:
+            return False
+        if speed is None:
+            speed = self.default_speed
+        if acc is None:
+            acc = self.default_acc
+        position = int(max(0, min(4095, position)))
+        speed = int(max(0, min(2400, speed)))
+        acc = int(max(0, min(254, acc)))
+        return self.bus.WritePosEx(servo_id, position, speed, acc) == 1
+
+    def write_positions(self, positions, speed=None, acc=None):
+        """All goals in one sync write (no replies, so always True when connected)"""
+        if not self.connected:
+            return False
+        if speed is None:
+            speed = self.default_speed
+        if acc is None:
+            acc = self.default_acc
+        goal = np.clip(np.asarray(positions), 0, 4095).astype(np.int16)
+        self.bus.SyncWritePosEx(self.ids, goal, int(max(0, min(2400, speed))), int(max(0, min(254, acc))))
+        return True
+
+    def read_position(self, servo_id):
+        if not self.connected:
+            return None
+        # A stale arm snapshot is refreshed as a whole, the cache then answers
+        # the other joints' reads too
+        if servo_id in self.ids and (time.monotonic() - self.state_time) * 1e6 > self.cache_us:
+            self.read_state()
+        pos = self.bus.ReadPos(servo_id)
+        return None if pos < 0 else pos
+
+    def get_joint_positions_degrees(self, retries=3):
+        """All joints from one sync read, re-reading only while a servo misses"""
+        for attempt in range(retries):
+            if self.read_state() == self.num_servos:
+                return [steps_to_degrees(int(p)) for p in self.state['Pos']]
+            time.sleep(0.01)
+        missing = [int(sid) for sid, err in zip(self.ids, self.state['Err']) if err]
+        print(f"⚠ Warning: servos {missing} did not answer after {retries} attempts")
+        return None
+
+
+if __name__ == '__main__':
+    port = sys.argv[1] if len(sys.argv) > 1 else '/dev/ttyACM0'
+    robot = NativeRobotController(port)
+    if not robot.connect():
+        sys.exit(1)
+    print("Reading all joints (Ctrl+C to stop)...")
+    try:
+        while True:
+            t0 = time.perf_counter()
+            robot.read_state()
+            dt_us = (time.perf_counter() - t0) * 1e6
+            joints = " ".join(f"{int(sid)}:{int(s['Pos']) if not s['Err'] else '--'}"
+                              for sid, s in zip(robot.ids, robot.state))
+            print(f"\r[{dt_us:.0f}us] {joints}    ", end='', flush=True)
+            time.sleep(0.1)
+    except KeyboardInterrupt:
+        print()
+    robot.disconnect()
@@ -185,6 +185,14 @@ class RobotController:
                 return position
         return None
     
+    def write_positions(self, positions, speed=None, acc=None):
+        """Goal positions (steps) for all servos, in servo_config order"""
+        success = True
+        for i, (servo_id, _, _, _, _) in enumerate(self.servo_config):
+            if not self.write_position(servo_id, positions[i], speed, acc):
+                success = False
+        return success
+    
     def get_joint_positions_degrees(self, retries=3):
         """
         Read all joint positions in degrees with retry logic
@@ -298,10 +306,7 @@ class RobotController:
             target_steps.append(steps)
         
         # Send commands to all servos
-        success = True
-        for i, (servo_id, _, _, _, _) in enumerate(self.servo_config):
-            if not self.write_position(servo_id, target_steps[i], speed, acc):
-                success = False
+        success = self.write_positions(target_steps, speed, acc)
         
         # Update current positions if successful
         if success: